@@ -0,0 +1,100 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   AccessUnitAssembler
+    \brief       Group NAL units into access units following the first-NAL-unit rules of H264/AVC (7.4.1.2.3), H265/HEVC (7.4.2.4.4) and H266/VVC (7.4.2.4.3)
+    \warning     Exact picture boundaries need parsingLevel::PARSING_SLICE_PREFIX, below it a slice is taken as a new picture
+                 when non-VCL NAL units which may open an access unit precede it
+ */
+
+#include "nal_parse.h"
+#include "nal_poc.h"
+
+#include <vector>
+
+struct au_nal
+{
+  int64_t offset; // Byte position of the NAL unit, start code included
+  uint32_t size;  // Size in bytes, start code included
+  int nalUnitType;
+};
+
+struct access_unit
+{
+  uint64_t index;
+  int64_t offset; // Byte position of the first NAL unit
+  uint64_t size;  // Sum of the NAL unit sizes
+  std::vector<au_nal> nals;
+
+  int firstVclNalUnitType;
+  bool irap; // IDR (H264), IRAP picture (H265, H266)
+  bool key;  // IRAP, GDR picture or picture with recovery point SEI : decoding can start here
+  sliceType picType; // SLICE_B if any B slice, else SLICE_P if any P slice, SLICE_I for intra pictures
+  int temporalId; // TemporalId of the first picture
+  bool reference; // First picture may be used for reference : nal_ref_idc (H264), not a sub-layer non-reference picture (H265), ph_non_ref_pic_flag (H266)
+  bool pocValid;
+  int32_t poc; // Picture order count of the first picture, with parsingLevel::PARSING_SLICE_PREFIX
+  int64_t pts; // Time stamps set by the demuxer (90 kHz clock of MPEG-2 TS), -1 when the container gives none
+  int64_t dts;
+};
+
+class AccessUnitAssembler
+{
+public:
+  AccessUnitAssembler(videoCodecType codecType, parsingLevel level);
+  virtual ~AccessUnitAssembler();
+
+public:
+  /**
+   * \brief Streaming mode : feed the NAL unit just parsed by NALParse::nal_parse()
+   * \param nal         NAL information filled by NALParse with the level given to the constructor
+   * \param offset      Byte position of the NAL unit (start code included)
+   * \param size        Size of the NAL unit in bytes (start code included)
+   * \return            true when an access unit was completed, it is available with au() until the next call
+   *                    Memory is bounded by the NAL units of the access unit in progress
+   */
+  bool push(const nal_info &nal, int64_t offset, uint32_t size);
+
+  /**
+   * \brief Complete the last access unit at the end of the stream, returns false if there is none
+   */
+  bool flush();
+
+  /**
+   * \brief Whole-buffer mode : parse an Annex-B byte stream and append all its access units to 'aus'
+   */
+  void assemble(unsigned char *buffer, int size, std::vector<access_unit> &aus);
+
+  const access_unit &au() const { return m_completed; }
+  void clear();
+
+private:
+  bool isReference(const nal_info &nal) const;
+  bool startsPicture(const nal_info &nal) const;
+  bool h264NewPicture(const nal_info &nal) const;
+
+  void append(const au_nal &entry);
+  void startPicture(const nal_info &nal);
+  void addSlice(const nal_info &nal);
+  bool finish();
+
+private:
+  videoCodecType m_codecType;
+  bool m_slicePrefix; // Slice header prefixes are available (parsingLevel::PARSING_SLICE_PREFIX)
+  PocCalculator m_poc;
+  uint64_t m_auCount;
+
+  access_unit m_cur;
+  access_unit m_completed;
+  bool m_curHasVcl;
+  bool m_curRecoveryPoint;
+
+  std::vector<au_nal> m_pending; // Non-VCL NAL units after the last VCL NAL unit, they open the next access unit or belong to the next slice
+  bool m_pendingRecoveryPoint;
+  bool m_pendingPictureHeader; // H266/VVC picture header NAL unit among the pending ones
+  int m_pendingPictureHeaderLayerId;
+
+  int m_lastPictureLayerId;
+  int m_lastVclNalUnitType;
+  slice_prefix m_lastSlice; // First slice of the current picture, for the H264/AVC picture boundary comparison
+};
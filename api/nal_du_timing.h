@@ -0,0 +1,79 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   DuTimingCalculator
+    \brief       Nominal CPB removal times of decoding units (H265/HEVC, H266/VVC) from buffering period, picture timing
+                 and decoding unit information SEI with the sub-picture HRD parameters, reported for every NAL unit
+    \warning     SEI messages are only interpreted with parsingLevel::PARSING_FULL
+                 Feed every NAL unit in decoding order, the timeline starts at the first buffering period
+ */
+
+#include "nal_parse.h"
+
+#include <vector>
+
+struct du_timing
+{
+  uint64_t auIndex;          // Access unit count since the first buffering period
+  uint32_t duIndex;          // Decoding unit of the access unit the NAL unit belongs to
+  uint32_t numDecodingUnits; // Signalled in picture timing SEI, 0 when decoding unit information SEI is used
+  double auRemovalTime;      // Nominal CPB removal time of the access unit in seconds (< 0 when unknown)
+  double duRemovalTime;      // Nominal CPB removal time of the decoding unit in seconds (< 0 when not signalled yet)
+};
+
+class DuTimingCalculator
+{
+public:
+  DuTimingCalculator(videoCodecType codecType);
+  virtual ~DuTimingCalculator();
+
+public:
+  /**
+   * \brief Feed the NAL unit just parsed by NALParse::nal_parse()
+   * \return Decoding unit and removal times the NAL unit belongs to
+   *         NAL units preceding the decoding unit information SEI of their decoding unit report duRemovalTime < 0,
+   *         they are released together with the decoding unit that follows
+   */
+  const du_timing &push(const nal_info &nal);
+
+  /**
+   * \brief Force an access unit boundary before the next NAL unit, for callers which know it from the container or transport
+   *        (otherwise boundaries are taken from access unit delimiters and buffering period / picture timing SEI)
+   */
+  void startAccessUnit() { m_forceNewAu = true; }
+
+  bool subPicHrd() const { return m_subPicHrd; } // Sub-picture HRD parameters are present in the active SPS / buffering period
+  double clockSubTick() const { return m_clockSubTick; }
+  void clear();
+
+private:
+  bool opensAccessUnit(const nal_info &nal) const;
+  bool updateHrd(const nal_info &nal);
+  void onBufferingPeriod(const nal_info &nal);
+  void onPictureTiming(const nal_info &nal);
+  void onDecodingUnitInfo(const nal_info &nal);
+  void newAccessUnit();
+
+private:
+  videoCodecType m_codecType;
+
+  double m_clockTick;    // num_units_in_tick / time_scale
+  double m_clockSubTick; // ClockTick / (tick_divisor_minus2 + 2)
+  bool m_subPicHrd;
+  bool m_duParamsInPicTiming; // sub_pic_cpb_params_in_pic_timing_sei_flag (H265) or bp_du_cpb_params_in_pic_timing_sei_flag (H266)
+  uint32_t m_htid;            // Sub-layer whose delays are used (target_temporal_id, or the highest one)
+
+  bool m_forceNewAu;
+  bool m_vclInAu;
+  bool m_bpInAu;
+  bool m_started;           // A buffering period anchored the timeline
+  double m_bpRemovalTime;   // Nominal removal time of the first access unit of the current buffering period
+  double m_prevAuRemovalTime;
+  double m_bpInitialRemovalTime; // InitCpbRemovalDelay / 90000 of the buffering period of the current access unit
+
+  uint32_t m_nalCountInAu;
+  std::vector<double> m_duRemovalTimes; // Decoding unit schedule of the picture timing SEI
+  std::vector<uint32_t> m_duLastNal;    // Index in the access unit of the last NAL unit of each decoding unit
+
+  du_timing m_cur;
+};
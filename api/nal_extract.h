@@ -0,0 +1,54 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   SubLayerExtractor
+    \brief       Temporal sub-layer extraction : NAL units with a TemporalId above the target are dropped and the kept ones are
+                 returned as scatter / gather vectors pointing into the input buffer, without copying any payload
+    \warning     POSIX only (struct iovec, writev). The input buffer must outlive the vectors
+                 Parameter sets are forwarded unchanged : the sub-bitstream of a lower TemporalId conforms without rewriting
+                 sps_max_sub_layers_minus1 (H265 10, H266 C.6), decoders bound the sub-layer dependent arrays by the highest
+                 TemporalId actually present
+                 H264/AVC carries a TemporalId only with SVC prefix (14) and slice extension (20) NAL units, other NAL units
+                 are in sub-layer 0
+ */
+
+#include "nal_filter.h"
+#include "nal_parse.h"
+
+class SubLayerExtractor : public NalFilter
+{
+public:
+  SubLayerExtractor(videoCodecType codecType, int targetTemporalId);
+  virtual ~SubLayerExtractor();
+
+public:
+  /**
+   * \brief Streaming mode : decide for the NAL unit just parsed by NALParse::nal_parse() (any parsing level)
+   * \param data        First byte of the NAL unit in the caller's buffer, start code included
+   * \param size        Size of the NAL unit in bytes, start code included
+   * \param iov         Vectors of the kept bytes, contiguous NAL units are merged into one vector
+   * \return            true when the NAL unit is kept
+   */
+  bool push(const nal_info &nal, const unsigned char *data, size_t size, std::vector<struct iovec> &iov);
+
+  /**
+   * \brief Whole-buffer mode : only start codes and NAL unit headers are read, nothing is unescaped or parsed
+   *        Bytes before the first start code are kept as they are
+   */
+  void extract(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov);
+
+  void clear();
+
+protected:
+  bool filter(const unsigned char *data, size_t size, const unsigned char *header, size_t headerSize);
+
+private:
+  int temporalId(int nalUnitType, const unsigned char *header, size_t size);
+  int headerNalUnitType(const unsigned char *header, size_t size) const;
+  bool isKept(int temporalId) const;
+
+private:
+  videoCodecType m_codecType;
+  int m_targetTemporalId;
+  int m_h264PrefixTemporalId; // TemporalId of the SVC prefix NAL unit, applies to the next base layer slice
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   MappedFile
+    \brief       Whole file in memory for the readers which address it at random (StreamSampler, Mp4Reader, PcapRtpReader,
+                 RandomAccessIndex::load()) : memory-mapped when built with sys/mman.h (HAVE_SYS_MMAN_H), read into a heap
+                 buffer otherwise, followed by zero bytes in both cases
+    \warning     POSIX only. Without mmap open() reads the whole file, the pages never touched are read anyway
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class fileAccess
+{
+  ACCESS_RANDOM = 0,
+  ACCESS_SEQUENTIAL
+};
+
+class MappedFile
+{
+public:
+  MappedFile();
+  virtual ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+  /**
+   * \param padding          Zero bytes readable after the file (rounded up to a page when mapped), 0 for none
+   * \param access           Access pattern hint of the mapping (madvise)
+   * \return                 false if the file cannot be read or is empty
+   */
+  bool open(const char *path, size_t padding = 0, fileAccess access = fileAccess::ACCESS_RANDOM);
+  void close();
+
+  uint8_t *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  uint8_t *m_data;
+  size_t m_size;
+  size_t m_mapSize; // 0 when the file is in m_buffer
+  std::vector<uint8_t> m_buffer;
+};
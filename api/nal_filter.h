@@ -0,0 +1,65 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   NalFilter
+    \brief       Base of the sub-bitstream extractors : splits an Annex B buffer at its start codes, asks the derived class
+                 whether each NAL unit is kept and returns the kept bytes as scatter / gather vectors pointing into the input
+                 buffer, without copying any payload
+    \warning     POSIX only (struct iovec, writev). The input buffer must outlive the vectors
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/uio.h>
+
+class NalFilter
+{
+public:
+  NalFilter();
+  virtual ~NalFilter();
+
+public:
+  /**
+   * \brief Write the vectors with writev(), in IOV_MAX sized batches and resuming partial writes
+   * \return false on a write error
+   */
+  static bool write(int fd, const std::vector<struct iovec> &iov);
+
+  uint64_t keptNals() const { return m_keptNals; }
+  uint64_t droppedNals() const { return m_droppedNals; }
+  uint64_t droppedBytes() const { return m_droppedBytes; }
+
+protected:
+  /**
+   * \brief Decide for one NAL unit of scan()
+   * \param data        First byte of the NAL unit, start code included
+   * \param size        Size of the NAL unit in bytes, start code included
+   * \param header      First byte of the NAL unit header
+   * \param headerSize  Bytes from the NAL unit header to the end of the NAL unit, 0 for an empty NAL unit
+   * \return            true when the NAL unit is kept
+   */
+  virtual bool filter(const unsigned char *data, size_t size, const unsigned char *header, size_t headerSize) = 0;
+
+  /**
+   * \brief Split the buffer into NAL units ending where the next start code (with its zero_byte) begins, as
+   *        NALParse::FindNextNal(), and keep the ones filter() accepts. Bytes before the first start code
+   *        (leading_zero_8bits) are kept as they are, they are not a NAL unit
+   */
+  void scan(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov);
+
+  /**
+   * \brief Count the NAL unit and add it to the vectors when kept, contiguous NAL units are merged into one vector
+   * \return kept
+   */
+  bool keep(bool kept, const unsigned char *data, size_t size, std::vector<struct iovec> &iov);
+  void clearCounters();
+
+private:
+  static void append(const unsigned char *data, size_t size, std::vector<struct iovec> &iov);
+
+private:
+  uint64_t m_keptNals;
+  uint64_t m_droppedNals;
+  uint64_t m_droppedBytes;
+};
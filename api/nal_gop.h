@@ -0,0 +1,97 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   GopAnalyzer
+    \brief       Per-GOP statistics (length, open / closed GOP, picture types, B-pyramid, reorder depth against the SPS limits,
+                 temporal sub-layer usage) computed online from access units, without decoding
+    \warning     Picture types and output order need parsingLevel::PARSING_SLICE_PREFIX
+                 A GOP starts at every IRAP, GDR or recovery point access unit, access units before the first one form a GOP
+                 with keyNalUnitType equal to -1
+                 The reorder depth restarts at IDR and BLA pictures, and at CRA / GDR pictures following an end of sequence NAL unit.
+                 H264 memory_management_control_operation 5 is not detected (dec_ref_pic_marking() is beyond the slice prefix),
+                 neither is a CRA / GDR picture starting a sequence with HandleCraAsClvsStartFlag set by external means
+ */
+
+#include "nal_parse.h"
+#include "nal_au.h"
+
+struct gop_stats
+{
+  uint64_t index;
+  uint64_t firstAu; // Decode order number of the first access unit
+  int64_t offset;   // Byte position of the first access unit
+  uint64_t size;    // Bytes of all access units of the GOP
+  uint32_t numPictures;
+  int keyNalUnitType; // NAL unit type of the random access picture starting the GOP, -1 when there is none
+  bool closed;        // No leading picture may reference the previous GOP (no RASL picture, or no leading picture after a H264 non-IDR key picture)
+
+  uint32_t numLeading; // Pictures following the key picture in decoding order and preceding it in output order
+  uint32_t numI;
+  uint32_t numP;
+  uint32_t numB;
+  uint32_t numUnknown;    // Slice type not parsed
+  uint32_t numReferenceB; // B pictures used for reference, non-zero for a B-pyramid
+  uint32_t maxBRun;       // Longest run of consecutive B pictures in decoding order
+
+  uint32_t maxReorder;       // Largest number of pictures preceding a picture in decoding order and following it in output order
+  int spsMaxReorder;         // num_reorder_frames (H264), max_num_reorder_pics of the highest sub-layer (H265, H266), -1 when not signalled
+  int spsMaxDecPicBuffering; // max_dec_frame_buffering (H264), max_dec_pic_buffering_minus1 + 1 of the highest sub-layer (H265, H266), -1 when not signalled
+  bool reorderExceeded;      // maxReorder above spsMaxReorder
+
+  int maxTemporalId;
+  uint32_t picturesPerTemporalId[MAX_TLAYER];
+};
+
+class GopAnalyzer
+{
+public:
+  GopAnalyzer(videoCodecType codecType);
+  virtual ~GopAnalyzer();
+
+public:
+  /**
+   * \brief Feed the NAL unit just parsed by NALParse::nal_parse() with parsingLevel::PARSING_SLICE_PREFIX
+   * \param offset      Byte position of the NAL unit (start code included)
+   * \param size        Size of the NAL unit in bytes (start code included)
+   * \return            true when a GOP was completed, its statistics are available with gop() until the next call
+   */
+  bool push(const nal_info &nal, int64_t offset, uint32_t size);
+
+  /**
+   * \brief Complete the pending GOPs at the end of the stream, call until it returns false
+   */
+  bool flush();
+
+  const gop_stats &gop() const { return m_completed; }
+  void clear();
+
+private:
+  bool isPocReset(int nalUnitType, bool newSequence) const;
+  bool isRasl(int nalUnitType) const;
+  bool isIdr(int nalUnitType) const;
+  void updateSpsLimits(const nal_info &nal);
+  bool addAccessUnit(const access_unit &au);
+  bool finishGop();
+
+private:
+  static const int REORDER_WINDOW = 32; // Pictures kept for the reorder depth, above the largest DPB size of the three standards
+
+  videoCodecType m_codecType;
+  AccessUnitAssembler m_assembler;
+  uint64_t m_gopCount;
+
+  gop_stats m_cur;
+  gop_stats m_completed;
+  uint32_t m_numRasl;
+  uint32_t m_bRun;
+  bool m_keyPocValid;
+  int32_t m_keyPoc;
+
+  int32_t m_pocWindow[REORDER_WINDOW]; // POC of the last pictures in decoding order, reset at each POC reset
+  uint32_t m_pocWindowSize;
+  uint32_t m_pocWindowPos;
+  bool m_afterEndOfSequence; // The last access unit ended with an end of sequence NAL unit
+
+  int m_spsMaxReorder;
+  int m_spsMaxDecPicBuffering;
+};
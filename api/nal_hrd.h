@@ -0,0 +1,133 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   CpbAnalyzer
+    \brief       Hypothetical reference decoder CPB occupancy check : the access units are fed into the coded picture buffer of
+                 every SchedSelIdx of the active SPS (H264 C.1, H265 C.2, H266 C.2) and removed at their nominal removal time,
+                 counting overflows, underflows, the peak fullness and the peak bitrate over a sliding window
+    \warning     Feed NAL units parsed with parsingLevel::PARSING_SLICE_PREFIX in decoding order (SPS and SEI must be parsed)
+                 Removal times come from buffering period and picture timing SEI, without them from the picture rate of the
+                 timing information, the first removal from initial_cpb_removal_delay or else CpbSize / BitRate (full buffer)
+                 NAL HRD parameters are used when present (all NAL unit bytes counted), else VCL HRD parameters (VCL and filler data bytes only)
+                 Low delay HRD big pictures are reported as underflows, splicing is reduced to au_cpb_removal_delay_delta
+                 The peak bitrate needs the timing information of the SPS (VUI for H264 / H265, general HRD parameters for H266)
+ */
+
+#include "nal_parse.h"
+#include "nal_au.h"
+
+#include <vector>
+
+struct cpb_schedule
+{
+  uint32_t schedSelIdx;
+  double bitRate;      // BitRate[ SchedSelIdx ] in bits per second
+  double cpbSize;      // CpbSize[ SchedSelIdx ] in bits
+  bool cbr;            // cbr_flag : the CPB is fed at BitRate without interruption
+  double initialDelay; // Removal time of the first access unit in seconds
+
+  uint64_t numAccessUnits; // Access units removed from the CPB
+  double fullness;         // Bits in the CPB just before the last removal
+  double peakFullness;     // Largest fullness just before a removal
+  double headroom;         // CpbSize - peakFullness, negative after an overflow
+  double minArrivalMargin; // Smallest (removal time - final arrival time) in seconds, negative after an underflow
+  uint64_t overflows;      // Removals at which the CPB held more than CpbSize bits
+  uint64_t underflows;     // Access units not completely in the CPB at their removal time
+};
+
+class CpbAnalyzer
+{
+public:
+  /**
+   * \param windowSeconds    Length of the sliding window of the peak bitrate
+   */
+  CpbAnalyzer(videoCodecType codecType, double windowSeconds = 1.0);
+  virtual ~CpbAnalyzer();
+
+public:
+  /**
+   * \brief Feed the NAL unit just parsed by NALParse::nal_parse() with parsingLevel::PARSING_SLICE_PREFIX
+   * \param offset      Byte position of the NAL unit (start code included)
+   * \param size        Size of the NAL unit in bytes (start code included)
+   * \return            true when an access unit was added to the simulation
+   *                    The cost per access unit is constant per schedule, memory is bounded by the access units in the CPB
+   */
+  bool push(const nal_info &nal, int64_t offset, uint32_t size);
+
+  /**
+   * \brief Add the last access unit and remove every access unit still in the CPB, at the end of the stream
+   */
+  void flush();
+
+  bool hrdValid() const { return !m_schedules.empty(); } // The active SPS signals timing and HRD parameters
+  size_t numSchedules() const { return m_schedules.size(); }
+  const cpb_schedule &schedule(size_t i) const { return m_schedules[i]; }
+  uint64_t numAccessUnits() const { return m_auCount; }
+  double windowBitrate() const { return m_windowBitrate; } // Bits per second of the window ending at the last access unit
+  double peakBitrate() const { return m_peakBitrate; }
+  void clear();
+
+private:
+  struct cpb_entry
+  {
+    double removalTime; // Relative to the first access unit
+    double bits;
+  };
+
+  struct timing_sei
+  {
+    bool bp;
+    bool pt;
+    uint32_t cpbRemovalDelay;
+    bool concatenation;
+    uint32_t cpbRemovalDelayDelta;
+    double initialDelay[MAX_CPB_CNT];
+    double initialOffset[MAX_CPB_CNT];
+  };
+
+  struct schedule_state
+  {
+    size_t head;           // First entry of m_pending not removed yet
+    double arrivedBits;    // Bits of the access units fed so far
+    double removedBits;
+    double lastBits;       // Bits of the last access unit fed
+    double finalArrival;   // Final arrival time of the last access unit
+    double bpInitialDelay; // initial_cpb_removal_delay of the current buffering period in seconds
+    double bpInitialOffset;
+  };
+
+  void updateHrd(const nal_info &nal);
+  void onSei(const nal_info &nal);
+  static void resetSei(timing_sei &sei);
+  void addAccessUnit(const access_unit &au);
+  void removeUntil(size_t s, double time, bool flushAll);
+  void compact();
+
+private:
+  videoCodecType m_codecType;
+  double m_windowSeconds;
+  AccessUnitAssembler m_assembler;
+
+  // Active HRD
+  bool m_nalHrd;
+  double m_clockTick;
+  double m_picDuration; // Removal interval when picture timing SEI is absent
+  std::vector<cpb_schedule> m_schedules;
+  std::vector<schedule_state> m_states;
+
+  // Timing SEI received since the last VCL NAL unit, they belong to the access unit of the next VCL NAL unit
+  timing_sei m_pendingSei;
+  // Timing SEI of the access unit in progress
+  timing_sei m_auSei;
+
+  // Removal timeline
+  uint64_t m_auCount;
+  double m_bpRemovalTime;
+  double m_prevRemovalTime;
+
+  std::vector<cpb_entry> m_pending; // Access units fed and not removed by every schedule, then the sliding window
+  size_t m_windowHead;              // First entry of m_pending in the bitrate window
+  double m_windowBits;
+  double m_windowBitrate;
+  double m_peakBitrate;
+};
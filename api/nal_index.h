@@ -0,0 +1,144 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   RandomAccessIndex
+    \brief       Random access index of an Annex-B byte stream : IRAP, GDR and recovery point access units with their
+                 decode order number, slice header POC / frame number and the parameter sets in effect, stored in a
+                 compact sidecar file which is memory-mapped for lookups (read whole without sys/mman.h)
+    \warning     POSIX only (pread, MappedFile). The sidecar uses the native byte order and is rebuilt when the version changes
+                 Slice prefixes of access units whose SPS / PPS was not received before them are missing (pocLsb and frameNum
+                 equal to -1)
+ */
+
+#include "nal_file.h"
+#include "nal_parse.h"
+#include "nal_au.h"
+#include "nal_rap.h"
+
+#include <vector>
+
+// Sidecar layout : rai_header, rai_entry[numEntries], rai_param_set[numParamSets], uint32_t refs[numRefs]
+struct rai_header
+{
+  char magic[8];
+  uint32_t version;
+  int32_t codecType;
+  uint64_t indexedSize; // Bytes of the stream covered by the index, an incremental update resumes here
+  uint64_t auCount;     // Access units before indexedSize
+  uint64_t streamHash;  // FNV-1a of the first bytes of the stream, to detect a replaced stream
+  uint32_t numEntries;
+  uint32_t numParamSets;
+  uint32_t numRefs;
+  uint32_t numUnitsInTick; // Timing of the SPS, 0 when not signalled
+  uint32_t timeScale;
+  uint32_t ticksPerFrame; // 2 for H264/AVC (field based clock ticks), 1 otherwise
+};
+
+struct rai_entry
+{
+  uint64_t offset;  // Byte position of the first NAL unit of the access unit (start code included)
+  uint64_t auIndex; // Decode order number of the access unit
+  int32_t pocLsb;   // Slice header pic_order_cnt_lsb of the first slice, -1 when unknown or not signalled
+  int32_t frameNum; // frame_num (H264), -1 otherwise
+  uint16_t nalUnitType;
+  uint8_t type; // rapType
+  uint8_t reserved;
+  uint32_t paramSetFirst; // First index in the reference table
+  uint32_t paramSetCount; // Parameter sets in effect at the end of the access unit, in decoding order
+  uint32_t reserved2;
+};
+
+enum class raiParamSetKind
+{
+  RAI_VPS = 0,
+  RAI_SPS,
+  RAI_PPS,
+  RAI_APS // H266/VVC, id is (aps_params_type << 8) | adaptation_parameter_set_id
+};
+
+struct rai_param_set
+{
+  uint64_t offset; // Byte position of the NAL unit (start code included)
+  uint32_t size;   // Size in bytes, start code included
+  uint8_t kind;    // raiParamSetKind
+  uint8_t reserved;
+  uint16_t id;
+};
+
+struct rai_seek
+{
+  rai_entry point;
+  std::vector<rai_param_set> paramSets; // To be fed to the decoder before 'point.offset', in decoding order
+};
+
+class RandomAccessIndex
+{
+public:
+  RandomAccessIndex();
+  virtual ~RandomAccessIndex();
+
+public:
+  /**
+   * \brief Index the whole stream
+   * \param codecType        UNDEFINED to detect the codec from the head of the stream (see DetectCodec())
+   * \return false if the stream cannot be read or its codec is not detected
+   */
+  bool build(const char *streamPath, videoCodecType codecType);
+
+  /**
+   * \brief Extend a built or loaded index to the current size of a stream which is still growing
+   *        Only the bytes after indexedSize are scanned, the index is rebuilt when the stream was truncated or replaced
+   */
+  bool update(const char *streamPath);
+
+  bool save(const char *indexPath) const;
+  bool load(const char *indexPath); // Memory-mapped, valid until clear(), update() or the destruction of the index
+
+  /**
+   * \brief Last random access point at or before the access unit 'auIndex' (decode order)
+   * \return false if there is none
+   */
+  bool seekFrame(uint64_t auIndex, rai_seek &out) const;
+
+  /**
+   * \brief Last random access point at or before 'seconds', access units are spaced by the SPS frame duration
+   *        unless 'frameRate' is given
+   */
+  bool seekTime(double seconds, rai_seek &out, double frameRate = 0) const;
+
+  size_t size() const { return m_numEntries; }
+  const rai_entry &entry(size_t i) const { return m_entryData[i]; }
+  const rai_header &header() const { return m_header; }
+  void clear();
+
+private:
+  bool scan(int fd, uint64_t streamSize);
+  void prime(int fd, NALParse &parser);
+  void detach();
+  void unmap();
+  void setViews();
+  int paramSetKind(int nalUnitType) const;
+  uint16_t paramSetId(const nal_info &nal, int kind) const;
+  void updateTiming(const nal_info &nal);
+  void activateParamSets(uint64_t end);
+  void addEntry(const access_unit &au, rapType type, const slice_prefix &slice, uint64_t auBase);
+
+private:
+  rai_header m_header;
+
+  std::vector<rai_entry> m_entries;
+  std::vector<rai_param_set> m_paramSets;
+  std::vector<uint32_t> m_refs;
+
+  // Views on the vectors, or on the mapped sidecar after load()
+  const rai_entry *m_entryData;
+  const rai_param_set *m_paramSetData;
+  const uint32_t *m_refData;
+  size_t m_numEntries;
+
+  MappedFile m_file; // Sidecar after load()
+
+  // Parameter sets in effect while building : key (kind << 16 | id) to index in m_paramSets
+  std::vector<std::pair<uint32_t, uint32_t>> m_active;
+  size_t m_paramSetCursor;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   Mp4Reader
+    \brief       ISO base media file (MP4) front end : the sample tables of the first H264 / H265 / H266 video track (moov, or
+                 moof of a fragmented file) are indexed, the parameter sets of its decoder configuration record (avcC, hvcC,
+                 vvcC) are parsed first and the samples are then split at their length prefixes into NAL units
+    \warning     POSIX only. Only the boxes are read while indexing : top-level boxes are skipped by their size, so the
+                 pages of mdat are touched only when a sample is read (built without sys/mman.h the whole file is read by
+                 open(), see MappedFile)
+                 Encrypted sample entries and edit lists are not interpreted, a track fragment whose data follows the one of
+                 another track (no base_data_offset, no default-base-is-moof) is skipped
+ */
+
+#include "nal_file.h"
+#include "nal_parse.h"
+
+#include <map>
+#include <vector>
+
+struct mp4_sample
+{
+  uint64_t offset; // Byte position in the file
+  uint32_t size;
+  int64_t dts;     // Decoding time in units of timescale()
+  int64_t pts;     // Composition time, dts plus the composition offset
+  bool sync;
+};
+
+class Mp4Reader
+{
+public:
+  Mp4Reader(parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX);
+  virtual ~Mp4Reader();
+
+public:
+  /**
+   * \brief Map the file, index the samples of the first video track and parse its decoder configuration record
+   * \return false if the file cannot be mapped or has no H264 / H265 / H266 track
+   */
+  bool open(const char *path);
+  void close();
+
+  size_t numSamples() const { return m_samples.size(); }
+  const mp4_sample &sample(size_t index) const { return m_samples[index]; }
+  const std::vector<mp4_sample> &samples() const { return m_samples; }
+
+  /**
+   * \brief Split a sample at its length prefixes, the NAL units point into the mapped file
+   * \return false if a length prefix runs past the sample
+   */
+  bool sampleNals(size_t index, std::vector<nal_buffer> &nals) const;
+
+  /**
+   * \brief Parse the NAL units of a sample with NALParse::nal_parse_batch(), after the parameter sets of the track
+   * \param results          One entry per NAL unit, may be NULL
+   * \return                 Number of NAL units parsed
+   */
+  size_t parseSample(size_t index, std::vector<nal_result> *results = NULL);
+
+  videoCodecType codecType() const { return m_codecType; }
+  uint32_t trackId() const { return m_trackId; }
+  uint32_t timescale() const { return m_timescale; }
+  uint32_t width() const { return m_width; }   // Of the sample entry
+  uint32_t height() const { return m_height; }
+  int lengthSize() const { return m_lengthSize; } // Bytes of the NAL unit length prefixes
+  bool fragmented() const { return m_fragmented; }
+  const std::vector<nal_buffer> &parameterSets() const { return m_paramSets; } // NAL units of the decoder configuration record
+  const nal_info &nal() const { return *m_parser.nal; }
+
+private:
+  struct mp4_box
+  {
+    uint32_t type;
+    const uint8_t *data; // Payload, after the box header
+    uint64_t size;
+  };
+
+  struct track_defaults
+  {
+    uint32_t sampleDuration;
+    uint32_t sampleSize;
+    uint32_t sampleFlags;
+  };
+
+  static bool NextBox(const uint8_t *&pos, const uint8_t *end, mp4_box &box);
+  static bool FindBox(const uint8_t *data, uint64_t size, uint32_t type, mp4_box &box);
+
+  void parseMoov(const mp4_box &moov);
+  bool parseTrak(const mp4_box &trak);
+  bool parseSampleEntry(const mp4_box &stsd);
+  bool parseAvcC(const uint8_t *data, uint64_t size);
+  bool parseHvcC(const uint8_t *data, uint64_t size);
+  bool parseVvcC(const uint8_t *data, uint64_t size);
+  bool addParamSet(const uint8_t *data, uint64_t size, const uint8_t *end);
+  bool parseSampleTable(const mp4_box &stbl);
+  void parseMoof(const mp4_box &moof, uint64_t moofOffset);
+
+private:
+  parsingLevel m_level;
+  NALParse m_parser;
+
+  MappedFile m_file; // With a trailing zero page : the parsers may read a few bytes past a NAL unit
+  uint8_t *m_data;
+  uint64_t m_size;
+
+  videoCodecType m_codecType;
+  uint32_t m_trackId;
+  uint32_t m_timescale;
+  uint32_t m_width;
+  uint32_t m_height;
+  int m_lengthSize;
+  bool m_fragmented;
+  std::vector<nal_buffer> m_paramSets;
+  std::map<uint32_t, track_defaults> m_trex; // Of the movie extends box, by track_ID
+  int64_t m_fragmentTime;                    // Decoding time following the last track fragment
+
+  std::vector<mp4_sample> m_samples;
+  std::vector<nal_buffer> m_nals;
+};
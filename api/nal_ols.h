@@ -0,0 +1,79 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   OlsExtractor
+    \brief       H266/VVC output layer set sub-bitstream extraction (C.6) : NAL units of the layers outside the target OLS,
+                 above the target TemporalId or above the sub-layers the OLS needs from a reference layer are dropped, and the
+                 kept ones are returned as scatter / gather vectors pointing into the input buffer, without copying any payload
+    \warning     POSIX only (struct iovec, writev). The input buffer must outlive the vectors
+                 The layer set comes from the last VPS, before it (or when sps_video_parameter_set_id is 0) the bitstream
+                 has a single layer and only the TemporalId is checked
+                 A GDR picture of a reference layer above the sub-layers the OLS needs is kept only when its
+                 ph_recovery_poc_cnt is 0, and when the picture header could not be parsed
+                 DCI, OPI and SEI NAL units are forwarded unchanged : opi_ols_idx and scalable nesting SEI messages are not rewritten
+ */
+
+#include "nal_filter.h"
+#include "nal_parse.h"
+
+class OlsExtractor : public NalFilter
+{
+public:
+  /**
+   * \param targetOlsIdx       Index of the output layer set, in the range of 0 to TotalNumOlss - 1 of the VPS
+   * \param targetTemporalId   Highest TemporalId kept, -1 to keep every sub-layer
+   */
+  OlsExtractor(int targetOlsIdx, int targetTemporalId);
+  virtual ~OlsExtractor();
+
+public:
+  /**
+   * \brief Streaming mode : decide for the NAL unit just parsed by NALParse::nal_parse() (any parsing level, the
+   *        ph_recovery_poc_cnt of GDR pictures is known from parsingLevel::PARSING_SLICE_PREFIX). VPS NAL units are
+   *        parsed again by the extractor whatever the caller's level, a VPS that cannot be parsed is counted by vpsErrors()
+   * \param data        First byte of the NAL unit in the caller's buffer, start code included
+   * \param size        Size of the NAL unit in bytes, start code included
+   * \param iov         Vectors of the kept bytes, contiguous NAL units are merged into one vector
+   * \return            true when the NAL unit is kept
+   */
+  bool push(const nal_info &nal, const unsigned char *data, size_t size, std::vector<struct iovec> &iov);
+
+  /**
+   * \brief Whole-buffer mode : only start codes and NAL unit headers are read, the VPS, SPS, PPS, picture header and GDR
+   *        NAL units are the only ones parsed. Bytes before the first start code are kept as they are
+   * \return            false when a VPS could not be parsed, its layer set is ignored and the previous one stays active
+   */
+  bool extract(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov);
+
+  /**
+   * \brief false when the last VPS has no OLS with the target index, the NAL units of every layer are then dropped
+   */
+  bool olsValid() const { return m_olsValid; }
+  int numLayersInOls() const { return m_numLayersInOls; }
+  /**
+   * \brief VPS NAL units that could not be parsed, their layer set is ignored and the previous one stays active
+   */
+  uint64_t vpsErrors() const { return m_vpsErrors; }
+  void clear();
+
+protected:
+  bool filter(const unsigned char *data, size_t size, const unsigned char *header, size_t headerSize);
+
+private:
+  bool parse(const unsigned char *data, size_t size, parsingLevel level);
+  void parseVps(const unsigned char *data, size_t size);
+  void setVps(const vvc::VPS *vps);
+  bool isKept(int nalUnitType, int layerId, int temporalId, int recoveryPocCnt) const;
+
+private:
+  NALParse m_parser; // VPS of both modes, parameter sets and picture headers of the whole-buffer mode
+  int m_targetOlsIdx;
+  int m_targetTemporalId;
+
+  bool m_vpsActive; // A VPS with its layer tables has been received
+  bool m_olsValid;
+  int m_numLayersInOls;
+  bool m_layerInOls[vvc::MAX_VPS_LAYERS];          // Indexed by nuh_layer_id
+  int m_numSubLayersInLayer[vvc::MAX_VPS_LAYERS];  // NumSubLayersInLayerInOLS[ targetOlsIdx ] indexed by nuh_layer_id
+  uint64_t m_vpsErrors;
+};
@@ -15,6 +15,7 @@
 #include "common_sei.h"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
 
 enum class videoCodecType
@@ -29,7 +30,72 @@ enum class parsingLevel
 {
   PARSING_NONE = 0,
   PARSING_PARAM_ID,
-  PARSING_FULL
+  PARSING_FULL,
+  PARSING_SLICE_PREFIX, // PARSING_FULL, plus the leading fields of every slice header (and picture header of H266/VVC)
+  PARSING_ENTRY_POINTS  // PARSING_SLICE_PREFIX, plus the whole slice header of H265/HEVC and H266/VVC up to the slice data
+};
+
+enum class sliceType
+{
+  SLICE_UNKNOWN = -1,
+  SLICE_B = 0,
+  SLICE_P,
+  SLICE_I,
+  SLICE_SP, // Only in H264/AVC
+  SLICE_SI  // Only in H264/AVC
+};
+
+// Leading slice header fields, enough for access unit splitting and frame typing without decoding the slice
+struct slice_prefix
+{
+  bool valid;                  // Fields were parsed for the current NAL unit
+  bool firstSliceInPic;        // first_mb_in_slice equal to 0 (H264), first_slice_segment_in_pic_flag (H265), first slice address of the picture (H266)
+  bool dependentSlice;         // dependent_slice_segment_flag (H265)
+  bool picHeaderInSliceHeader; // sh_picture_header_in_slice_header_flag (H266)
+  int sliceAddress;            // first_mb_in_slice (H264), slice_segment_address (H265), sh_slice_address (H266), -1 when unknown
+  sliceType type;
+  int ppsId;
+  int pocLsb; // -1 when not signalled (IDR pictures, H264 pic_order_cnt_type other than 0)
+
+  // H264/AVC picture boundary fields (7.4.1.2.4)
+  int nalRefIdc;
+  int frameNum;
+  bool fieldPic;
+  bool bottomField;
+  int idrPicId;
+  int deltaPocBottom;
+  int deltaPicOrderCnt[2]; // delta_pic_order_cnt[] of pic_order_cnt_type 1
+
+  // H266/VVC picture header, kept for the slices following a picture header NAL unit
+  bool gdrOrIrapPic;
+  bool gdrPic;
+  bool nonRefPic;
+  bool interSliceAllowed;
+  bool intraSliceAllowed;
+  int recoveryPocCnt; // ph_recovery_poc_cnt of GDR pictures, -1 otherwise
+  int pocMsbCycle;    // ph_poc_msb_cycle_val, -1 when not present
+};
+
+// Substreams of a H265/HEVC or H266/VVC slice (tiles, CTU rows of WPP), each one can be decoded by its own thread
+// Byte positions are in the NAL unit as found in the byte stream (start code included), emulation prevention bytes
+// counted as entry_point_offset_minus1 does : data + substreamOffset[i] is the first byte of substream i
+struct slice_entry_points
+{
+  bool valid;                // The whole slice header was parsed for the current NAL unit
+  uint32_t sliceDataOffset;  // Byte position of slice_data()
+  uint32_t firstCtuAddr;     // Picture raster scan address of the first CTU of the slice (segment)
+  uint32_t numCtus;          // CTUs of the slice (H266), 0 when only the slice data tells (H265 slice segments)
+  int sliceIdx;              // Index of the rectangular slice in the picture (H266 pps_rect_slice_flag), -1 otherwise
+  int subPicIdx;             // Subpicture of the slice (H266), 0 without subpictures
+  std::vector<uint32_t> substreamOffset;
+  std::vector<uint32_t> substreamSize;
+  std::vector<uint32_t> substreamCtuAddr; // Picture raster scan address of the first CTU of every substream
+
+  // H266/VVC picture header fields the slice headers depend on, kept for the slices following a picture header NAL unit
+  bool phLmcsEnabled;
+  bool phExplicitScalingListEnabled;
+  bool phTemporalMvpEnabled;
+  uint32_t phNumRefEntries[2]; // num_ref_entries[ i ][ RplsIdx[ i ] ] of ref_pic_lists() in the picture header
 };
 
 struct h264_seis
@@ -45,136 +111,351 @@ struct hevc_seis
   struct SEITimeCode hevc_sei_tc;
 };
 
+struct vvc_seis
+{
+  struct SEIBufferingPeriod vvc_sei_bp;
+  struct SEIPictureTimingH266 vvc_sei_pt;
+  bool vvc_bp_available; // Picture timing of H266/VVC can only be interpreted with an active buffering period
+};
+
 struct mpeg_common_seis
 {
   struct SEIUserDataRegistered common_sei_dr;
   struct SEIUserDataUnregistered common_sei_du;
+  struct SEIMasteringDisplayColourVolume common_sei_mdcv;
+  struct SEIContentLightLevelInfo common_sei_cll;
+  struct SEIRecoveryPoint common_sei_rp;
+  struct SEIDependentRAPIndication common_sei_drap;
+  struct SEIExtendedDrapIndication common_sei_edrap;
+  struct SEIScalableNesting common_sei_sn;
+  struct SEIDecodingUnitInfo common_sei_dui;
+};
+
+// NAL unit handed over already split from the byte stream (demuxer, RTP depacketizer, ISOBMFF sample)
+struct nal_buffer
+{
+  const uint8_t *data; // NAL unit header first, a start code in front of it is skipped
+  uint32_t size;
+};
+
+// What NALParse::nal_parse_batch() keeps of every NAL unit, nal_info describes only the last one
+struct nal_result
+{
+  int nal_unit_type; // -1 when the buffer is shorter than the NAL unit header
+  int nuh_layer_id;
+  int temporal_id;
+  int sei_type;      // Payload type of the first SEI message, -1 otherwise
+  slice_prefix slice; // Filled with parsingLevel::PARSING_SLICE_PREFIX
 };
 
+// Parameter sets received, owned and deleted as the types of codecType
+// SPS and PPS are kept by their id : sps / pps point to the ones the last slice referred to, or to the last received ones
 struct param_set
 {
+  videoCodecType codecType;
   void *vps; // Caution: H264/AVC standard has not VPS
   void *sps;
   void *pps;
   void *aps; // Caution: Only available in VVC
+  std::vector<void *> spsList; // Indexed by sps_id
+  std::vector<void *> ppsList; // Indexed by pps_id
+
+  static const int MAX_PARAM_SET_ID = 255; // pic_parameter_set_id of H264/AVC, the largest id range
+
+  param_set() : codecType(videoCodecType::UNDEFINED), vps(NULL), sps(NULL), pps(NULL), aps(NULL) {}
+  param_set(const param_set &) = delete;
+  param_set &operator=(const param_set &) = delete;
+  param_set(param_set &&other) noexcept
+      : codecType(other.codecType), vps(other.vps), sps(other.sps), pps(other.pps), aps(other.aps),
+        spsList(std::move(other.spsList)), ppsList(std::move(other.ppsList))
+  {
+    other.vps = other.sps = other.pps = other.aps = NULL;
+    other.spsList.clear();
+    other.ppsList.clear();
+  }
+  param_set &operator=(param_set &&other) noexcept
+  {
+    if (this != &other)
+    {
+      clear();
+      codecType = other.codecType;
+      vps = other.vps;
+      sps = other.sps;
+      pps = other.pps;
+      aps = other.aps;
+      spsList = std::move(other.spsList);
+      ppsList = std::move(other.ppsList);
+      other.vps = other.sps = other.pps = other.aps = NULL;
+      other.spsList.clear();
+      other.ppsList.clear();
+    }
+    return *this;
+  }
+  ~param_set() { clear(); }
+
+  /**
+   * \brief Parameter sets of another codec are deleted, those allocated before the first call are adopted
+   */
+  void setCodec(videoCodecType type)
+  {
+    if (codecType != videoCodecType::UNDEFINED && type != codecType)
+      clear();
+    codecType = type;
+  }
+
+  /**
+   * \brief Take a parameter set just parsed, it replaces the one of the same id and becomes sps / pps
+   *        A set with an id out of range is deleted
+   */
+  void storeSps(int id, void *set)
+  {
+    if (store(spsList, id, set, false))
+      sps = set;
+  }
+  void storePps(int id, void *set)
+  {
+    if (store(ppsList, id, set, true))
+      pps = set;
+  }
+
+  void *findSps(int id) const { return id >= 0 && id < static_cast<int>(spsList.size()) ? spsList[id] : NULL; }
+  void *findPps(int id) const { return id >= 0 && id < static_cast<int>(ppsList.size()) ? ppsList[id] : NULL; }
+
+  void clear()
+  {
+    if (codecType == videoCodecType::H265_HEVC)
+    {
+      delete static_cast<hevc::vps *>(vps);
+    }
+    else if (codecType == videoCodecType::H266_VVC)
+    {
+      delete static_cast<vvc::APS *>(aps);
+      delete static_cast<vvc::VPS *>(vps);
+    }
+    for (size_t i = 0; i < spsList.size(); i++)
+      deleteSet(spsList[i], false);
+    for (size_t i = 0; i < ppsList.size(); i++)
+      deleteSet(ppsList[i], true);
+    spsList.clear();
+    ppsList.clear();
+    vps = sps = pps = aps = NULL;
+  }
+
+private:
+  bool store(std::vector<void *> &list, int id, void *set, bool isPps)
+  {
+    if (id < 0 || id > MAX_PARAM_SET_ID)
+    {
+      deleteSet(set, isPps);
+      return false;
+    }
+    if (id >= static_cast<int>(list.size()))
+      list.resize(id + 1, NULL);
+    if (list[id] != set)
+      deleteSet(list[id], isPps);
+    list[id] = set;
+    return true;
+  }
+
+  void deleteSet(void *set, bool isPps)
+  {
+    if (codecType == videoCodecType::H264_AVC)
+    {
+      if (isPps)
+        delete static_cast<avc::pps *>(set);
+      else
+        delete static_cast<avc::sps *>(set);
+    }
+    else if (codecType == videoCodecType::H265_HEVC)
+    {
+      if (isPps)
+        delete static_cast<hevc::pps *>(set);
+      else
+        delete static_cast<hevc::sps *>(set);
+    }
+    else if (codecType == videoCodecType::H266_VVC)
+    {
+      if (isPps)
+        delete static_cast<vvc::PPS *>(set);
+      else
+        delete static_cast<vvc::SPS *>(set);
+    }
+  }
 };
 
+// Held by value : the fields read for every NAL unit come first, the SEI messages last
 struct nal_info
 {
   videoCodecType codecType;
   int nal_unit_type;
+  int nuh_layer_id;
+  int temporal_id;
+  param_set mpegParamSet;
+  slice_prefix slice; // Filled with parsingLevel::PARSING_SLICE_PREFIX
+
+  // Operation point whose nested SEI messages (scalable nesting) are interpreted, set by the caller
+  int target_ols_idx;
+  int target_layer_id;
+  int target_temporal_id; // -1 : highest sub-layer
   int sei_type;
   size_t sei_length;
+  std::vector<int> sei_types; // Payload types of every SEI message in the current NAL unit, in bitstream order
   void *sei;
+  slice_entry_points entry; // Filled with parsingLevel::PARSING_ENTRY_POINTS
 
-  param_set *mpegParamSet;
+  h264_seis h264SEI;
+  hevc_seis hevcSEI;
+  vvc_seis vvcSEI;
+  mpeg_common_seis mpegCommonSEI;
 
-  h264_seis *h264SEI;
-  hevc_seis *hevcSEI;
-  mpeg_common_seis *mpegCommonSEI;
-
-  nal_info()
+  nal_info() : h264SEI(), hevcSEI(), vvcSEI(), mpegCommonSEI()
   {
     codecType = videoCodecType::UNDEFINED;
     nal_unit_type = -1;
+    nuh_layer_id = 0;
+    temporal_id = 0;
+    target_ols_idx = 0;
+    target_layer_id = 0;
+    target_temporal_id = -1;
     sei_type = -1;
     sei = nullptr;
     sei_length = 0;
-    mpegParamSet = new param_set{};
-    h264SEI = new h264_seis{};
-    hevcSEI = new hevc_seis{};
-    mpegCommonSEI = new mpeg_common_seis{};
-  }
-  ~nal_info()
-  {
-    if (codecType == videoCodecType::H264_AVC)
-    {
-      if (mpegParamSet->sps)
-      {
-        delete static_cast<avc::sps *>(mpegParamSet->sps);
-        mpegParamSet->sps = NULL;
-      }
-      if (mpegParamSet->pps)
-      {
-        delete static_cast<avc::pps *>(mpegParamSet->pps);
-        mpegParamSet->pps = NULL;
-      }
-    }
-    if (codecType == videoCodecType::H265_HEVC)
-    {
-      if (mpegParamSet->sps)
-      {
-        delete static_cast<hevc::sps *>(mpegParamSet->sps);
-        mpegParamSet->sps = NULL;
-      }
-      if (mpegParamSet->pps)
-      {
-        delete static_cast<hevc::pps *>(mpegParamSet->pps);
-        mpegParamSet->pps = NULL;
-      }
-    }
-    if (codecType == videoCodecType::H266_VVC)
-    {
-      if (mpegParamSet->aps)
-      {
-        delete static_cast<vvc::APS *>(mpegParamSet->aps);
-        mpegParamSet->aps = NULL;
-      }
-      if (mpegParamSet->vps)
-      {
-        delete static_cast<vvc::VPS *>(mpegParamSet->vps);
-        mpegParamSet->vps = NULL;
-      }
-      if (mpegParamSet->sps)
-      {
-        delete static_cast<vvc::SPS *>(mpegParamSet->sps);
-        mpegParamSet->sps = NULL;
-      }
-      if (mpegParamSet->pps)
-      {
-        delete static_cast<vvc::PPS *>(mpegParamSet->pps);
-        mpegParamSet->pps = NULL;
-      }
-    }
-
-    delete mpegParamSet;
-    mpegParamSet = NULL;
-    delete h264SEI;
-    h264SEI = NULL;
-    delete hevcSEI;
-    hevcSEI = NULL;
-    delete mpegCommonSEI;
-    mpegCommonSEI = NULL;
+    slice = slice_prefix{};
+    slice.sliceAddress = -1;
+    slice.type = sliceType::SLICE_UNKNOWN;
+    slice.ppsId = -1;
+    slice.pocLsb = -1;
+    slice.recoveryPocCnt = -1;
+    slice.pocMsbCycle = -1;
+    entry.valid = false;
+    entry.sliceDataOffset = 0;
+    entry.firstCtuAddr = 0;
+    entry.numCtus = 0;
+    entry.sliceIdx = -1;
+    entry.subPicIdx = 0;
+    entry.phLmcsEnabled = false;
+    entry.phExplicitScalingListEnabled = false;
+    entry.phTemporalMvpEnabled = false;
+    entry.phNumRefEntries[0] = 0;
+    entry.phNumRefEntries[1] = 0;
   }
+  nal_info(const nal_info &) = delete;
+  nal_info &operator=(const nal_info &) = delete;
+  nal_info(nal_info &&) = default;
+  nal_info &operator=(nal_info &&) = default;
 };
 
+struct parseNalH264;
+class parseNalH265;
+class parseNalH266;
+
 class NALParse
 {
 public:
   NALParse();
   virtual ~NALParse();
+  NALParse(const NALParse &) = delete;
+  NALParse &operator=(const NALParse &) = delete;
+  NALParse(NALParse &&other) noexcept;
+  NALParse &operator=(NALParse &&other) noexcept;
 
 public:
   /**
    * \brief Extern API to parse NAL unit of h264/AVC, h265/HEVC and h266/VVC
    * \param nal_bitstream    Pointer to indicate buffer for NAL stream (Started with Byte stream NAL Unit, ex) 0 0 1, 0 0 0 1 ~)
-   * \param codecType        Video codec type
+   * \param codecType        Video codec type, UNDEFINED to detect it from the bytes at nextNalPos (see DetectCodec())
+   *                         The detected codec is kept in nal->codecType and used by the next calls given UNDEFINED
+   *                         When no codec is detected, nal->nal_unit_type is -1 and nextNalPos is moved to seqSize
    * \param nextNalPos       Position of next NAL stream in the currnent packet
    * \param seqSize          NAL size (Just needed to find end of NAL stream)
    * \param level            Parsing level (Refer to enum parsingLevel structure)
    */
   void nal_parse(unsigned char *nal_bitstream, videoCodecType codecType, int &nextNalPos, int seqSize, parsingLevel level);
-  nal_info *nal;
+
+  /**
+   * \brief Resynchronize on a byte stream entered at an arbitrary position : nextNalPos is moved to the next start code
+   *        at or after it, ready for nal_parse()
+   * \return                 false when no start code follows before seqSize (nextNalPos is then seqSize)
+   */
+  bool nal_resync(unsigned char *nal_bitstream, int &nextNalPos, int seqSize);
+
+  /**
+   * \brief Parse one NAL unit already split from the byte stream, no start code search
+   * \param data             NAL unit, optionally preceded by a start code
+   * \param size             Size of the NAL unit in bytes, start code included
+   */
+  void nal_parse_unit(const uint8_t *data, uint32_t size, videoCodecType codecType, parsingLevel level);
+
+  /**
+   * \brief Parse NAL units already split from the byte stream, in decoding order, in one loop
+   *        The codec is dispatched once per batch and one parser object and its buffers serve every NAL unit
+   *        Parameter sets and SEI messages are kept in nal as with nal_parse(), nal describes the last NAL unit
+   * \param results          One entry per NAL unit, may be NULL
+   * \return                 Number of NAL units parsed, buffers shorter than the NAL unit header are skipped
+   */
+  size_t nal_parse_batch(const nal_buffer *nals, size_t count, videoCodecType codecType, parsingLevel level, nal_result *results);
+
+  /**
+   * \brief Parse one NAL unit handed over as a scatter list (MPEG-2 TS payloads, RTP fragmentation units), in order
+   *        Slice NAL units are parsed from their first bytes (see nal_bytes_needed()) gathered out of the fragments,
+   *        other NAL units are gathered whole, a single fragment is parsed in place
+   * \param fragments        NAL unit header first, no start code, may stop after nal_bytes_needed() bytes
+   */
+  void nal_parse_scatter(const nal_buffer *fragments, size_t count, videoCodecType codecType, parsingLevel level);
+
+  /**
+   * \brief Bytes of a NAL unit the parser reads, counted from its NAL unit header
+   * \param header           NAL unit header (1 byte for H264/AVC, 2 bytes otherwise)
+   * \return                 UINT32_MAX when the whole NAL unit is read
+   */
+  static uint32_t nal_bytes_needed(const uint8_t *header, videoCodecType codecType, parsingLevel level);
+
+  /**
+   * \brief NAL unit type classes shared by the stream analyzers (access units, POC, random access points, HRD, ...)
+   *        nal_is_suffix() : never opens an access unit, follows the VCL NAL units of its own one (suffix SEI / APS, filler data,
+   *        end of sequence / bitstream, reserved and unspecified types of the same rule)
+   *        nal_is_irap() : IDR picture (H264/AVC), IRAP picture (H265/HEVC, H266/VVC), GDR excluded
+   *        nal_is_vps() is false for H264/AVC, nal_is_aps() for every codec but H266/VVC (prefix and suffix APS)
+   */
+  static bool nal_is_vcl(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_suffix(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_end_of_sequence(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_aud(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_irap(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_vps(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_sps(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_pps(videoCodecType codecType, int nalUnitType);
+  static bool nal_is_aps(videoCodecType codecType, int nalUnitType);
+
+  /**
+   * \brief Unescaped payload of the last NAL unit, after its NAL unit header, valid until the next call
+   *        Only for non-VCL NAL units parsed above parsingLevel::PARSING_NONE, rbspSize() is 0 otherwise
+   */
+  const uint8_t *rbsp() const { return m_rbspSize ? m_rbsp.data() + m_rbspHeader : NULL; }
+  size_t rbspSize() const { return m_rbspSize; }
+
+  nal_info *nal; // Points to the nal_info held by the parser
 
 private:
-  void h264_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level);
-  void hevc_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level);
-  void vvc_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level);
+  // stream points to the NAL unit header, nalLen counts from it, firstPos is the length of the start code in front (entry
+  // point offsets of H265/HEVC and H266/VVC count from the first byte of the NAL unit)
+  void h264_nal_parse(parseNalH264 &lib, unsigned char *stream, int nalLen, parsingLevel level);
+  void hevc_nal_parse(parseNalH265 &lib, unsigned char *stream, int nalLen, int firstPos, parsingLevel level);
+  void vvc_nal_parse(parseNalH266 &lib, unsigned char *stream, int nalLen, int firstPos, parsingLevel level);
+  void xStoreResult(nal_result *result) const;
 
 private:
   int FindStartCode(const unsigned char *nal_bitstream);
   int FindNextNal(unsigned char *nal_bitstream, int nextNalPos, int seqSize);
-  std::vector<uint8_t> UnescapeRbsp(const uint8_t *data, size_t length);
+  void UnescapeRbsp(const uint8_t *data, size_t length, std::vector<uint8_t> &out, size_t maxLength = SIZE_MAX, std::vector<uint32_t> *epbLocation = NULL);
+
+private:
+  nal_info m_nalInfo;
+  std::vector<uint8_t> m_rbsp;          // Unescaped bytes of the current NAL unit, kept for their capacity
+  std::vector<uint32_t> m_epbLocation;
+  size_t m_rbspHeader; // Bytes of the NAL unit header at the start of m_rbsp
+  size_t m_rbspSize;   // Payload bytes of m_rbsp after the header, 0 when m_rbsp holds no whole payload
+  std::vector<uint8_t> m_gather; // NAL unit gathered out of the fragments given to nal_parse_scatter()
 };
 
 template <typename T1, typename T2, typename T3>
@@ -189,4 +470,5 @@ public:
   virtual void sps_parse(unsigned char *nal_bitstream, T2 *pcSPS, int curLen, parsingLevel level) = 0;
   virtual void pps_parse(unsigned char *nal_bitstream, T3 *pcPPS, T2 *pcSPS, int curLen, parsingLevel level) = 0;
   virtual void sei_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) = 0;
+  virtual void slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) = 0;
 };
\ No newline at end of file
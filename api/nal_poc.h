@@ -0,0 +1,62 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   PocCalculator
+    \brief       Picture order count of every picture from slice header prefixes : H264/AVC pic_order_cnt_type 0, 1 and 2 (8.2.1),
+                 H265/HEVC (8.3.1) and H266/VVC (8.3.1) with the MSB wrap of pic_order_cnt_lsb
+    \warning     Needs parsingLevel::PARSING_SLICE_PREFIX. Memory management control operation 5 of H264/AVC is signalled after
+                 the slice header prefix and is not taken into account
+ */
+
+#include "nal_parse.h"
+
+struct poc_info
+{
+  bool valid;         // Slice header prefix of the first slice was parsed
+  uint64_t picIndex;  // Pictures before this one in decoding order
+  int layerId;        // nuh_layer_id of the picture (H265, H266)
+  int32_t poc;        // PicOrderCntVal (H265, H266), PicOrderCnt() of the frame or field (H264)
+  int32_t topPoc;     // TopFieldOrderCnt (H264), equal to poc otherwise
+  int32_t bottomPoc;  // BottomFieldOrderCnt (H264), equal to poc otherwise
+};
+
+class PocCalculator
+{
+public:
+  PocCalculator(videoCodecType codecType);
+  virtual ~PocCalculator();
+
+public:
+  /**
+   * \brief Feed every NAL unit just parsed by NALParse::nal_parse(), in decoding order
+   * \return true when the NAL unit is the first slice of a picture, whose picture order count is available with poc()
+   */
+  bool push(const nal_info &nal);
+
+  const poc_info &poc() const { return m_cur; }
+  void clear();
+
+private:
+  void h264Poc(const nal_info &nal);
+  void hevcPoc(const nal_info &nal);
+  void vvcPoc(const nal_info &nal);
+  static int derivePocMsb(int pocLsb, int prevPocLsb, int prevPocMsb, int maxPocLsb);
+
+private:
+  static const int MAX_LAYERS = 64;
+
+  videoCodecType m_codecType;
+  uint64_t m_picCount;
+  poc_info m_cur;
+
+  // H264/AVC
+  int m_prevPocMsb;        // prevPicOrderCntMsb of the previous reference picture
+  int m_prevPocLsb;        // prevPicOrderCntLsb of the previous reference picture
+  int m_prevFrameNumOffset;
+  int m_prevFrameNum;
+
+  // H265/HEVC, H266/VVC
+  int m_prevTid0Poc[MAX_LAYERS];
+  bool m_firstPicInLayer[MAX_LAYERS]; // Next IRAP / GDR picture of the layer starts a coded video sequence
+  bool m_pendingPictureHeader;        // H266/VVC picture header NAL unit received, the next slice starts a picture
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   DetectCodec(), ProbeMediaInfo()
+    \brief       Codec detection of an Annex-B byte stream from its first bytes : the NAL unit headers found behind the start
+                 codes are scored under the header syntax of each codec (forbidden and reserved bits, TemporalId, reserved
+                 NAL unit types, leading bytes of the parameter sets and their order before the first slice)
+                 Media information (picture size, frame rate, bit depth, chroma format, profile / level, colour and HDR
+                 signalling) taken from the first SPS, parsing stops at the first IRAP picture
+    \warning     Only the first maxBytes are read, the time is bounded by them and not by the stream size
+                 A stream starting in the middle of a coded video sequence, without parameter sets, is scored on the NAL unit
+                 headers alone and detected with a lower confidence
+                 H264 streams without IDR pictures are complete at the first slice following a recovery point SEI
+ */
+
+#include "nal_parse.h"
+
+static const size_t CODEC_PROBE_BYTES = 4096;
+
+struct codec_probe
+{
+  videoCodecType codecType; // Most plausible codec, UNDEFINED when none fits
+  double confidence;        // 0 to 1 : share of the best score the runner-up does not reach
+  int score[3];             // H264/AVC, H265/HEVC, H266/VVC
+  uint32_t numNalUnits;     // NAL units scored
+  size_t bytesProbed;
+};
+
+/**
+ * \brief Detect the codec of the byte stream starting at 'data'
+ * \param size             Bytes available at 'data', at most maxBytes of them are read
+ * \return                 probe.codecType
+ */
+videoCodecType DetectCodec(const uint8_t *data, size_t size, codec_probe &probe, size_t maxBytes = CODEC_PROBE_BYTES);
+
+static const uint64_t MEDIA_PROBE_BYTES = 8 << 20;
+
+struct media_info
+{
+  videoCodecType codecType;
+  bool valid;    // An SPS was parsed : the fields below are set
+  bool complete; // The SPS, PPS, first IRAP picture (and VPS of a multi-layer H266 stream) were all found
+  uint64_t bytesRead;
+
+  uint32_t width;       // Cropped by the conformance window (frame cropping of H264)
+  uint32_t height;
+  uint32_t codedWidth;  // Decoded picture size
+  uint32_t codedHeight;
+  bool interlaced;      // Field coding (H264 frame_mbs_only_flag 0, sps_field_seq_flag / field_seq_flag)
+  double frameRate;     // Frames per second from the timing information, 0 when not signalled
+  uint32_t numUnitsInTick;
+  uint32_t timeScale;
+
+  int bitDepthLuma;
+  int bitDepthChroma;
+  int chromaFormatIdc;  // 0 : 4:0:0, 1 : 4:2:0, 2 : 4:2:2, 3 : 4:4:4
+  int profileIdc;       // profile_idc (H264), general_profile_idc (H265, H266)
+  int levelIdc;         // level_idc (H264) or general_level_idc (H265, H266), as coded
+  double level;         // Level number, e.g. 4.1
+  bool highTier;
+
+  bool colourDescription; // Colour fields below are signalled, otherwise they hold the unspecified value 2
+  int colourPrimaries;
+  int transferCharacteristics;
+  int matrixCoefficients;
+  bool fullRange;
+  bool hdr;             // PQ (16) or HLG (18) transfer characteristics
+  bool wideColourGamut; // BT.2020 colour primaries (9)
+
+  bool masteringDisplay;  // Mastering display colour volume SEI found before the first IRAP picture
+  uint32_t maxDisplayLuminance; // In units of 0.0001 cd/m2
+  uint32_t minDisplayLuminance;
+  bool contentLightLevel; // Content light level information SEI found before the first IRAP picture
+  uint16_t maxContentLightLevel;   // MaxCLL
+  uint16_t maxPicAverageLightLevel; // MaxFALL
+};
+
+/**
+ * \brief Media information of an Annex-B file : the stream is parsed only until its first SPS, PPS and IRAP picture
+ * \param codecType        UNDEFINED to detect it with DetectCodec()
+ * \param maxBytes         Bound of the bytes read, the probe stops there with info.complete false
+ * \return                 false if the file cannot be read or no SPS was found
+ */
+bool ProbeMediaInfo(const char *streamPath, media_info &info, videoCodecType codecType = videoCodecType::UNDEFINED, uint64_t maxBytes = MEDIA_PROBE_BYTES);
+
+/**
+ * \brief Same as above for a byte stream in memory
+ */
+bool ProbeMediaInfo(const uint8_t *data, size_t size, media_info &info, videoCodecType codecType = videoCodecType::UNDEFINED);
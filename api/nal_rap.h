@@ -0,0 +1,83 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   RapClassifier
+    \brief       Classify random access points from NAL unit types and recovery point / DRAP / EDRAP SEI, without decoding slices
+    \warning     SEI messages are only interpreted with parsingLevel::PARSING_FULL, picture boundaries need parsingLevel::PARSING_SLICE_PREFIX :
+                 below it consecutive slices of the same NAL unit type are taken as one picture
+ */
+
+#include "nal_parse.h"
+
+#include <vector>
+
+enum class rapType
+{
+  RAP_NONE = 0,
+  RAP_IDR,            // IDR picture (all codecs)
+  RAP_CRA,            // Clean random access, leading pictures may be skipped (H265, H266)
+  RAP_BLA,            // Broken link access (H265)
+  RAP_GDR,            // Gradual decoding refresh picture (H266)
+  RAP_RECOVERY_POINT, // Picture with recovery point SEI (open-GOP, intra refresh)
+  RAP_EDRAP,          // Extended dependent RAP, needs the referenced RAP pictures (H266)
+  RAP_DRAP            // Dependent RAP, needs the preceding IRAP picture (H265, H266)
+};
+
+struct rap_point
+{
+  int64_t position;  // Byte position of the first NAL unit of the access unit, as given to push()
+  uint64_t nalIndex; // Index of the first NAL unit of the access unit
+  rapType type;
+  int recoveryPocCnt; // Number of pictures until output is correct (0 for IRAP pictures, -1 when unknown)
+  bool exactMatch;
+  bool brokenLink;
+};
+
+class RapClassifier
+{
+public:
+  /**
+   * \param level       Parsing level given to NALParse for the NAL units pushed
+   */
+  RapClassifier(videoCodecType codecType, parsingLevel level = parsingLevel::PARSING_FULL);
+  virtual ~RapClassifier();
+
+public:
+  /**
+   * \brief Feed the NAL unit just parsed by NALParse::nal_parse()
+   * \param nal         NAL information filled by NALParse
+   * \param position    Byte position of the NAL unit in the stream
+   * \return            Type of random access point started by this NAL unit, RAP_NONE otherwise
+   *                    (only the first VCL NAL unit of a picture returns a type)
+   */
+  rapType push(const nal_info &nal, int64_t position);
+
+  const std::vector<rap_point> &points() const { return m_points; }
+  void clear();
+
+  static bool isIrap(rapType type) { return type == rapType::RAP_IDR || type == rapType::RAP_CRA || type == rapType::RAP_BLA; }
+
+private:
+  bool startsPicture(const nal_info &nal) const;
+  rapType classifyVcl(int nalUnitType) const;
+  void collectSei(const nal_info &nal);
+
+private:
+  videoCodecType m_codecType;
+  bool m_slicePrefix; // Slice header prefixes are available (parsingLevel::PARSING_SLICE_PREFIX)
+  uint64_t m_nalIndex;
+
+  bool m_inPicture;    // VCL NAL units already seen for the current picture
+  int m_lastVclNalUnitType;
+  int m_lastIdrPicId;  // idr_pic_id of the current H264/AVC IDR picture, -1 otherwise
+  bool m_auStartValid; // A prefix NAL unit (AUD, parameter set, SEI, ...) opened the next access unit
+  int64_t m_auStartPosition;
+  uint64_t m_auStartNalIndex;
+
+  bool m_pendingRecoveryPoint;
+  bool m_pendingDrap;
+  bool m_pendingEdrap;
+  SEIRecoveryPoint m_recoveryPoint;
+
+  std::vector<rap_point> m_points;
+};
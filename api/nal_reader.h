@@ -0,0 +1,181 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   AsyncFileReader
+    \brief       Read-ahead of a stream file : one I/O thread keeps up to 'depth' large aligned reads in flight through io_uring,
+                 or worker threads read with pread when io_uring is unavailable, filled buffers are handed to the parsing
+                 thread in file order through a lock-free ring of slots and are read again once released
+                 readNalChunks() cuts the buffers at start codes for NALParse::nal_parse() and NalEventParser::parse()
+    \warning     POSIX only, io_uring needs the Linux headers at build time (HAVE_IO_URING), without them the pread workers read
+                 One consumer thread calls acquire() / release(), a slot is only refilled after its release
+                 With direct I/O (O_DIRECT) the buffer size must be a multiple of the logical block size of the device
+ */
+
+#include "nal_parse.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const size_t READ_BUFFER_SIZE = 4 << 20;
+static const unsigned READ_QUEUE_DEPTH = 8;
+static const size_t READ_BUFFER_PADDING = 8; // Zero bytes after the data of a buffer, start code searches read a few bytes past it
+
+struct read_buffer
+{
+  unsigned char *data; // Followed by READ_BUFFER_PADDING zero bytes
+  size_t size;
+  uint64_t offset; // Byte position of data[0] in the file
+  uint64_t sequence;
+};
+
+class AsyncFileReader
+{
+public:
+  /**
+   * \param bufferSize       Size of each read, rounded up to 4096 bytes
+   * \param depth            Buffers, i.e. reads in flight plus buffers held by the consumer
+   * \param threads          pread worker threads when io_uring is unavailable, 0 for one per buffer up to 4
+   */
+  AsyncFileReader(size_t bufferSize = READ_BUFFER_SIZE, unsigned depth = READ_QUEUE_DEPTH, unsigned threads = 0);
+  virtual ~AsyncFileReader();
+  AsyncFileReader(const AsyncFileReader &) = delete;
+  AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+
+public:
+  /**
+   * \param direct           Bypass the page cache (O_DIRECT), ignored when the file system refuses it
+   * \param useUring         false to force the pread workers
+   * \return                 false if the file cannot be opened
+   */
+  bool open(const char *streamPath, bool direct = false, bool useUring = true);
+  void close();
+
+  /**
+   * \brief Next buffer in file order, waits until it is filled
+   * \return                 false at the end of the file or after a read error
+   */
+  bool acquire(read_buffer &buffer);
+
+  /**
+   * \brief Give the buffer back for the next reads, buffers may be held and released in any order
+   */
+  void release(const read_buffer &buffer);
+
+  /**
+   * \brief Read the whole file and call consume(unsigned char *data, int size, uint64_t offset) with pieces which end at a
+   *        start code (or at the end of the file) : each piece holds whole NAL units and is readable 4 bytes past its end
+   *        Pieces are parsed in place in the read buffers, only a NAL unit crossing two buffers is copied
+   * \return                 false after a read error
+   */
+  template <class Consumer>
+  bool readNalChunks(Consumer consume);
+
+  bool uring() const { return m_uring != NULL; }
+  bool error() const { return m_error.load(std::memory_order_acquire); }
+  uint64_t size() const { return m_size; }
+
+private:
+  enum slotState
+  {
+    SLOT_FREE = 0,
+    SLOT_READING,
+    SLOT_FILLED
+  };
+
+  struct slot
+  {
+    unsigned char *data;
+    size_t size;   // Bytes read so far
+    size_t length; // Bytes to read
+    uint64_t offset;
+    std::atomic<uint64_t> sequence; // Read the slot holds or may start next
+    std::atomic<int> state;
+  };
+
+  struct uring_queue;
+
+  bool setupUring();
+  void uringLoop();
+  void preadLoop();
+  bool readSlot(slot &s);
+  void finishSlot(slot &s, bool ok);
+  static void backoff(unsigned &spins);
+  static size_t lastStartCode(const unsigned char *data, size_t size, size_t from);
+
+private:
+  size_t m_bufferSize;
+  unsigned m_depth;
+  unsigned m_threads;
+  int m_fd;
+  uint64_t m_size;
+  uint64_t m_numReads;
+
+  std::vector<unsigned char *> m_buffers;
+  slot *m_slots;
+  uring_queue *m_uring;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<uint64_t> m_claimSequence; // Next read for the pread workers
+  std::atomic<bool> m_stop;
+  std::atomic<bool> m_error;
+  uint64_t m_acquireSequence; // Next buffer for the consumer
+
+  std::vector<unsigned char> m_carry; // NAL units crossing two buffers, for readNalChunks()
+};
+
+template <class Consumer>
+bool AsyncFileReader::readNalChunks(Consumer consume)
+{
+  m_carry.clear();
+  uint64_t carryOffset = 0;
+  read_buffer buffer;
+  while (acquire(buffer))
+  {
+    // The NAL unit left from the previous buffer ends at the first start code found entirely in this one,
+    // a start code whose leading zero byte is still in the carry is left to the consumer
+    size_t head = 0;
+    if (!m_carry.empty())
+    {
+      head = buffer.size;
+      for (size_t i = 0; i + 2 < buffer.size; i++)
+      {
+        if (buffer.data[i] == 0 && buffer.data[i + 1] == 0 && buffer.data[i + 2] == 1 && (i > 0 || m_carry.back() != 0))
+        {
+          head = (i > 0 && buffer.data[i - 1] == 0) ? i - 1 : i;
+          break;
+        }
+      }
+      m_carry.insert(m_carry.end(), buffer.data, buffer.data + head);
+      if (head < buffer.size)
+      {
+        const size_t carrySize = m_carry.size();
+        m_carry.resize(carrySize + READ_BUFFER_PADDING, 0);
+        consume(m_carry.data(), static_cast<int>(carrySize), carryOffset);
+        m_carry.clear();
+      }
+    }
+
+    if (head < buffer.size)
+    {
+      // Whole NAL units are parsed in place, the last one may continue in the next buffer
+      const size_t last = buffer.offset + buffer.size < m_size ? lastStartCode(buffer.data, buffer.size, head) : buffer.size;
+      if (last > head)
+        consume(buffer.data + head, static_cast<int>(last - head), buffer.offset + head);
+      if (last < buffer.size)
+      {
+        m_carry.assign(buffer.data + last, buffer.data + buffer.size);
+        carryOffset = buffer.offset + last;
+      }
+    }
+    release(buffer);
+  }
+  if (!m_carry.empty() && !error())
+  {
+    const size_t carrySize = m_carry.size();
+    m_carry.resize(carrySize + READ_BUFFER_PADDING, 0);
+    consume(m_carry.data(), static_cast<int>(carrySize), carryOffset);
+  }
+  m_carry.clear();
+  return !error();
+}
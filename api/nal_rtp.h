@@ -0,0 +1,141 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   RtpDepacketizer, PcapRtpReader
+    \brief       RTP payload formats of H264/AVC (RFC 6184), H265/HEVC (RFC 7798) and H266/VVC (RFC 9328) : single NAL unit
+                 packets and the NAL units of aggregation packets (STAP-A, AP) are parsed in place in the packet, fragmentation
+                 units (FU-A, FU) are reassembled in one buffer reused from a NAL unit to the next, which keeps only the bytes
+                 the parser reads (see NALParse::nal_bytes_needed()). Access units are assembled by AccessUnitAssembler, closed
+                 by the marker bit, and carry the RTP timestamp of their first NAL unit as pts
+                 PcapRtpReader reads the UDP payloads of a capture file, to feed the depacketizer without a network
+    \warning     Non-interleaved mode only : STAP-B, MTAP, FU-B (RFC 6184) and PACI (RFC 7798) packets are counted and skipped,
+                 DONL / DOND fields (sprop-max-don-diff > 0) are skipped without reordering
+                 Packets are not reordered : a sequence number gap drops the fragmented NAL unit in progress and a late or
+                 duplicate packet is dropped
+                 Offsets of the access units count the NAL units received, each behind a 4-byte start code
+ */
+
+#include "nal_file.h"
+#include "nal_parse.h"
+#include "nal_au.h"
+
+#include <deque>
+#include <vector>
+
+struct rtp_stats
+{
+  uint64_t packets;
+  uint64_t invalid;        // Packets too short, not RTP version 2, of another payload type, or jumping 3000 sequence numbers or more
+                           // ahead without a following packet (RFC 3550 A.1)
+  uint64_t lost;           // Packets missing from the sequence numbers
+  uint64_t late;           // Packets up to 100 sequence numbers older than the highest one (reordered or duplicated), dropped
+  uint64_t unsupported;    // Packet types of the interleaved mode and PACI packets
+  uint64_t droppedNals;    // Fragmented NAL units lost to a sequence gap or a missing start fragment
+  uint64_t nalUnits;
+  uint64_t aggregated;     // NAL units of aggregation packets
+  uint64_t fragmented;     // NAL units reassembled from fragmentation units
+};
+
+class RtpDepacketizer
+{
+public:
+  /**
+   * \param payloadType      RTP payload type of the stream, -1 to take every packet
+   * \param donl             DONL / DOND fields are present (sprop-max-don-diff greater than 0, H265 and H266 only)
+   */
+  RtpDepacketizer(videoCodecType codecType, parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX, int payloadType = -1, bool donl = false);
+  virtual ~RtpDepacketizer();
+
+public:
+  /**
+   * \brief Depacketize one RTP packet (RTP header first) and append the access units completed
+   */
+  void push(const uint8_t *packet, size_t size, std::vector<access_unit> &aus);
+
+  /**
+   * \brief End of the stream : completes the last access unit
+   */
+  void flush(std::vector<access_unit> &aus);
+
+  /**
+   * \brief Parameter set given out of band (sprop-parameter-sets, sprop-vps / sprop-sps / sprop-pps of the SDP)
+   */
+  void parameterSet(const uint8_t *nal, uint32_t size);
+
+  void clear();
+
+  const nal_info &nal() const { return *m_parser.nal; } // Last NAL unit parsed
+  const rtp_stats &stats() const { return m_stats; }
+
+private:
+  struct rtp_timestamp
+  {
+    uint64_t offset; // First NAL unit of the packets with this time stamp
+    int64_t timestamp;
+  };
+
+  void payload(const uint8_t *data, size_t size, std::vector<access_unit> &aus);
+  void aggregation(const uint8_t *data, size_t size, size_t headerSize, std::vector<access_unit> &aus);
+  void fragment(const uint8_t *data, size_t size, std::vector<access_unit> &aus);
+  void nalUnit(const nal_buffer *fragments, size_t count, uint32_t fullSize, std::vector<access_unit> &aus);
+  void complete(std::vector<access_unit> &aus);
+
+private:
+  videoCodecType m_codecType;
+  parsingLevel m_level;
+  int m_payloadType;
+  bool m_donl;
+  NALParse m_parser;
+  AccessUnitAssembler m_assembler;
+  rtp_stats m_stats;
+
+  bool m_started;
+  uint32_t m_ssrc;
+  uint16_t m_sequence;    // Highest sequence number taken
+  uint32_t m_badSequence; // Sequence number expected after a very large jump, RFC 3550 A.1 bad_seq
+  uint32_t m_lastTimestamp;
+  int64_t m_timestampWraps;
+  std::deque<rtp_timestamp> m_timestamps;
+  uint64_t m_offset; // Bytes of the NAL units received, each with a 4-byte start code
+
+  bool m_inFragment;
+  bool m_fragmentCounted;          // The NAL unit of the remaining fragments is already counted in droppedNals
+  std::vector<uint8_t> m_fragment; // NAL unit of the fragmentation units in progress, capacity kept
+  uint32_t m_fragmentSize;         // Whole size of that NAL unit
+  uint32_t m_fragmentNeeded;       // Bytes of it the parser reads
+};
+
+class PcapRtpReader
+{
+public:
+  PcapRtpReader();
+  virtual ~PcapRtpReader();
+
+public:
+  /**
+   * \brief Map a capture file of the libpcap format (not pcapng), with Ethernet, Linux cooked or raw IP link layers
+   * \param udpPort          Destination port of the packets taken, -1 for every UDP packet
+   * \return                 false if the file cannot be read (see MappedFile) or is not a capture file
+   */
+  bool open(const char *path, int udpPort = -1);
+  void close();
+
+  /**
+   * \brief UDP payload of the next packet, IPv4 or IPv6, pointing into the mapped file
+   * \return                 false at the end of the capture
+   */
+  bool next(const uint8_t *&payload, size_t &size);
+
+private:
+  uint32_t read32(const uint8_t *p) const;
+  bool udpPayload(const uint8_t *frame, size_t size, const uint8_t *&payload, size_t &payloadSize) const;
+
+private:
+  MappedFile m_file;
+  uint8_t *m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_bigEndian; // Byte order of the capture, from its magic number
+  uint32_t m_linkType;
+  int m_udpPort;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   StreamSampler
+    \brief       Sampling of memory-mapped Annex-B streams at arbitrary byte offsets : seek() resynchronizes on the next start
+                 code and then on the next parameter set (VPS / SPS) or IRAP NAL unit, next() parses from there and tells
+                 whether the NAL unit is trustworthy, i.e. an SPS and a PPS were parsed since the sync point
+                 Strided sampling : for (offset = 0; offset < size(); offset += stride) { seek(offset); while (next() && ...) }
+    \warning     POSIX only. The cost of a sample is the bytes scanned up to its sync point plus the bytes parsed, pages of
+                 the stream which are never touched are never read (built without sys/mman.h the whole stream is read by
+                 open(), see MappedFile)
+                 Parameter sets are forgotten at every seek(), NAL units before the first SPS / PPS of a sample are parsed
+                 without them (slice prefixes are invalid) and a PPS preceding every SPS is not parsed at all
+ */
+
+#include "nal_file.h"
+#include "nal_parse.h"
+
+static const uint64_t SAMPLE_MAX_SCAN = 32 << 20;
+
+class StreamSampler
+{
+public:
+  StreamSampler(videoCodecType codecType, parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX);
+  virtual ~StreamSampler();
+
+public:
+  /**
+   * \brief Map the stream, the codec is detected from its head when the constructor was given UNDEFINED
+   * \return false if the stream cannot be mapped or its codec is not detected
+   */
+  bool open(const char *streamPath);
+  void close();
+
+  /**
+   * \brief Resynchronize at 'offset' on the next parameter set or IRAP NAL unit
+   * \param maxScan          Bytes scanned for the sync point at most
+   * \return                 false when there is none before maxScan or the end of the stream
+   */
+  bool seek(uint64_t offset, uint64_t maxScan = SAMPLE_MAX_SCAN);
+
+  /**
+   * \brief Parse the next NAL unit after the sync point
+   * \return                 false at the end of the stream or without a sync point
+   */
+  bool next();
+
+  const nal_info &nal() const { return *m_parser.nal; }
+  uint64_t nalOffset() const { return m_nalOffset; } // Byte position of the last NAL unit parsed, start code included
+  uint32_t nalSize() const { return m_nalSize; }
+  uint64_t syncOffset() const { return m_syncOffset; }
+  bool trusted() const { return m_sps && m_pps; } // The last NAL unit was parsed with the SPS and PPS of this sample
+
+  videoCodecType codecType() const { return m_codecType; }
+  uint64_t size() const { return m_size; }
+
+private:
+  int nalUnitType(uint64_t pos) const;
+  bool isSyncPoint(int nalUnitType) const;
+
+private:
+  videoCodecType m_codecType;
+  parsingLevel m_level;
+  NALParse m_parser;
+
+  MappedFile m_file; // With a trailing zero page : start code searches may read a few bytes past the end
+  unsigned char *m_data;
+  uint64_t m_size;
+
+  bool m_synced;
+  uint64_t m_pos; // Start code of the next NAL unit
+  uint64_t m_syncOffset;
+  uint64_t m_nalOffset;
+  uint32_t m_nalSize;
+  bool m_sps;
+  bool m_pps;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   NalStatistics
+    \brief       NAL unit count and byte statistics by NAL unit type, category, TemporalId and nuh_layer_id, with the bitrate of
+                 each NAL unit type over a sliding window of access unit timestamps
+    \warning     One thread calls push(), any number of threads may call snapshot() concurrently : counters are published with a
+                 sequence lock, readers retry instead of blocking the parser and the parser never waits for them
+                 Timestamps must be in decoding order (DTS, or access unit count / frame rate), a jump backwards larger than the
+                 window restarts it
+ */
+
+#include "nal_parse.h"
+
+#include <atomic>
+
+enum class nalCategory
+{
+  NAL_CATEGORY_VCL = 0,
+  NAL_CATEGORY_PARAMETER_SET, // VPS, SPS, PPS, APS, DCI, OPI, subset / extension SPS
+  NAL_CATEGORY_SEI,
+  NAL_CATEGORY_FILLER,
+  NAL_CATEGORY_OTHER, // Delimiters, end of sequence / bitstream, picture header, prefix and reserved NAL units
+  NAL_CATEGORY_NUM
+};
+
+struct nal_counter
+{
+  uint64_t count;
+  uint64_t bytes;
+};
+
+struct nal_stats_snapshot
+{
+  static const int MAX_NAL_TYPES = 64;
+  static const int MAX_LAYERS = 64;
+  static const int NUM_CATEGORIES = static_cast<int>(nalCategory::NAL_CATEGORY_NUM);
+
+  uint64_t sequence; // Increases with every published update
+  nal_counter total;
+  nal_counter byType[MAX_NAL_TYPES];
+  nal_counter byCategory[NUM_CATEGORIES];
+  nal_counter byTemporalId[MAX_TLAYER];
+  nal_counter byLayer[MAX_LAYERS];
+  nal_counter byTypeAndTemporalId[MAX_NAL_TYPES][MAX_TLAYER];
+
+  double windowSeconds;               // Span of the window the bitrates are computed on, shorter at the start of the stream
+  double windowBitrate;               // Bits per second of all NAL units in the window
+  double windowBitrateByType[MAX_NAL_TYPES];
+  double windowBitrateByCategory[NUM_CATEGORIES];
+};
+
+class NalStatistics
+{
+public:
+  /**
+   * \param windowSeconds    Length of the sliding window, kept in NUM_BUCKETS buckets
+   */
+  NalStatistics(videoCodecType codecType, double windowSeconds = 1.0);
+  virtual ~NalStatistics();
+
+public:
+  /**
+   * \brief Count the NAL unit just parsed by NALParse::nal_parse() (any parsing level)
+   * \param size        Size of the NAL unit in bytes, start code included
+   * \param timestamp   Time of the access unit the NAL unit belongs to, in seconds
+   */
+  void push(const nal_info &nal, uint32_t size, double timestamp);
+
+  /**
+   * \brief Copy a consistent view of the counters, callable from any thread
+   */
+  void snapshot(nal_stats_snapshot &out) const;
+
+  nalCategory category(int nalUnitType) const;
+  void clear();
+
+private:
+  static const int NUM_BUCKETS = 16;
+  static const int MAX_NAL_TYPES = nal_stats_snapshot::MAX_NAL_TYPES;
+  static const int MAX_LAYERS = nal_stats_snapshot::MAX_LAYERS;
+  static const int NUM_CATEGORIES = nal_stats_snapshot::NUM_CATEGORIES;
+
+  struct atomic_counter
+  {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> bytes;
+  };
+
+  static void add(atomic_counter &c, uint64_t bytes);
+  static void load(const atomic_counter &c, nal_counter &out);
+  void advanceWindow(int64_t bucket);
+
+private:
+  videoCodecType m_codecType;
+  double m_bucketSeconds;
+
+  std::atomic<uint64_t> m_sequence; // Odd while push() updates the counters
+
+  atomic_counter m_total;
+  atomic_counter m_byType[MAX_NAL_TYPES];
+  atomic_counter m_byCategory[NUM_CATEGORIES];
+  atomic_counter m_byTemporalId[MAX_TLAYER];
+  atomic_counter m_byLayer[MAX_LAYERS];
+  atomic_counter m_byTypeAndTemporalId[MAX_NAL_TYPES][MAX_TLAYER];
+
+  // Ring of the bytes per NAL unit type of the last NUM_BUCKETS buckets, m_lastBucket is the newest one
+  std::atomic<uint64_t> m_bucketBytes[NUM_BUCKETS][MAX_NAL_TYPES];
+  std::atomic<int64_t> m_lastBucket;
+  std::atomic<int64_t> m_firstBucket; // Oldest bucket since the window (re)started
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   TimecodeEngine
+    \brief       Convert clock timestamps of SEI (H264/AVC picture timing, H265/HEVC time code) to SMPTE timecodes and 64-bit timestamps
+    \warning     Feed access units in decoding order, one call per access unit
+ */
+
+#include "nal_parse.h"
+
+#include <string>
+#include <vector>
+
+enum timecodeFlag
+{
+  TIMECODE_VALID = 0x01,         // Entry carries a timecode (signalled or extrapolated)
+  TIMECODE_DROP_FRAME = 0x02,    // counting_type 4 : n_frames 0 and 1 (0 to 3 at 60 fps) are dropped at every minute except each tenth
+  TIMECODE_FIELD_BASED = 0x04,   // nuit_field_based_flag : one unit of n_frames lasts two clock ticks
+  TIMECODE_DISCONTINUITY = 0x08, // Signalled discontinuity_flag or a jump from the previous entry
+  TIMECODE_EXTRAPOLATED = 0x10,  // Access unit without clock timestamp, continued from the previous entry
+};
+
+/** Compact per access unit record (16 bytes), meant to be stored in long arrays */
+struct timecode_entry
+{
+  int64_t timestamp; // Clock time in units of 1/time_scale seconds, drop-frame corrected (-1 when no timing information)
+  uint16_t frames;   // Normalized SMPTE label HH:MM:SS:FF
+  uint8_t hours;
+  uint8_t minutes;
+  uint8_t seconds;
+  uint8_t flags; // Combination of timecodeFlag
+  uint16_t reserved;
+};
+
+class TimecodeEngine
+{
+public:
+  TimecodeEngine();
+  virtual ~TimecodeEngine();
+
+public:
+  /**
+   * \brief Set clock tick of the sequence (num_units_in_tick / time_scale of VUI)
+   */
+  void setTiming(uint32_t numUnitsInTick, uint32_t timeScale);
+  void setTiming(const avc::sps *sps);
+  void setTiming(const hevc::sps *sps);
+
+  /**
+   * \brief Append the timecode of one access unit, returns false when the SEI carries no clock timestamp
+   *        (the access unit is then extrapolated from the previous entry)
+   */
+  bool push(const SEITimeCode &sei);
+  bool push(const SEIPictureTimingH264 &sei);
+  void pushWithoutTimecode();
+
+  /**
+   * \brief Index of the first access unit at or after 'timestamp' inside the first continuous segment covering it, size() if none
+   *        Timestamps only increase inside a segment, so each segment is binary searched
+   */
+  size_t find(int64_t timestamp) const;
+
+  const std::vector<timecode_entry> &entries() const { return m_entries; }
+  size_t size() const { return m_entries.size(); }
+  void reserve(size_t numAccessUnits) { m_entries.reserve(numAccessUnits); }
+  void clear();
+
+  static std::string toString(const timecode_entry &entry);
+
+private:
+  void append(const SEITimeSet &ts);
+  int64_t labelToFrameNumber(int hours, int minutes, int seconds, int frames, bool dropFrame) const;
+  void frameNumberToLabel(int64_t frameNumber, bool dropFrame, timecode_entry &entry) const;
+
+private:
+  uint32_t m_numUnitsInTick;
+  uint32_t m_timeScale;
+
+  SEITimeSet m_prevTimeSet; // Values inferred for partial timestamps (full_timestamp_flag equal to 0)
+  int64_t m_prevFrameNumber;
+  bool m_prevFieldBased;
+  bool m_prevDropFrame;
+
+  std::vector<timecode_entry> m_entries;
+  std::vector<size_t> m_segmentStart;
+};
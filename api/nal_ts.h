@@ -0,0 +1,128 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   TsDemuxer
+    \brief       MPEG-2 transport stream front end (ISO/IEC 13818-1) : the PAT and PMT give the PID of the video stream (stream_type
+                 0x1B H264/AVC, 0x24 H265/HEVC, 0x33 H266/VVC), its PES payloads are scanned for start codes as they arrive and
+                 every NAL unit is handed to NALParse::nal_parse_scatter() as the list of its pieces in the TS packets
+                 Access units are assembled by AccessUnitAssembler and carry the PTS / DTS of the PES packet they start in
+    \warning     188-byte packets only. Pieces are parsed where they lie in the data given to push(), only the part of a NAL
+                 unit still open at the end of push() is copied (the first bytes of a slice, whole non-VCL NAL units)
+                 Offsets of the access units count bytes of the elementary stream, not of the transport stream
+                 A continuity counter error drops the NAL unit in progress
+ */
+
+#include "nal_parse.h"
+#include "nal_au.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+static const int TS_PACKET_SIZE = 188;
+static const size_t TS_MAX_PES_TIMESTAMPS = 256; // PES packets waiting for the access unit starting in them
+
+enum tsStreamType
+{
+  TS_STREAM_TYPE_H264 = 0x1B,
+  TS_STREAM_TYPE_H265 = 0x24,
+  TS_STREAM_TYPE_H266 = 0x33
+};
+
+struct ts_stats
+{
+  uint64_t packets;
+  uint64_t syncLosses;         // Bytes skipped to find the sync byte again
+  uint64_t continuityErrors;
+  uint64_t transportErrors;    // Packets with transport_error_indicator set, ignored
+  uint64_t crcErrors;          // PSI sections failing CRC_32, ignored
+  uint64_t pesPackets;
+  uint64_t nalUnits;
+  uint64_t copiedBytes;        // Bytes of NAL units copied because they stayed open at the end of push()
+};
+
+class TsDemuxer
+{
+public:
+  /**
+   * \param pid              PID of the video stream, -1 for the first H264 / H265 / H266 stream of the first PMT
+   */
+  TsDemuxer(parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX, int pid = -1);
+  virtual ~TsDemuxer();
+
+public:
+  /**
+   * \brief Demux the following bytes of the transport stream, split anywhere, and append the access units completed
+   */
+  void push(const uint8_t *data, size_t size, std::vector<access_unit> &aus);
+
+  /**
+   * \brief End of the stream : the last NAL unit and access unit are completed
+   */
+  void flush(std::vector<access_unit> &aus);
+
+  void clear();
+
+  videoCodecType codecType() const { return m_codecType; } // UNDEFINED until the PMT was found
+  int pid() const { return m_pid; }
+  const nal_info &nal() const { return *m_parser.nal; } // Last NAL unit parsed
+  const ts_stats &stats() const { return m_stats; }
+
+private:
+  struct psi_section
+  {
+    std::vector<uint8_t> data;
+    int continuity;
+  };
+
+  struct pes_timestamp
+  {
+    uint64_t offset; // Elementary stream byte position of the PES payload
+    int64_t pts;     // -1 for a PES packet without PTS
+    int64_t dts;
+    bool used;
+  };
+
+  void packet(const uint8_t *p);
+  void psiPayload(int pid, const uint8_t *payload, int size, bool unitStart);
+  void section(int pid, const uint8_t *data, int size);
+  void pesPayload(const uint8_t *payload, int size, bool unitStart);
+  void esBytes(const uint8_t *data, size_t size);
+  void appendNal(const uint8_t *data, size_t size);
+  void endNal(size_t trailingZeros);
+  void keepOpenNal();
+  void dropNal();
+  void complete(std::vector<access_unit> &aus);
+
+private:
+  parsingLevel m_level;
+  int m_pid;
+  bool m_pidFixed;
+  videoCodecType m_codecType;
+  NALParse m_parser;
+  AccessUnitAssembler *m_assembler;
+  ts_stats m_stats;
+
+  std::map<int, int> m_pmtPids; // PID of the PMT to program_number
+  std::map<int, psi_section> m_sections;
+  int m_continuity; // Of the video PID, -1 before its first packet
+
+  uint8_t m_partial[TS_PACKET_SIZE]; // Packet split across two push() calls
+  int m_partialSize;
+
+  bool m_inPes;
+  std::deque<pes_timestamp> m_timestamps;
+
+  // Start code scan and the NAL unit in progress
+  uint64_t m_esOffset; // Elementary stream bytes scanned
+  int m_zeros;         // Zero bytes ending the bytes scanned, up to 3
+  bool m_inNal;
+  uint64_t m_nalOffset; // Start code of the NAL unit in progress
+  uint32_t m_startCodeSize;
+  uint64_t m_nalSize;   // Bytes after the start code
+  uint64_t m_nalKept;   // Bytes of m_fragments, at most nal_bytes_needed()
+  uint32_t m_nalNeeded;
+  std::vector<nal_buffer> m_fragments;
+  std::vector<uint8_t> m_carry; // Open NAL unit copied at the end of push(), first fragment when not empty
+  std::vector<access_unit> *m_out;
+};
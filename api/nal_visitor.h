@@ -0,0 +1,192 @@
+#pragma once
+
+/** \author      Dongjae Won
+    \interface   NalEventParser
+    \brief       Event driven parsing : parameter sets, SEI messages, slice prefixes and access unit ends are handed to a visitor
+                 while the stream is parsed, nothing is collected before the caller sees it
+    \warning     Visitor calls are bound at compile time : derive from nal_visitor and declare only the events of interest, the
+                 remaining ones are empty inline functions the compiler removes
+                 Objects handed to an event are valid during the call only (parameter sets are overwritten by the next one)
+                 on_au_end() fires when the first slice of the next access unit arrives, so after the events of the non-VCL NAL
+                 units opening that access unit, or at flush()
+ */
+
+#include "nal_parse.h"
+#include "nal_au.h"
+
+#include <stdint.h>
+
+struct sei_view
+{
+  int payloadType;
+  const uint8_t *payload; // sei_payload() without emulation prevention bytes
+  uint32_t payloadSize;
+};
+
+/**
+ * \brief Read the sei_message() at 'pos' of an SEI RBSP (after the NAL unit header) and move 'pos' past it
+ * \return false at the RBSP trailing bits or when the message is truncated
+ */
+bool NextSeiMessage(const uint8_t *rbsp, size_t size, size_t &pos, sei_view &sei);
+
+// Events of a visitor, all empty : parameter set events are templates so one visitor may serve every codec
+struct nal_visitor
+{
+  void on_nal(const nal_info &, int64_t, uint32_t) {} // Every NAL unit, before its other events
+  template <typename VPS>
+  void on_vps(const nal_info &, const VPS &) {}
+  template <typename SPS>
+  void on_sps(const nal_info &, const SPS &) {}
+  template <typename PPS>
+  void on_pps(const nal_info &, const PPS &) {}
+  void on_aps(const nal_info &, const vvc::APS &) {} // Only available in VVC
+  void on_sei(const nal_info &, const sei_view &) {}
+  void on_slice_prefix(const nal_info &, const slice_prefix &) {} // With parsingLevel::PARSING_SLICE_PREFIX
+  void on_au_end(const access_unit &) {}
+};
+
+// Codec specific part of NalEventParser, only the parameter set types of one codec are instantiated
+template <videoCodecType Codec>
+struct nal_event_dispatch;
+
+template <>
+struct nal_event_dispatch<videoCodecType::H264_AVC>
+{
+  static bool isSei(int nalUnitType) { return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SEI); }
+
+  template <class Visitor>
+  static void paramSet(Visitor &visitor, const nal_info &nal)
+  {
+    const param_set &ps = nal.mpegParamSet;
+    if (nal.nal_unit_type == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SPS) && ps.sps)
+      visitor.on_sps(nal, *static_cast<const avc::sps *>(ps.sps));
+    else if (nal.nal_unit_type == static_cast<int>(avc::h264_nal_type::NALU_TYPE_PPS) && ps.pps)
+      visitor.on_pps(nal, *static_cast<const avc::pps *>(ps.pps));
+  }
+};
+
+template <>
+struct nal_event_dispatch<videoCodecType::H265_HEVC>
+{
+  static bool isSei(int nalUnitType)
+  {
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI) || nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI);
+  }
+
+  template <class Visitor>
+  static void paramSet(Visitor &visitor, const nal_info &nal)
+  {
+    const param_set &ps = nal.mpegParamSet;
+    if (nal.nal_unit_type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_VPS) && ps.vps)
+      visitor.on_vps(nal, *static_cast<const hevc::vps *>(ps.vps));
+    else if (nal.nal_unit_type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SPS) && ps.sps)
+      visitor.on_sps(nal, *static_cast<const hevc::sps *>(ps.sps));
+    else if (nal.nal_unit_type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PPS) && ps.pps)
+      visitor.on_pps(nal, *static_cast<const hevc::pps *>(ps.pps));
+  }
+};
+
+template <>
+struct nal_event_dispatch<videoCodecType::H266_VVC>
+{
+  static bool isSei(int nalUnitType) { return nalUnitType == vvc::NAL_UNIT_PREFIX_SEI || nalUnitType == vvc::NAL_UNIT_SUFFIX_SEI; }
+
+  template <class Visitor>
+  static void paramSet(Visitor &visitor, const nal_info &nal)
+  {
+    const param_set &ps = nal.mpegParamSet;
+    if (nal.nal_unit_type == vvc::NAL_UNIT_VPS && ps.vps)
+      visitor.on_vps(nal, *static_cast<const vvc::VPS *>(ps.vps));
+    else if (nal.nal_unit_type == vvc::NAL_UNIT_SPS && ps.sps)
+      visitor.on_sps(nal, *static_cast<const vvc::SPS *>(ps.sps));
+    else if (nal.nal_unit_type == vvc::NAL_UNIT_PPS && ps.pps)
+      visitor.on_pps(nal, *static_cast<const vvc::PPS *>(ps.pps));
+    else if ((nal.nal_unit_type == vvc::NAL_UNIT_PREFIX_APS || nal.nal_unit_type == vvc::NAL_UNIT_SUFFIX_APS) && ps.aps)
+      visitor.on_aps(nal, *static_cast<const vvc::APS *>(ps.aps));
+  }
+};
+
+template <videoCodecType Codec, class Visitor>
+class NalEventParser
+{
+public:
+  NalEventParser(Visitor &visitor, parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX)
+      : m_visitor(visitor), m_level(level), m_assembler(Codec, level), m_offset(0)
+  {
+  }
+  virtual ~NalEventParser() {}
+
+public:
+  /**
+   * \brief Parse an Annex-B byte stream, may be called again with the following data (split at NAL unit boundaries)
+   */
+  void parse(unsigned char *buffer, int size)
+  {
+    int pos = 0;
+    while (pos < size)
+    {
+      const int start = pos;
+      m_parser.nal_parse(buffer, Codec, pos, size, m_level);
+      notify(m_offset + start, static_cast<uint32_t>(pos - start));
+    }
+    m_offset += size;
+  }
+
+  /**
+   * \brief Parse NAL units handed over already split (RTP, MP4 samples, MPEG-2 TS), see NALParse::nal_parse_batch()
+   */
+  void parse(const nal_buffer *nals, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      m_parser.nal_parse_unit(nals[i].data, nals[i].size, Codec, m_level);
+      if (m_parser.nal->nal_unit_type >= 0)
+        notify(m_offset, nals[i].size);
+      m_offset += nals[i].size;
+    }
+  }
+
+  /**
+   * \brief End of the stream : completes the last access unit
+   */
+  void flush()
+  {
+    if (m_assembler.flush())
+      m_visitor.on_au_end(m_assembler.au());
+  }
+
+  const nal_info &nal() const { return *m_parser.nal; }
+
+private:
+  void notify(int64_t offset, uint32_t size)
+  {
+    const nal_info &nal = *m_parser.nal;
+    if (m_assembler.push(nal, offset, size))
+      m_visitor.on_au_end(m_assembler.au());
+
+    m_visitor.on_nal(nal, offset, size);
+    if (nal.slice.valid)
+    {
+      m_visitor.on_slice_prefix(nal, nal.slice);
+      return;
+    }
+    if (m_level == parsingLevel::PARSING_NONE)
+      return;
+    if (nal_event_dispatch<Codec>::isSei(nal.nal_unit_type))
+    {
+      size_t pos = 0;
+      sei_view sei;
+      while (NextSeiMessage(m_parser.rbsp(), m_parser.rbspSize(), pos, sei))
+        m_visitor.on_sei(nal, sei);
+      return;
+    }
+    nal_event_dispatch<Codec>::paramSet(m_visitor, nal);
+  }
+
+private:
+  Visitor &m_visitor;
+  parsingLevel m_level;
+  NALParse m_parser;
+  AccessUnitAssembler m_assembler;
+  int64_t m_offset; // Byte position of the data given to the next parse()
+};
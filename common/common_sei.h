@@ -16,9 +16,14 @@ struct SEI
     PICTURE_TIMING = 1,
     USER_DATA_REGISTERED_ITU_T_T35 = 4,
     USER_DATA_UNREGISTERED = 5,
+    RECOVERY_POINT = 6,
+    DECODING_UNIT_INFO = 130,
+    SCALABLE_NESTING = 133,
     TIME_CODE = 136,
     MASTERING_DISPLAY_COLOUR_VOLUME = 137,
     CONTENT_LIGHT_LEVEL_INFO = 144,
+    DEPENDENT_RAP_INDICATION = 145,
+    EXTENDED_DRAP_INDICATION = 206,
   };
 
   virtual PayloadType payloadType() const = 0;
@@ -38,6 +43,32 @@ struct SEIBufferingPeriod : public SEI
   uint32_t initialAltCpbRemovalDelayOffset[MAX_CPB_CNT][2];
   bool concatenationFlag;
   uint32_t auCpbRemovalDelayDelta;
+
+  // H.266/VVC signals the HRD code lengths and per sub-layer delays in the buffering period itself
+  bool bpNalCpbParamsPresentFlag;
+  bool bpVclCpbParamsPresentFlag;
+  uint32_t initialCpbRemovalDelayLength;
+  uint32_t cpbRemovalDelayLength;
+  uint32_t dpbOutputDelayLength;
+  bool bpDecodingUnitHrdParamsPresentFlag;
+  uint32_t duCpbRemovalDelayIncrementLength;
+  uint32_t dpbOutputDelayDuLength;
+  bool decodingUnitCpbParamsInPicTimingSeiFlag;
+  bool decodingUnitDpbDuParamsInPicTimingSeiFlag;
+  bool additionalConcatenationInfoPresentFlag;
+  uint32_t maxInitialRemovalDelayForConcatenation;
+  uint32_t bpMaxSubLayers;
+  bool cpbRemovalDelayDeltasPresentFlag;
+  uint32_t numCpbRemovalDelayDeltas;
+  uint32_t cpbRemovalDelayDelta[16];
+  uint32_t bpCpbCnt;
+  bool sublayerInitialCpbRemovalDelayPresentFlag;
+  uint32_t sublayerInitialCpbRemovalDelay[MAX_TLAYER][MAX_CPB_CNT][2];
+  uint32_t sublayerInitialCpbRemovalOffset[MAX_TLAYER][MAX_CPB_CNT][2];
+  bool sublayerDpbOutputOffsetsPresentFlag;
+  uint32_t dpbOutputTidOffset[MAX_TLAYER];
+  bool altCpbParamsPresentFlag;
+  bool useAltCpbParamsFlag;
 };
 
 struct SEIPictureTimingH264 : public SEI
@@ -107,6 +138,7 @@ struct SEIPictureTimingH266 : public SEI
   std::vector<std::vector<uint32_t>> m_vclCpbAltInitialRemovalOffsetDelta;
   std::vector<uint32_t> m_vclCpbDelayOffset;
   std::vector<uint32_t> m_vclDpbDelayOffset;
+  bool m_delayForConcatenationEnsureFlag;
   int m_ptDisplayElementalPeriodsMinus1;
 };
 
@@ -172,3 +204,65 @@ struct SEIContentLightLevelInfo : public SEI
   uint16_t max_content_light_level;     // MaxCLL
   uint16_t max_pic_average_light_level; // MaxFALL
 };
+
+struct SEIRecoveryPoint : public SEI
+{
+  PayloadType payloadType() const override { return RECOVERY_POINT; }
+
+  int recoveryPocCnt; // recovery_frame_cnt (H264) or recovery_poc_cnt (H265, H266)
+  bool exactMatchingFlag;
+  bool brokenLinkFlag;
+  uint8_t changingSliceGroupIdc; // Only in H264/AVC
+};
+
+struct SEIDependentRAPIndication : public SEI
+{
+  PayloadType payloadType() const override { return DEPENDENT_RAP_INDICATION; }
+  // Empty payload, the presence of the message marks the associated picture as DRAP picture
+};
+
+struct SEIExtendedDrapIndication : public SEI
+{
+  PayloadType payloadType() const override { return EXTENDED_DRAP_INDICATION; }
+
+  uint32_t edrapIdx; // edrap_rap_id_minus1 + 1
+  bool edrapLeadingPicDecodableFlag;
+  uint32_t edrapReservedZero12Bits;
+  uint32_t edrapNumRefRapPicsMinus1;
+  std::vector<uint32_t> edrapRefRapId;
+};
+
+struct SEIDecodingUnitInfo : public SEI
+{
+  PayloadType payloadType() const override { return DECODING_UNIT_INFO; }
+
+  uint32_t decodingUnitIdx;
+  bool subLayerDelaysPresentFlag[MAX_TLAYER];       // H265/HEVC only signals the highest sub-layer (sps_max_sub_layers_minus1)
+  uint32_t duSptCpbRemovalDelayIncrement[MAX_TLAYER]; // Clock sub-ticks between this decoding unit and the last one of the access unit
+  bool dpbOutputDuDelayPresentFlag;
+  uint32_t picSptDpbOutputDuDelay;
+};
+
+struct SEINestedMessage
+{
+  int payloadType;
+  uint32_t payloadSize;
+  uint32_t payloadOffset; // Byte offset of the payload in the SEI RBSP (after the NAL unit header), the payload is not copied
+  bool applied;           // Interpreted into the regular SEI structures because it targets the selected OLS / layer / sub-layer
+};
+
+struct SEIScalableNesting : public SEI
+{
+  PayloadType payloadType() const override { return SCALABLE_NESTING; }
+
+  bool bitstreamSubsetFlag; // Only in H265/HEVC
+  bool olsFlag;             // sn_ols_flag (H266) or nesting_op_flag (H265)
+  bool defaultOpFlag;       // Only in H265/HEVC
+  bool subpicFlag;          // Only in H266/VVC
+  bool allLayersFlag;
+  std::vector<uint32_t> olsIdx;        // NestingOlsIdx (H266) or nesting_op_idx (H265)
+  std::vector<uint32_t> maxTemporalId; // Highest sub-layer of each olsIdx entry (H265), or a single entry for the layer list
+  std::vector<uint32_t> layerId;
+  std::vector<uint32_t> subpicId;
+  std::vector<SEINestedMessage> nestedMessages;
+};
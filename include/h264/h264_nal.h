@@ -26,6 +26,7 @@ public:
   void sps_parse(unsigned char *nal_bitstream, avc::sps *sps, int curLen, parsingLevel level) override;
   void pps_parse(unsigned char *nal_bitstream, avc::pps *pps, avc::sps *sps, int curLen, parsingLevel level) override;
   void sei_parse(unsigned char *msg, nal_info &nal, int curLen) override;
+  void slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) override;
 
 protected:
   Bitstream *m_bits{new Bitstream};
@@ -39,4 +40,5 @@ public:
   void interpret_picture_timing_info(unsigned char *payload, int size, avc::sps *sps, SEIPictureTimingH264 &sei);    // SEI Type = 1
   void interpret_user_data_registered_itu_t_t35_info(unsigned char *payload, int size, SEIUserDataRegistered &sei);                       // SEI Type = 4
   void interpret_user_data_unregistered_info(unsigned char *payload, int size, SEIUserDataUnregistered &sei);                             // SEI Type = 5
+  void interpret_recovery_point_info(unsigned char *payload, int size, SEIRecoveryPoint &sei);                                           // SEI Type = 6
 };
\ No newline at end of file
@@ -53,6 +53,7 @@ namespace avc
     NALU_TYPE_FILL = 12,
     NALU_TYPE_PREFIX = 14,
     NALU_TYPE_SUB_SPS = 15,
+    NALU_TYPE_AUX_SLICE = 19,
     NALU_TYPE_SLC_EXT = 20,
     NALU_TYPE_VDRD = 24
   };
@@ -3,7 +3,7 @@
 #include "hevc_vlc.h"
 #include "nal_parse.h"
 
-class parseNalH265 : public parseLib<hevc:: vps, hevc::sps, hevc::pps>, public SyntaxElementParser, public TComInputBitstream
+class parseNalH265 final : public parseLib<hevc:: vps, hevc::sps, hevc::pps>, public SyntaxElementParser, public TComInputBitstream
 {
 public:
   parseNalH265(){};
@@ -16,6 +16,15 @@ public:
     }
   };
 
+  /**
+   * \brief Empty the bitstream so that the same object parses the next NAL unit
+   */
+  void reset()
+  {
+    m_bits->m_fifo.clear();
+    m_bits->resetToStart();
+  }
+
 protected:
   void parseShortTermRefPicSet(hevc::sps *pcSPS, hevc::TComReferencePictureSet *pcRPS, int idx);
   void parseVUI(hevc::TComVUI *pcVUI, hevc::sps *pcSPS);
@@ -30,9 +39,25 @@ public:
   void sps_parse(unsigned char *nal_bitstream, hevc::sps *pcSPS, int curLen, parsingLevel level) override;
   void pps_parse(unsigned char *nal_bitstream, hevc::pps *pcPPS, hevc::sps *pcSPS, int curLen, parsingLevel level) override;
   void sei_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) override;
+  void slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) override;
+  /**
+   * \brief Parse the whole slice segment header and fill nal.slice and nal.entry
+   * \param curLen        Bytes of nal_bitstream (RBSP from the NAL unit header on), padding included
+   * \param dataLen       Bytes of nal_bitstream unescaped from the NAL unit, the padding follows them
+   * \param epbLocation   Byte positions of the emulation prevention bytes removed, from the NAL unit header on
+   * \param headerOffset  Byte position of the NAL unit header in the NAL unit (start code length)
+   * \param nalSize       Size of the NAL unit in bytes, start code included
+   * \return              false when the slice segment header could not be parsed completely within dataLen bytes
+   *                      (truncated, or not conforming)
+   */
+  bool slice_header_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen, int dataLen, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize);
 
 private:
   void sortDeltaPOC();
+  void xParseSliceHeaderPrefix(nal_info &nal);
+  bool xParseSliceHeaderRest(nal_info &nal, int dataLen, std::vector<uint32_t> &entryPointOffset);
+  void xParsePredWeightTable(const hevc::sps *sps, bool bSlice, const unsigned int numRefIdx[2]);
+  void xSetSubstreams(nal_info &nal, const std::vector<uint32_t> &entryPointOffset, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize);
   void xDecodeScalingList(hevc::TComScalingList *scalingList, unsigned int sizeId, unsigned int listId);
   TComInputBitstream *m_bits{new TComInputBitstream};
 
@@ -55,7 +80,7 @@ public:
   // void xParseSEIFillerPayload(SEIFillerPayload &sei, unsigned int payloadSize);
   void xParseSEIUserDataRegistered(SEIUserDataRegistered &sei, unsigned int payloadSize);
   void xParseSEIUserDataUnregistered(SEIUserDataUnregistered &sei, unsigned int payloadSize);
-  // void xParseSEIRecoveryPoint(SEIRecoveryPoint &sei, unsigned int payloadSize);
+  void xParseSEIRecoveryPoint(SEIRecoveryPoint &sei, unsigned int payloadSize);
   // void xParseSEISceneInfo(SEISceneInfo &sei, unsigned int payloadSize);
   // void xParseSEIPictureSnapshot(SEIPictureSnapshot &sei, unsigned int payloadSize);
   // void xParseSEIProgressiveRefinementSegmentStart(SEIProgressiveRefinementSegmentStart &sei, unsigned int payloadSize);
@@ -68,10 +93,11 @@ public:
   // void xParseSEIGreenMetadataInfo(SEIGreenMetadataInfo &sei, unsigned int payLoadSize);
   // void xParseSEISOPDescription(SEISOPDescription &sei, unsigned int payloadSize);
   // void xParseSEIActiveParameterSets(SEIActiveParameterSets &sei, unsigned int payloadSize);
-  // void xParseSEIDecodingUnitInfo(SEIDecodingUnitInfo &sei, unsigned int payloadSize, const sps *sps);
+  void xParseSEIDecodingUnitInfo(SEIDecodingUnitInfo &sei, unsigned int payloadSize, const hevc::sps *sps);
   // void xParseSEITemporalLevel0Index(SEITemporalLevel0Index &sei, unsigned int payloadSize);
   // void xParseSEIDecodedPictureHash(SEIDecodedPictureHash &sei, unsigned int payloadSize);
-  // void xParseSEIScalableNesting(SEIScalableNesting &sei, const NalUnitType nalUnitType, unsigned int payloadSize, const sps *sps);
+  void xParseSEIScalableNesting(SEIScalableNesting &sei, nal_info &nal, hevc::hevc_nal_type nalUnitType, unsigned int payloadSize, hevc::sps *sps);
+  bool xNestingAppliesToTarget(const SEIScalableNesting &sei, const nal_info &nal, const hevc::sps *sps);
   // void xParseSEIRegionRefreshInfo(SEIRegionRefreshInfo &sei, unsigned int payloadSize);
   // void xParseSEINoDisplay(SEINoDisplay &sei, unsigned int payloadSize);
   void xParseSEITimeCode(SEITimeCode &sei, unsigned int payloadSize);
@@ -92,7 +118,7 @@ public:
   // void xParseSEIColourRemappingInfo(SEIColourRemappingInfo &sei, unsigned int payloadSize);
   // void xParseSEIDeinterlaceFieldIdentification(SEIDeinterlaceFieldIdentification &sei, unsigned int payLoadSize);
   // void xParseSEIContentLightLevelInfo(SEIContentLightLevelInfo &sei, unsigned int payLoadSize);
-  // void xParseSEIDependentRAPIndication(SEIDependentRAPIndication &sei, unsigned int payLoadSize);
+  void xParseSEIDependentRAPIndication(SEIDependentRAPIndication &sei, unsigned int payLoadSize);
   // void xParseSEICodedRegionCompletion(SEICodedRegionCompletion &sei, unsigned int payLoadSize);
   // void xParseSEIAlternativeTransferCharacteristics(SEIAlternativeTransferCharacteristics &sei, unsigned int payLoadSize);
   // void xParseSEIAmbientViewingEnvironment(SEIAmbientViewingEnvironment &sei, unsigned int payLoadSize);
@@ -3,7 +3,7 @@
 #include "vvc_vlc.h"
 #include "nal_parse.h"
 
-class parseNalH266 : public parseLib<vvc::VPS, vvc::SPS, vvc::PPS>, public VLCReader, public InputBitstream
+class parseNalH266 final : public parseLib<vvc::VPS, vvc::SPS, vvc::PPS>, public VLCReader, public InputBitstream
 {
 public:
   parseNalH266(){};
@@ -16,6 +16,15 @@ public:
     }
   };
 
+  /**
+   * \brief Empty the bitstream so that the same object parses the next NAL unit
+   */
+  void reset()
+  {
+    m_bits->m_fifo.clear();
+    m_bits->resetToStart();
+  }
+
 protected:
   void copyRefPicList(vvc::SPS *pcSPS, vvc::ReferencePictureList *source_rpl, vvc::ReferencePictureList *dest_rpl);
   void parseRefPicList(vvc::SPS *pcSPS, vvc::ReferencePictureList *rpl, int rplIdx);
@@ -43,14 +52,36 @@ public:
   void pps_parse(unsigned char *nal_bitstream, vvc::PPS *pcPPS, vvc::SPS *pcSPS, int curLen, parsingLevel level) override;
   void aps_parse(unsigned char *nal_bitstream, vvc::APS *aps, int curLen, parsingLevel level);
   void sei_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) override;
+  void slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen) override;
+  /**
+   * \brief Parse the whole picture header or slice header and fill nal.slice and nal.entry
+   * \param curLen        Bytes of nal_bitstream (RBSP after the NAL unit header), padding included
+   * \param dataLen       Bytes of nal_bitstream unescaped from the NAL unit, the padding follows them
+   * \param epbLocation   Byte positions of the emulation prevention bytes removed, after the NAL unit header
+   * \param headerOffset  Byte position of the RBSP in the NAL unit (start code and NAL unit header lengths)
+   * \param nalSize       Size of the NAL unit in bytes, start code included
+   * \return              false when the header could not be parsed completely within dataLen bytes (truncated, or not
+   *                      conforming)
+   */
+  bool slice_header_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen, int dataLen, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize);
   void alf_aps_parse(vvc::APS *aps);
   void lmcs_aps_parse(vvc::APS *aps);
   void scalinglist_aps_parse(vvc::APS *aps);
 protected:
   bool xMoreRbspData();
+  bool xActivateParamSets(nal_info &nal);
+  bool xParsePictureHeaderPrefix(nal_info &nal);
+  bool xParsePictureHeaderRest(nal_info &nal, int dataLen);
+  bool xParseSliceHeader(nal_info &nal, int dataLen, std::vector<uint32_t> *entryPointOffset);
+  void xParseRefPicLists(vvc::SPS *sps, const vvc::PPS *pps, uint32_t numRefEntries[2]);
+  void xParsePredWeightTable(const vvc::SPS *sps, const vvc::PPS *pps, const uint32_t numRefIdx[2], const uint32_t numRefEntries[2]);
+  void xParseAlfInfo(const vvc::SPS *sps);
+  void xParseDeblockingParams(const vvc::PPS *pps);
+  void xSetSubstreams(nal_info &nal, const std::vector<uint32_t> &entryPointOffset, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize);
 
 private:  
   InputBitstream *m_bits{new InputBitstream};
+  std::vector<uint32_t> m_ctuAddrInSlice; // CtbAddrInCurrSlice of the last slice header parsed
 };
 
 class parseSeiH266 : public VLCReader, public InputBitstream
@@ -61,19 +92,21 @@ public:
   // void parseSEImessage(InputBitstream *bs, SEIMessages &seis, const NalUnitType nalUnitType, const uint32_t nuh_layer_id, const uint32_t temporalId, const VPS *vps, const SPS *sps, HRD &hrd, );
   // void parseAndExtractSEIScalableNesting(InputBitstream *bs, const NalUnitType nalUnitType, const uint32_t nuh_layer_id, const VPS *vps, const SPS *sps, HRD &hrd, uint32_t payloadSize, std::vector<std::tuple<int, int, bool, uint32_t, uint8_t *, int, int>> *seiList);
   // void getSEIDecodingUnitInfoDuiIdx(InputBitstream *bs, const NalUnitType nalUnitType, const uint32_t nuh_layer_id, HRD &hrd, uint32_t payloadSize, int &duiIdx);
+  void xReadSEIPayloadData(int payloadType, int payloadSize, nal_info &nal, vvc::NalUnitType nalUnitType, uint32_t temporalId, InputBitstream *bits);
 
 protected:
-  // void xParseSEIuserDataUnregistered          (SEIuserDataUnregistered &sei,          uint32_t payloadSize,                      );
-  // void xParseSEIDecodingUnitInfo              (SEIDecodingUnitInfo& sei,              uint32_t payloadSize, const SEIBufferingPeriod& bp, const uint32_t temporalId,  );
+  void xParseSEIUserDataUnregistered(SEIUserDataUnregistered &sei, uint32_t payloadSize);
+  void xParseSEIRecoveryPoint(SEIRecoveryPoint &sei);
+  void xParseSEIDecodingUnitInfo(SEIDecodingUnitInfo &sei, const SEIBufferingPeriod &bp, const uint32_t temporalId);
   // void xParseSEIDecodedPictureHash            (SEIDecodedPictureHash& sei,            uint32_t payloadSize,                      );
-  void xParseSEIBufferingPeriod(SEIBufferingPeriod &sei, uint32_t payloadSize);
+  bool xParseSEIBufferingPeriod(SEIBufferingPeriod &sei);
   void xParseSEIPictureTiming(SEIPictureTimingH266 &sei, uint32_t payloadSize, const uint32_t temporalId, const SEIBufferingPeriod &bp);
-  // void xParseSEIScalableNesting               (SEIScalableNesting& sei, const NalUnitType nalUnitType, const uint32_t nuhLayerId, uint32_t payloadSize, const VPS* vps, const SPS* sps, HRD &hrd, std::ostream* decodedMessageOutputStream);
+  void xParseSEIScalableNesting(SEIScalableNesting &sei, nal_info &nal, vvc::NalUnitType nalUnitType, uint32_t temporalId, uint32_t payloadSize);
+  bool xNestingAppliesToTarget(const SEIScalableNesting &sei, const nal_info &nal);
   // void xParseSEIScalableNestingBinary         (SEIScalableNesting& sei, const NalUnitType nalUnitType, const uint32_t nuhLayerId, uint32_t payloadSize, const VPS* vps, const SPS* sps, HRD &hrd, std::ostream* decodedMessageOutputStream, std::vector<std::tuple<int, int, bool, uint32_t, uint8_t*, int, int>> *seiList);
   // void xCheckScalableNestingConstraints       (const SEIScalableNesting& sei, const NalUnitType nalUnitType, const VPS* vps);
   // void xParseSEIFrameFieldinfo                (SEIFrameFieldInfo& sei,                uint32_t payloadSize,  );
   // void xParseSEIGreenMetadataInfo             (SEIGreenMetadataInfo& sei,             uint32_t payLoadSize,                      );
-  // void xParseSEIDependentRAPIndication        (SEIDependentRAPIndication& sei,        uint32_t payLoadSize,                      );
   // void xParseSEIFramePacking                  (SEIFramePacking& sei,                  uint32_t payloadSize,                      );
   // void xParseSEIDisplayOrientation            (SEIDisplayOrientation& sei,            uint32_t payloadSize,                     std::ostream* pDecodedMessageOutputStream);
   // void xParseSEIParameterSetsInclusionIndication(SEIParameterSetsInclusionIndication& sei, uint32_t payloadSize,                std::ostream* pDecodedMessageOutputStream);
@@ -97,7 +130,7 @@ protected:
   void xParseSEIContentLightLevelInfo(SEIContentLightLevelInfo &sei, uint32_t payloadSize);
   // void xParseSEIAmbientViewingEnvironment     (SEIAmbientViewingEnvironment& sei,     uint32_t payloadSize,                      );
   // void xParseSEIContentColourVolume           (SEIContentColourVolume& sei,           uint32_t payloadSize,                      );
-  // void xParseSEIExtendedDrapIndication        (SEIExtendedDrapIndication& sei,        uint32_t payloadSize,                      );
+  void xParseSEIExtendedDrapIndication(SEIExtendedDrapIndication &sei, uint32_t payloadSize);
   // void xParseSEIColourTransformInfo           (SEIColourTransformInfo& sei, uint32_t payloadSize, std::ostream* pDecodedMessageOutputStream);
   // void xParseSEIConstrainedRaslIndication     (SEIConstrainedRaslIndication& sei,     uint32_t payLoadSize,                      );
   // void xParseSEIShutterInterval(SEIShutterIntervalInfo& sei, uint32_t payloadSize,  );
@@ -350,6 +350,9 @@ namespace vvc
     uint32_t m_numTilesInSlice;             //!< number of tiles in slice (raster-scan slices only)
     uint32_t m_numCtuInSlice;               //!< number of CTUs in the slice
     std::vector<uint32_t> m_ctuAddrInSlice; //!< raster-scan addresses of all the CTUs in the slice
+
+    void initSliceMap(uint32_t sliceID);
+    void addCtusToSlice(uint32_t startX, uint32_t stopX, uint32_t startY, uint32_t stopY, uint32_t picWidthInCtbs);
   };
 
   struct RectSlice
@@ -789,6 +792,7 @@ namespace vvc
     void initTiles();
     void resetTileSliceInfo();
     void initRectSlices();
+    void initRectSliceMap(const SPS *sps);
     void setChromaQpOffsetListEntry(int cuChromaQpOffsetIdxPlus1, int cbOffset, int crOffset, int jointCbCrOffset);
   };
 
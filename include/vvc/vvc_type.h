@@ -295,6 +295,7 @@ namespace vvc
     FILLER_PAYLOAD = 3,
     USER_DATA_REGISTERED_ITU_T_T35 = 4,
     USER_DATA_UNREGISTERED = 5,
+    RECOVERY_POINT = 6,
     FILM_GRAIN_CHARACTERISTICS = 19,
     FRAME_PACKING = 45,
     DISPLAY_ORIENTATION = 47,
@@ -381,7 +381,7 @@ void parseNalH264::pps_parse(unsigned char *nal_bitstream, avc::pps *pps, avc::s
 
 void parseNalH264::sei_parse(unsigned char *msg, nal_info &nal, int curLen)
 {
-  avc::sps *sps = reinterpret_cast<avc::sps *>(nal.mpegParamSet->sps);
+  avc::sps *sps = reinterpret_cast<avc::sps *>(nal.mpegParamSet.sps);
   parseSeiH264 fCallobj;
 
   int payload_type = 0;
@@ -389,36 +389,53 @@ void parseNalH264::sei_parse(unsigned char *msg, nal_info &nal, int curLen)
   int offset = 0;
   unsigned char tmp_byte;
 
+  // Messages end before the rbsp_trailing_bits byte
+  int rbspEnd = curLen;
+  while (rbspEnd > 0 && msg[rbspEnd - 1] == 0)
+    rbspEnd--;
+  if (rbspEnd > 0 && msg[rbspEnd - 1] == 0x80)
+    rbspEnd--;
+
   do
   {
+    bool truncated = false;
     payload_type = 0;
-    tmp_byte = msg[offset++];
-    while (tmp_byte == 0xFF)
+    do
     {
-      payload_type += 255;
+      truncated = offset >= rbspEnd;
+      if (truncated)
+        break;
       tmp_byte = msg[offset++];
-    }
-    payload_type += tmp_byte;
+      payload_type += tmp_byte;
+    } while (tmp_byte == 0xFF);
 
     payload_size = 0;
-    tmp_byte = msg[offset++];
-    while (tmp_byte == 0xFF)
+    do
     {
-      payload_size += 255;
+      truncated = truncated || offset >= rbspEnd;
+      if (truncated)
+        break;
       tmp_byte = msg[offset++];
+      payload_size += tmp_byte;
+    } while (tmp_byte == 0xFF);
+
+    if (truncated || offset + payload_size > rbspEnd)
+    {
+      fprintf(stderr, "Warning: SEI payload exceeds the NAL unit, remaining messages are ignored\n");
+      break;
     }
-    payload_size += tmp_byte;
 
     nal.sei_type = payload_type;
     nal.sei_length = payload_size;
+    nal.sei_types.push_back(payload_type);
 
     switch (payload_type)
     {
     case avc::SEI_BUFFERING_PERIOD:
-      fCallobj.interpret_buffering_period_info(msg + offset, payload_size, sps, nal.h264SEI->h264_sei_bp);
+      fCallobj.interpret_buffering_period_info(msg + offset, payload_size, sps, nal.h264SEI.h264_sei_bp);
       break;
     case avc::SEI_PIC_TIMING:
-      fCallobj.interpret_picture_timing_info(msg + offset, payload_size, sps, nal.h264SEI->h264_sei_pt);
+      fCallobj.interpret_picture_timing_info(msg + offset, payload_size, sps, nal.h264SEI.h264_sei_pt);
       break;
     case avc::SEI_PAN_SCAN_RECT:
       // interpret_pan_scan_rect_info( msg+offset, payload_size, sps ); // TODO: Not implemented yet
@@ -427,13 +444,13 @@ void parseNalH264::sei_parse(unsigned char *msg, nal_info &nal, int curLen)
       // interpret_filler_payload_info( msg+offset, payload_size, sps ); // TODO: Not implemented yet
       break;
     case avc::SEI_USER_DATA_REGISTERED_ITU_T_T35:
-      fCallobj.interpret_user_data_registered_itu_t_t35_info(msg + offset, payload_size, nal.mpegCommonSEI->common_sei_dr);
+      fCallobj.interpret_user_data_registered_itu_t_t35_info(msg + offset, payload_size, nal.mpegCommonSEI.common_sei_dr);
       break;
     case avc::SEI_USER_DATA_UNREGISTERED:
-      fCallobj.interpret_user_data_unregistered_info(msg + offset, payload_size, nal.mpegCommonSEI->common_sei_du);
+      fCallobj.interpret_user_data_unregistered_info(msg + offset, payload_size, nal.mpegCommonSEI.common_sei_du);
       break;
     case avc::SEI_RECOVERY_POINT:
-      // interpret_recovery_point_info( msg+offset, payload_size, sps ); // TODO: Not implemented yet
+      fCallobj.interpret_recovery_point_info(msg + offset, payload_size, nal.mpegCommonSEI.common_sei_rp);
       break;
     case avc::SEI_DEC_REF_PIC_MARKING_REPETITION:
       // interpret_dec_ref_pic_marking_repetition_info( msg+offset, payload_size, sps, pSlice ); // pSlice → Cannot parse
@@ -497,6 +514,70 @@ void parseNalH264::sei_parse(unsigned char *msg, nal_info &nal, int curLen)
     }
     offset += payload_size;
 
-  } while (msg[offset] != 0x80);
-  assert(msg[offset] == 0x80);
-}
\ No newline at end of file
+  } while (offset < rbspEnd);
+}
+
+void parseNalH264::slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen)
+{
+  static const sliceType sliceTypes[5] = {sliceType::SLICE_P, sliceType::SLICE_B, sliceType::SLICE_I, sliceType::SLICE_SP, sliceType::SLICE_SI};
+
+  Bitstream *s = m_bits;
+  s->streamBuffer = nal_bitstream;
+  s->code_len = s->bitstream_length = curLen;
+  s->ei_flag = 0;
+  s->read_len = s->frame_bitoffset = 0;
+  DecoderParams *p_Dec = m_pDec;
+  p_Dec->UsedBits = 0;
+
+  slice_prefix &slice = nal.slice;
+
+  slice.valid = false;
+  slice.dependentSlice = false;
+  slice.picHeaderInSliceHeader = false;
+  slice.frameNum = -1;
+  slice.fieldPic = false;
+  slice.bottomField = false;
+  slice.idrPicId = -1;
+  slice.pocLsb = -1;
+  slice.deltaPocBottom = 0;
+  slice.deltaPicOrderCnt[0] = slice.deltaPicOrderCnt[1] = 0;
+
+  slice.sliceAddress = s->read_ue_v(s, &p_Dec->UsedBits);
+  slice.firstSliceInPic = (slice.sliceAddress == 0);
+  const int type = s->read_ue_v(s, &p_Dec->UsedBits);
+  slice.type = (type >= 0 && type < 10) ? sliceTypes[type % 5] : sliceType::SLICE_UNKNOWN;
+  slice.ppsId = s->read_ue_v(s, &p_Dec->UsedBits);
+
+  // The remaining lengths come from the parameter sets the slice refers to, they become the active ones
+  avc::pps *pps = static_cast<avc::pps *>(nal.mpegParamSet.findPps(slice.ppsId));
+  avc::sps *sps = pps ? static_cast<avc::sps *>(nal.mpegParamSet.findSps(static_cast<int>(pps->seq_parameter_set_id))) : NULL;
+  if (!sps || !pps)
+    return;
+  nal.mpegParamSet.sps = sps;
+  nal.mpegParamSet.pps = pps;
+
+  if (sps->separate_colour_plane_flag)
+    s->read_u_v(2, s, &p_Dec->UsedBits); // colour_plane_id
+  slice.frameNum = s->read_u_v(sps->log2_max_frame_num_minus4 + 4, s, &p_Dec->UsedBits);
+  if (!sps->frame_mbs_only_flag)
+  {
+    slice.fieldPic = s->read_u_1(s, &p_Dec->UsedBits);
+    if (slice.fieldPic)
+      slice.bottomField = s->read_u_1(s, &p_Dec->UsedBits);
+  }
+  if (static_cast<avc::h264_nal_type>(nal.nal_unit_type) == avc::h264_nal_type::NALU_TYPE_IDR)
+    slice.idrPicId = s->read_ue_v(s, &p_Dec->UsedBits);
+  if (sps->pic_order_cnt_type == 0)
+  {
+    slice.pocLsb = s->read_u_v(sps->log2_max_pic_order_cnt_lsb_minus4 + 4, s, &p_Dec->UsedBits);
+    if (pps->bottom_field_pic_order_in_frame_present_flag && !slice.fieldPic)
+      slice.deltaPocBottom = s->read_se_v(s, &p_Dec->UsedBits);
+  }
+  if (sps->pic_order_cnt_type == 1 && !sps->delta_pic_order_always_zero_flag)
+  {
+    slice.deltaPicOrderCnt[0] = s->read_se_v(s, &p_Dec->UsedBits);
+    if (pps->bottom_field_pic_order_in_frame_present_flag && !slice.fieldPic)
+      slice.deltaPicOrderCnt[1] = s->read_se_v(s, &p_Dec->UsedBits);
+  }
+  slice.valid = true;
+}
@@ -40,8 +40,8 @@ void parseSeiH264::interpret_buffering_period_info(unsigned char *payload, int s
     {
       for (k = 0; k < sps->vui_seq_parameters.vcl_hrd_parameters.cpb_cnt_minus1 + 1; k++)
       {
-        sei_bp.initialCpbRemovalDelay[k][0] = buf->read_u_v(sps->vui_seq_parameters.vcl_hrd_parameters.initial_cpb_removal_delay_length_minus1 + 1, buf, &p_Dec->UsedBits);
-        sei_bp.initialCpbRemovalDelayOffset[k][0] = buf->read_u_v(sps->vui_seq_parameters.vcl_hrd_parameters.initial_cpb_removal_delay_length_minus1 + 1, buf, &p_Dec->UsedBits);
+        sei_bp.initialCpbRemovalDelay[k][1] = buf->read_u_v(sps->vui_seq_parameters.vcl_hrd_parameters.initial_cpb_removal_delay_length_minus1 + 1, buf, &p_Dec->UsedBits);
+        sei_bp.initialCpbRemovalDelayOffset[k][1] = buf->read_u_v(sps->vui_seq_parameters.vcl_hrd_parameters.initial_cpb_removal_delay_length_minus1 + 1, buf, &p_Dec->UsedBits);
       }
     }
   }
@@ -147,7 +147,7 @@ void parseSeiH264::interpret_picture_timing_info(unsigned char *payload, int siz
         sei_pt.cnt_dropped_flag[i] = buf->read_u_1(buf, &p_Dec->UsedBits);
         sei_pt.nframes[i] = buf->read_u_v(8, buf, &p_Dec->UsedBits);
 
-        if (sei_pt.full_timestamp_flag)
+        if (sei_pt.full_timestamp_flag[i])
         {
           sei_pt.seconds_value[i] = buf->read_u_v(6, buf, &p_Dec->UsedBits);
           sei_pt.minutes_value[i] = buf->read_u_v(6, buf, &p_Dec->UsedBits);
@@ -156,7 +156,7 @@ void parseSeiH264::interpret_picture_timing_info(unsigned char *payload, int siz
         else
         {
           sei_pt.seconds_flag[i] = buf->read_u_1(buf, &p_Dec->UsedBits);
-          if (sei_pt.seconds_flag)
+          if (sei_pt.seconds_flag[i])
           {
             sei_pt.seconds_value[i] = buf->read_u_v(6, buf, &p_Dec->UsedBits);
             sei_pt.minutes_flag[i] = buf->read_u_1(buf, &p_Dec->UsedBits);
@@ -224,4 +224,22 @@ void parseSeiH264::interpret_user_data_unregistered_info(unsigned char *payload,
     sei_du.userData.push_back(payload[offset]);
     offset++;
   }
-}
\ No newline at end of file
+}
+
+void parseSeiH264::interpret_recovery_point_info(unsigned char *payload, int size, SEIRecoveryPoint &sei_rp)
+{
+  DecoderParams *p_Dec = m_pDec;
+  Bitstream *buf;
+
+  buf = m_bits;
+  buf->bitstream_length = size;
+  buf->streamBuffer = payload;
+  buf->frame_bitoffset = 0;
+
+  p_Dec->UsedBits = 0;
+
+  sei_rp.recoveryPocCnt = buf->read_ue_v(buf, &p_Dec->UsedBits);
+  sei_rp.exactMatchingFlag = buf->read_u_1(buf, &p_Dec->UsedBits);
+  sei_rp.brokenLinkFlag = buf->read_u_1(buf, &p_Dec->UsedBits);
+  sei_rp.changingSliceGroupIdc = (uint8_t)buf->read_u_v(2, buf, &p_Dec->UsedBits);
+}
@@ -812,6 +812,8 @@ void parseNalH265::sps_parse(unsigned char *nal_bitstream, hevc::sps *pcSPS, int
   xReadUvlc(uiCode, "pic_height_in_luma_samples");
   pcSPS->m_picHeightInLumaSamples = uiCode;
   xReadFlag(uiCode, "conformance_window_flag");
+  pcSPS->m_conformanceWindow = hevc::Window();
+  pcSPS->m_conformanceWindow.m_enabledFlag = uiCode;
   if (uiCode != 0)
   {
     hevc::Window &conf = pcSPS->m_conformanceWindow;
@@ -1198,6 +1200,11 @@ void parseNalH265::pps_parse(unsigned char *nal_bitstream, hevc::pps *pcPPS, hev
       pcPPS->m_deblockingFilterTcOffsetDiv2 = iCode;
     }
   }
+  else
+  {
+    pcPPS->m_deblockingFilterOverrideEnabledFlag = false;
+    pcPPS->m_ppsDeblockingFilterDisabledFlag = false;
+  }
   xReadFlag(uiCode, "pps_scaling_list_data_present_flag");
   pcPPS->m_scalingListPresentFlag = uiCode ? true : false;
   if (pcPPS->m_scalingListPresentFlag)
@@ -1214,6 +1221,7 @@ void parseNalH265::pps_parse(unsigned char *nal_bitstream, hevc::pps *pcPPS, hev
   xReadFlag(uiCode, "slice_segment_header_extension_present_flag");
   pcPPS->m_sliceHeaderExtensionPresentFlag = uiCode;
 
+  pcPPS->m_ppsRangeExtension.m_chromaQpOffsetListLen = 0;
   xReadFlag(uiCode, "pps_extension_present_flag");
   if (uiCode)
   {
@@ -1305,27 +1313,512 @@ void parseNalH265::sei_parse(unsigned char *nal_bitstream, nal_info &nal, int cu
     m_bits->m_fifo.push_back(nal_bitstream[i + 2]);
   setBitstream(m_bits);
 
-  int payloadType = 0;
-  unsigned int val = 0;
-  do
-  {
-    xReadCode(8, val, "payload_type");
-    payloadType += val;
-  } while (val == 0xFF);
+  parseSeiH265 *sei_handler = new parseSeiH265;
+  hevc::sps *sps = reinterpret_cast<hevc::sps *>(nal.mpegParamSet.sps);
 
-  unsigned int payloadSize = 0;
   do
   {
-    xReadCode(8, val, "payload_size");
-    payloadSize += val;
-  } while (val == 0xFF);
+    int payloadType = 0;
+    unsigned int val = 0;
+    do
+    {
+      xReadCode(8, val, "payload_type");
+      payloadType += val;
+    } while (val == 0xFF);
 
-  parseSeiH265 *sei_handler = new parseSeiH265;
-  hevc::sps *sps = reinterpret_cast<hevc::sps *>(nal.mpegParamSet->sps);
-  nal.sei_type = payloadType;
-  nal.sei_length = payloadSize;
+    unsigned int payloadSize = 0;
+    do
+    {
+      xReadCode(8, val, "payload_size");
+      payloadSize += val;
+    } while (val == 0xFF);
+
+    const unsigned int payloadStart = m_bits->getByteLocation();
+    if (payloadStart + payloadSize > m_bits->m_fifo.size())
+    {
+      fprintf(stderr, "Warning: SEI payload exceeds the NAL unit, remaining messages are ignored\n");
+      break;
+    }
+
+    nal.sei_type = payloadType;
+    nal.sei_length = payloadSize;
+    nal.sei_types.push_back(payloadType);
 
-  sei_handler->xReadSEIPayloadData(payloadType, payloadSize, nal, (hevc::hevc_nal_type)nal.nal_unit_type, sps, m_bits);
+    sei_handler->xReadSEIPayloadData(payloadType, payloadSize, nal, (hevc::hevc_nal_type)nal.nal_unit_type, sps, m_bits);
+
+    // Skip to the next message by the signalled size, whether or not the payload was interpreted
+    m_bits->m_fifo_idx = payloadStart + payloadSize;
+    m_bits->m_num_held_bits = 0;
+  } while (m_bits->getNumBitsLeft() > 0 && xMoreRbspData());
 
   delete sei_handler;
-}
\ No newline at end of file
+}
+
+void parseNalH265::slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen)
+{
+  for (int i = 0; i < curLen; i++)
+    m_bits->m_fifo.push_back(nal_bitstream[i]);
+  setBitstream(m_bits);
+
+  m_pcBitstream->m_fifo_idx = 2;
+  m_pcBitstream->m_num_held_bits = 0;
+  m_pcBitstream->m_held_bits = 1;
+  m_pcBitstream->m_numBitsRead = 16;
+
+  xParseSliceHeaderPrefix(nal);
+}
+
+bool parseNalH265::slice_header_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen, int dataLen, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize)
+{
+  slice_entry_points &entry = nal.entry;
+  entry.valid = false;
+  entry.numCtus = 0;
+  entry.sliceIdx = -1;
+  entry.subPicIdx = 0;
+  entry.substreamOffset.clear();
+  entry.substreamSize.clear();
+  entry.substreamCtuAddr.clear();
+
+  slice_prefix_parse(nal_bitstream, nal, curLen);
+  if (!nal.slice.valid)
+    return true;
+  entry.firstCtuAddr = nal.slice.sliceAddress;
+
+  std::vector<uint32_t> entryPointOffset;
+  if (!xParseSliceHeaderRest(nal, dataLen, entryPointOffset))
+    return false;
+
+  xSetSubstreams(nal, entryPointOffset, epbLocation, headerOffset, nalSize);
+  return true;
+}
+
+void parseNalH265::xParseSliceHeaderPrefix(nal_info &nal)
+{
+  static const sliceType sliceTypes[3] = {sliceType::SLICE_B, sliceType::SLICE_P, sliceType::SLICE_I};
+
+  unsigned int uiCode;
+  slice_prefix &slice = nal.slice;
+  const hevc::hevc_nal_type nalUnitType = static_cast<hevc::hevc_nal_type>(nal.nal_unit_type);
+
+  slice.valid = false;
+  slice.picHeaderInSliceHeader = false;
+
+  xReadFlag(uiCode, "first_slice_segment_in_pic_flag");
+  slice.firstSliceInPic = uiCode;
+  if (nalUnitType >= hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP && nalUnitType <= hevc::hevc_nal_type::NAL_UNIT_RESERVED_IRAP_VCL23)
+  {
+    xReadFlag(uiCode, "no_output_of_prior_pics_flag");
+  }
+  xReadUvlc(uiCode, "slice_pic_parameter_set_id");
+  slice.ppsId = uiCode;
+
+  slice.dependentSlice = false;
+  slice.sliceAddress = slice.firstSliceInPic ? 0 : -1;
+
+  // The remaining lengths come from the parameter sets the slice refers to, they become the active ones
+  hevc::pps *pps = static_cast<hevc::pps *>(nal.mpegParamSet.findPps(slice.ppsId));
+  hevc::sps *sps = pps ? static_cast<hevc::sps *>(nal.mpegParamSet.findSps(pps->m_SPSId)) : NULL;
+  if (!sps || !pps)
+  {
+    slice.type = sliceType::SLICE_UNKNOWN;
+    slice.pocLsb = -1;
+    return;
+  }
+  nal.mpegParamSet.sps = sps;
+  nal.mpegParamSet.pps = pps;
+
+  if (!slice.firstSliceInPic)
+  {
+    if (pps->m_dependentSliceSegmentsEnabledFlag)
+    {
+      xReadFlag(uiCode, "dependent_slice_segment_flag");
+      slice.dependentSlice = uiCode;
+    }
+    const int log2CtbSize = sps->m_log2MinCodingBlockSize + sps->m_log2DiffMaxMinCodingBlockSize;
+    const unsigned int picSizeInCtbs = ((sps->m_picWidthInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize) *
+                                       ((sps->m_picHeightInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize);
+    int bitsSliceSegmentAddress = 0;
+    while (picSizeInCtbs > (1u << bitsSliceSegmentAddress))
+      bitsSliceSegmentAddress++;
+    uiCode = 0;
+    if (bitsSliceSegmentAddress > 0)
+      xReadCode(bitsSliceSegmentAddress, uiCode, "slice_segment_address");
+    slice.sliceAddress = uiCode;
+  }
+
+  // A dependent slice segment takes slice type and POC of the preceding independent one, left untouched in 'slice'
+  if (!slice.dependentSlice)
+  {
+    for (int i = 0; i < pps->m_numExtraSliceHeaderBits; i++)
+    {
+      xReadFlag(uiCode, "slice_reserved_flag[]");
+    }
+    xReadUvlc(uiCode, "slice_type");
+    slice.type = uiCode < 3 ? sliceTypes[uiCode] : sliceType::SLICE_UNKNOWN;
+    if (pps->m_OutputFlagPresentFlag)
+    {
+      xReadFlag(uiCode, "pic_output_flag");
+    }
+    slice.pocLsb = -1;
+    if (nalUnitType != hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_W_RADL && nalUnitType != hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_N_LP)
+    {
+      xReadCode(sps->m_uiBitsForPOC, uiCode, "slice_pic_order_cnt_lsb");
+      slice.pocLsb = uiCode;
+    }
+  }
+  slice.valid = true;
+}
+
+// Ceil( Log2( n ) ), the length of u(v) indices into n entries
+static unsigned int ceilLog2Bits(unsigned int n)
+{
+  unsigned int bits = 0;
+  while (n > (1u << bits))
+    bits++;
+  return bits;
+}
+
+bool parseNalH265::xParseSliceHeaderRest(nal_info &nal, int dataLen, std::vector<uint32_t> &entryPointOffset)
+{
+  unsigned int uiCode;
+  int iCode;
+  const slice_prefix &slice = nal.slice;
+  hevc::sps *sps = static_cast<hevc::sps *>(nal.mpegParamSet.sps);
+  const hevc::pps *pps = static_cast<const hevc::pps *>(nal.mpegParamSet.pps);
+  const hevc::hevc_nal_type nalUnitType = static_cast<hevc::hevc_nal_type>(nal.nal_unit_type);
+  const int chromaArrayType = sps->m_chromaFormatIdc; // separate_colour_plane_flag is 0
+  const unsigned long dataBits = 8ul * dataLen;
+
+  // Reads running into the padding after dataLen bytes : the slice segment header continues past the unescaped bytes
+#define SLICE_HEADER_TRUNCATED() (8ul * m_pcBitstream->m_fifo.size() - m_pcBitstream->getNumBitsLeft() > dataBits)
+
+  if (!slice.dependentSlice)
+  {
+    bool sliceTemporalMvpEnabled = false;
+    unsigned int numPicTotalCurr = 0;
+    if (nalUnitType != hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_W_RADL && nalUnitType != hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_N_LP)
+    {
+      const int numRps = (int)sps->m_RPSList.m_referencePictureSets.size();
+      hevc::TComReferencePictureSet localRps;
+      const hevc::TComReferencePictureSet *rps = &localRps;
+      xReadFlag(uiCode, "short_term_ref_pic_set_sps_flag");
+      if (!uiCode)
+      {
+        parseShortTermRefPicSet(sps, &localRps, numRps);
+      }
+      else
+      {
+        uiCode = 0;
+        if (numRps > 1)
+          xReadCode(ceilLog2Bits(numRps), uiCode, "short_term_ref_pic_set_idx");
+        if ((int)uiCode >= numRps)
+          return false;
+        rps = &sps->m_RPSList.m_referencePictureSets[uiCode];
+      }
+      for (int i = 0; i < rps->m_numberOfPictures && i < hevc::MAX_NUM_REF_PICS; i++)
+        numPicTotalCurr += rps->m_used[i];
+
+      if (sps->m_bLongTermRefsPresent)
+      {
+        unsigned int numLtSps = 0, numLtPics = 0;
+        if (sps->m_numLongTermRefPicSPS > 0)
+          xReadUvlc(numLtSps, "num_long_term_sps");
+        xReadUvlc(numLtPics, "num_long_term_pics");
+        if (numLtSps > sps->m_numLongTermRefPicSPS || numLtSps + numLtPics > (unsigned int)hevc::MAX_NUM_REF_PICS)
+          return false;
+        for (unsigned int i = 0; i < numLtSps + numLtPics; i++)
+        {
+          if (i < numLtSps)
+          {
+            uiCode = 0;
+            if (sps->m_numLongTermRefPicSPS > 1)
+              xReadCode(ceilLog2Bits(sps->m_numLongTermRefPicSPS), uiCode, "lt_idx_sps");
+            numPicTotalCurr += uiCode < sps->m_numLongTermRefPicSPS && sps->m_usedByCurrPicLtSPSFlag[uiCode];
+          }
+          else
+          {
+            xReadCode(sps->m_uiBitsForPOC, uiCode, "poc_lsb_lt");
+            xReadFlag(uiCode, "used_by_curr_pic_lt_flag");
+            numPicTotalCurr += uiCode;
+          }
+          xReadFlag(uiCode, "delta_poc_msb_present_flag");
+          if (uiCode)
+            xReadUvlc(uiCode, "delta_poc_msb_cycle_lt");
+        }
+      }
+      if (sps->m_SPSTemporalMVPEnabledFlag)
+      {
+        xReadFlag(uiCode, "slice_temporal_mvp_enabled_flag");
+        sliceTemporalMvpEnabled = uiCode;
+      }
+    }
+    if (SLICE_HEADER_TRUNCATED())
+      return false;
+
+    bool saoLuma = false, saoChroma = false;
+    if (sps->m_bUseSAO)
+    {
+      xReadFlag(uiCode, "slice_sao_luma_flag");
+      saoLuma = uiCode;
+      if (chromaArrayType != hevc::CHROMA_400)
+      {
+        xReadFlag(uiCode, "slice_sao_chroma_flag");
+        saoChroma = uiCode;
+      }
+    }
+
+    if (slice.type == sliceType::SLICE_P || slice.type == sliceType::SLICE_B)
+    {
+      const bool bSlice = slice.type == sliceType::SLICE_B;
+      unsigned int numRefIdx[2] = {pps->m_numRefIdxL0DefaultActive, bSlice ? pps->m_numRefIdxL1DefaultActive : 0};
+      xReadFlag(uiCode, "num_ref_idx_active_override_flag");
+      if (uiCode)
+      {
+        xReadUvlc(uiCode, "num_ref_idx_l0_active_minus1");
+        numRefIdx[0] = uiCode + 1;
+        if (bSlice)
+        {
+          xReadUvlc(uiCode, "num_ref_idx_l1_active_minus1");
+          numRefIdx[1] = uiCode + 1;
+        }
+      }
+      if (numRefIdx[0] > (unsigned int)hevc::MAX_NUM_REF_PICS || numRefIdx[1] > (unsigned int)hevc::MAX_NUM_REF_PICS)
+        return false;
+
+      if (pps->m_listsModificationPresentFlag && numPicTotalCurr > 1)
+      {
+        const unsigned int listEntryBits = ceilLog2Bits(numPicTotalCurr);
+        for (int list = 0; list < (bSlice ? 2 : 1); list++)
+        {
+          xReadFlag(uiCode, list ? "ref_pic_list_modification_flag_l1" : "ref_pic_list_modification_flag_l0");
+          if (uiCode)
+          {
+            for (unsigned int i = 0; i < numRefIdx[list]; i++)
+              xReadCode(listEntryBits, uiCode, list ? "list_entry_l1" : "list_entry_l0");
+          }
+        }
+      }
+      if (bSlice)
+        xReadFlag(uiCode, "mvd_l1_zero_flag");
+      if (pps->m_cabacInitPresentFlag)
+        xReadFlag(uiCode, "cabac_init_flag");
+      if (sliceTemporalMvpEnabled)
+      {
+        unsigned int collocatedFromL0 = 1;
+        if (bSlice)
+          xReadFlag(collocatedFromL0, "collocated_from_l0_flag");
+        if ((collocatedFromL0 && numRefIdx[0] > 1) || (!collocatedFromL0 && numRefIdx[1] > 1))
+          xReadUvlc(uiCode, "collocated_ref_idx");
+      }
+      if ((pps->m_bUseWeightPred && !bSlice) || (pps->m_useWeightedBiPred && bSlice))
+      {
+        xParsePredWeightTable(sps, bSlice, numRefIdx);
+        if (SLICE_HEADER_TRUNCATED())
+          return false;
+      }
+      xReadUvlc(uiCode, "five_minus_max_num_merge_cand");
+    }
+
+    xReadSvlc(iCode, "slice_qp_delta");
+    if (pps->m_bSliceChromaQpFlag)
+    {
+      xReadSvlc(iCode, "slice_cb_qp_offset");
+      xReadSvlc(iCode, "slice_cr_qp_offset");
+    }
+    if (pps->m_ppsRangeExtension.m_chromaQpOffsetListLen > 0)
+      xReadFlag(uiCode, "cu_chroma_qp_offset_enabled_flag");
+
+    bool deblockingDisabled = pps->m_ppsDeblockingFilterDisabledFlag;
+    if (pps->m_deblockingFilterOverrideEnabledFlag)
+    {
+      xReadFlag(uiCode, "deblocking_filter_override_flag");
+      if (uiCode)
+      {
+        xReadFlag(uiCode, "slice_deblocking_filter_disabled_flag");
+        deblockingDisabled = uiCode;
+        if (!deblockingDisabled)
+        {
+          xReadSvlc(iCode, "slice_beta_offset_div2");
+          xReadSvlc(iCode, "slice_tc_offset_div2");
+        }
+      }
+    }
+    if (pps->m_loopFilterAcrossSlicesEnabledFlag && (saoLuma || saoChroma || !deblockingDisabled))
+      xReadFlag(uiCode, "slice_loop_filter_across_slices_enabled_flag");
+  }
+  if (SLICE_HEADER_TRUNCATED())
+    return false;
+
+  entryPointOffset.clear();
+  if (pps->m_tilesEnabledFlag || pps->m_entropyCodingSyncEnabledFlag)
+  {
+    const int log2CtbSize = sps->m_log2MinCodingBlockSize + sps->m_log2DiffMaxMinCodingBlockSize;
+    const unsigned int picSizeInCtbs = ((sps->m_picWidthInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize) *
+                                       ((sps->m_picHeightInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize);
+    unsigned int numEntryPoints;
+    xReadUvlc(numEntryPoints, "num_entry_point_offsets");
+    if (numEntryPoints >= picSizeInCtbs)
+      return false;
+    if (numEntryPoints > 0)
+    {
+      xReadUvlc(uiCode, "offset_len_minus1");
+      if (uiCode > 31)
+        return false;
+      const unsigned int offsetLen = uiCode + 1;
+      if ((unsigned long)numEntryPoints * offsetLen > m_pcBitstream->getNumBitsLeft())
+        return false;
+      entryPointOffset.resize(numEntryPoints);
+      for (unsigned int i = 0; i < numEntryPoints; i++)
+      {
+        xReadCode(offsetLen, uiCode, "entry_point_offset_minus1");
+        entryPointOffset[i] = uiCode + 1;
+      }
+    }
+  }
+
+  if (pps->m_sliceHeaderExtensionPresentFlag)
+  {
+    unsigned int extensionLength;
+    xReadUvlc(extensionLength, "slice_segment_header_extension_length");
+    if (8ul * extensionLength > m_pcBitstream->getNumBitsLeft())
+      return false;
+    for (unsigned int i = 0; i < extensionLength; i++)
+      xReadCode(8, uiCode, "slice_segment_header_extension_data_byte");
+  }
+  // byte_alignment() ends on the byte after the current one
+  if (((8ul * m_pcBitstream->m_fifo.size() - m_pcBitstream->getNumBitsLeft()) / 8 + 1) * 8 > dataBits)
+    return false;
+#undef SLICE_HEADER_TRUNCATED
+
+  xReadFlag(uiCode, "alignment_bit_equal_to_one");
+  if (uiCode != 1)
+    return false;
+  while (m_pcBitstream->getNumBitsUntilByteAligned())
+  {
+    xReadFlag(uiCode, "alignment_bit_equal_to_zero");
+    if (uiCode != 0)
+      return false;
+  }
+  return true;
+}
+
+void parseNalH265::xParsePredWeightTable(const hevc::sps *sps, bool bSlice, const unsigned int numRefIdx[2])
+{
+  unsigned int uiCode;
+  int iCode;
+  const bool chroma = sps->m_chromaFormatIdc != hevc::CHROMA_400;
+
+  xReadUvlc(uiCode, "luma_log2_weight_denom");
+  if (chroma)
+    xReadSvlc(iCode, "delta_chroma_log2_weight_denom");
+
+  for (int list = 0; list < (bSlice ? 2 : 1); list++)
+  {
+    bool lumaWeight[hevc::MAX_NUM_REF_PICS] = {false};
+    bool chromaWeight[hevc::MAX_NUM_REF_PICS] = {false};
+    for (unsigned int i = 0; i < numRefIdx[list]; i++)
+    {
+      xReadFlag(uiCode, list ? "luma_weight_l1_flag[i]" : "luma_weight_l0_flag[i]");
+      lumaWeight[i] = uiCode;
+    }
+    if (chroma)
+    {
+      for (unsigned int i = 0; i < numRefIdx[list]; i++)
+      {
+        xReadFlag(uiCode, list ? "chroma_weight_l1_flag[i]" : "chroma_weight_l0_flag[i]");
+        chromaWeight[i] = uiCode;
+      }
+    }
+    for (unsigned int i = 0; i < numRefIdx[list]; i++)
+    {
+      if (lumaWeight[i])
+      {
+        xReadSvlc(iCode, "delta_luma_weight_lX[i]");
+        xReadSvlc(iCode, "luma_offset_lX[i]");
+      }
+      if (chromaWeight[i])
+      {
+        for (int j = 0; j < 2; j++)
+        {
+          xReadSvlc(iCode, "delta_chroma_weight_lX[i][j]");
+          xReadSvlc(iCode, "delta_chroma_offset_lX[i][j]");
+        }
+      }
+    }
+  }
+}
+
+void parseNalH265::xSetSubstreams(nal_info &nal, const std::vector<uint32_t> &entryPointOffset, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize)
+{
+  slice_entry_points &entry = nal.entry;
+  const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+  const hevc::pps *pps = static_cast<const hevc::pps *>(nal.mpegParamSet.pps);
+
+  // Position of slice_segment_data() in the RBSP, moved past every emulation prevention byte in front of it
+  uint32_t sliceData = m_pcBitstream->getByteLocation();
+  for (size_t i = 0; i < epbLocation.size() && epbLocation[i] <= sliceData; i++)
+    sliceData++;
+  entry.sliceDataOffset = headerOffset + sliceData;
+
+  uint32_t offset = entry.sliceDataOffset;
+  entry.substreamOffset.push_back(offset);
+  for (size_t i = 0; i < entryPointOffset.size(); i++)
+  {
+    offset += entryPointOffset[i];
+    if (offset >= nalSize)
+      return;
+    entry.substreamSize.push_back(offset - entry.substreamOffset.back());
+    entry.substreamOffset.push_back(offset);
+  }
+  if (offset >= nalSize)
+    return;
+  entry.substreamSize.push_back(nalSize - offset);
+
+  // Tile column and row boundaries in CTBs (6.5.1)
+  const int log2CtbSize = sps->m_log2MinCodingBlockSize + sps->m_log2DiffMaxMinCodingBlockSize;
+  const uint32_t widthInCtbs = (sps->m_picWidthInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize;
+  const uint32_t heightInCtbs = (sps->m_picHeightInLumaSamples + (1 << log2CtbSize) - 1) >> log2CtbSize;
+  const int numCols = pps->m_tilesEnabledFlag ? pps->m_numTileColumnsMinus1 + 1 : 1;
+  const int numRows = pps->m_tilesEnabledFlag ? pps->m_numTileRowsMinus1 + 1 : 1;
+  std::vector<uint32_t> colBd(numCols + 1, 0), rowBd(numRows + 1, 0);
+  for (int i = 0; i < numCols; i++)
+    colBd[i + 1] = pps->m_uniformSpacingFlag || i == numCols - 1 || (int)pps->m_tileColumnWidth.size() < numCols - 1
+                       ? ((i + 1) * widthInCtbs) / numCols
+                       : colBd[i] + pps->m_tileColumnWidth[i];
+  for (int i = 0; i < numRows; i++)
+    rowBd[i + 1] = pps->m_uniformSpacingFlag || i == numRows - 1 || (int)pps->m_tileRowHeight.size() < numRows - 1
+                       ? ((i + 1) * heightInCtbs) / numRows
+                       : rowBd[i] + pps->m_tileRowHeight[i];
+  colBd[numCols] = widthInCtbs;
+  rowBd[numRows] = heightInCtbs;
+
+  // A substream is a tile, or a CTB row of a tile with entropy_coding_sync_enabled_flag
+  uint32_t ctuAddr = entry.firstCtuAddr;
+  for (size_t i = 0; i < entry.substreamOffset.size(); i++)
+  {
+    if (ctuAddr >= widthInCtbs * heightInCtbs)
+      return;
+    entry.substreamCtuAddr.push_back(ctuAddr);
+
+    const uint32_t x = ctuAddr % widthInCtbs, y = ctuAddr / widthInCtbs;
+    int tileX = 0, tileY = 0;
+    while (tileX < numCols - 1 && x >= colBd[tileX + 1])
+      tileX++;
+    while (tileY < numRows - 1 && y >= rowBd[tileY + 1])
+      tileY++;
+    if (pps->m_entropyCodingSyncEnabledFlag && y + 1 < rowBd[tileY + 1])
+    {
+      ctuAddr = (y + 1) * widthInCtbs + colBd[tileX];
+    }
+    else
+    {
+      if (++tileX == numCols)
+      {
+        tileX = 0;
+        tileY++;
+      }
+      ctuAddr = tileY < numRows ? rowBd[tileY] * widthInCtbs + colBd[tileX] : widthInCtbs * heightInCtbs;
+    }
+  }
+  entry.valid = true;
+}
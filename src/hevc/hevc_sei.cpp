@@ -153,6 +153,193 @@ void parseSeiH265::xParseSEIUserDataUnregistered(SEIUserDataUnregistered &sei, u
   }
 }
 
+void parseSeiH265::xParseSEIRecoveryPoint(SEIRecoveryPoint &sei, unsigned int payloadSize)
+{
+  int iCode;
+  unsigned int uiCode;
+  xReadSvlc(iCode, "recovery_poc_cnt");
+  sei.recoveryPocCnt = iCode;
+  xReadFlag(uiCode, "exact_matching_flag");
+  sei.exactMatchingFlag = uiCode;
+  xReadFlag(uiCode, "broken_link_flag");
+  sei.brokenLinkFlag = uiCode;
+}
+
+void parseSeiH265::xParseSEIDecodingUnitInfo(SEIDecodingUnitInfo &sei, unsigned int payloadSize, const hevc::sps *sps)
+{
+  unsigned int code;
+  unsigned int i;
+
+  const hevc::TComHRD *hrd = &(sps->m_vuiParameters.m_hrdParameters);
+  const unsigned int highestTid = sps->m_uiMaxTLayers > 0 ? sps->m_uiMaxTLayers - 1 : 0;
+
+  for (i = 0; i < MAX_TLAYER; i++)
+    sei.subLayerDelaysPresentFlag[i] = false;
+
+  xReadUvlc(code, "decoding_unit_idx");
+  sei.decodingUnitIdx = code;
+  if (!hrd->m_subPicCpbParamsInPicTimingSEIFlag)
+  {
+    xReadCode((hrd->m_duCpbRemovalDelayLengthMinus1 + 1), code, "du_spt_cpb_removal_delay_increment");
+    sei.duSptCpbRemovalDelayIncrement[highestTid] = code;
+    sei.subLayerDelaysPresentFlag[highestTid] = true;
+  }
+  xReadFlag(code, "dpb_output_du_delay_present_flag");
+  sei.dpbOutputDuDelayPresentFlag = code;
+  if (sei.dpbOutputDuDelayPresentFlag)
+  {
+    xReadCode(hrd->m_dpbOutputDelayDuLengthMinus1 + 1, code, "pic_spt_dpb_output_du_delay");
+    sei.picSptDpbOutputDuDelay = code;
+  }
+}
+
+void parseSeiH265::xParseSEIDependentRAPIndication(SEIDependentRAPIndication &sei, unsigned int payloadSize)
+{
+}
+
+void parseSeiH265::xParseSEIScalableNesting(SEIScalableNesting &sei, nal_info &nal, hevc::hevc_nal_type nalUnitType, unsigned int payloadSize, hevc::sps *sps)
+{
+  unsigned int code;
+  unsigned int i;
+  const unsigned int payloadEnd = m_pcBitstream->getByteLocation() + payloadSize;
+
+  sei.olsIdx.clear();
+  sei.maxTemporalId.clear();
+  sei.layerId.clear();
+  sei.subpicId.clear();
+  sei.nestedMessages.clear();
+  sei.defaultOpFlag = false;
+  sei.allLayersFlag = false;
+  sei.subpicFlag = false;
+
+  xReadFlag(code, "bitstream_subset_flag");
+  sei.bitstreamSubsetFlag = code;
+  xReadFlag(code, "nesting_op_flag");
+  sei.olsFlag = code;
+  if (sei.olsFlag)
+  {
+    xReadFlag(code, "default_op_flag");
+    sei.defaultOpFlag = code;
+    xReadUvlc(code, "nesting_num_ops_minus1");
+    assert(code < hevc::MAX_VPS_OP_SETS_PLUS1);
+    const unsigned int numOps = code + 1;
+    if (sei.defaultOpFlag)
+    {
+      // Default operation point : layers up to the one of the SEI NAL unit, sub-layers up to its TemporalId
+      sei.olsIdx.push_back(0);
+      sei.maxTemporalId.push_back(nal.temporal_id);
+    }
+    for (i = sei.defaultOpFlag; i < numOps; i++)
+    {
+      xReadCode(3, code, "nesting_max_temporal_id_plus1[i]");
+      sei.maxTemporalId.push_back(code - 1);
+      xReadUvlc(code, "nesting_op_idx[i]");
+      sei.olsIdx.push_back(code);
+    }
+  }
+  else
+  {
+    xReadFlag(code, "all_layers_flag");
+    sei.allLayersFlag = code;
+    if (!sei.allLayersFlag)
+    {
+      xReadCode(3, code, "nesting_no_op_max_temporal_id_plus1");
+      sei.maxTemporalId.push_back(code - 1);
+      xReadUvlc(code, "nesting_num_layers_minus1");
+      const unsigned int numLayers = code + 1;
+      for (i = 0; i < numLayers; i++)
+      {
+        xReadCode(6, code, "nesting_layer_id[i]");
+        sei.layerId.push_back(code);
+      }
+    }
+    else
+    {
+      sei.maxTemporalId.push_back(MAX_TLAYER - 1);
+    }
+  }
+
+  while (m_pcBitstream->getNumBitsUntilByteAligned())
+  {
+    xReadFlag(code, "nesting_zero_bit");
+  }
+
+  // Nested messages stay in the SEI RBSP, only the ones of the target operation point are interpreted
+  const bool applies = xNestingAppliesToTarget(sei, nal, sps);
+  while (m_pcBitstream->getByteLocation() < payloadEnd)
+  {
+    int nestedType = 0;
+    unsigned int nestedSize = 0;
+    do
+    {
+      xReadCode(8, code, "payload_type");
+      nestedType += code;
+    } while (code == 0xFF);
+    do
+    {
+      xReadCode(8, code, "payload_size");
+      nestedSize += code;
+    } while (code == 0xFF);
+
+    SEINestedMessage msg;
+    msg.payloadType = nestedType;
+    msg.payloadSize = nestedSize;
+    msg.payloadOffset = m_pcBitstream->getByteLocation();
+    msg.applied = applies && static_cast<hevc::hevc_sei_type>(nestedType) != hevc::hevc_sei_type::SCALABLE_NESTING;
+    if (msg.payloadOffset + nestedSize > payloadEnd)
+    {
+      fprintf(stderr, "Warning: nested SEI message exceeds the scalable nesting payload\n");
+      break;
+    }
+    sei.nestedMessages.push_back(msg);
+
+    if (msg.applied)
+    {
+      xReadSEIPayloadData(nestedType, nestedSize, nal, nalUnitType, sps, m_pcBitstream);
+    }
+    m_pcBitstream->m_fifo_idx = msg.payloadOffset + nestedSize;
+    m_pcBitstream->m_num_held_bits = 0;
+  }
+}
+
+bool parseSeiH265::xNestingAppliesToTarget(const SEIScalableNesting &sei, const nal_info &nal, const hevc::sps *sps)
+{
+  const int targetTid = nal.target_temporal_id >= 0 ? nal.target_temporal_id : (sps ? (int)sps->m_uiMaxTLayers - 1 : MAX_TLAYER - 1);
+
+  if (!sei.olsFlag)
+  {
+    if (targetTid > (int)sei.maxTemporalId[0])
+      return false;
+    if (sei.allLayersFlag)
+      return true;
+    for (size_t i = 0; i < sei.layerId.size(); i++)
+    {
+      if ((int)sei.layerId[i] == nal.target_layer_id)
+        return true;
+    }
+    return false;
+  }
+
+  const hevc::vps *vps = reinterpret_cast<const hevc::vps *>(nal.mpegParamSet.vps);
+  for (size_t i = 0; i < sei.olsIdx.size(); i++)
+  {
+    if ((int)sei.maxTemporalId[i] != targetTid)
+      continue;
+
+    bool layerIncluded;
+    if (i == 0 && sei.defaultOpFlag)
+      layerIncluded = nal.target_layer_id <= nal.nuh_layer_id;
+    else if (vps && sei.olsIdx[i] < vps->m_numOpSets && nal.target_layer_id < hevc::MAX_VPS_NUH_RESERVED_ZERO_LAYER_ID_PLUS1)
+      layerIncluded = vps->m_layerIdIncludedFlag[sei.olsIdx[i]][nal.target_layer_id];
+    else
+      layerIncluded = (sei.olsIdx[i] == 0 && nal.target_layer_id == 0);
+
+    if (layerIncluded)
+      return true;
+  }
+  return false;
+}
+
 void parseSeiH265::xParseSEITimeCode(SEITimeCode &sei, unsigned int payloadSize)
 {
   unsigned int code;
@@ -160,7 +347,7 @@ void parseSeiH265::xParseSEITimeCode(SEITimeCode &sei, unsigned int payloadSize)
   sei.numClockTs = code;
   for (unsigned int i = 0; i < sei.numClockTs; i++)
   {
-    SEITimeSet currentTimeSet;
+    SEITimeSet currentTimeSet{};
     xReadFlag(code, "clock_time_stamp_flag[i]");
     currentTimeSet.clockTimeStampFlag = code;
     if (currentTimeSet.clockTimeStampFlag)
@@ -236,10 +423,10 @@ void parseSeiH265::xReadSEIPayloadData(int payloadType, int payloadSize, nal_inf
   switch (static_cast<hevc::hevc_sei_type>(payloadType))
   {
   case hevc::hevc_sei_type::BUFFERING_PERIOD:
-    xParseSEIBufferingPeriod(nal.hevcSEI->hevc_sei_bp, payloadSize, sps);
+    xParseSEIBufferingPeriod(nal.hevcSEI.hevc_sei_bp, payloadSize, sps);
     break;
   case hevc::hevc_sei_type::PICTURE_TIMING:
-    xParseSEIPictureTiming(nal.hevcSEI->hevc_sei_pt, payloadSize, sps);
+    xParseSEIPictureTiming(nal.hevcSEI.hevc_sei_pt, payloadSize, sps);
     break;
   case hevc::hevc_sei_type::PAN_SCAN_RECT:
     // xParseSEIPanScanRect((SEIPanScanRect &)sei, payloadSize);
@@ -248,13 +435,13 @@ void parseSeiH265::xReadSEIPayloadData(int payloadType, int payloadSize, nal_inf
     // xParseSEIFillerPayload((SEIFillerPayload &)sei, payloadSize);
     break;
   case hevc::hevc_sei_type::USER_DATA_REGISTERED_ITU_T_T35:
-    xParseSEIUserDataRegistered(nal.mpegCommonSEI->common_sei_dr, payloadSize);
+    xParseSEIUserDataRegistered(nal.mpegCommonSEI.common_sei_dr, payloadSize);
     break;
   case hevc::hevc_sei_type::USER_DATA_UNREGISTERED:
-    xParseSEIUserDataUnregistered(nal.mpegCommonSEI->common_sei_du, payloadSize);
+    xParseSEIUserDataUnregistered(nal.mpegCommonSEI.common_sei_du, payloadSize);
     break;
   case hevc::hevc_sei_type::RECOVERY_POINT:
-    // xParseSEIRecoveryPoint((SEIRecoveryPoint &)sei, payloadSize);
+    xParseSEIRecoveryPoint(nal.mpegCommonSEI.common_sei_rp, payloadSize);
     break;
   case hevc::hevc_sei_type::SCENE_INFO:
     // xParseSEISceneInfo((SEISceneInfo &)sei, payloadSize);
@@ -296,13 +483,13 @@ void parseSeiH265::xReadSEIPayloadData(int payloadType, int payloadSize, nal_inf
     // xParseSEIActiveParameterSets((SEIActiveParameterSets &)sei, payloadSize);
     break;
   case hevc::hevc_sei_type::DECODING_UNIT_INFO:
-    // xParseSEIDecodingUnitInfo((SEIDecodingUnitInfo &)sei, payloadSize, sps);
+    xParseSEIDecodingUnitInfo(nal.mpegCommonSEI.common_sei_dui, payloadSize, sps);
     break;
   case hevc::hevc_sei_type::TEMPORAL_LEVEL0_INDEX:
     // xParseSEITemporalLevel0Index((SEITemporalLevel0Index &)sei, payloadSize);
     break;
   case hevc::hevc_sei_type::SCALABLE_NESTING:
-    // xParseSEIScalableNesting((SEIScalableNesting &)sei, nalUnitType, payloadSize, sps);
+    xParseSEIScalableNesting(nal.mpegCommonSEI.common_sei_sn, nal, nalUnitType, payloadSize, sps);
     break;
   case hevc::hevc_sei_type::REGION_REFRESH_INFO:
     // xParseSEIRegionRefreshInfo((SEIRegionRefreshInfo &)sei, payloadSize);
@@ -311,7 +498,7 @@ void parseSeiH265::xReadSEIPayloadData(int payloadType, int payloadSize, nal_inf
     // xParseSEINoDisplay((SEINoDisplay &)sei, payloadSize);
     break;
   case hevc::hevc_sei_type::TIME_CODE:
-    xParseSEITimeCode(nal.hevcSEI->hevc_sei_tc, payloadSize);
+    xParseSEITimeCode(nal.hevcSEI.hevc_sei_tc, payloadSize);
     break;
   case hevc::hevc_sei_type::MASTERING_DISPLAY_COLOUR_VOLUME:
     // xParseSEIMasteringDisplayColourVolume((SEIMasteringDisplayColourVolume &)sei, payloadSize);
@@ -341,7 +528,7 @@ void parseSeiH265::xReadSEIPayloadData(int payloadType, int payloadSize, nal_inf
     // xParseSEIContentLightLevelInfo((SEIContentLightLevelInfo &)sei, payloadSize);
     break;
   case hevc::hevc_sei_type::DEPENDENT_RAP_INDICATION:
-    // xParseSEIDependentRAPIndication((SEIDependentRAPIndication &)sei, payloadSize);
+    xParseSEIDependentRAPIndication(nal.mpegCommonSEI.common_sei_drap, payloadSize);
     break;
   case hevc::hevc_sei_type::CODED_REGION_COMPLETION:
     // xParseSEICodedRegionCompletion((SEICodedRegionCompletion &)sei, payloadSize);
@@ -0,0 +1,284 @@
+#include "nal_au.h"
+
+AccessUnitAssembler::AccessUnitAssembler(videoCodecType codecType, parsingLevel level)
+    : m_poc(codecType)
+{
+  m_codecType = codecType;
+  m_slicePrefix = (level >= parsingLevel::PARSING_SLICE_PREFIX);
+  clear();
+}
+
+AccessUnitAssembler::~AccessUnitAssembler()
+{
+}
+
+void AccessUnitAssembler::clear()
+{
+  m_auCount = 0;
+  m_cur = access_unit{};
+  m_cur.firstVclNalUnitType = -1;
+  m_cur.picType = sliceType::SLICE_UNKNOWN;
+  m_cur.temporalId = 0;
+  m_cur.reference = false;
+  m_cur.pocValid = false;
+  m_cur.poc = 0;
+  m_cur.pts = -1;
+  m_cur.dts = -1;
+  m_completed = m_cur;
+  m_curHasVcl = false;
+  m_curRecoveryPoint = false;
+
+  m_pending.clear();
+  m_pendingRecoveryPoint = false;
+  m_pendingPictureHeader = false;
+  m_pendingPictureHeaderLayerId = 0;
+
+  m_lastPictureLayerId = 0;
+  m_lastVclNalUnitType = -1;
+  m_lastSlice = slice_prefix{};
+  m_poc.clear();
+}
+
+bool AccessUnitAssembler::isReference(const nal_info &nal) const
+{
+  // Unknown below parsingLevel::PARSING_SLICE_PREFIX for H264/AVC and H266/VVC, taken as reference
+  if (m_codecType == videoCodecType::H264_AVC)
+    return !m_slicePrefix || !nal.slice.valid || nal.slice.nalRefIdc != 0;
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return nal.nal_unit_type > static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_VCL_N14) || (nal.nal_unit_type % 2) == 1;
+  if (m_codecType == videoCodecType::H266_VVC)
+    return !m_slicePrefix || nal.slice.pocLsb < 0 || !nal.slice.nonRefPic;
+  return true;
+}
+
+bool AccessUnitAssembler::h264NewPicture(const nal_info &nal) const
+{
+  // First VCL NAL unit of a primary coded picture (7.4.1.2.4)
+  const slice_prefix &cur = nal.slice;
+  const slice_prefix &prev = m_lastSlice;
+  if (!cur.valid || !prev.valid)
+    return cur.firstSliceInPic;
+
+  const int idr = static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR);
+  if (cur.frameNum != prev.frameNum || cur.ppsId != prev.ppsId || cur.fieldPic != prev.fieldPic || cur.bottomField != prev.bottomField)
+    return true;
+  if ((cur.nalRefIdc == 0) != (prev.nalRefIdc == 0))
+    return true;
+  if (cur.pocLsb != prev.pocLsb || cur.deltaPocBottom != prev.deltaPocBottom)
+    return true;
+  if ((nal.nal_unit_type == idr) != (m_lastVclNalUnitType == idr))
+    return true;
+  if (nal.nal_unit_type == idr && cur.idrPicId != prev.idrPicId)
+    return true;
+  return false;
+}
+
+bool AccessUnitAssembler::startsPicture(const nal_info &nal) const
+{
+  if (!m_curHasVcl)
+    return true;
+
+  if (!m_slicePrefix)
+  {
+    // Without slice headers : non-VCL NAL units opening an access unit, or a change between IRAP and non-IRAP slices
+    return !m_pending.empty() || NALParse::nal_is_irap(m_codecType, nal.nal_unit_type) != NALParse::nal_is_irap(m_codecType, m_lastVclNalUnitType);
+  }
+
+  if (m_codecType == videoCodecType::H264_AVC)
+    return h264NewPicture(nal);
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return nal.slice.firstSliceInPic;
+  if (m_codecType == videoCodecType::H266_VVC)
+    return m_pendingPictureHeader || nal.slice.picHeaderInSliceHeader;
+  return false;
+}
+
+void AccessUnitAssembler::append(const au_nal &entry)
+{
+  if (m_cur.nals.empty())
+    m_cur.offset = entry.offset;
+  m_cur.size += entry.size;
+  m_cur.nals.push_back(entry);
+}
+
+void AccessUnitAssembler::startPicture(const nal_info &nal)
+{
+  const int layerId = m_pendingPictureHeader ? m_pendingPictureHeaderLayerId : nal.nuh_layer_id;
+
+  // Pictures of higher layers belong to the access unit of the lower layer picture before them (H265, H266)
+  const bool newAu = m_curHasVcl && (m_codecType == videoCodecType::H264_AVC || layerId <= m_lastPictureLayerId);
+  if (newAu)
+  {
+    finish();
+    m_curRecoveryPoint = m_pendingRecoveryPoint;
+  }
+  else
+  {
+    m_curRecoveryPoint = m_curRecoveryPoint || m_pendingRecoveryPoint;
+  }
+
+  if (m_cur.firstVclNalUnitType < 0)
+  {
+    m_cur.firstVclNalUnitType = nal.nal_unit_type;
+    m_cur.irap = NALParse::nal_is_irap(m_codecType, nal.nal_unit_type);
+    m_cur.key = m_cur.irap || m_curRecoveryPoint ||
+                (m_codecType == videoCodecType::H266_VVC && nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_GDR);
+    m_cur.temporalId = nal.temporal_id;
+    m_cur.reference = isReference(nal);
+    m_cur.pocValid = m_slicePrefix && m_poc.poc().valid;
+    m_cur.poc = m_poc.poc().poc;
+  }
+  m_lastPictureLayerId = layerId;
+  m_lastSlice = nal.slice;
+}
+
+void AccessUnitAssembler::addSlice(const nal_info &nal)
+{
+  sliceType type = nal.slice.type;
+  if (!m_slicePrefix || !nal.slice.valid)
+    type = sliceType::SLICE_UNKNOWN;
+  else if (type == sliceType::SLICE_SP)
+    type = sliceType::SLICE_P;
+  else if (type == sliceType::SLICE_SI)
+    type = sliceType::SLICE_I;
+
+  if (type == sliceType::SLICE_B || m_cur.picType == sliceType::SLICE_UNKNOWN)
+    m_cur.picType = type;
+  else if (type == sliceType::SLICE_P && m_cur.picType == sliceType::SLICE_I)
+    m_cur.picType = type;
+}
+
+bool AccessUnitAssembler::push(const nal_info &nal, int64_t offset, uint32_t size)
+{
+  au_nal entry;
+  entry.offset = offset;
+  entry.size = size;
+  entry.nalUnitType = nal.nal_unit_type;
+
+  bool recoveryPoint = false;
+  for (size_t i = 0; i < nal.sei_types.size(); i++)
+    recoveryPoint = recoveryPoint || (nal.sei_types[i] == SEI::RECOVERY_POINT);
+
+  if (m_slicePrefix)
+    m_poc.push(nal);
+
+  bool completed = false;
+  if (!NALParse::nal_is_vcl(m_codecType, nal.nal_unit_type))
+  {
+    if (NALParse::nal_is_aud(m_codecType, nal.nal_unit_type) && m_curHasVcl)
+    {
+      // The access unit delimiter is always the first NAL unit of an access unit
+      for (size_t i = 0; i < m_pending.size(); i++)
+        append(m_pending[i]);
+      m_pending.clear();
+      m_pendingPictureHeader = false;
+      m_pendingRecoveryPoint = false;
+      completed = finish();
+      append(entry);
+    }
+    else if (!m_curHasVcl)
+    {
+      append(entry);
+      m_curRecoveryPoint = m_curRecoveryPoint || recoveryPoint;
+      if (m_codecType == videoCodecType::H266_VVC && nal.nal_unit_type == vvc::NAL_UNIT_PH)
+      {
+        m_pendingPictureHeader = true;
+        m_pendingPictureHeaderLayerId = nal.nuh_layer_id;
+      }
+    }
+    else if (NALParse::nal_is_suffix(m_codecType, nal.nal_unit_type) && m_pending.empty())
+    {
+      append(entry);
+      // End of sequence / bitstream is the last NAL unit of its access unit
+      if (NALParse::nal_is_end_of_sequence(m_codecType, nal.nal_unit_type))
+        completed = finish();
+    }
+    else
+    {
+      m_pending.push_back(entry);
+      m_pendingRecoveryPoint = m_pendingRecoveryPoint || recoveryPoint;
+      if (m_codecType == videoCodecType::H266_VVC && nal.nal_unit_type == vvc::NAL_UNIT_PH)
+      {
+        m_pendingPictureHeader = true;
+        m_pendingPictureHeaderLayerId = nal.nuh_layer_id;
+      }
+    }
+    return completed;
+  }
+
+  if (startsPicture(nal))
+  {
+    const bool hadAu = m_curHasVcl;
+    const uint64_t auCount = m_auCount;
+    startPicture(nal);
+    completed = hadAu && m_auCount != auCount;
+  }
+
+  for (size_t i = 0; i < m_pending.size(); i++)
+    append(m_pending[i]);
+  m_pending.clear();
+  m_pendingPictureHeader = false;
+  m_pendingRecoveryPoint = false;
+
+  append(entry);
+  addSlice(nal);
+  m_curHasVcl = true;
+  m_lastVclNalUnitType = nal.nal_unit_type;
+  return completed;
+}
+
+bool AccessUnitAssembler::finish()
+{
+  if (m_cur.nals.empty())
+    return false;
+
+  m_cur.index = m_auCount++;
+  std::swap(m_cur, m_completed);
+
+  // Keep the NAL list capacity of the previous access unit to avoid reallocations
+  m_cur.nals.clear();
+  m_cur.offset = 0;
+  m_cur.size = 0;
+  m_cur.firstVclNalUnitType = -1;
+  m_cur.irap = false;
+  m_cur.key = false;
+  m_cur.picType = sliceType::SLICE_UNKNOWN;
+  m_cur.temporalId = 0;
+  m_cur.reference = false;
+  m_cur.pocValid = false;
+  m_cur.poc = 0;
+  m_cur.pts = -1;
+  m_cur.dts = -1;
+  m_curHasVcl = false;
+  m_curRecoveryPoint = false;
+  return true;
+}
+
+bool AccessUnitAssembler::flush()
+{
+  for (size_t i = 0; i < m_pending.size(); i++)
+    append(m_pending[i]);
+  m_pending.clear();
+  m_pendingPictureHeader = false;
+  m_pendingRecoveryPoint = false;
+  return finish();
+}
+
+void AccessUnitAssembler::assemble(unsigned char *buffer, int size, std::vector<access_unit> &aus)
+{
+  NALParse parser;
+  const parsingLevel level = m_slicePrefix ? parsingLevel::PARSING_SLICE_PREFIX : parsingLevel::PARSING_FULL;
+
+  int nextNalPos = 0;
+  while (nextNalPos < size)
+  {
+    const int nalPos = nextNalPos;
+    parser.nal_parse(buffer, m_codecType, nextNalPos, size, level);
+    if (nextNalPos <= nalPos)
+      break;
+    if (push(*parser.nal, nalPos, static_cast<uint32_t>(nextNalPos - nalPos)))
+      aus.push_back(m_completed);
+  }
+  if (flush())
+    aus.push_back(m_completed);
+}
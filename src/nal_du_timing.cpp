@@ -0,0 +1,308 @@
+#include "nal_du_timing.h"
+
+DuTimingCalculator::DuTimingCalculator(videoCodecType codecType)
+{
+  m_codecType = codecType;
+  clear();
+}
+
+DuTimingCalculator::~DuTimingCalculator()
+{
+}
+
+void DuTimingCalculator::clear()
+{
+  m_clockTick = 0;
+  m_clockSubTick = 0;
+  m_subPicHrd = false;
+  m_duParamsInPicTiming = false;
+  m_htid = 0;
+
+  m_forceNewAu = false;
+  m_started = false;
+  m_bpRemovalTime = 0;
+  m_prevAuRemovalTime = 0;
+  m_bpInitialRemovalTime = 0;
+
+  m_cur = du_timing{};
+  newAccessUnit();
+}
+
+void DuTimingCalculator::newAccessUnit()
+{
+  if (m_started)
+    m_cur.auIndex++;
+  m_cur.duIndex = 0;
+  m_cur.numDecodingUnits = 0;
+  m_cur.auRemovalTime = -1;
+  m_cur.duRemovalTime = -1;
+
+  m_vclInAu = false;
+  m_bpInAu = false;
+  m_nalCountInAu = 0;
+  m_duRemovalTimes.clear();
+  m_duLastNal.clear();
+}
+
+bool DuTimingCalculator::opensAccessUnit(const nal_info &nal) const
+{
+  // Parameter sets and prefix SEI may sit between the slices of one picture, so only NAL units which
+  // exist once per access unit before its first slice are taken as boundaries
+  bool prefixSei = false;
+  if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    if (nal.nal_unit_type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_ACCESS_UNIT_DELIMITER))
+      return true;
+    prefixSei = (nal.nal_unit_type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI));
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    if (nal.nal_unit_type == vvc::NAL_UNIT_ACCESS_UNIT_DELIMITER || nal.nal_unit_type == vvc::NAL_UNIT_PH)
+      return true;
+    prefixSei = (nal.nal_unit_type == vvc::NAL_UNIT_PREFIX_SEI);
+  }
+  if (!prefixSei)
+    return false;
+
+  for (size_t i = 0; i < nal.sei_types.size(); i++)
+  {
+    const int payloadType = nal.sei_types[i];
+    if (payloadType == SEI::BUFFERING_PERIOD || payloadType == SEI::PICTURE_TIMING)
+      return true;
+    if (payloadType == SEI::DECODING_UNIT_INFO && nal.mpegCommonSEI.common_sei_dui.decodingUnitIdx == 0)
+      return true;
+  }
+  return false;
+}
+
+bool DuTimingCalculator::updateHrd(const nal_info &nal)
+{
+  m_clockTick = 0;
+  m_subPicHrd = false;
+  if (!nal.mpegParamSet.sps)
+    return false;
+
+  uint32_t numUnitsInTick = 0, timeScale = 0, tickDivisor = 2, maxSubLayers = 1;
+  if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+    const hevc::TComVUI *vui = &(sps->m_vuiParameters);
+    if (!sps->m_vuiParametersPresentFlag || !vui->m_timingInfo.m_timingInfoPresentFlag)
+      return false;
+
+    numUnitsInTick = vui->m_timingInfo.m_numUnitsInTick;
+    timeScale = vui->m_timingInfo.m_timeScale;
+    if (vui->m_hrdParametersPresentFlag && vui->m_hrdParameters.m_subPicCpbParamsPresentFlag)
+    {
+      m_subPicHrd = true;
+      m_duParamsInPicTiming = vui->m_hrdParameters.m_subPicCpbParamsInPicTimingSEIFlag;
+      tickDivisor = vui->m_hrdParameters.m_tickDivisorMinus2 + 2;
+    }
+    // Delays of H265/HEVC are only signalled for the highest sub-layer
+    maxSubLayers = sps->m_uiMaxTLayers;
+    m_htid = maxSubLayers > 0 ? maxSubLayers - 1 : 0;
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+    const SEIBufferingPeriod &bp = nal.vvcSEI.vvc_sei_bp;
+    if (!sps->m_generalHrdParametersPresentFlag || !nal.vvcSEI.vvc_bp_available)
+      return false;
+
+    numUnitsInTick = sps->m_generalHrdParams.m_numUnitsInTick;
+    timeScale = sps->m_generalHrdParams.m_timeScale;
+    if (bp.bpDecodingUnitHrdParamsPresentFlag)
+    {
+      m_subPicHrd = true;
+      m_duParamsInPicTiming = bp.decodingUnitCpbParamsInPicTimingSeiFlag;
+      tickDivisor = sps->m_generalHrdParams.m_tickDivisorMinus2 + 2;
+    }
+    maxSubLayers = bp.bpMaxSubLayers;
+    m_htid = (nal.target_temporal_id < 0 || nal.target_temporal_id >= (int)maxSubLayers) ? maxSubLayers - 1 : nal.target_temporal_id;
+  }
+  if (numUnitsInTick == 0 || timeScale == 0)
+    return false;
+
+  m_clockTick = (double)numUnitsInTick / timeScale;
+  m_clockSubTick = m_clockTick / tickDivisor;
+  return true;
+}
+
+void DuTimingCalculator::onBufferingPeriod(const nal_info &nal)
+{
+  if (!updateHrd(nal))
+    return;
+
+  uint32_t initialDelay = 0;
+  if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+    const int nalOrVcl = sps->m_vuiParameters.m_hrdParameters.m_nalHrdParametersPresentFlag ? 0 : 1;
+    initialDelay = nal.hevcSEI.hevc_sei_bp.initialCpbRemovalDelay[0][nalOrVcl];
+  }
+  else
+  {
+    const SEIBufferingPeriod &bp = nal.vvcSEI.vvc_sei_bp;
+    const int nalOrVcl = bp.bpNalCpbParamsPresentFlag ? 0 : 1;
+    initialDelay = bp.sublayerInitialCpbRemovalDelayPresentFlag ? bp.sublayerInitialCpbRemovalDelay[m_htid][0][nalOrVcl] : bp.initialCpbRemovalDelay[0][nalOrVcl];
+  }
+  m_bpInAu = true;
+  m_bpInitialRemovalTime = initialDelay / 90000.0;
+}
+
+void DuTimingCalculator::onPictureTiming(const nal_info &nal)
+{
+  if (!updateHrd(nal))
+    return;
+
+  uint32_t auCpbRemovalDelay = 0;
+  bool concatenation = false;
+  uint32_t auCpbRemovalDelayDelta = 0;
+  if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    auCpbRemovalDelay = nal.hevcSEI.hevc_sei_pt.auCpbRemovalDelay;
+    concatenation = nal.hevcSEI.hevc_sei_bp.concatenationFlag;
+    auCpbRemovalDelayDelta = nal.hevcSEI.hevc_sei_bp.auCpbRemovalDelayDelta;
+  }
+  else
+  {
+    const SEIPictureTimingH266 &pt = nal.vvcSEI.vvc_sei_pt;
+    // pt_cpb_removal_delay_minus1[i] not present is inferred from the next higher sub-layer
+    uint32_t tid = m_htid;
+    while (tid + 1 < nal.vvcSEI.vvc_sei_bp.bpMaxSubLayers && !pt.m_ptSubLayerDelaysPresentFlag[tid])
+      tid++;
+    auCpbRemovalDelay = pt.m_auCpbRemovalDelay[tid];
+    concatenation = nal.vvcSEI.vvc_sei_bp.concatenationFlag;
+    auCpbRemovalDelayDelta = nal.vvcSEI.vvc_sei_bp.auCpbRemovalDelayDelta;
+  }
+
+  // AuNominalRemovalTime of C.2.3 (H265) / C.2.3 (H266), splicing reduced to au_cpb_removal_delay_delta
+  double auRemovalTime;
+  if (m_bpInAu)
+  {
+    if (!m_started)
+      auRemovalTime = m_bpInitialRemovalTime;
+    else if (concatenation)
+      auRemovalTime = m_prevAuRemovalTime + m_clockTick * auCpbRemovalDelayDelta;
+    else
+      auRemovalTime = m_bpRemovalTime + m_clockTick * auCpbRemovalDelay;
+    m_bpRemovalTime = auRemovalTime;
+    m_started = true;
+  }
+  else if (m_started)
+  {
+    auRemovalTime = m_bpRemovalTime + m_clockTick * auCpbRemovalDelay;
+  }
+  else
+  {
+    return;
+  }
+  m_prevAuRemovalTime = auRemovalTime;
+  m_cur.auRemovalTime = auRemovalTime;
+
+  if (!m_subPicHrd)
+  {
+    m_cur.numDecodingUnits = 1;
+    m_cur.duRemovalTime = auRemovalTime;
+    return;
+  }
+  if (!m_duParamsInPicTiming)
+    return;
+
+  // DuNominalRemovalTime : the last decoding unit is removed with the access unit, each one before by its increment
+  uint32_t numDecodingUnits;
+  if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    const SEIPictureTimingH265 &pt = nal.hevcSEI.hevc_sei_pt;
+    numDecodingUnits = pt.numDecodingUnitsMinus1 + 1;
+    m_duRemovalTimes.assign(numDecodingUnits, auRemovalTime);
+    m_duLastNal.assign(numDecodingUnits, 0);
+    for (int i = (int)numDecodingUnits - 2; i >= 0; i--)
+    {
+      const uint32_t increment = pt.duCommonCpbRemovalDelayFlag ? pt.duCommonCpbRemovalDelayMinus1 + 1 : pt.duCpbRemovalDelayMinus1[i] + 1;
+      m_duRemovalTimes[i] = m_duRemovalTimes[i + 1] - m_clockSubTick * increment;
+    }
+    for (uint32_t i = 0, lastNal = 0; i < numDecodingUnits; i++)
+    {
+      lastNal += pt.numNalusInDuMinus1[i] + 1;
+      m_duLastNal[i] = lastNal - 1;
+    }
+  }
+  else
+  {
+    const SEIPictureTimingH266 &pt = nal.vvcSEI.vvc_sei_pt;
+    const uint32_t maxSubLayers = nal.vvcSEI.vvc_sei_bp.bpMaxSubLayers;
+    uint32_t tid = m_htid;
+    while (tid + 1 < maxSubLayers && !pt.m_ptSubLayerDelaysPresentFlag[tid])
+      tid++;
+
+    numDecodingUnits = pt.m_numDecodingUnitsMinus1 + 1;
+    m_duRemovalTimes.assign(numDecodingUnits, auRemovalTime);
+    m_duLastNal.assign(numDecodingUnits, 0);
+    for (int i = (int)numDecodingUnits - 2; i >= 0; i--)
+    {
+      const uint32_t increment = pt.m_duCommonCpbRemovalDelayFlag ? pt.m_duCommonCpbRemovalDelayMinus1[tid] + 1 : pt.m_duCpbRemovalDelayMinus1[i * maxSubLayers + tid] + 1;
+      m_duRemovalTimes[i] = m_duRemovalTimes[i + 1] - m_clockSubTick * increment;
+    }
+    for (uint32_t i = 0, lastNal = 0; i < numDecodingUnits; i++)
+    {
+      lastNal += pt.m_numNalusInDuMinus1[i] + 1;
+      m_duLastNal[i] = lastNal - 1;
+    }
+  }
+  m_cur.numDecodingUnits = numDecodingUnits;
+}
+
+void DuTimingCalculator::onDecodingUnitInfo(const nal_info &nal)
+{
+  if (!updateHrd(nal) || !m_subPicHrd)
+    return;
+
+  const SEIDecodingUnitInfo &dui = nal.mpegCommonSEI.common_sei_dui;
+  m_cur.duIndex = dui.decodingUnitIdx;
+  if (m_duParamsInPicTiming)
+    return;
+
+  uint32_t tid = m_htid;
+  while (tid + 1 < MAX_TLAYER && !dui.subLayerDelaysPresentFlag[tid])
+    tid++;
+  m_cur.duRemovalTime = (m_cur.auRemovalTime < 0 || !dui.subLayerDelaysPresentFlag[tid]) ? -1 : m_cur.auRemovalTime - m_clockSubTick * dui.duSptCpbRemovalDelayIncrement[tid];
+}
+
+const du_timing &DuTimingCalculator::push(const nal_info &nal)
+{
+  if (m_forceNewAu || (m_vclInAu && opensAccessUnit(nal)))
+    newAccessUnit();
+  m_forceNewAu = false;
+
+  const uint32_t nalIndex = m_nalCountInAu++;
+
+  for (size_t i = 0; i < nal.sei_types.size(); i++)
+  {
+    switch (nal.sei_types[i])
+    {
+    case SEI::BUFFERING_PERIOD:
+      onBufferingPeriod(nal);
+      break;
+    case SEI::PICTURE_TIMING:
+      onPictureTiming(nal);
+      break;
+    case SEI::DECODING_UNIT_INFO:
+      onDecodingUnitInfo(nal);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (!m_duLastNal.empty())
+  {
+    while (m_cur.duIndex + 1 < m_duLastNal.size() && nalIndex > m_duLastNal[m_cur.duIndex])
+      m_cur.duIndex++;
+    m_cur.duRemovalTime = m_duRemovalTimes[m_cur.duIndex];
+  }
+
+  if (NALParse::nal_is_vcl(m_codecType, nal.nal_unit_type))
+    m_vclInAu = true;
+  return m_cur;
+}
@@ -0,0 +1,87 @@
+#include "nal_extract.h"
+
+SubLayerExtractor::SubLayerExtractor(videoCodecType codecType, int targetTemporalId)
+{
+  m_codecType = codecType;
+  m_targetTemporalId = targetTemporalId;
+  clear();
+}
+
+SubLayerExtractor::~SubLayerExtractor()
+{
+}
+
+void SubLayerExtractor::clear()
+{
+  m_h264PrefixTemporalId = 0;
+  clearCounters();
+}
+
+int SubLayerExtractor::headerNalUnitType(const unsigned char *header, size_t size) const
+{
+  if (size < (m_codecType == videoCodecType::H264_AVC ? 1u : 2u))
+    return -1;
+  if (m_codecType == videoCodecType::H264_AVC)
+    return header[0] & 0x1f;
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return (header[0] & 0x7e) >> 1;
+  if (m_codecType == videoCodecType::H266_VVC)
+    return header[1] >> 3;
+  return -1;
+}
+
+int SubLayerExtractor::temporalId(int nalUnitType, const unsigned char *header, size_t size)
+{
+  if (m_codecType == videoCodecType::H265_HEVC || m_codecType == videoCodecType::H266_VVC)
+    return size >= 2 ? static_cast<int>(header[1] & 0x07) - 1 : 0;
+
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    // nal_unit_header_svc_extension() : temporal_id is the 3 MSBs of its third byte (G.7.3.1.1)
+    const bool svcExtension = nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_PREFIX) ||
+                              nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SLC_EXT);
+    if (svcExtension)
+    {
+      const int tid = (size >= 4 && (header[1] & 0x80)) ? (header[3] >> 5) : 0;
+      if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_PREFIX))
+        m_h264PrefixTemporalId = tid;
+      return tid;
+    }
+    if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SLICE) || nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR))
+    {
+      const int tid = m_h264PrefixTemporalId;
+      m_h264PrefixTemporalId = 0;
+      return tid;
+    }
+  }
+  return 0;
+}
+
+bool SubLayerExtractor::isKept(int temporalId) const
+{
+  return m_targetTemporalId < 0 || temporalId <= m_targetTemporalId;
+}
+
+bool SubLayerExtractor::push(const nal_info &nal, const unsigned char *data, size_t size, std::vector<struct iovec> &iov)
+{
+  size_t i = 0;
+  while (i + 2 < size && !(data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1))
+    i++;
+  const unsigned char *header = data + i + 3;
+  const size_t headerSize = (i + 3 < size) ? size - i - 3 : 0;
+
+  int tid = nal.temporal_id;
+  if (m_codecType == videoCodecType::H264_AVC)
+    tid = temporalId(nal.nal_unit_type, header, headerSize);
+  return keep(isKept(tid), data, size, iov);
+}
+
+bool SubLayerExtractor::filter(const unsigned char *, size_t, const unsigned char *header, size_t headerSize)
+{
+  return isKept(temporalId(headerNalUnitType(header, headerSize), header, headerSize));
+}
+
+void SubLayerExtractor::extract(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov)
+{
+  scan(buffer, size, iov);
+}
@@ -0,0 +1,90 @@
+#include "nal_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+MappedFile::MappedFile()
+{
+  m_data = NULL;
+  m_size = 0;
+  m_mapSize = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const char *path, size_t padding, fileAccess access)
+{
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+
+#ifdef HAVE_SYS_MMAN_H
+  // The file is mapped over an anonymous zero mapping covering the padding
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t mapSize = ((size + page - 1) / page + (padding + page - 1) / page) * page;
+  void *base = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+  {
+    ::close(fd);
+    return false;
+  }
+  void *map = mmap(base, size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    munmap(base, mapSize);
+    return false;
+  }
+  madvise(map, size, access == fileAccess::ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+  m_data = static_cast<uint8_t *>(map);
+  m_mapSize = mapSize;
+#else
+  (void)access;
+  m_buffer.assign(size + padding, 0);
+  size_t done = 0;
+  while (done < size)
+  {
+    const ssize_t got = read(fd, m_buffer.data() + done, size - done);
+    if (got <= 0)
+      break;
+    done += static_cast<size_t>(got);
+  }
+  ::close(fd);
+  if (done < size)
+  {
+    std::vector<uint8_t>().swap(m_buffer);
+    return false;
+  }
+  m_data = m_buffer.data();
+#endif
+  m_size = size;
+  return true;
+}
+
+void MappedFile::close()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (m_data && m_mapSize)
+    munmap(m_data, m_mapSize);
+#endif
+  std::vector<uint8_t>().swap(m_buffer);
+  m_data = NULL;
+  m_size = 0;
+  m_mapSize = 0;
+}
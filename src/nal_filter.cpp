@@ -0,0 +1,128 @@
+#include "nal_filter.h"
+
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+NalFilter::NalFilter()
+{
+  clearCounters();
+}
+
+NalFilter::~NalFilter()
+{
+}
+
+void NalFilter::clearCounters()
+{
+  m_keptNals = 0;
+  m_droppedNals = 0;
+  m_droppedBytes = 0;
+}
+
+void NalFilter::append(const unsigned char *data, size_t size, std::vector<struct iovec> &iov)
+{
+  if (!iov.empty() && static_cast<const unsigned char *>(iov.back().iov_base) + iov.back().iov_len == data)
+  {
+    iov.back().iov_len += size;
+  }
+  else
+  {
+    struct iovec v;
+    v.iov_base = const_cast<unsigned char *>(data);
+    v.iov_len = size;
+    iov.push_back(v);
+  }
+}
+
+bool NalFilter::keep(bool kept, const unsigned char *data, size_t size, std::vector<struct iovec> &iov)
+{
+  if (!kept)
+  {
+    m_droppedNals++;
+    m_droppedBytes += size;
+    return false;
+  }
+
+  m_keptNals++;
+  append(data, size, iov);
+  return true;
+}
+
+void NalFilter::scan(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov)
+{
+  size_t nalStart = 0;
+  size_t headerPos = 0;
+  bool inNal = false;
+  size_t pos = 0;
+  for (;;)
+  {
+    const unsigned char *p = pos + 2 < size ? static_cast<const unsigned char *>(memchr(buffer + pos + 2, 1, size - pos - 2)) : NULL;
+    if (p)
+    {
+      const size_t one = static_cast<size_t>(p - buffer);
+      if (buffer[one - 1] != 0 || buffer[one - 2] != 0)
+      {
+        pos = one - 1;
+        continue;
+      }
+      pos = one;
+    }
+
+    const size_t nalEnd = p ? ((pos >= 3 && buffer[pos - 3] == 0) ? pos - 3 : pos - 2) : size;
+    if (inNal)
+    {
+      const size_t headerSize = nalEnd > headerPos ? nalEnd - headerPos : 0;
+      keep(filter(buffer + nalStart, nalEnd - nalStart, buffer + headerPos, headerSize), buffer + nalStart, nalEnd - nalStart, iov);
+    }
+    else if (nalEnd > 0)
+    {
+      append(buffer, nalEnd, iov);
+    }
+    if (!p)
+      break;
+
+    nalStart = nalEnd;
+    inNal = true;
+    headerPos = pos + 1;
+    pos = pos + 1;
+  }
+}
+
+bool NalFilter::write(int fd, const std::vector<struct iovec> &iov)
+{
+  size_t index = 0;
+  size_t done = 0; // Bytes of iov[index] already written
+  while (index < iov.size())
+  {
+    struct iovec batch[IOV_MAX];
+    int count = 0;
+    for (size_t i = index; i < iov.size() && count < IOV_MAX; i++, count++)
+      batch[count] = iov[i];
+    batch[0].iov_base = static_cast<unsigned char *>(batch[0].iov_base) + done;
+    batch[0].iov_len -= done;
+
+    ssize_t written = writev(fd, batch, count);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    size_t left = static_cast<size_t>(written);
+    while (index < iov.size() && left >= iov[index].iov_len - done)
+    {
+      left -= iov[index].iov_len - done;
+      done = 0;
+      index++;
+    }
+    done += left;
+  }
+  return true;
+}
@@ -0,0 +1,221 @@
+#include "nal_gop.h"
+
+#include <algorithm>
+
+GopAnalyzer::GopAnalyzer(videoCodecType codecType)
+    : m_assembler(codecType, parsingLevel::PARSING_SLICE_PREFIX)
+{
+  m_codecType = codecType;
+  clear();
+}
+
+GopAnalyzer::~GopAnalyzer()
+{
+}
+
+void GopAnalyzer::clear()
+{
+  m_assembler.clear();
+  m_gopCount = 0;
+  m_cur = gop_stats{};
+  m_cur.keyNalUnitType = -1;
+  m_cur.maxTemporalId = -1;
+  m_completed = m_cur;
+  m_numRasl = 0;
+  m_bRun = 0;
+  m_keyPocValid = false;
+  m_keyPoc = 0;
+  m_pocWindowSize = 0;
+  m_pocWindowPos = 0;
+  m_afterEndOfSequence = false;
+  m_spsMaxReorder = -1;
+  m_spsMaxDecPicBuffering = -1;
+}
+
+bool GopAnalyzer::isIdr(int nalUnitType) const
+{
+  if (m_codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR);
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_W_RADL) ||
+           nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_N_LP);
+  if (m_codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL || nalUnitType == vvc::NAL_UNIT_CODED_SLICE_IDR_N_LP;
+  return false;
+}
+
+bool GopAnalyzer::isPocReset(int nalUnitType, bool newSequence) const
+{
+  // Pictures starting a new POC timeline : every previous picture is output before them
+  // CRA and GDR pictures only after an end of sequence (NoRaslOutputFlag / NoOutputBeforeRecoveryFlag equal to 1)
+  if (isIdr(nalUnitType))
+    return true;
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return (nalUnitType >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP) &&
+            nalUnitType <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_N_LP)) ||
+           (newSequence && nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_CRA));
+  if (m_codecType == videoCodecType::H266_VVC)
+    return newSequence && (nalUnitType == vvc::NAL_UNIT_CODED_SLICE_CRA || nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR);
+  return false;
+}
+
+bool GopAnalyzer::isRasl(int nalUnitType) const
+{
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_RASL_N) ||
+           nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_RASL_R);
+  if (m_codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_CODED_SLICE_RASL;
+  return false;
+}
+
+void GopAnalyzer::updateSpsLimits(const nal_info &nal)
+{
+  if (!nal.mpegParamSet.sps)
+    return;
+
+  m_spsMaxReorder = -1;
+  m_spsMaxDecPicBuffering = -1;
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    const avc::sps *sps = static_cast<const avc::sps *>(nal.mpegParamSet.sps);
+    if (sps->vui_parameters_present_flag && sps->vui_seq_parameters.bitstream_restriction_flag)
+    {
+      m_spsMaxReorder = static_cast<int>(sps->vui_seq_parameters.num_reorder_frames);
+      m_spsMaxDecPicBuffering = static_cast<int>(sps->vui_seq_parameters.max_dec_frame_buffering);
+    }
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+    const unsigned int htid = sps->m_uiMaxTLayers > 0 ? std::min<unsigned int>(sps->m_uiMaxTLayers, MAX_TLAYER) - 1 : 0;
+    m_spsMaxReorder = sps->m_numReorderPics[htid];
+    m_spsMaxDecPicBuffering = static_cast<int>(sps->m_uiMaxDecPicBuffering[htid]);
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+    if (sps->m_ptlDpbHrdParamsPresentFlag)
+    {
+      const uint32_t htid = sps->m_uiMaxTLayers > 0 ? std::min<uint32_t>(sps->m_uiMaxTLayers, MAX_TLAYER) - 1 : 0;
+      m_spsMaxReorder = sps->m_maxNumReorderPics[htid];
+      m_spsMaxDecPicBuffering = static_cast<int>(sps->m_maxDecPicBuffering[htid]);
+    }
+  }
+}
+
+bool GopAnalyzer::finishGop()
+{
+  if (m_cur.numPictures == 0)
+    return false;
+
+  if (m_cur.keyNalUnitType >= 0)
+  {
+    if (m_codecType == videoCodecType::H264_AVC)
+      m_cur.closed = isIdr(m_cur.keyNalUnitType) || m_cur.numLeading == 0;
+    else
+      m_cur.closed = m_numRasl == 0;
+  }
+  m_cur.reorderExceeded = m_cur.spsMaxReorder >= 0 && m_cur.maxReorder > static_cast<uint32_t>(m_cur.spsMaxReorder);
+
+  m_completed = m_cur;
+  m_cur = gop_stats{};
+  m_cur.keyNalUnitType = -1;
+  m_cur.maxTemporalId = -1;
+  m_numRasl = 0;
+  m_bRun = 0;
+  m_keyPocValid = false;
+  m_gopCount++;
+  return true;
+}
+
+bool GopAnalyzer::addAccessUnit(const access_unit &au)
+{
+  bool completed = false;
+  if (au.key && m_cur.numPictures > 0)
+    completed = finishGop();
+
+  if (m_cur.numPictures == 0)
+  {
+    m_cur.index = m_gopCount;
+    m_cur.firstAu = au.index;
+    m_cur.offset = au.offset;
+    m_cur.keyNalUnitType = au.key ? au.firstVclNalUnitType : -1;
+    m_keyPocValid = au.key && au.pocValid;
+    m_keyPoc = au.poc;
+    // Limits of the SPS received before the first access unit of the GOP
+    m_cur.spsMaxReorder = m_spsMaxReorder;
+    m_cur.spsMaxDecPicBuffering = m_spsMaxDecPicBuffering;
+  }
+  const bool newSequence = m_afterEndOfSequence;
+  m_afterEndOfSequence = !au.nals.empty() && NALParse::nal_is_end_of_sequence(m_codecType, au.nals.back().nalUnitType);
+  if (isPocReset(au.firstVclNalUnitType, newSequence))
+  {
+    m_pocWindowSize = 0;
+    m_pocWindowPos = 0;
+  }
+
+  m_cur.numPictures++;
+  m_cur.size += au.size;
+
+  if (au.picType == sliceType::SLICE_I)
+    m_cur.numI++;
+  else if (au.picType == sliceType::SLICE_P)
+    m_cur.numP++;
+  else if (au.picType == sliceType::SLICE_B)
+    m_cur.numB++;
+  else
+    m_cur.numUnknown++;
+
+  if (au.picType == sliceType::SLICE_B)
+  {
+    m_bRun++;
+    m_cur.maxBRun = std::max(m_cur.maxBRun, m_bRun);
+    if (au.reference)
+      m_cur.numReferenceB++;
+  }
+  else
+  {
+    m_bRun = 0;
+  }
+
+  const int tid = std::min(std::max(au.temporalId, 0), MAX_TLAYER - 1);
+  m_cur.picturesPerTemporalId[tid]++;
+  m_cur.maxTemporalId = std::max(m_cur.maxTemporalId, tid);
+  if (isRasl(au.firstVclNalUnitType))
+    m_numRasl++;
+
+  if (au.pocValid)
+  {
+    // Pictures decoded before this one and output after it
+    uint32_t reorder = 0;
+    for (uint32_t i = 0; i < m_pocWindowSize; i++)
+      reorder += (m_pocWindow[i] > au.poc) ? 1 : 0;
+    m_cur.maxReorder = std::max(m_cur.maxReorder, reorder);
+
+    if (m_keyPocValid && au.poc < m_keyPoc)
+      m_cur.numLeading++;
+
+    m_pocWindow[m_pocWindowPos] = au.poc;
+    m_pocWindowPos = (m_pocWindowPos + 1) % REORDER_WINDOW;
+    m_pocWindowSize = std::min<uint32_t>(m_pocWindowSize + 1, REORDER_WINDOW);
+  }
+  return completed;
+}
+
+bool GopAnalyzer::push(const nal_info &nal, int64_t offset, uint32_t size)
+{
+  if (NALParse::nal_is_sps(m_codecType, nal.nal_unit_type))
+    updateSpsLimits(nal);
+
+  if (!m_assembler.push(nal, offset, size))
+    return false;
+  return addAccessUnit(m_assembler.au());
+}
+
+bool GopAnalyzer::flush()
+{
+  if (m_assembler.flush() && addAccessUnit(m_assembler.au()))
+    return true;
+  return finishGop();
+}
@@ -0,0 +1,379 @@
+#include "nal_hrd.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Type I bitstream of the VCL HRD : VCL and filler data NAL units
+static bool isVclHrdNal(videoCodecType codecType, int nalUnitType)
+{
+  if (NALParse::nal_is_vcl(codecType, nalUnitType))
+    return true;
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_FILL);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_FILLER_DATA);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_FD;
+  return false;
+}
+
+CpbAnalyzer::CpbAnalyzer(videoCodecType codecType, double windowSeconds)
+    : m_assembler(codecType, parsingLevel::PARSING_SLICE_PREFIX)
+{
+  m_codecType = codecType;
+  m_windowSeconds = windowSeconds > 0 ? windowSeconds : 1.0;
+  clear();
+}
+
+CpbAnalyzer::~CpbAnalyzer()
+{
+}
+
+void CpbAnalyzer::clear()
+{
+  m_assembler.clear();
+  m_nalHrd = true;
+  m_clockTick = 0;
+  m_picDuration = 0;
+  m_schedules.clear();
+  m_states.clear();
+
+  resetSei(m_pendingSei);
+  resetSei(m_auSei);
+
+  m_auCount = 0;
+  m_bpRemovalTime = 0;
+  m_prevRemovalTime = 0;
+
+  m_pending.clear();
+  m_windowHead = 0;
+  m_windowBits = 0;
+  m_windowBitrate = 0;
+  m_peakBitrate = 0;
+}
+
+void CpbAnalyzer::updateHrd(const nal_info &nal)
+{
+  if (!nal.mpegParamSet.sps)
+    return;
+
+  // BitRate = ( bit_rate_value_minus1 + 1 ) * 2^( 6 + bit_rate_scale ), CpbSize = ( cpb_size_value_minus1 + 1 ) * 2^( 4 + cpb_size_scale )
+  std::vector<cpb_schedule> schedules;
+  double clockTick = 0, picDuration = 0;
+  bool nalHrd = true;
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    const avc::sps *sps = static_cast<const avc::sps *>(nal.mpegParamSet.sps);
+    const avc::vui_seq_parameters_t &vui = sps->vui_seq_parameters;
+    if (sps->vui_parameters_present_flag && vui.timing_info_present_flag && vui.num_units_in_tick && vui.time_scale)
+    {
+      clockTick = (double)vui.num_units_in_tick / vui.time_scale;
+      picDuration = 2 * clockTick; // A frame lasts two ticks
+    }
+    if (clockTick > 0 && (vui.nal_hrd_parameters_present_flag || vui.vcl_hrd_parameters_present_flag))
+    {
+      nalHrd = vui.nal_hrd_parameters_present_flag;
+      const avc::hrd_parameters_t &hrd = nalHrd ? vui.nal_hrd_parameters : vui.vcl_hrd_parameters;
+      for (uint32_t k = 0; k <= hrd.cpb_cnt_minus1 && k < MAX_CPB_CNT; k++)
+      {
+        cpb_schedule s = cpb_schedule{};
+        s.schedSelIdx = k;
+        s.bitRate = ldexp((double)hrd.bit_rate_value_minus1[k] + 1, 6 + hrd.bit_rate_scale);
+        s.cpbSize = ldexp((double)hrd.cpb_size_value_minus1[k] + 1, 4 + hrd.cpb_size_scale);
+        s.cbr = hrd.cbr_flag[k] != 0;
+        schedules.push_back(s);
+      }
+    }
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+    const hevc::TComVUI &vui = sps->m_vuiParameters;
+    const hevc::TComHRD &hrd = vui.m_hrdParameters;
+    // The HRD of the highest sub-layer
+    const hevc::HrdSubLayerInfo &sub = hrd.m_HRD[sps->m_uiMaxTLayers > 0 ? std::min<unsigned int>(sps->m_uiMaxTLayers, MAX_TLAYER) - 1 : 0];
+    if (sps->m_vuiParametersPresentFlag && vui.m_timingInfo.m_timingInfoPresentFlag && vui.m_timingInfo.m_numUnitsInTick && vui.m_timingInfo.m_timeScale)
+    {
+      clockTick = (double)vui.m_timingInfo.m_numUnitsInTick / vui.m_timingInfo.m_timeScale;
+      picDuration = (vui.m_hrdParametersPresentFlag && sub.fixedPicRateWithinCvsFlag) ? clockTick * (sub.picDurationInTcMinus1 + 1) : clockTick;
+    }
+    if (clockTick > 0 && vui.m_hrdParametersPresentFlag && (hrd.m_nalHrdParametersPresentFlag || hrd.m_vclHrdParametersPresentFlag))
+    {
+      nalHrd = hrd.m_nalHrdParametersPresentFlag;
+      const int nalOrVcl = nalHrd ? 0 : 1;
+      for (uint32_t k = 0; k <= sub.cpbCntMinus1 && k < MAX_CPB_CNT; k++)
+      {
+        cpb_schedule s = cpb_schedule{};
+        s.schedSelIdx = k;
+        s.bitRate = ldexp((double)sub.bitRateValueMinus1[k][nalOrVcl] + 1, 6 + hrd.m_bitRateScale);
+        s.cpbSize = ldexp((double)sub.cpbSizeValue[k][nalOrVcl] + 1, 4 + hrd.m_cpbSizeScale);
+        s.cbr = sub.cbrFlag[k][nalOrVcl];
+        schedules.push_back(s);
+      }
+    }
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+    const vvc::GeneralHrdParams &hrd = sps->m_generalHrdParams;
+    const vvc::OlsHrdParams &ols = sps->m_olsHrdParams[sps->m_uiMaxTLayers > 0 ? std::min<uint32_t>(sps->m_uiMaxTLayers, MAX_TLAYER) - 1 : 0];
+    if (sps->m_generalHrdParametersPresentFlag && hrd.m_numUnitsInTick && hrd.m_timeScale)
+    {
+      clockTick = (double)hrd.m_numUnitsInTick / hrd.m_timeScale;
+      picDuration = ols.m_fixedPicRateWithinCvsFlag ? clockTick * (ols.m_elementDurationInTcMinus1 + 1) : clockTick;
+    }
+    if (clockTick > 0 && (hrd.m_generalNalHrdParamsPresentFlag || hrd.m_generalVclHrdParamsPresentFlag))
+    {
+      nalHrd = hrd.m_generalNalHrdParamsPresentFlag;
+      const int nalOrVcl = nalHrd ? 0 : 1;
+      for (uint32_t k = 0; k <= hrd.m_hrdCpbCntMinus1 && k < MAX_CPB_CNT; k++)
+      {
+        cpb_schedule s = cpb_schedule{};
+        s.schedSelIdx = k;
+        s.bitRate = ldexp((double)ols.m_bitRateValueMinus1[k][nalOrVcl] + 1, 6 + hrd.m_bitRateScale);
+        s.cpbSize = ldexp((double)ols.m_cpbSizeValueMinus1[k][nalOrVcl] + 1, 4 + hrd.m_cpbSizeScale);
+        s.cbr = ols.m_cbrFlag[k][nalOrVcl];
+        schedules.push_back(s);
+      }
+    }
+  }
+
+  // An SPS repeated at every random access point keeps the simulation running
+  bool same = schedules.size() == m_schedules.size() && nalHrd == m_nalHrd && clockTick == m_clockTick && picDuration == m_picDuration;
+  for (size_t i = 0; same && i < schedules.size(); i++)
+    same = schedules[i].bitRate == m_schedules[i].bitRate && schedules[i].cpbSize == m_schedules[i].cpbSize && schedules[i].cbr == m_schedules[i].cbr;
+  if (same)
+    return;
+
+  // New HRD : empty the CPBs of the previous one, the next access unit starts a new timeline
+  for (size_t s = 0; s < m_states.size(); s++)
+    removeUntil(s, 0, true);
+  m_schedules = schedules;
+  m_states.assign(schedules.size(), schedule_state{});
+  for (size_t s = 0; s < m_states.size(); s++)
+  {
+    m_states[s].head = m_pending.size();
+    m_states[s].bpInitialDelay = -1;
+  }
+  m_nalHrd = nalHrd;
+  m_clockTick = clockTick;
+  m_picDuration = picDuration;
+  compact();
+}
+
+void CpbAnalyzer::resetSei(timing_sei &sei)
+{
+  sei.bp = false;
+  sei.pt = false;
+  sei.cpbRemovalDelay = 0;
+  sei.concatenation = false;
+  sei.cpbRemovalDelayDelta = 0;
+  for (int i = 0; i < MAX_CPB_CNT; i++)
+  {
+    sei.initialDelay[i] = -1;
+    sei.initialOffset[i] = 0;
+  }
+}
+
+void CpbAnalyzer::onSei(const nal_info &nal)
+{
+  for (size_t i = 0; i < nal.sei_types.size(); i++)
+  {
+    const int payloadType = nal.sei_types[i];
+    if (payloadType == SEI::BUFFERING_PERIOD)
+    {
+      const SEIBufferingPeriod *bp = NULL;
+      if (m_codecType == videoCodecType::H264_AVC)
+        bp = &nal.h264SEI.h264_sei_bp;
+      else if (m_codecType == videoCodecType::H265_HEVC)
+        bp = &nal.hevcSEI.hevc_sei_bp;
+      else if (m_codecType == videoCodecType::H266_VVC)
+        bp = &nal.vvcSEI.vvc_sei_bp;
+      if (!bp)
+        continue;
+
+      const int nalOrVcl = m_nalHrd ? 0 : 1;
+      m_pendingSei.bp = true;
+      m_pendingSei.concatenation = m_codecType != videoCodecType::H264_AVC && bp->concatenationFlag;
+      m_pendingSei.cpbRemovalDelayDelta = bp->auCpbRemovalDelayDelta;
+      for (int k = 0; k < MAX_CPB_CNT; k++)
+      {
+        m_pendingSei.initialDelay[k] = bp->initialCpbRemovalDelay[k][nalOrVcl] / 90000.0;
+        m_pendingSei.initialOffset[k] = bp->initialCpbRemovalDelayOffset[k][nalOrVcl] / 90000.0;
+      }
+    }
+    else if (payloadType == SEI::PICTURE_TIMING)
+    {
+      if (m_codecType == videoCodecType::H264_AVC)
+      {
+        m_pendingSei.pt = true;
+        m_pendingSei.cpbRemovalDelay = nal.h264SEI.h264_sei_pt.cpb_removal_delay;
+      }
+      else if (m_codecType == videoCodecType::H265_HEVC)
+      {
+        m_pendingSei.pt = true;
+        m_pendingSei.cpbRemovalDelay = nal.hevcSEI.hevc_sei_pt.auCpbRemovalDelay;
+      }
+      else if (m_codecType == videoCodecType::H266_VVC && nal.vvcSEI.vvc_bp_available && nal.vvcSEI.vvc_sei_bp.bpMaxSubLayers > 0)
+      {
+        // pt_cpb_removal_delay_minus1 of the highest sub-layer is always present
+        m_pendingSei.pt = true;
+        m_pendingSei.cpbRemovalDelay = nal.vvcSEI.vvc_sei_pt.m_auCpbRemovalDelay[nal.vvcSEI.vvc_sei_bp.bpMaxSubLayers - 1];
+      }
+    }
+  }
+}
+
+void CpbAnalyzer::removeUntil(size_t s, double time, bool flushAll)
+{
+  // The CPB fills between removals, so its largest fullness is reached just before each removal. The last access unit
+  // fed arrives from segmentStart to finalArrival, every access unit before it has fully arrived
+  cpb_schedule &sched = m_schedules[s];
+  schedule_state &st = m_states[s];
+  const double segmentStart = st.finalArrival - st.lastBits / sched.bitRate;
+  while (st.head < m_pending.size() && (flushAll || m_pending[st.head].removalTime < time))
+  {
+    const cpb_entry &e = m_pending[st.head];
+    const double notArrived = std::max(0.0, st.finalArrival - std::max(e.removalTime, segmentStart)) * sched.bitRate;
+    const double fullness = st.arrivedBits - notArrived - st.removedBits;
+
+    sched.numAccessUnits++;
+    sched.fullness = fullness;
+    sched.peakFullness = std::max(sched.peakFullness, fullness);
+    sched.headroom = sched.cpbSize - sched.peakFullness;
+    if (fullness > sched.cpbSize + 1e-6 * sched.cpbSize)
+      sched.overflows++;
+
+    st.removedBits += e.bits;
+    st.head++;
+  }
+}
+
+void CpbAnalyzer::compact()
+{
+  size_t head = m_windowHead;
+  for (size_t s = 0; s < m_states.size(); s++)
+    head = std::min(head, m_states[s].head);
+  if (head < 1024 || head * 2 < m_pending.size())
+    return;
+
+  m_pending.erase(m_pending.begin(), m_pending.begin() + head);
+  m_windowHead -= head;
+  for (size_t s = 0; s < m_states.size(); s++)
+    m_states[s].head -= head;
+}
+
+void CpbAnalyzer::addAccessUnit(const access_unit &au)
+{
+  double bits = 0;
+  if (m_nalHrd)
+  {
+    bits = 8.0 * au.size;
+  }
+  else
+  {
+    for (size_t i = 0; i < au.nals.size(); i++)
+      bits += isVclHrdNal(m_codecType, au.nals[i].nalUnitType) ? 8.0 * au.nals[i].size : 0;
+  }
+
+  // Nominal removal time relative to the first access unit (C.1.2 H264, C.2.3 H265 / H266)
+  const bool first = m_auCount == 0;
+  double removalTime;
+  if (first)
+    removalTime = 0;
+  else if (m_auSei.bp && m_auSei.concatenation)
+    removalTime = m_prevRemovalTime + m_clockTick * m_auSei.cpbRemovalDelayDelta;
+  else if (m_auSei.pt)
+    removalTime = m_bpRemovalTime + m_clockTick * m_auSei.cpbRemovalDelay;
+  else
+    removalTime = m_prevRemovalTime + m_picDuration;
+  removalTime = std::max(removalTime, m_prevRemovalTime);
+  if (first || m_auSei.bp)
+    m_bpRemovalTime = removalTime;
+
+  for (size_t s = 0; s < m_schedules.size(); s++)
+  {
+    cpb_schedule &sched = m_schedules[s];
+    schedule_state &st = m_states[s];
+    const bool timelineStart = st.head == m_pending.size() && st.arrivedBits == 0;
+    if (m_auSei.bp && m_auSei.initialDelay[sched.schedSelIdx] >= 0)
+    {
+      st.bpInitialDelay = m_auSei.initialDelay[sched.schedSelIdx];
+      st.bpInitialOffset = m_auSei.initialOffset[sched.schedSelIdx];
+    }
+    if (timelineStart)
+    {
+      // Without buffering period the CPB is full when the first access unit is removed
+      sched.initialDelay = st.bpInitialDelay >= 0 ? st.bpInitialDelay : sched.cpbSize / sched.bitRate;
+      sched.minArrivalMargin = sched.initialDelay;
+      st.finalArrival = removalTime - sched.initialDelay;
+    }
+
+    // Initial arrival : right after the previous access unit for CBR, not before the initial delay preceding the removal for VBR
+    double arrival = st.finalArrival;
+    if (!sched.cbr && !timelineStart)
+    {
+      const double delay = st.bpInitialDelay >= 0 ? st.bpInitialDelay + (m_auSei.bp ? 0 : st.bpInitialOffset) : sched.initialDelay;
+      arrival = std::max(arrival, removalTime - delay);
+    }
+    st.arrivedBits += bits;
+    st.lastBits = bits;
+    st.finalArrival = arrival + bits / sched.bitRate;
+
+    removeUntil(s, st.finalArrival, false);
+
+    const double margin = removalTime - st.finalArrival;
+    sched.minArrivalMargin = std::min(sched.minArrivalMargin, margin);
+    if (margin < -1e-9)
+      sched.underflows++;
+  }
+
+  cpb_entry e;
+  e.removalTime = removalTime;
+  e.bits = bits;
+  m_pending.push_back(e);
+
+  // Bitrate of the access units removed within the last window
+  m_windowBits += bits;
+  while (m_windowHead < m_pending.size() && m_pending[m_windowHead].removalTime <= removalTime - m_windowSeconds + 1e-9)
+    m_windowBits -= m_pending[m_windowHead++].bits;
+  m_windowBitrate = m_windowBits / m_windowSeconds;
+  m_peakBitrate = std::max(m_peakBitrate, m_windowBitrate);
+
+  m_prevRemovalTime = removalTime;
+  m_auCount++;
+  compact();
+}
+
+bool CpbAnalyzer::push(const nal_info &nal, int64_t offset, uint32_t size)
+{
+  // The first VCL NAL unit of an access unit completes the previous one, the SEI received before it are then bound to its own
+  const bool completed = m_assembler.push(nal, offset, size);
+  if (completed)
+  {
+    addAccessUnit(m_assembler.au());
+    resetSei(m_auSei);
+  }
+  if (NALParse::nal_is_vcl(m_codecType, nal.nal_unit_type) && (m_pendingSei.bp || m_pendingSei.pt))
+  {
+    m_auSei = m_pendingSei;
+    resetSei(m_pendingSei);
+  }
+
+  if (NALParse::nal_is_sps(m_codecType, nal.nal_unit_type))
+    updateHrd(nal);
+  onSei(nal);
+  return completed;
+}
+
+void CpbAnalyzer::flush()
+{
+  if (m_assembler.flush())
+  {
+    addAccessUnit(m_assembler.au());
+    resetSei(m_auSei);
+  }
+  resetSei(m_pendingSei);
+  for (size_t s = 0; s < m_states.size(); s++)
+    removeUntil(s, 0, true);
+}
@@ -0,0 +1,516 @@
+#include "nal_index.h"
+#include "nal_probe.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char RAI_MAGIC[8] = {'N', 'A', 'L', 'R', 'A', 'I', 'D', 'X'};
+static const uint32_t RAI_VERSION = 1;
+static const size_t RAI_WINDOW_SIZE = 16 << 20; // Bytes of the stream read at once, doubled for larger NAL units
+static const size_t RAI_HASH_BYTES = 4096;
+
+static uint64_t hashStreamHead(int fd, uint64_t streamSize)
+{
+  unsigned char buf[RAI_HASH_BYTES];
+  size_t len = static_cast<size_t>(std::min<uint64_t>(streamSize, RAI_HASH_BYTES));
+  if (pread(fd, buf, len, 0) != static_cast<ssize_t>(len))
+    return 0;
+
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++)
+    hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+  return hash;
+}
+
+static bool readAt(int fd, unsigned char *buf, size_t len, uint64_t offset)
+{
+  while (len > 0)
+  {
+    ssize_t got = pread(fd, buf, len, static_cast<off_t>(offset));
+    if (got <= 0)
+      return false;
+    buf += got;
+    len -= static_cast<size_t>(got);
+    offset += static_cast<uint64_t>(got);
+  }
+  return true;
+}
+
+RandomAccessIndex::RandomAccessIndex()
+{
+  clear();
+}
+
+RandomAccessIndex::~RandomAccessIndex()
+{
+  unmap();
+}
+
+void RandomAccessIndex::clear()
+{
+  unmap();
+  memset(&m_header, 0, sizeof(m_header));
+  memcpy(m_header.magic, RAI_MAGIC, sizeof(RAI_MAGIC));
+  m_header.version = RAI_VERSION;
+  m_header.codecType = static_cast<int32_t>(videoCodecType::UNDEFINED);
+
+  m_entries.clear();
+  m_paramSets.clear();
+  m_refs.clear();
+  m_active.clear();
+  m_paramSetCursor = 0;
+  setViews();
+}
+
+void RandomAccessIndex::unmap()
+{
+  m_file.close();
+}
+
+void RandomAccessIndex::setViews()
+{
+  m_entryData = m_entries.data();
+  m_paramSetData = m_paramSets.data();
+  m_refData = m_refs.data();
+  m_numEntries = m_entries.size();
+  m_header.numEntries = static_cast<uint32_t>(m_entries.size());
+  m_header.numParamSets = static_cast<uint32_t>(m_paramSets.size());
+  m_header.numRefs = static_cast<uint32_t>(m_refs.size());
+}
+
+void RandomAccessIndex::detach()
+{
+  // Copy a memory-mapped index into the vectors before extending it
+  if (!m_file.data())
+    return;
+  m_entries.assign(m_entryData, m_entryData + m_header.numEntries);
+  m_paramSets.assign(m_paramSetData, m_paramSetData + m_header.numParamSets);
+  m_refs.assign(m_refData, m_refData + m_header.numRefs);
+  unmap();
+  setViews();
+}
+
+int RandomAccessIndex::paramSetKind(int nalUnitType) const
+{
+  const videoCodecType codecType = static_cast<videoCodecType>(m_header.codecType);
+  if (NALParse::nal_is_vps(codecType, nalUnitType))
+    return static_cast<int>(raiParamSetKind::RAI_VPS);
+  if (NALParse::nal_is_sps(codecType, nalUnitType))
+    return static_cast<int>(raiParamSetKind::RAI_SPS);
+  if (NALParse::nal_is_pps(codecType, nalUnitType))
+    return static_cast<int>(raiParamSetKind::RAI_PPS);
+  if (NALParse::nal_is_aps(codecType, nalUnitType))
+    return static_cast<int>(raiParamSetKind::RAI_APS);
+  return -1;
+}
+
+uint16_t RandomAccessIndex::paramSetId(const nal_info &nal, int kind) const
+{
+  const param_set *ps = &nal.mpegParamSet;
+  videoCodecType codecType = static_cast<videoCodecType>(m_header.codecType);
+  if (codecType == videoCodecType::H264_AVC)
+  {
+    if (kind == static_cast<int>(raiParamSetKind::RAI_SPS) && ps->sps)
+      return static_cast<uint16_t>(static_cast<const avc::sps *>(ps->sps)->seq_parameter_set_id);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_PPS) && ps->pps)
+      return static_cast<uint16_t>(static_cast<const avc::pps *>(ps->pps)->pic_parameter_set_id);
+  }
+  else if (codecType == videoCodecType::H265_HEVC)
+  {
+    if (kind == static_cast<int>(raiParamSetKind::RAI_VPS) && ps->vps)
+      return static_cast<uint16_t>(static_cast<const hevc::vps *>(ps->vps)->m_VPSId);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_SPS) && ps->sps)
+      return static_cast<uint16_t>(static_cast<const hevc::sps *>(ps->sps)->m_SPSId);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_PPS) && ps->pps)
+      return static_cast<uint16_t>(static_cast<const hevc::pps *>(ps->pps)->m_PPSId);
+  }
+  else if (codecType == videoCodecType::H266_VVC)
+  {
+    if (kind == static_cast<int>(raiParamSetKind::RAI_VPS) && ps->vps)
+      return static_cast<uint16_t>(static_cast<const vvc::VPS *>(ps->vps)->m_VPSId);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_SPS) && ps->sps)
+      return static_cast<uint16_t>(static_cast<const vvc::SPS *>(ps->sps)->m_SPSId);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_PPS) && ps->pps)
+      return static_cast<uint16_t>(static_cast<const vvc::PPS *>(ps->pps)->m_PPSId);
+    if (kind == static_cast<int>(raiParamSetKind::RAI_APS) && ps->aps)
+    {
+      const vvc::APS *aps = static_cast<const vvc::APS *>(ps->aps);
+      return static_cast<uint16_t>((static_cast<int>(aps->m_APSType) << 8) | aps->m_APSId);
+    }
+  }
+  return 0;
+}
+
+void RandomAccessIndex::updateTiming(const nal_info &nal)
+{
+  if (!nal.mpegParamSet.sps)
+    return;
+
+  videoCodecType codecType = static_cast<videoCodecType>(m_header.codecType);
+  uint32_t numUnitsInTick = 0, timeScale = 0, ticksPerFrame = 1;
+  if (codecType == videoCodecType::H264_AVC)
+  {
+    const avc::sps *sps = static_cast<const avc::sps *>(nal.mpegParamSet.sps);
+    if (sps->vui_parameters_present_flag && sps->vui_seq_parameters.timing_info_present_flag)
+    {
+      numUnitsInTick = sps->vui_seq_parameters.num_units_in_tick;
+      timeScale = sps->vui_seq_parameters.time_scale;
+      ticksPerFrame = 2;
+    }
+  }
+  else if (codecType == videoCodecType::H265_HEVC)
+  {
+    const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+    if (sps->m_vuiParametersPresentFlag && sps->m_vuiParameters.m_timingInfo.m_timingInfoPresentFlag)
+    {
+      numUnitsInTick = sps->m_vuiParameters.m_timingInfo.m_numUnitsInTick;
+      timeScale = sps->m_vuiParameters.m_timingInfo.m_timeScale;
+    }
+  }
+  else if (codecType == videoCodecType::H266_VVC)
+  {
+    const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+    if (sps->m_generalHrdParametersPresentFlag)
+    {
+      numUnitsInTick = sps->m_generalHrdParams.m_numUnitsInTick;
+      timeScale = sps->m_generalHrdParams.m_timeScale;
+    }
+  }
+
+  if (numUnitsInTick > 0 && timeScale > 0)
+  {
+    m_header.numUnitsInTick = numUnitsInTick;
+    m_header.timeScale = timeScale;
+    m_header.ticksPerFrame = ticksPerFrame;
+  }
+}
+
+void RandomAccessIndex::activateParamSets(uint64_t end)
+{
+  // Parameter sets received before 'end' replace the ones with the same kind and id
+  while (m_paramSetCursor < m_paramSets.size() && m_paramSets[m_paramSetCursor].offset < end)
+  {
+    const rai_param_set &ps = m_paramSets[m_paramSetCursor];
+    const uint32_t key = (static_cast<uint32_t>(ps.kind) << 16) | ps.id;
+    size_t i = 0;
+    while (i < m_active.size() && m_active[i].first != key)
+      i++;
+    if (i == m_active.size())
+      m_active.push_back(std::make_pair(key, 0u));
+    m_active[i].second = static_cast<uint32_t>(m_paramSetCursor++);
+  }
+}
+
+void RandomAccessIndex::addEntry(const access_unit &au, rapType type, const slice_prefix &slice, uint64_t auBase)
+{
+  activateParamSets(static_cast<uint64_t>(au.offset) + au.size);
+
+  rai_entry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.offset = static_cast<uint64_t>(au.offset);
+  entry.auIndex = auBase + au.index;
+  entry.pocLsb = slice.valid ? slice.pocLsb : -1;
+  entry.frameNum = (slice.valid && static_cast<videoCodecType>(m_header.codecType) == videoCodecType::H264_AVC) ? slice.frameNum : -1;
+  entry.nalUnitType = static_cast<uint16_t>(au.firstVclNalUnitType);
+  entry.type = static_cast<uint8_t>(type);
+  entry.paramSetFirst = static_cast<uint32_t>(m_refs.size());
+  entry.paramSetCount = static_cast<uint32_t>(m_active.size());
+
+  // Indices in m_paramSets follow the stream order, which is the order the decoder needs
+  size_t first = m_refs.size();
+  for (size_t i = 0; i < m_active.size(); i++)
+    m_refs.push_back(m_active[i].second);
+  std::sort(m_refs.begin() + first, m_refs.end());
+  m_entries.push_back(entry);
+}
+
+void RandomAccessIndex::prime(int fd, NALParse &parser)
+{
+  // Parameter sets in effect at the resume position, parsed again in stream order so that slice prefixes can be read
+  std::vector<uint32_t> active;
+  for (size_t i = 0; i < m_active.size(); i++)
+    active.push_back(m_active[i].second);
+  std::sort(active.begin(), active.end());
+
+  std::vector<unsigned char> buf;
+  for (size_t i = 0; i < active.size(); i++)
+  {
+    const rai_param_set &ps = m_paramSets[active[i]];
+    buf.assign(ps.size + 4, 0);
+    if (!readAt(fd, buf.data(), ps.size, ps.offset))
+      continue;
+    int nextNalPos = 0;
+    parser.nal_parse(buf.data(), static_cast<videoCodecType>(m_header.codecType), nextNalPos, static_cast<int>(ps.size), parsingLevel::PARSING_SLICE_PREFIX);
+    if (paramSetKind(parser.nal->nal_unit_type) == static_cast<int>(raiParamSetKind::RAI_SPS))
+      updateTiming(*parser.nal);
+  }
+}
+
+bool RandomAccessIndex::scan(int fd, uint64_t streamSize)
+{
+  const videoCodecType codecType = static_cast<videoCodecType>(m_header.codecType);
+  const uint64_t resume = m_header.indexedSize;
+  const uint64_t auBase = m_header.auCount;
+
+  // Drop what was indexed from the access unit left open by the previous scan
+  while (!m_entries.empty() && m_entries.back().offset >= resume)
+  {
+    m_refs.resize(m_entries.back().paramSetFirst);
+    m_entries.pop_back();
+  }
+  while (!m_paramSets.empty() && m_paramSets.back().offset >= resume)
+    m_paramSets.pop_back();
+  m_active.clear();
+  m_paramSetCursor = 0;
+  activateParamSets(resume);
+
+  NALParse parser;
+  AccessUnitAssembler assembler(codecType, parsingLevel::PARSING_SLICE_PREFIX);
+  RapClassifier classifier(codecType, parsingLevel::PARSING_SLICE_PREFIX);
+  prime(fd, parser);
+
+  rapType curType = rapType::RAP_NONE;
+  slice_prefix curSlice = slice_prefix{};
+  bool needFirstSlice = true;
+  uint64_t completedAus = 0;
+
+  std::vector<unsigned char> buf;
+  size_t windowSize = RAI_WINDOW_SIZE;
+  uint64_t pos = resume;
+  while (pos < streamSize)
+  {
+    size_t len = static_cast<size_t>(std::min<uint64_t>(windowSize, streamSize - pos));
+    const bool last = (pos + len == streamSize);
+    buf.resize(len + 4);
+    if (!readAt(fd, buf.data(), len, pos))
+      return false;
+    memset(buf.data() + len, 0, 4);
+
+    // Stop the window at the last start code so that nal_parse() never sees a truncated NAL unit
+    size_t seqSize = len;
+    if (!last)
+    {
+      seqSize = 0;
+      for (size_t i = len - 3; i > 0; i--)
+      {
+        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+        {
+          seqSize = (buf[i - 1] == 0) ? i - 1 : i;
+          break;
+        }
+      }
+      if (seqSize == 0)
+      {
+        windowSize *= 2;
+        continue;
+      }
+    }
+
+    int nextNalPos = 0;
+    while (nextNalPos < static_cast<int>(seqSize))
+    {
+      const int nalPos = nextNalPos;
+      parser.nal_parse(buf.data(), codecType, nextNalPos, static_cast<int>(seqSize), parsingLevel::PARSING_SLICE_PREFIX);
+      if (nextNalPos <= nalPos)
+        break;
+
+      const nal_info &nal = *parser.nal;
+      const int64_t offset = static_cast<int64_t>(pos) + nalPos;
+      const uint32_t size = static_cast<uint32_t>(nextNalPos - nalPos);
+
+      const int kind = paramSetKind(nal.nal_unit_type);
+      if (kind >= 0)
+      {
+        rai_param_set ps;
+        memset(&ps, 0, sizeof(ps));
+        ps.offset = static_cast<uint64_t>(offset);
+        ps.size = size;
+        ps.kind = static_cast<uint8_t>(kind);
+        ps.id = paramSetId(nal, kind);
+        m_paramSets.push_back(ps);
+        if (kind == static_cast<int>(raiParamSetKind::RAI_SPS))
+          updateTiming(nal);
+      }
+
+      const rapType type = classifier.push(nal, offset);
+      if (assembler.push(nal, offset, size))
+      {
+        if (curType != rapType::RAP_NONE)
+          addEntry(assembler.au(), curType, curSlice, auBase);
+        completedAus++;
+        curType = rapType::RAP_NONE;
+        needFirstSlice = true;
+      }
+
+      // Only random access points which can be decoded without any previous picture are indexed
+      if (type != rapType::RAP_NONE && type != rapType::RAP_DRAP && type != rapType::RAP_EDRAP && curType == rapType::RAP_NONE)
+        curType = type;
+      if (needFirstSlice && nal.slice.valid)
+      {
+        curSlice = nal.slice;
+        needFirstSlice = false;
+      }
+    }
+    pos += seqSize;
+  }
+
+  // The last access unit may still be growing : it is indexed, and scanned again by the next update
+  uint64_t indexedSize = streamSize;
+  if (assembler.flush())
+  {
+    if (curType != rapType::RAP_NONE)
+      addEntry(assembler.au(), curType, curSlice, auBase);
+    indexedSize = static_cast<uint64_t>(assembler.au().offset);
+  }
+
+  m_header.indexedSize = indexedSize;
+  m_header.auCount = auBase + completedAus;
+  setViews();
+  return true;
+}
+
+bool RandomAccessIndex::build(const char *streamPath, videoCodecType codecType)
+{
+  clear();
+  m_header.codecType = static_cast<int32_t>(codecType);
+  return update(streamPath);
+}
+
+bool RandomAccessIndex::update(const char *streamPath)
+{
+  int fd = open(streamPath, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    return false;
+  }
+  const uint64_t streamSize = static_cast<uint64_t>(st.st_size);
+
+  detach();
+  const uint64_t hash = hashStreamHead(fd, streamSize);
+  const bool replaced = streamSize < m_header.indexedSize ||
+                        (m_header.indexedSize >= RAI_HASH_BYTES && hash != m_header.streamHash);
+  if (replaced)
+  {
+    int32_t codecType = m_header.codecType;
+    clear();
+    m_header.codecType = codecType;
+  }
+  m_header.streamHash = hash;
+
+  if (static_cast<videoCodecType>(m_header.codecType) == videoCodecType::UNDEFINED)
+  {
+    // Detected from the bytes the hash covers
+    unsigned char head[RAI_HASH_BYTES];
+    const size_t len = static_cast<size_t>(std::min<uint64_t>(streamSize, RAI_HASH_BYTES));
+    codec_probe probe;
+    if (!readAt(fd, head, len, 0) || DetectCodec(head, len, probe, RAI_HASH_BYTES) == videoCodecType::UNDEFINED)
+    {
+      close(fd);
+      return false;
+    }
+    m_header.codecType = static_cast<int32_t>(probe.codecType);
+  }
+
+  bool ret = scan(fd, streamSize);
+  close(fd);
+  return ret;
+}
+
+bool RandomAccessIndex::save(const char *indexPath) const
+{
+  // Written next to the target and renamed, readers never map a partial index
+  std::string tmpPath = std::string(indexPath) + ".tmp";
+  FILE *fp = fopen(tmpPath.c_str(), "wb");
+  if (!fp)
+    return false;
+
+  bool ok = fwrite(&m_header, sizeof(m_header), 1, fp) == 1;
+  if (ok && m_header.numEntries)
+    ok = fwrite(m_entryData, sizeof(rai_entry), m_header.numEntries, fp) == m_header.numEntries;
+  if (ok && m_header.numParamSets)
+    ok = fwrite(m_paramSetData, sizeof(rai_param_set), m_header.numParamSets, fp) == m_header.numParamSets;
+  if (ok && m_header.numRefs)
+    ok = fwrite(m_refData, sizeof(uint32_t), m_header.numRefs, fp) == m_header.numRefs;
+  ok = (fclose(fp) == 0) && ok;
+
+  if (!ok || rename(tmpPath.c_str(), indexPath) != 0)
+  {
+    remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool RandomAccessIndex::load(const char *indexPath)
+{
+  clear();
+  if (!m_file.open(indexPath, 0, fileAccess::ACCESS_RANDOM))
+    return false;
+  if (m_file.size() < sizeof(rai_header))
+  {
+    clear();
+    return false;
+  }
+
+  const unsigned char *base = m_file.data();
+  rai_header header;
+  memcpy(&header, base, sizeof(header));
+  const uint64_t expected = sizeof(rai_header) + (uint64_t)header.numEntries * sizeof(rai_entry) +
+                            (uint64_t)header.numParamSets * sizeof(rai_param_set) + (uint64_t)header.numRefs * sizeof(uint32_t);
+  if (memcmp(header.magic, RAI_MAGIC, sizeof(RAI_MAGIC)) != 0 || header.version != RAI_VERSION || expected != m_file.size())
+  {
+    clear();
+    return false;
+  }
+
+  m_header = header;
+  m_entryData = reinterpret_cast<const rai_entry *>(base + sizeof(rai_header));
+  m_paramSetData = reinterpret_cast<const rai_param_set *>(m_entryData + header.numEntries);
+  m_refData = reinterpret_cast<const uint32_t *>(m_paramSetData + header.numParamSets);
+  m_numEntries = header.numEntries;
+  return true;
+}
+
+bool RandomAccessIndex::seekFrame(uint64_t auIndex, rai_seek &out) const
+{
+  size_t lo = 0, hi = m_numEntries;
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (m_entryData[mid].auIndex <= auIndex)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return false;
+
+  out.point = m_entryData[lo - 1];
+  out.paramSets.clear();
+  for (uint32_t i = 0; i < out.point.paramSetCount; i++)
+    out.paramSets.push_back(m_paramSetData[m_refData[out.point.paramSetFirst + i]]);
+  return true;
+}
+
+bool RandomAccessIndex::seekTime(double seconds, rai_seek &out, double frameRate) const
+{
+  double frameDuration = 0;
+  if (frameRate > 0)
+    frameDuration = 1.0 / frameRate;
+  else if (m_header.timeScale > 0)
+    frameDuration = (double)m_header.ticksPerFrame * m_header.numUnitsInTick / m_header.timeScale;
+  if (frameDuration <= 0 || seconds < 0)
+    return false;
+
+  return seekFrame(static_cast<uint64_t>(seconds / frameDuration + 1e-6), out);
+}
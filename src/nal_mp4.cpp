@@ -0,0 +1,621 @@
+#include "nal_mp4.h"
+
+#include <algorithm>
+
+static uint32_t FourCC(const char *type)
+{
+  return (static_cast<uint32_t>(static_cast<uint8_t>(type[0])) << 24) | (static_cast<uint32_t>(static_cast<uint8_t>(type[1])) << 16) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(type[2])) << 8) | static_cast<uint32_t>(static_cast<uint8_t>(type[3]));
+}
+
+static uint16_t Read16(const uint8_t *p)
+{
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static uint64_t Read64(const uint8_t *p)
+{
+  return (static_cast<uint64_t>(Read32(p)) << 32) | Read32(p + 4);
+}
+
+// Sample entry of a visual track : SampleEntry (8 bytes) and VisualSampleEntry (70 bytes) fields before the child boxes
+static const uint64_t VISUAL_SAMPLE_ENTRY_SIZE = 78;
+// sample_is_non_sync_sample of the sample flags (8.8.3.1)
+static const uint32_t SAMPLE_FLAG_NON_SYNC = 0x10000;
+// Zero page after the file : the parsers may read a few bytes past a NAL unit
+static const size_t MP4_PADDING = 4096;
+
+Mp4Reader::Mp4Reader(parsingLevel level)
+{
+  m_level = level;
+  m_data = NULL;
+  m_size = 0;
+  close();
+}
+
+Mp4Reader::~Mp4Reader()
+{
+  close();
+}
+
+bool Mp4Reader::open(const char *path)
+{
+  close();
+  if (!m_file.open(path, MP4_PADDING, fileAccess::ACCESS_RANDOM))
+    return false;
+  m_data = m_file.data();
+  m_size = m_file.size();
+
+  // Top-level boxes : moov comes before the movie fragments it describes
+  const uint8_t *pos = m_data;
+  const uint8_t *end = m_data + m_size;
+  const uint8_t *start = pos;
+  mp4_box box;
+  while (NextBox(pos, end, box))
+  {
+    if (box.type == FourCC("moov"))
+      parseMoov(box);
+    else if (box.type == FourCC("moof") && m_codecType != videoCodecType::UNDEFINED)
+      parseMoof(box, static_cast<uint64_t>(start - m_data));
+    start = pos;
+  }
+
+  if (m_codecType == videoCodecType::UNDEFINED)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void Mp4Reader::close()
+{
+  m_file.close();
+  m_data = NULL;
+  m_size = 0;
+  m_parser = NALParse();
+  m_codecType = videoCodecType::UNDEFINED;
+  m_trackId = 0;
+  m_timescale = 0;
+  m_width = 0;
+  m_height = 0;
+  m_lengthSize = 4;
+  m_fragmented = false;
+  m_paramSets.clear();
+  m_trex.clear();
+  m_fragmentTime = 0;
+  m_samples.clear();
+}
+
+bool Mp4Reader::NextBox(const uint8_t *&pos, const uint8_t *end, mp4_box &box)
+{
+  // size 1 : 64-bit largesize follows the type, size 0 : the box extends to the end of its container
+  if (end - pos < 8)
+    return false;
+  uint64_t size = Read32(pos);
+  box.type = Read32(pos + 4);
+  uint64_t header = 8;
+  if (size == 1)
+  {
+    if (end - pos < 16)
+      return false;
+    size = Read64(pos + 8);
+    header = 16;
+  }
+  else if (size == 0)
+    size = static_cast<uint64_t>(end - pos);
+  if (size < header || size > static_cast<uint64_t>(end - pos))
+    return false;
+  box.data = pos + header;
+  box.size = size - header;
+  pos += size;
+  return true;
+}
+
+bool Mp4Reader::FindBox(const uint8_t *data, uint64_t size, uint32_t type, mp4_box &box)
+{
+  const uint8_t *pos = data;
+  while (NextBox(pos, data + size, box))
+  {
+    if (box.type == type)
+      return true;
+  }
+  return false;
+}
+
+void Mp4Reader::parseMoov(const mp4_box &moov)
+{
+  const uint8_t *pos = moov.data;
+  mp4_box box;
+  while (NextBox(pos, moov.data + moov.size, box))
+  {
+    if (box.type == FourCC("trak") && m_codecType == videoCodecType::UNDEFINED)
+      parseTrak(box);
+    else if (box.type == FourCC("mvex"))
+    {
+      // TrackExtendsBox : defaults of the track fragments
+      const uint8_t *p = box.data;
+      mp4_box trex;
+      while (NextBox(p, box.data + box.size, trex))
+      {
+        if (trex.type != FourCC("trex") || trex.size < 24)
+          continue;
+        track_defaults &defaults = m_trex[Read32(trex.data + 4)];
+        defaults.sampleDuration = Read32(trex.data + 12);
+        defaults.sampleSize = Read32(trex.data + 16);
+        defaults.sampleFlags = Read32(trex.data + 20);
+      }
+    }
+  }
+}
+
+bool Mp4Reader::parseTrak(const mp4_box &trak)
+{
+  mp4_box tkhd, mdia, hdlr, mdhd, minf, stbl, stsd;
+  if (!FindBox(trak.data, trak.size, FourCC("tkhd"), tkhd) || !FindBox(trak.data, trak.size, FourCC("mdia"), mdia) ||
+      !FindBox(mdia.data, mdia.size, FourCC("hdlr"), hdlr) || !FindBox(mdia.data, mdia.size, FourCC("mdhd"), mdhd) ||
+      !FindBox(mdia.data, mdia.size, FourCC("minf"), minf) || !FindBox(minf.data, minf.size, FourCC("stbl"), stbl) ||
+      !FindBox(stbl.data, stbl.size, FourCC("stsd"), stsd))
+    return false;
+  if (hdlr.size < 12 || Read32(hdlr.data + 8) != FourCC("vide"))
+    return false;
+
+  // Full boxes : version 1 has 64-bit times
+  const bool tkhdV1 = tkhd.size > 0 && tkhd.data[0] == 1;
+  const bool mdhdV1 = mdhd.size > 0 && mdhd.data[0] == 1;
+  if (tkhd.size < (tkhdV1 ? 24u : 16u) || mdhd.size < (mdhdV1 ? 24u : 16u))
+    return false;
+
+  m_paramSets.clear();
+  m_parser = NALParse();
+  if (!parseSampleEntry(stsd))
+  {
+    m_codecType = videoCodecType::UNDEFINED;
+    return false;
+  }
+  m_trackId = Read32(tkhd.data + (tkhdV1 ? 20 : 12));
+  m_timescale = Read32(mdhd.data + (mdhdV1 ? 20 : 12));
+
+  // The parameter sets go through the parsers before any sample
+  for (size_t i = 0; i < m_paramSets.size(); i++)
+    m_parser.nal_parse_unit(m_paramSets[i].data, m_paramSets[i].size, m_codecType, m_level);
+  if (!parseSampleTable(stbl))
+    m_samples.clear();
+  return true;
+}
+
+bool Mp4Reader::parseSampleEntry(const mp4_box &stsd)
+{
+  if (stsd.size < 8 || Read32(stsd.data + 4) == 0)
+    return false;
+
+  // First sample entry only
+  const uint8_t *pos = stsd.data + 8;
+  mp4_box entry;
+  if (!NextBox(pos, stsd.data + stsd.size, entry) || entry.size < VISUAL_SAMPLE_ENTRY_SIZE)
+    return false;
+  m_width = Read16(entry.data + 24);
+  m_height = Read16(entry.data + 26);
+
+  const uint8_t *children = entry.data + VISUAL_SAMPLE_ENTRY_SIZE;
+  const uint64_t childrenSize = entry.size - VISUAL_SAMPLE_ENTRY_SIZE;
+  mp4_box config;
+  if ((entry.type == FourCC("avc1") || entry.type == FourCC("avc3")) && FindBox(children, childrenSize, FourCC("avcC"), config))
+  {
+    m_codecType = videoCodecType::H264_AVC;
+    return parseAvcC(config.data, config.size);
+  }
+  if ((entry.type == FourCC("hvc1") || entry.type == FourCC("hev1")) && FindBox(children, childrenSize, FourCC("hvcC"), config))
+  {
+    m_codecType = videoCodecType::H265_HEVC;
+    return parseHvcC(config.data, config.size);
+  }
+  if ((entry.type == FourCC("vvc1") || entry.type == FourCC("vvi1")) && FindBox(children, childrenSize, FourCC("vvcC"), config))
+  {
+    // vvcC is a full box
+    m_codecType = videoCodecType::H266_VVC;
+    return config.size > 4 && parseVvcC(config.data + 4, config.size - 4);
+  }
+  return false;
+}
+
+bool Mp4Reader::addParamSet(const uint8_t *data, uint64_t size, const uint8_t *end)
+{
+  if (size == 0 || size > static_cast<uint64_t>(end - data))
+    return false;
+  nal_buffer nal = {data, static_cast<uint32_t>(size)};
+  m_paramSets.push_back(nal);
+  return true;
+}
+
+bool Mp4Reader::parseAvcC(const uint8_t *data, uint64_t size)
+{
+  // AVCDecoderConfigurationRecord (ISO/IEC 14496-15 5.3.3.1)
+  const uint8_t *end = data + size;
+  if (size < 7 || data[0] != 1)
+    return false;
+  m_lengthSize = (data[4] & 0x03) + 1;
+  const uint8_t *p = data + 5;
+  for (int list = 0; list < 2; list++)
+  {
+    if (p >= end)
+      return false;
+    const int count = list == 0 ? (*p & 0x1f) : *p; // numOfSequenceParameterSets, numOfPictureParameterSets
+    p++;
+    for (int i = 0; i < count; i++)
+    {
+      if (end - p < 2 || !addParamSet(p + 2, Read16(p), end))
+        return false;
+      p += 2 + Read16(p);
+    }
+  }
+  return true;
+}
+
+bool Mp4Reader::parseHvcC(const uint8_t *data, uint64_t size)
+{
+  // HEVCDecoderConfigurationRecord (ISO/IEC 14496-15 8.3.3.1) : 22 bytes of fields, then the NAL unit arrays
+  const uint8_t *end = data + size;
+  if (size < 23)
+    return false;
+  m_lengthSize = (data[21] & 0x03) + 1;
+  const int numArrays = data[22];
+  const uint8_t *p = data + 23;
+  for (int a = 0; a < numArrays; a++)
+  {
+    if (end - p < 3)
+      return false;
+    const int numNalus = Read16(p + 1);
+    p += 3;
+    for (int i = 0; i < numNalus; i++)
+    {
+      if (end - p < 2 || !addParamSet(p + 2, Read16(p), end))
+        return false;
+      p += 2 + Read16(p);
+    }
+  }
+  return true;
+}
+
+bool Mp4Reader::parseVvcC(const uint8_t *data, uint64_t size)
+{
+  // VvcDecoderConfigurationRecord (ISO/IEC 14496-15 11.2.4.2)
+  const uint8_t *end = data + size;
+  if (size < 1)
+    return false;
+  m_lengthSize = ((data[0] >> 1) & 0x03) + 1;
+  const bool ptlPresent = data[0] & 0x01;
+  const uint8_t *p = data + 1;
+  if (ptlPresent)
+  {
+    // ols_idx, num_sublayers, constant_frame_rate, chroma_format_idc, bit_depth_minus8, then VvcPTLRecord
+    if (end - p < 6)
+      return false;
+    const int numSublayers = (Read16(p) >> 4) & 0x07;
+    p += 3;
+    const int numBytesConstraintInfo = p[0] & 0x3f;
+    p += 3 + numBytesConstraintInfo; // num_bytes_constraint_info, general_profile_idc / tier, general_level_idc, constraints
+    if (numSublayers > 1)
+    {
+      if (end - p < 1)
+        return false;
+      const int presentFlags = p[0];
+      p++;
+      for (int i = numSublayers - 2; i >= 0; i--)
+        if (presentFlags & (0x80 >> (numSublayers - 2 - i)))
+          p++; // sublayer_level_idc
+    }
+    if (end - p < 1)
+      return false;
+    p += 1 + 4 * p[0]; // ptl_num_sub_profiles, general_sub_profile_idc
+    p += 6;            // max_picture_width, max_picture_height, avg_frame_rate
+  }
+  if (end - p < 1)
+    return false;
+  const int numArrays = p[0];
+  p++;
+  for (int a = 0; a < numArrays; a++)
+  {
+    if (end - p < 1)
+      return false;
+    const int nalUnitType = p[0] & 0x1f;
+    p++;
+    int numNalus = 1; // DCI and OPI NAL units come alone
+    if (nalUnitType != vvc::NAL_UNIT_DCI && nalUnitType != vvc::NAL_UNIT_OPI)
+    {
+      if (end - p < 2)
+        return false;
+      numNalus = Read16(p);
+      p += 2;
+    }
+    for (int i = 0; i < numNalus; i++)
+    {
+      if (end - p < 2 || !addParamSet(p + 2, Read16(p), end))
+        return false;
+      p += 2 + Read16(p);
+    }
+  }
+  return true;
+}
+
+bool Mp4Reader::parseSampleTable(const mp4_box &stbl)
+{
+  mp4_box stsz = mp4_box(), stsc = mp4_box(), stco = mp4_box(), stts = mp4_box(), ctts = mp4_box(), stss = mp4_box();
+  const bool compactSizes = !FindBox(stbl.data, stbl.size, FourCC("stsz"), stsz) && FindBox(stbl.data, stbl.size, FourCC("stz2"), stsz);
+  const bool offsets64 = !FindBox(stbl.data, stbl.size, FourCC("stco"), stco) && FindBox(stbl.data, stbl.size, FourCC("co64"), stco);
+  if (stsz.size < 12 || stco.size < 8 || !FindBox(stbl.data, stbl.size, FourCC("stsc"), stsc) || stsc.size < 8 ||
+      !FindBox(stbl.data, stbl.size, FourCC("stts"), stts) || stts.size < 8)
+    return false;
+  const bool hasCtts = FindBox(stbl.data, stbl.size, FourCC("ctts"), ctts) && ctts.size >= 8;
+  const bool hasStss = FindBox(stbl.data, stbl.size, FourCC("stss"), stss) && stss.size >= 8;
+
+  // Entry counts are checked against the box sizes once, the loops below read without checks
+  const uint32_t numSamples = Read32(stsz.data + 8);
+  const uint32_t fixedSize = compactSizes ? 0 : Read32(stsz.data + 4);
+  const int fieldSize = compactSizes ? stsz.data[7] : 32;
+  if (fieldSize != 4 && fieldSize != 8 && fieldSize != 16 && fieldSize != 32)
+    return false;
+  if (fixedSize == 0 && (static_cast<uint64_t>(numSamples) * fieldSize + 7) / 8 > stsz.size - 12)
+    return false;
+  const uint32_t numChunks = Read32(stco.data + 4);
+  const uint32_t numStsc = Read32(stsc.data + 4);
+  const uint32_t numStts = Read32(stts.data + 4);
+  const uint32_t numCtts = hasCtts ? Read32(ctts.data + 4) : 0;
+  const uint32_t numStss = hasStss ? Read32(stss.data + 4) : 0;
+  if (static_cast<uint64_t>(numChunks) * (offsets64 ? 8 : 4) > stco.size - 8 || static_cast<uint64_t>(numStsc) * 12 > stsc.size - 8 ||
+      static_cast<uint64_t>(numStts) * 8 > stts.size - 8 || (hasCtts && static_cast<uint64_t>(numCtts) * 8 > ctts.size - 8) ||
+      (hasStss && static_cast<uint64_t>(numStss) * 4 > stss.size - 8))
+    return false;
+
+  // Samples the chunks can hold, checked before the table is allocated
+  uint64_t chunkSamples = 0;
+  for (uint32_t e = 0; e < numStsc; e++)
+  {
+    const uint8_t *entry = stsc.data + 8 + 12 * static_cast<uint64_t>(e);
+    const uint32_t firstChunk = std::max<uint32_t>(Read32(entry), 1);
+    const uint32_t lastChunk = std::min(e + 1 < numStsc ? Read32(entry + 12) - 1 : numChunks, numChunks);
+    if (lastChunk >= firstChunk)
+      chunkSamples += static_cast<uint64_t>(lastChunk - firstChunk + 1) * Read32(entry + 4);
+  }
+  if (numSamples > chunkSamples)
+    return false;
+
+  m_samples.resize(numSamples);
+  for (uint32_t i = 0; i < numSamples; i++)
+  {
+    mp4_sample &s = m_samples[i];
+    if (fixedSize)
+      s.size = fixedSize;
+    else if (fieldSize == 32)
+      s.size = Read32(stsz.data + 12 + 4 * static_cast<uint64_t>(i));
+    else if (fieldSize == 16)
+      s.size = Read16(stsz.data + 12 + 2 * static_cast<uint64_t>(i));
+    else if (fieldSize == 8)
+      s.size = stsz.data[12 + i];
+    else
+      s.size = (stsz.data[12 + i / 2] >> ((i & 1) ? 0 : 4)) & 0x0f;
+    s.sync = !hasStss;
+  }
+
+  // Chunks : runs of stsc entries give the samples of every chunk
+  uint32_t sample = 0;
+  for (uint32_t e = 0; e < numStsc && sample < numSamples; e++)
+  {
+    const uint8_t *entry = stsc.data + 8 + 12 * static_cast<uint64_t>(e);
+    const uint32_t firstChunk = Read32(entry);
+    const uint32_t lastChunk = e + 1 < numStsc ? Read32(entry + 12) - 1 : numChunks;
+    const uint32_t samplesPerChunk = Read32(entry + 4);
+    for (uint32_t chunk = firstChunk; chunk >= 1 && chunk <= lastChunk && chunk <= numChunks && sample < numSamples; chunk++)
+    {
+      uint64_t offset = offsets64 ? Read64(stco.data + 8 + 8 * static_cast<uint64_t>(chunk - 1)) : Read32(stco.data + 8 + 4 * static_cast<uint64_t>(chunk - 1));
+      for (uint32_t k = 0; k < samplesPerChunk && sample < numSamples; k++, sample++)
+      {
+        m_samples[sample].offset = offset;
+        offset += m_samples[sample].size;
+      }
+    }
+  }
+  if (sample < numSamples)
+    return false;
+
+  // Decoding times, composition offsets (signed in version 1, in practice also in version 0) and sync samples
+  int64_t dts = 0;
+  sample = 0;
+  for (uint32_t e = 0; e < numStts && sample < numSamples; e++)
+  {
+    const uint32_t count = Read32(stts.data + 8 + 8 * static_cast<uint64_t>(e));
+    const uint32_t delta = Read32(stts.data + 12 + 8 * static_cast<uint64_t>(e));
+    for (uint32_t k = 0; k < count && sample < numSamples; k++, sample++)
+    {
+      m_samples[sample].dts = dts;
+      m_samples[sample].pts = dts;
+      dts += delta;
+    }
+  }
+  for (; sample < numSamples; sample++)
+    m_samples[sample].pts = m_samples[sample].dts = dts;
+  sample = 0;
+  for (uint32_t e = 0; e < numCtts && sample < numSamples; e++)
+  {
+    const uint32_t count = Read32(ctts.data + 8 + 8 * static_cast<uint64_t>(e));
+    const int32_t offset = static_cast<int32_t>(Read32(ctts.data + 12 + 8 * static_cast<uint64_t>(e)));
+    for (uint32_t k = 0; k < count && sample < numSamples; k++, sample++)
+      m_samples[sample].pts = m_samples[sample].dts + offset;
+  }
+  for (uint32_t e = 0; e < numStss; e++)
+  {
+    const uint32_t number = Read32(stss.data + 8 + 4 * static_cast<uint64_t>(e));
+    if (number >= 1 && number <= numSamples)
+      m_samples[number - 1].sync = true;
+  }
+  m_fragmentTime = dts;
+  return true;
+}
+
+void Mp4Reader::parseMoof(const mp4_box &moof, uint64_t moofOffset)
+{
+  // Without base_data_offset nor default-base-is-moof, a track fragment starts where the data of the previous one ends,
+  // which is only known when the previous one is of the track read : other track fragments of that kind are skipped
+  uint64_t previousEnd = moofOffset;
+  bool previousEndKnown = true;
+  const uint8_t *pos = moof.data;
+  mp4_box traf;
+  while (NextBox(pos, moof.data + moof.size, traf))
+  {
+    if (traf.type != FourCC("traf"))
+      continue;
+    mp4_box tfhd;
+    const bool known = previousEndKnown;
+    previousEndKnown = false;
+    if (!FindBox(traf.data, traf.size, FourCC("tfhd"), tfhd) || tfhd.size < 8 || Read32(tfhd.data + 4) != m_trackId)
+      continue;
+
+    // TrackFragmentHeaderBox : optional fields in the order of their flags
+    const uint32_t tfhdFlags = Read32(tfhd.data) & 0xffffff;
+    track_defaults defaults = m_trex.count(m_trackId) ? m_trex[m_trackId] : track_defaults{0, 0, 0};
+    uint64_t baseOffset = moofOffset;
+    const uint8_t *f = tfhd.data + 8;
+    const uint8_t *tfhdEnd = tfhd.data + tfhd.size;
+    if ((tfhdFlags & 0x01) && tfhdEnd - f >= 8)
+    {
+      baseOffset = Read64(f);
+      f += 8;
+    }
+    else if (!(tfhdFlags & 0x020000))
+    {
+      if (!known)
+        continue;
+      baseOffset = previousEnd;
+    }
+    m_fragmented = true;
+    if ((tfhdFlags & 0x02) && tfhdEnd - f >= 4)
+      f += 4; // sample_description_index
+    if ((tfhdFlags & 0x08) && tfhdEnd - f >= 4)
+    {
+      defaults.sampleDuration = Read32(f);
+      f += 4;
+    }
+    if ((tfhdFlags & 0x10) && tfhdEnd - f >= 4)
+    {
+      defaults.sampleSize = Read32(f);
+      f += 4;
+    }
+    if ((tfhdFlags & 0x20) && tfhdEnd - f >= 4)
+      defaults.sampleFlags = Read32(f);
+
+    mp4_box tfdt;
+    if (FindBox(traf.data, traf.size, FourCC("tfdt"), tfdt) && tfdt.size >= 8)
+      m_fragmentTime = static_cast<int64_t>(tfdt.data[0] == 1 && tfdt.size >= 12 ? Read64(tfdt.data + 4) : Read32(tfdt.data + 4));
+
+    // TrackRunBoxes : a run without data_offset continues after the previous one
+    uint64_t dataOffset = baseOffset;
+    const uint8_t *r = traf.data;
+    mp4_box trun;
+    while (NextBox(r, traf.data + traf.size, trun))
+    {
+      if (trun.type != FourCC("trun") || trun.size < 8)
+        continue;
+      const bool signedCts = trun.data[0] >= 1;
+      const uint32_t flags = Read32(trun.data) & 0xffffff;
+      const uint32_t count = Read32(trun.data + 4);
+      const uint8_t *p = trun.data + 8;
+      const uint8_t *end = trun.data + trun.size;
+      if ((flags & 0x01) && end - p >= 4)
+      {
+        dataOffset = baseOffset + static_cast<int64_t>(static_cast<int32_t>(Read32(p)));
+        p += 4;
+      }
+      uint32_t firstFlags = defaults.sampleFlags;
+      const bool hasFirstFlags = (flags & 0x04) != 0;
+      if (hasFirstFlags && end - p >= 4)
+      {
+        firstFlags = Read32(p);
+        p += 4;
+      }
+      const int fieldBytes = 4 * (((flags >> 8) & 1) + ((flags >> 9) & 1) + ((flags >> 10) & 1) + ((flags >> 11) & 1));
+      if (static_cast<uint64_t>(count) * fieldBytes > static_cast<uint64_t>(end - p))
+        continue;
+      // Without per-sample fields nothing in the box bounds the count : the samples of the default size must fit in the file
+      if (fieldBytes == 0 && (defaults.sampleSize == 0 || dataOffset > m_size ||
+                              static_cast<uint64_t>(count) > (m_size - dataOffset) / defaults.sampleSize))
+        continue;
+
+      m_samples.reserve(m_samples.size() + count);
+      for (uint32_t i = 0; i < count; i++)
+      {
+        mp4_sample s;
+        uint32_t duration = defaults.sampleDuration;
+        uint32_t sampleFlags = (i == 0 && hasFirstFlags) ? firstFlags : defaults.sampleFlags;
+        int64_t ctsOffset = 0;
+        s.size = defaults.sampleSize;
+        if (flags & 0x100)
+        {
+          duration = Read32(p);
+          p += 4;
+        }
+        if (flags & 0x200)
+        {
+          s.size = Read32(p);
+          p += 4;
+        }
+        if (flags & 0x400)
+        {
+          if (!(i == 0 && hasFirstFlags))
+            sampleFlags = Read32(p);
+          p += 4;
+        }
+        if (flags & 0x800)
+        {
+          ctsOffset = signedCts ? static_cast<int64_t>(static_cast<int32_t>(Read32(p))) : static_cast<int64_t>(Read32(p));
+          p += 4;
+        }
+        s.offset = dataOffset;
+        s.dts = m_fragmentTime;
+        s.pts = m_fragmentTime + ctsOffset;
+        s.sync = !(sampleFlags & SAMPLE_FLAG_NON_SYNC);
+        m_samples.push_back(s);
+        dataOffset += s.size;
+        m_fragmentTime += duration;
+      }
+    }
+    previousEnd = dataOffset;
+    previousEndKnown = true;
+  }
+}
+
+bool Mp4Reader::sampleNals(size_t index, std::vector<nal_buffer> &nals) const
+{
+  nals.clear();
+  const mp4_sample &s = m_samples[index];
+  if (s.offset > m_size || s.size > m_size - s.offset)
+    return false;
+
+  const uint8_t *p = m_data + s.offset;
+  const uint8_t *end = p + s.size;
+  while (end - p >= m_lengthSize)
+  {
+    uint32_t length = 0;
+    for (int i = 0; i < m_lengthSize; i++)
+      length = (length << 8) | p[i];
+    p += m_lengthSize;
+    if (length > static_cast<uint64_t>(end - p))
+      return false;
+    nal_buffer nal = {p, length};
+    nals.push_back(nal);
+    p += length;
+  }
+  return p == end;
+}
+
+size_t Mp4Reader::parseSample(size_t index, std::vector<nal_result> *results)
+{
+  sampleNals(index, m_nals);
+  if (results)
+    results->resize(m_nals.size());
+  return m_parser.nal_parse_batch(m_nals.data(), m_nals.size(), m_codecType, m_level, results ? results->data() : NULL);
+}
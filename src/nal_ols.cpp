@@ -0,0 +1,148 @@
+#include "nal_ols.h"
+
+OlsExtractor::OlsExtractor(int targetOlsIdx, int targetTemporalId)
+{
+  m_targetOlsIdx = targetOlsIdx;
+  m_targetTemporalId = targetTemporalId;
+  clear();
+}
+
+OlsExtractor::~OlsExtractor()
+{
+}
+
+void OlsExtractor::clear()
+{
+  m_vpsActive = false;
+  m_olsValid = true;
+  m_numLayersInOls = 0;
+  for (int i = 0; i < vvc::MAX_VPS_LAYERS; i++)
+  {
+    m_layerInOls[i] = false;
+    m_numSubLayersInLayer[i] = 0;
+  }
+  m_parser = NALParse();
+  m_vpsErrors = 0;
+  clearCounters();
+}
+
+void OlsExtractor::setVps(const vvc::VPS *vps)
+{
+  // Below parsingLevel::PARSING_FULL only the VPS id is known
+  if (!vps || vps->m_maxLayers == 0)
+    return;
+
+  m_vpsActive = true;
+  m_olsValid = m_targetOlsIdx >= 0 && m_targetOlsIdx < vps->m_totalNumOLSs &&
+               m_targetOlsIdx < static_cast<int>(vps->m_layerIdInOls.size());
+  m_numLayersInOls = 0;
+  for (int i = 0; i < vvc::MAX_VPS_LAYERS; i++)
+  {
+    m_layerInOls[i] = false;
+    m_numSubLayersInLayer[i] = 0;
+  }
+  if (!m_olsValid)
+    return;
+
+  m_numLayersInOls = vps->m_numLayersInOls[m_targetOlsIdx];
+  for (int j = 0; j < m_numLayersInOls; j++)
+  {
+    const int layerId = vps->m_layerIdInOls[m_targetOlsIdx][j];
+    if (layerId < 0 || layerId >= vvc::MAX_VPS_LAYERS)
+      continue;
+    m_layerInOls[layerId] = true;
+
+    // Sub-layers of a reference layer above what the OLS layers use for inter-layer prediction are not needed
+    const int subLayers = vps->m_numSubLayersInLayerInOLS[m_targetOlsIdx][vps->m_generalLayerIdx[layerId]];
+    // 0 is legal : only the IRAP and GDR pictures of the layer are needed
+    m_numSubLayersInLayer[layerId] = subLayers >= 0 ? subLayers : static_cast<int>(vps->m_vpsMaxSubLayers);
+  }
+}
+
+bool OlsExtractor::isKept(int nalUnitType, int layerId, int temporalId, int recoveryPocCnt) const
+{
+  if (m_targetTemporalId >= 0 && temporalId > m_targetTemporalId)
+    return false;
+
+  // Layer independent NAL units are kept whatever their nuh_layer_id
+  if (nalUnitType == vvc::NAL_UNIT_DCI || nalUnitType == vvc::NAL_UNIT_OPI || nalUnitType == vvc::NAL_UNIT_VPS ||
+      nalUnitType == vvc::NAL_UNIT_ACCESS_UNIT_DELIMITER || nalUnitType == vvc::NAL_UNIT_EOB)
+    return true;
+
+  if (!m_vpsActive)
+    return true;
+  if (layerId < 0 || layerId >= vvc::MAX_VPS_LAYERS || !m_layerInOls[layerId])
+    return false;
+
+  // IRAP pictures and GDR pictures of ph_recovery_poc_cnt 0 of a reference layer are kept at every TemporalId, they are the
+  // inter-layer reference of the IRAP / GDR access units (C.6). A GDR picture of an unknown ph_recovery_poc_cnt (-1) is kept
+  const bool vcl = NALParse::nal_is_vcl(videoCodecType::H266_VVC, nalUnitType);
+  const bool rap = NALParse::nal_is_irap(videoCodecType::H266_VVC, nalUnitType) ||
+                   (nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR && recoveryPocCnt <= 0);
+  if (vcl && !rap && temporalId >= m_numSubLayersInLayer[layerId])
+    return false;
+  return true;
+}
+
+bool OlsExtractor::parse(const unsigned char *data, size_t size, parsingLevel level)
+{
+  int nextNalPos = 0;
+  try
+  {
+    m_parser.nal_parse(const_cast<unsigned char *>(data), videoCodecType::H266_VVC, nextNalPos, static_cast<int>(size), level);
+  }
+  catch (const std::exception &e)
+  {
+    vvc::msg(vvc::WARNING, "Warning: NAL unit not parsed by the OLS extraction%s\n", e.what());
+    return false;
+  }
+  return true;
+}
+
+void OlsExtractor::parseVps(const unsigned char *data, size_t size)
+{
+  // NALParse keeps the previous VPS when the new one cannot be parsed, a new VPS is always a new object
+  const void *previous = m_parser.nal->mpegParamSet.vps;
+  if (parse(data, size, parsingLevel::PARSING_FULL) && m_parser.nal->mpegParamSet.vps != previous)
+    setVps(static_cast<const vvc::VPS *>(m_parser.nal->mpegParamSet.vps));
+  else
+    m_vpsErrors++;
+}
+
+bool OlsExtractor::push(const nal_info &nal, const unsigned char *data, size_t size, std::vector<struct iovec> &iov)
+{
+  if (nal.nal_unit_type == vvc::NAL_UNIT_VPS)
+    parseVps(data, size);
+  const bool gdr = nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_GDR;
+  const int recoveryPocCnt = (gdr && nal.slice.valid) ? nal.slice.recoveryPocCnt : -1;
+  return keep(isKept(nal.nal_unit_type, nal.nuh_layer_id, nal.temporal_id, recoveryPocCnt), data, size, iov);
+}
+
+bool OlsExtractor::filter(const unsigned char *data, size_t size, const unsigned char *header, size_t headerSize)
+{
+  if (headerSize < 2)
+    return true;
+
+  const int nalUnitType = header[1] >> 3;
+  int recoveryPocCnt = -1;
+  if (nalUnitType == vvc::NAL_UNIT_VPS)
+  {
+    parseVps(data, size);
+  }
+  else if (nalUnitType == vvc::NAL_UNIT_SPS || nalUnitType == vvc::NAL_UNIT_PPS || nalUnitType == vvc::NAL_UNIT_PH ||
+           nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR)
+  {
+    // ph_recovery_poc_cnt of the GDR pictures, from their picture header NAL unit or their slice header
+    if (parse(data, size, parsingLevel::PARSING_SLICE_PREFIX) && nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR &&
+        m_parser.nal->slice.valid)
+      recoveryPocCnt = m_parser.nal->slice.recoveryPocCnt;
+  }
+  return isKept(nalUnitType, header[0] & 0x3f, static_cast<int>(header[1] & 0x07) - 1, recoveryPocCnt);
+}
+
+bool OlsExtractor::extract(const unsigned char *buffer, size_t size, std::vector<struct iovec> &iov)
+{
+  const uint64_t vpsErrors = m_vpsErrors;
+  scan(buffer, size, iov);
+  return m_vpsErrors == vpsErrors;
+}
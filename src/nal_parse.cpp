@@ -1,45 +1,380 @@
 #include "nal_parse.h"
+#include "nal_probe.h"
 #include "h264_nal.h"
 #include "hevc_nal.h"
 #include "vvc_nal.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+// Slice header prefixes fit well within this many RBSP bytes, the rest of the slice is never unescaped
+static const size_t SLICE_PREFIX_BYTES = 48;
+// Padding of '1' bits so that reads running past a short NAL unit stop on Exp-Golomb codes of value 0
+static const size_t SLICE_PREFIX_PADDING = 8;
+// Raw bytes of a slice NAL unit gathered for its prefix : header and SLICE_PREFIX_BYTES, even if every third byte is an emulation prevention byte
+static const uint32_t SLICE_PREFIX_GATHER_BYTES = 128;
+// Whole slice headers (parsingLevel::PARSING_ENTRY_POINTS) : the NAL unit is unescaped again when the first bytes are not enough
+static const size_t SLICE_HEADER_BYTES = 1024;
+// Covers the reads of one part of the slice header running past the unescaped bytes, before the parser checks the length
+static const size_t SLICE_HEADER_PADDING = 64;
+
 NALParse::NALParse()
 {
-  nal = new nal_info();
+  nal = &m_nalInfo;
+  m_rbspHeader = 0;
+  m_rbspSize = 0;
 }
 
 NALParse::~NALParse()
 {
-  if (nal != nullptr)
+}
+
+NALParse::NALParse(NALParse &&other) noexcept
+    : m_nalInfo(std::move(other.m_nalInfo)), m_rbsp(std::move(other.m_rbsp)), m_epbLocation(std::move(other.m_epbLocation)), m_gather(std::move(other.m_gather))
+{
+  nal = &m_nalInfo;
+  m_rbspHeader = other.m_rbspHeader;
+  m_rbspSize = other.m_rbspSize;
+  other.m_rbspSize = 0;
+}
+
+NALParse &NALParse::operator=(NALParse &&other) noexcept
+{
+  if (this != &other)
   {
-    delete nal;
-    nal = nullptr;
+    m_nalInfo = std::move(other.m_nalInfo);
+    m_rbsp = std::move(other.m_rbsp);
+    m_epbLocation = std::move(other.m_epbLocation);
+    m_gather = std::move(other.m_gather);
+    m_rbspHeader = other.m_rbspHeader;
+    m_rbspSize = other.m_rbspSize;
+    other.m_rbspSize = 0;
   }
+  return *this;
 }
 
 void NALParse::nal_parse(unsigned char *nal_bitstream, videoCodecType codecType, int &nextNalPos, int seqSize, parsingLevel level)
+{
+  if (codecType == videoCodecType::UNDEFINED)
+  {
+    // Detected once from the head of the first buffer, then kept for the following calls
+    codec_probe probe;
+    codecType = nal->codecType != videoCodecType::UNDEFINED ? nal->codecType : DetectCodec(nal_bitstream + nextNalPos, static_cast<size_t>(seqSize - nextNalPos), probe);
+    if (codecType == videoCodecType::UNDEFINED)
+    {
+      nal->nal_unit_type = -1;
+      m_rbspSize = 0;
+      nextNalPos = seqSize;
+      return;
+    }
+  }
+  nal->codecType = codecType;
+  nal->mpegParamSet.setCodec(codecType);
+
+  unsigned char *stream = &nal_bitstream[nextNalPos];
+  const int firstPos = FindStartCode(stream);
+  stream += firstPos;
+  if (codecType == videoCodecType::H264_AVC)
+  {
+    const int curLen = FindNextNal(stream + 1, nextNalPos + firstPos + 1, seqSize);
+    nextNalPos += (firstPos + 1 + curLen);
+    parseNalH264 lib;
+    h264_nal_parse(lib, stream, 1 + curLen, level);
+  }
+  else if (codecType == videoCodecType::H265_HEVC)
+  {
+    const int curLen = FindNextNal(stream, nextNalPos + firstPos, seqSize);
+    nextNalPos += (firstPos + curLen);
+    parseNalH265 lib;
+    hevc_nal_parse(lib, stream, curLen, firstPos, level);
+  }
+  else if (codecType == videoCodecType::H266_VVC)
+  {
+    const int curLen = FindNextNal(stream, nextNalPos + firstPos, seqSize);
+    nextNalPos += (firstPos + curLen);
+    parseNalH266 lib;
+    vvc_nal_parse(lib, stream, curLen, firstPos, level);
+  }
+}
+
+bool NALParse::nal_resync(unsigned char *nal_bitstream, int &nextNalPos, int seqSize)
+{
+  if (nextNalPos >= seqSize)
+    return false;
+  nextNalPos += FindNextNal(&nal_bitstream[nextNalPos], nextNalPos, seqSize);
+  return nextNalPos < seqSize;
+}
+
+void NALParse::nal_parse_unit(const uint8_t *data, uint32_t size, videoCodecType codecType, parsingLevel level)
+{
+  nal_buffer buffer = {data, size};
+  nal_parse_batch(&buffer, 1, codecType, level, NULL);
+}
+
+uint32_t NALParse::nal_bytes_needed(const uint8_t *header, videoCodecType codecType, parsingLevel level)
+{
+  // Slice NAL units are read up to their slice header prefix, the parsers below return on the same types
+  if (level == parsingLevel::PARSING_NONE)
+    return codecType == videoCodecType::H264_AVC ? 1 : 2;
+  if (level >= parsingLevel::PARSING_ENTRY_POINTS && codecType != videoCodecType::H264_AVC)
+    return UINT32_MAX;
+  bool slice = false;
+  if (codecType == videoCodecType::H264_AVC)
+  {
+    const avc::h264_nal_type type = static_cast<avc::h264_nal_type>(header[0] & 0x1f);
+    slice = type == avc::h264_nal_type::NALU_TYPE_SLICE || type == avc::h264_nal_type::NALU_TYPE_DPA || type == avc::h264_nal_type::NALU_TYPE_IDR;
+  }
+  else if (codecType == videoCodecType::H265_HEVC)
+    slice = ((header[0] >> 1) & 0x3f) <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_IRAP_VCL23);
+  else if (codecType == videoCodecType::H266_VVC)
+  {
+    const int type = header[1] >> 3;
+    slice = type <= vvc::NAL_UNIT_RESERVED_IRAP_VCL_11 || type == vvc::NAL_UNIT_PH;
+  }
+  return slice ? SLICE_PREFIX_GATHER_BYTES : UINT32_MAX;
+}
+
+bool NALParse::nal_is_vcl(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType >= static_cast<int>(avc::h264_nal_type::NALU_TYPE_SLICE) && nalUnitType <= static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType >= 0 && nalUnitType < static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_VPS);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType >= 0 && nalUnitType < vvc::NAL_UNIT_OPI;
+  return false;
+}
+
+bool NALParse::nal_is_suffix(videoCodecType codecType, int nalUnitType)
+{
+  // First-NAL-unit rules of H264/AVC (7.4.1.2.3), H265/HEVC (7.4.2.4.4) and H266/VVC (7.4.2.4.3)
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_FILL) ||
+           nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_EOSEQ) ||
+           nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_EOSTREAM) ||
+           nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_AUX_SLICE);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI) ||
+           nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_FILLER_DATA) ||
+           nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_EOS) ||
+           nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_EOB) ||
+           (nalUnitType >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_NVCL45) && nalUnitType <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_NVCL47)) ||
+           (nalUnitType >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_UNSPECIFIED_56) && nalUnitType <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_UNSPECIFIED_63));
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_SUFFIX_SEI || nalUnitType == vvc::NAL_UNIT_SUFFIX_APS ||
+           nalUnitType == vvc::NAL_UNIT_FD || nalUnitType == vvc::NAL_UNIT_EOS || nalUnitType == vvc::NAL_UNIT_EOB ||
+           nalUnitType == vvc::NAL_UNIT_RESERVED_NVCL_27 || nalUnitType == vvc::NAL_UNIT_UNSPECIFIED_30 || nalUnitType == vvc::NAL_UNIT_UNSPECIFIED_31;
+  return false;
+}
+
+bool NALParse::nal_is_end_of_sequence(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_EOSEQ) || nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_EOSTREAM);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_EOS) || nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_EOB);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_EOS || nalUnitType == vvc::NAL_UNIT_EOB;
+  return false;
+}
+
+bool NALParse::nal_is_aud(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_AUD);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_ACCESS_UNIT_DELIMITER);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_ACCESS_UNIT_DELIMITER;
+  return false;
+}
+
+bool NALParse::nal_is_irap(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP) &&
+           nalUnitType <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_IRAP_VCL23);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType >= vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL && nalUnitType <= vvc::NAL_UNIT_CODED_SLICE_CRA;
+  return false;
+}
+
+bool NALParse::nal_is_vps(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_VPS);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_VPS;
+  return false;
+}
+
+bool NALParse::nal_is_sps(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SPS);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SPS);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_SPS;
+  return false;
+}
+
+bool NALParse::nal_is_pps(videoCodecType codecType, int nalUnitType)
+{
+  if (codecType == videoCodecType::H264_AVC)
+    return nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_PPS);
+  if (codecType == videoCodecType::H265_HEVC)
+    return nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PPS);
+  if (codecType == videoCodecType::H266_VVC)
+    return nalUnitType == vvc::NAL_UNIT_PPS;
+  return false;
+}
+
+bool NALParse::nal_is_aps(videoCodecType codecType, int nalUnitType)
+{
+  return codecType == videoCodecType::H266_VVC && (nalUnitType == vvc::NAL_UNIT_PREFIX_APS || nalUnitType == vvc::NAL_UNIT_SUFFIX_APS);
+}
+
+void NALParse::nal_parse_scatter(const nal_buffer *fragments, size_t count, videoCodecType codecType, parsingLevel level)
+{
+  while (count > 0 && fragments[0].size == 0)
+  {
+    fragments++;
+    count--;
+  }
+  if (count == 0)
+  {
+    nal->nal_unit_type = -1;
+    m_rbspSize = 0;
+    return;
+  }
+  if (count == 1)
+  {
+    nal_parse_unit(fragments[0].data, fragments[0].size, codecType, level);
+    return;
+  }
+
+  // The NAL unit header may itself be split
+  uint8_t header[2] = {fragments[0].data[0], 0};
+  if (fragments[0].size > 1)
+    header[1] = fragments[0].data[1];
+  else
+  {
+    for (size_t i = 1; i < count; i++)
+    {
+      if (fragments[i].size > 0)
+      {
+        header[1] = fragments[i].data[0];
+        break;
+      }
+    }
+  }
+  const uint32_t needed = nal_bytes_needed(header, codecType, level);
+
+  m_gather.clear();
+  for (size_t i = 0; i < count && m_gather.size() < needed; i++)
+  {
+    const uint32_t take = static_cast<uint32_t>(std::min<uint64_t>(fragments[i].size, needed - m_gather.size()));
+    m_gather.insert(m_gather.end(), fragments[i].data, fragments[i].data + take);
+  }
+  nal_parse_unit(m_gather.data(), static_cast<uint32_t>(m_gather.size()), codecType, level);
+}
+
+// Start code in front of a NAL unit handed over already split, at most as long as the unit
+static int SplitStartCode(const uint8_t *data, uint32_t size)
+{
+  if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1)
+    return 4;
+  if (size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1)
+    return 3;
+  return 0;
+}
+
+void NALParse::xStoreResult(nal_result *result) const
+{
+  result->nal_unit_type = nal->nal_unit_type;
+  result->nuh_layer_id = nal->nuh_layer_id;
+  result->temporal_id = nal->temporal_id;
+  result->sei_type = nal->sei_types.empty() ? -1 : nal->sei_types[0];
+  result->slice = nal->slice;
+}
+
+size_t NALParse::nal_parse_batch(const nal_buffer *nals, size_t count, videoCodecType codecType, parsingLevel level, nal_result *results)
 {
   nal->codecType = codecType;
+  nal->mpegParamSet.setCodec(codecType);
+
+  // One parser object for the whole batch, its bitstream is emptied before every NAL unit
+  // The parsers only read the buffers : the constness is dropped for their interfaces
+  size_t parsed = 0;
   if (codecType == videoCodecType::H264_AVC)
   {
-    h264_nal_parse(nal_bitstream, nextNalPos, seqSize, level);
+    parseNalH264 lib;
+    for (size_t i = 0; i < count; i++)
+    {
+      const int firstPos = SplitStartCode(nals[i].data, nals[i].size);
+      const int nalLen = static_cast<int>(nals[i].size) - firstPos;
+      nal->nal_unit_type = -1;
+      m_rbspSize = 0;
+      if (nalLen >= 1)
+      {
+        h264_nal_parse(lib, const_cast<unsigned char *>(nals[i].data) + firstPos, nalLen, level);
+        parsed++;
+      }
+      if (results)
+        xStoreResult(&results[i]);
+    }
   }
   else if (codecType == videoCodecType::H265_HEVC)
   {
-    hevc_nal_parse(nal_bitstream, nextNalPos, seqSize, level);
+    parseNalH265 lib;
+    for (size_t i = 0; i < count; i++)
+    {
+      const int firstPos = SplitStartCode(nals[i].data, nals[i].size);
+      const int nalLen = static_cast<int>(nals[i].size) - firstPos;
+      nal->nal_unit_type = -1;
+      m_rbspSize = 0;
+      if (nalLen >= 2)
+      {
+        lib.reset();
+        hevc_nal_parse(lib, const_cast<unsigned char *>(nals[i].data) + firstPos, nalLen, firstPos, level);
+        parsed++;
+      }
+      if (results)
+        xStoreResult(&results[i]);
+    }
   }
   else if (codecType == videoCodecType::H266_VVC)
   {
-    vvc_nal_parse(nal_bitstream, nextNalPos, seqSize, level);
+    parseNalH266 lib;
+    for (size_t i = 0; i < count; i++)
+    {
+      const int firstPos = SplitStartCode(nals[i].data, nals[i].size);
+      const int nalLen = static_cast<int>(nals[i].size) - firstPos;
+      nal->nal_unit_type = -1;
+      m_rbspSize = 0;
+      if (nalLen >= 2)
+      {
+        lib.reset();
+        vvc_nal_parse(lib, const_cast<unsigned char *>(nals[i].data) + firstPos, nalLen, firstPos, level);
+        parsed++;
+      }
+      if (results)
+        xStoreResult(&results[i]);
+    }
   }
+  return parsed;
 }
 
-std::vector<uint8_t> NALParse::UnescapeRbsp(const uint8_t *data, size_t length)
+void NALParse::UnescapeRbsp(const uint8_t *data, size_t length, std::vector<uint8_t> &out, size_t maxLength, std::vector<uint32_t> *epbLocation)
 {
-  std::vector<uint8_t> out;
-  out.reserve(length);
+  out.clear();
+  out.reserve(length < maxLength ? length : maxLength);
 
-  for (size_t i = 0; i < length;)
+  for (size_t i = 0; i < length && out.size() < maxLength;)
   {
     // Be careful about over/underflow here. byte_length_ - 3 can underflow, and
     // i + 3 can overflow, but byte_length_ - i can't, because i < byte_length_
@@ -52,6 +387,8 @@ std::vector<uint8_t> NALParse::UnescapeRbsp(const uint8_t *data, size_t length)
       out.push_back(data[i++]);
       out.push_back(data[i++]);
       // Skip the emulation byte.
+      if (epbLocation)
+        epbLocation->push_back(static_cast<uint32_t>(i));
       i++;
     }
     else
@@ -60,137 +397,262 @@ std::vector<uint8_t> NALParse::UnescapeRbsp(const uint8_t *data, size_t length)
       out.push_back(data[i++]);
     }
   }
-  return out;
 }
 
-void NALParse::h264_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level)
+void NALParse::h264_nal_parse(parseNalH264 &lib, unsigned char *stream, int nalLen, parsingLevel level)
 {
-  parseNalH264 lib;
   nal_info *nal = this->nal;
-  unsigned char *stream = &nal_bitstream[nextNalPos];
-  int firstPos = FindStartCode(stream);
-  stream += firstPos;
 
   nal->nal_unit_type = static_cast<int>((*(stream)) & 0x1f);
   nal->sei_type = -1;
+  nal->sei_types.clear();
+  m_rbspSize = 0;
+  nal->slice.valid = false;
+  const int nalRefIdc = static_cast<int>((*(stream)) >> 5) & 0x03;
   stream++;
-  int curLen = FindNextNal(stream, nextNalPos + firstPos, seqSize);
-  nextNalPos += (firstPos + 1 + curLen);
-
-  std::vector<uint8_t> streamTmp = UnescapeRbsp(stream, curLen);
-  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
+  int curLen = nalLen - 1;
 
-  if (level > parsingLevel::PARSING_NONE && curLen > 0)
+  const avc::h264_nal_type nalUnitType = static_cast<avc::h264_nal_type>(nal->nal_unit_type);
+  if (nalUnitType == avc::h264_nal_type::NALU_TYPE_SLICE || nalUnitType == avc::h264_nal_type::NALU_TYPE_DPA || nalUnitType == avc::h264_nal_type::NALU_TYPE_IDR)
   {
-    if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_SEI && level > parsingLevel::PARSING_PARAM_ID)
+    if (level >= parsingLevel::PARSING_SLICE_PREFIX && curLen > 0)
     {
-      lib.sei_parse(realStream, *nal, curLen);
-    }
-    else if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_SPS)
-    {
-      if (!nal->mpegParamSet->sps)
-        nal->mpegParamSet->sps = new avc::sps;
-      lib.sps_parse(realStream, reinterpret_cast<avc::sps *>(nal->mpegParamSet->sps), curLen, level);
-    }
-    else if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_PPS)
-    {
-      if (!nal->mpegParamSet->pps)
-        nal->mpegParamSet->pps = new avc::pps;
-      lib.pps_parse(realStream, reinterpret_cast<avc::pps *>(nal->mpegParamSet->pps), reinterpret_cast<avc::sps *>(nal->mpegParamSet->sps), curLen, level);
+      std::vector<uint8_t> &prefix = m_rbsp;
+      UnescapeRbsp(stream, curLen, prefix, SLICE_PREFIX_BYTES);
+      prefix.resize(prefix.size() + SLICE_PREFIX_PADDING, 0xFF);
+      nal->slice.nalRefIdc = nalRefIdc;
+      lib.slice_prefix_parse(prefix.data(), *nal, static_cast<int>(prefix.size()));
     }
+    return;
+  }
+  if (level == parsingLevel::PARSING_NONE || curLen <= 0)
+    return;
+
+  std::vector<uint8_t> &streamTmp = m_rbsp;
+  UnescapeRbsp(stream, curLen, streamTmp);
+  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
+  curLen = static_cast<int>(streamTmp.size());
+  m_rbspHeader = 0;
+  m_rbspSize = streamTmp.size();
+
+  if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_SEI && level > parsingLevel::PARSING_PARAM_ID)
+  {
+    lib.sei_parse(realStream, *nal, curLen);
+  }
+  else if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_SPS)
+  {
+    std::unique_ptr<avc::sps> sps(new avc::sps());
+    lib.sps_parse(realStream, sps.get(), curLen, level);
+    const int id = static_cast<int>(sps->seq_parameter_set_id);
+    nal->mpegParamSet.storeSps(id, sps.release());
+  }
+  else if (static_cast<avc::h264_nal_type>(nal->nal_unit_type) == avc::h264_nal_type::NALU_TYPE_PPS)
+  {
+    std::unique_ptr<avc::pps> pps(new avc::pps());
+    lib.pps_parse(realStream, pps.get(), reinterpret_cast<avc::sps *>(nal->mpegParamSet.sps), curLen, level);
+    const int id = static_cast<int>(pps->pic_parameter_set_id);
+    nal->mpegParamSet.storePps(id, pps.release());
   }
 }
 
-void NALParse::hevc_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level)
+void NALParse::hevc_nal_parse(parseNalH265 &lib, unsigned char *stream, int nalLen, int firstPos, parsingLevel level)
 {
-  parseNalH265 lib;
   nal_info *nal = this->nal;
-  unsigned char *stream = &nal_bitstream[nextNalPos];
-  int firstPos = FindStartCode(stream);
-  stream += firstPos;
 
   nal->nal_unit_type = static_cast<int>((*(stream)) & 0x7e) >> 1;
+  nal->nuh_layer_id = static_cast<int>(((stream[0] & 0x01) << 5) | (stream[1] >> 3));
+  nal->temporal_id = static_cast<int>(stream[1] & 0x07) - 1;
   nal->sei_type = -1;
-  int curLen = FindNextNal(stream, nextNalPos + firstPos, seqSize);
-  nextNalPos += (firstPos + curLen);
+  nal->sei_types.clear();
+  m_rbspSize = 0;
+  nal->slice.valid = false;
+  nal->entry.valid = false;
+  int curLen = nalLen;
 
-  std::vector<uint8_t> streamTmp = UnescapeRbsp(stream, curLen);
-  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
-
-  if (level > parsingLevel::PARSING_NONE && curLen > 0)
+  if (nal->nal_unit_type <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_RESERVED_IRAP_VCL23))
   {
-    if ((static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI ||
-         static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI) &&
-        level > parsingLevel::PARSING_PARAM_ID)
-    {
-      lib.sei_parse(realStream, *nal, curLen);
-    }
-    else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_VPS)
-    {
-      if (!nal->mpegParamSet->vps)
-        nal->mpegParamSet->vps = new hevc::vps;
-      lib.vps_parse(realStream, reinterpret_cast<hevc::vps *>(nal->mpegParamSet->vps), curLen, level);
-    }
-    else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_SPS)
+    // Slice NAL units : nothing is read below PARSING_SLICE_PREFIX, so the slice data is never unescaped
+    if (level >= parsingLevel::PARSING_SLICE_PREFIX && curLen > 2 &&
+        (nal->nal_unit_type <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_RASL_R) ||
+         nal->nal_unit_type >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP)) &&
+        nal->nal_unit_type <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_CRA))
     {
-      if (!nal->mpegParamSet->sps)
-        nal->mpegParamSet->sps = new hevc::sps;
-      lib.sps_parse(realStream, reinterpret_cast<hevc::sps *>(nal->mpegParamSet->sps), curLen, level);
-    }
-    else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_PPS)
-    {
-      if (!nal->mpegParamSet->pps)
-        nal->mpegParamSet->pps = new hevc::pps;
-      lib.pps_parse(realStream, reinterpret_cast<hevc::pps *>(nal->mpegParamSet->pps), reinterpret_cast<hevc::sps *>(nal->mpegParamSet->sps), curLen, level);
+      if (level >= parsingLevel::PARSING_ENTRY_POINTS)
+      {
+        // Entry points are counted in bytes of the NAL unit, the positions of the emulation prevention bytes map them back
+        std::vector<uint32_t> &epbLocation = m_epbLocation;
+        std::vector<uint8_t> &header = m_rbsp;
+        epbLocation.clear();
+        UnescapeRbsp(stream, curLen, header, SLICE_HEADER_BYTES, &epbLocation);
+        const int dataLen = static_cast<int>(header.size());
+        header.resize(header.size() + SLICE_HEADER_PADDING, 0xFF);
+        if (!lib.slice_header_parse(header.data(), *nal, static_cast<int>(header.size()), dataLen, epbLocation, firstPos, firstPos + curLen) &&
+            dataLen == static_cast<int>(SLICE_HEADER_BYTES))
+        {
+          lib.reset();
+          epbLocation.clear();
+          UnescapeRbsp(stream, curLen, header, SIZE_MAX, &epbLocation);
+          const int wholeLen = static_cast<int>(header.size());
+          header.resize(header.size() + SLICE_HEADER_PADDING, 0xFF);
+          lib.slice_header_parse(header.data(), *nal, static_cast<int>(header.size()), wholeLen, epbLocation, firstPos, firstPos + curLen);
+        }
+        return;
+      }
+      std::vector<uint8_t> &prefix = m_rbsp;
+      UnescapeRbsp(stream, curLen, prefix, SLICE_PREFIX_BYTES);
+      prefix.resize(prefix.size() + SLICE_PREFIX_PADDING, 0xFF);
+      lib.slice_prefix_parse(prefix.data(), *nal, static_cast<int>(prefix.size()));
     }
+    return;
+  }
+  if (level == parsingLevel::PARSING_NONE || curLen <= 0)
+    return;
+
+  std::vector<uint8_t> &streamTmp = m_rbsp;
+  UnescapeRbsp(stream, curLen, streamTmp);
+  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
+  curLen = static_cast<int>(streamTmp.size());
+  m_rbspHeader = 2;
+  m_rbspSize = streamTmp.size() > 2 ? streamTmp.size() - 2 : 0;
+
+  if ((static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI ||
+       static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI) &&
+      level > parsingLevel::PARSING_PARAM_ID)
+  {
+    lib.sei_parse(realStream, *nal, curLen);
+  }
+  else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_VPS)
+  {
+    if (!nal->mpegParamSet.vps)
+      nal->mpegParamSet.vps = new hevc::vps;
+    lib.vps_parse(realStream, reinterpret_cast<hevc::vps *>(nal->mpegParamSet.vps), curLen, level);
+  }
+  else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_SPS)
+  {
+    std::unique_ptr<hevc::sps> sps(new hevc::sps());
+    lib.sps_parse(realStream, sps.get(), curLen, level);
+    const int id = sps->m_SPSId;
+    nal->mpegParamSet.storeSps(id, sps.release());
+  }
+  else if (static_cast<hevc::hevc_nal_type>(nal->nal_unit_type) == hevc::hevc_nal_type::NAL_UNIT_PPS)
+  {
+    std::unique_ptr<hevc::pps> pps(new hevc::pps());
+    lib.pps_parse(realStream, pps.get(), reinterpret_cast<hevc::sps *>(nal->mpegParamSet.sps), curLen, level);
+    const int id = pps->m_PPSId;
+    nal->mpegParamSet.storePps(id, pps.release());
   }
 }
 
-void NALParse::vvc_nal_parse(unsigned char *nal_bitstream, int &nextNalPos, int seqSize, parsingLevel level)
+void NALParse::vvc_nal_parse(parseNalH266 &lib, unsigned char *stream, int nalLen, int firstPos, parsingLevel level)
 {
-  parseNalH266 lib;
   nal_info *nal = this->nal;
-  unsigned char *stream = &nal_bitstream[nextNalPos];
-  int firstPos = FindStartCode(stream);
-  stream += firstPos;
 
   nal->nal_unit_type = static_cast<int>(stream[1] & 0xF8) >> 3;
+  nal->nuh_layer_id = static_cast<int>(stream[0] & 0x3F);
+  nal->temporal_id = static_cast<int>(stream[1] & 0x07) - 1;
   nal->sei_type = -1;
-  int curLen = FindNextNal(stream, nextNalPos + firstPos, seqSize);
-  nextNalPos += (firstPos + curLen);
+  nal->sei_types.clear();
+  m_rbspSize = 0;
+  nal->slice.valid = false;
+  nal->entry.valid = false;
   stream += 2; // length of nal unit header
+  int curLen = nalLen > 2 ? nalLen - 2 : 0;
 
-  std::vector<uint8_t> streamTmp = UnescapeRbsp(stream, curLen);
-  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
-
-  if (level > parsingLevel::PARSING_NONE && curLen > 0)
+  if (nal->nal_unit_type <= vvc::NAL_UNIT_RESERVED_IRAP_VCL_11 || nal->nal_unit_type == vvc::NAL_UNIT_PH)
   {
-    if ((static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PREFIX_SEI ||
-         static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SUFFIX_SEI) &&
-        level > parsingLevel::PARSING_PARAM_ID)
+    // Slice NAL units : nothing is read below PARSING_SLICE_PREFIX, so the slice data is never unescaped
+    if (level >= parsingLevel::PARSING_SLICE_PREFIX && curLen > 0 &&
+        (nal->nal_unit_type <= vvc::NAL_UNIT_CODED_SLICE_RASL || nal->nal_unit_type >= vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL) &&
+        nal->nal_unit_type != vvc::NAL_UNIT_RESERVED_IRAP_VCL_11)
     {
-      lib.sei_parse(realStream, *nal, curLen);
+      if (level >= parsingLevel::PARSING_ENTRY_POINTS)
+      {
+        // Entry points are counted in bytes of the NAL unit, the positions of the emulation prevention bytes map them back
+        std::vector<uint32_t> &epbLocation = m_epbLocation;
+        std::vector<uint8_t> &header = m_rbsp;
+        epbLocation.clear();
+        UnescapeRbsp(stream, curLen, header, SLICE_HEADER_BYTES, &epbLocation);
+        const int dataLen = static_cast<int>(header.size());
+        header.resize(header.size() + SLICE_HEADER_PADDING, 0xFF);
+        if (!lib.slice_header_parse(header.data(), *nal, static_cast<int>(header.size()), dataLen, epbLocation, firstPos + 2, firstPos + 2 + curLen) &&
+            dataLen == static_cast<int>(SLICE_HEADER_BYTES))
+        {
+          lib.reset();
+          epbLocation.clear();
+          UnescapeRbsp(stream, curLen, header, SIZE_MAX, &epbLocation);
+          const int wholeLen = static_cast<int>(header.size());
+          header.resize(header.size() + SLICE_HEADER_PADDING, 0xFF);
+          lib.slice_header_parse(header.data(), *nal, static_cast<int>(header.size()), wholeLen, epbLocation, firstPos + 2, firstPos + 2 + curLen);
+        }
+        return;
+      }
+      std::vector<uint8_t> &prefix = m_rbsp;
+      UnescapeRbsp(stream, curLen, prefix, SLICE_PREFIX_BYTES);
+      prefix.resize(prefix.size() + SLICE_PREFIX_PADDING, 0xFF);
+      lib.slice_prefix_parse(prefix.data(), *nal, static_cast<int>(prefix.size()));
     }
-    else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SPS)
+    return;
+  }
+  if (level == parsingLevel::PARSING_NONE || curLen <= 0)
+    return;
+
+  std::vector<uint8_t> &streamTmp = m_rbsp;
+  UnescapeRbsp(stream, curLen, streamTmp);
+  uint8_t* realStream = streamTmp.size() == (uint32_t)curLen ? stream : streamTmp.data();
+  curLen = static_cast<int>(streamTmp.size());
+  m_rbspHeader = 0;
+  m_rbspSize = streamTmp.size();
+
+  if ((static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PREFIX_SEI ||
+       static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SUFFIX_SEI) &&
+      level > parsingLevel::PARSING_PARAM_ID)
+  {
+    lib.sei_parse(realStream, *nal, curLen);
+  }
+  else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_VPS)
+  {
+    // The layer set of a VPS violating a constraint (checkVPS) is not used, the previous VPS stays active
+    std::unique_ptr<vvc::VPS> vps(new vvc::VPS());
+    try
     {
-      if (!nal->mpegParamSet->sps)
-        nal->mpegParamSet->sps = new vvc::SPS;
-      lib.sps_parse(realStream, reinterpret_cast<vvc::SPS *>(nal->mpegParamSet->sps), curLen, level);
+      lib.vps_parse(realStream, vps.get(), curLen, level);
     }
-    else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PPS)
+    catch (const std::exception &e)
     {
-      if (!nal->mpegParamSet->pps)
-        nal->mpegParamSet->pps = new vvc::PPS;
-      lib.pps_parse(realStream, reinterpret_cast<vvc::PPS *>(nal->mpegParamSet->pps), reinterpret_cast<vvc::SPS *>(nal->mpegParamSet->sps), curLen, level);
+      vvc::msg(vvc::WARNING, "Warning: VPS ignored%s\n", e.what());
+      return;
     }
-    else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PREFIX_APS ||
-             static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SUFFIX_APS)
+    delete static_cast<vvc::VPS *>(nal->mpegParamSet.vps);
+    nal->mpegParamSet.vps = vps.release();
+  }
+  else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SPS)
+  {
+    std::unique_ptr<vvc::SPS> sps(new vvc::SPS());
+    lib.sps_parse(realStream, sps.get(), curLen, level);
+    const int id = sps->m_SPSId;
+    nal->mpegParamSet.storeSps(id, sps.release());
+    // The slice map of a PPS depends on the subpictures and CTU size of its SPS
+    for (size_t i = 0; i < nal->mpegParamSet.ppsList.size(); i++)
     {
-      if (!nal->mpegParamSet->aps)
-        nal->mpegParamSet->aps = new vvc::APS;
-      lib.aps_parse(realStream, reinterpret_cast<vvc::APS *>(nal->mpegParamSet->aps), curLen, level);
+      vvc::PPS *pps = static_cast<vvc::PPS *>(nal->mpegParamSet.ppsList[i]);
+      if (pps && pps->m_SPSId == id)
+        pps->m_sliceMap.clear();
     }
   }
+  else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PPS)
+  {
+    std::unique_ptr<vvc::PPS> pps(new vvc::PPS());
+    lib.pps_parse(realStream, pps.get(), reinterpret_cast<vvc::SPS *>(nal->mpegParamSet.sps), curLen, level);
+    const int id = pps->m_PPSId;
+    nal->mpegParamSet.storePps(id, pps.release());
+  }
+  else if (static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_PREFIX_APS ||
+           static_cast<vvc::NalUnitType>(nal->nal_unit_type) == vvc::NalUnitType::NAL_UNIT_SUFFIX_APS)
+  {
+    if (!nal->mpegParamSet.aps)
+      nal->mpegParamSet.aps = new vvc::APS;
+    lib.aps_parse(realStream, reinterpret_cast<vvc::APS *>(nal->mpegParamSet.aps), curLen, level);
+  }
 }
 
 int NALParse::FindStartCode(const unsigned char *pData)
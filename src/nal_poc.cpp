@@ -0,0 +1,247 @@
+#include "nal_poc.h"
+
+#include <algorithm>
+
+PocCalculator::PocCalculator(videoCodecType codecType)
+{
+  m_codecType = codecType;
+  clear();
+}
+
+PocCalculator::~PocCalculator()
+{
+}
+
+void PocCalculator::clear()
+{
+  m_picCount = 0;
+  m_cur = poc_info{};
+
+  m_prevPocMsb = 0;
+  m_prevPocLsb = 0;
+  m_prevFrameNumOffset = 0;
+  m_prevFrameNum = 0;
+
+  for (int i = 0; i < MAX_LAYERS; i++)
+  {
+    m_prevTid0Poc[i] = 0;
+    m_firstPicInLayer[i] = true;
+  }
+  m_pendingPictureHeader = false;
+}
+
+int PocCalculator::derivePocMsb(int pocLsb, int prevPocLsb, int prevPocMsb, int maxPocLsb)
+{
+  if (pocLsb < prevPocLsb && (prevPocLsb - pocLsb) >= (maxPocLsb / 2))
+    return prevPocMsb + maxPocLsb;
+  if (pocLsb > prevPocLsb && (pocLsb - prevPocLsb) > (maxPocLsb / 2))
+    return prevPocMsb - maxPocLsb;
+  return prevPocMsb;
+}
+
+bool PocCalculator::push(const nal_info &nal)
+{
+  if (NALParse::nal_is_end_of_sequence(m_codecType, nal.nal_unit_type))
+  {
+    // The next IRAP / GDR picture starts a new coded video sequence
+    std::fill(m_firstPicInLayer, m_firstPicInLayer + MAX_LAYERS, true);
+    return false;
+  }
+  if (m_codecType == videoCodecType::H266_VVC && nal.nal_unit_type == vvc::NAL_UNIT_PH)
+  {
+    m_pendingPictureHeader = true;
+    return false;
+  }
+  if (!NALParse::nal_is_vcl(m_codecType, nal.nal_unit_type))
+    return false;
+
+  bool newPicture = nal.slice.firstSliceInPic;
+  if (m_codecType == videoCodecType::H266_VVC)
+  {
+    newPicture = m_pendingPictureHeader || nal.slice.picHeaderInSliceHeader;
+    m_pendingPictureHeader = false;
+  }
+  if (!newPicture)
+    return false;
+
+  m_cur.valid = false;
+  m_cur.picIndex = m_picCount++;
+  m_cur.layerId = nal.nuh_layer_id;
+  if (m_codecType == videoCodecType::H264_AVC)
+    h264Poc(nal);
+  else if (m_codecType == videoCodecType::H265_HEVC)
+    hevcPoc(nal);
+  else if (m_codecType == videoCodecType::H266_VVC)
+    vvcPoc(nal);
+  return true;
+}
+
+void PocCalculator::h264Poc(const nal_info &nal)
+{
+  const slice_prefix &slice = nal.slice;
+  const avc::sps *sps = static_cast<const avc::sps *>(nal.mpegParamSet.sps);
+  if (!slice.valid || !sps)
+    return;
+
+  const bool idr = static_cast<avc::h264_nal_type>(nal.nal_unit_type) == avc::h264_nal_type::NALU_TYPE_IDR;
+  const bool reference = slice.nalRefIdc != 0;
+  int topPoc = 0, bottomPoc = 0;
+
+  if (sps->pic_order_cnt_type == 0)
+  {
+    // 8.2.1.1
+    const int maxPocLsb = 1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+    const int prevPocMsb = idr ? 0 : m_prevPocMsb;
+    const int prevPocLsb = idr ? 0 : m_prevPocLsb;
+    const int pocMsb = derivePocMsb(slice.pocLsb, prevPocLsb, prevPocMsb, maxPocLsb);
+
+    if (!slice.fieldPic)
+    {
+      topPoc = pocMsb + slice.pocLsb;
+      bottomPoc = topPoc + slice.deltaPocBottom;
+    }
+    else
+    {
+      topPoc = bottomPoc = pocMsb + slice.pocLsb;
+    }
+
+    if (reference)
+    {
+      m_prevPocMsb = pocMsb;
+      m_prevPocLsb = slice.pocLsb;
+    }
+  }
+  else
+  {
+    const int maxFrameNum = 1 << (sps->log2_max_frame_num_minus4 + 4);
+    int frameNumOffset = m_prevFrameNumOffset;
+    if (idr)
+      frameNumOffset = 0;
+    else if (m_prevFrameNum > slice.frameNum)
+      frameNumOffset = m_prevFrameNumOffset + maxFrameNum;
+
+    if (sps->pic_order_cnt_type == 1)
+    {
+      // 8.2.1.2
+      const int numRefFrames = static_cast<int>(sps->num_ref_frames_in_pic_order_cnt_cycle);
+      int absFrameNum = numRefFrames != 0 ? frameNumOffset + slice.frameNum : 0;
+      if (!reference && absFrameNum > 0)
+        absFrameNum--;
+
+      int expectedPoc = 0;
+      if (absFrameNum > 0)
+      {
+        int expectedDeltaPerCycle = 0;
+        for (int i = 0; i < numRefFrames; i++)
+          expectedDeltaPerCycle += sps->offset_for_ref_frame[i];
+
+        const int cycleCnt = (absFrameNum - 1) / numRefFrames;
+        const int frameNumInCycle = (absFrameNum - 1) % numRefFrames;
+        expectedPoc = cycleCnt * expectedDeltaPerCycle;
+        for (int i = 0; i <= frameNumInCycle; i++)
+          expectedPoc += sps->offset_for_ref_frame[i];
+      }
+      if (!reference)
+        expectedPoc += sps->offset_for_non_ref_pic;
+
+      if (!slice.fieldPic)
+      {
+        topPoc = expectedPoc + slice.deltaPicOrderCnt[0];
+        bottomPoc = topPoc + sps->offset_for_top_to_bottom_field + slice.deltaPicOrderCnt[1];
+      }
+      else if (!slice.bottomField)
+      {
+        topPoc = bottomPoc = expectedPoc + slice.deltaPicOrderCnt[0];
+      }
+      else
+      {
+        topPoc = bottomPoc = expectedPoc + sps->offset_for_top_to_bottom_field + slice.deltaPicOrderCnt[0];
+      }
+    }
+    else
+    {
+      // 8.2.1.3
+      int tempPoc = 0;
+      if (!idr)
+        tempPoc = reference ? 2 * (frameNumOffset + slice.frameNum) : 2 * (frameNumOffset + slice.frameNum) - 1;
+      topPoc = bottomPoc = tempPoc;
+    }
+
+    m_prevFrameNumOffset = frameNumOffset;
+    m_prevFrameNum = slice.frameNum;
+  }
+
+  m_cur.topPoc = topPoc;
+  m_cur.bottomPoc = bottomPoc;
+  if (!slice.fieldPic)
+    m_cur.poc = std::min(topPoc, bottomPoc);
+  else
+    m_cur.poc = slice.bottomField ? bottomPoc : topPoc;
+  m_cur.valid = true;
+}
+
+void PocCalculator::hevcPoc(const nal_info &nal)
+{
+  const slice_prefix &slice = nal.slice;
+  const hevc::sps *sps = static_cast<const hevc::sps *>(nal.mpegParamSet.sps);
+  if (!slice.valid || !sps)
+    return;
+
+  const hevc::hevc_nal_type nalUnitType = static_cast<hevc::hevc_nal_type>(nal.nal_unit_type);
+  const int layer = std::min(nal.nuh_layer_id, MAX_LAYERS - 1);
+  const int maxPocLsb = 1 << sps->m_uiBitsForPOC;
+  const bool irap = nalUnitType >= hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP && nalUnitType <= hevc::hevc_nal_type::NAL_UNIT_RESERVED_IRAP_VCL23;
+  const bool noRaslOutput = irap && (nalUnitType != hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_CRA || m_firstPicInLayer[layer]);
+  const int pocLsb = slice.pocLsb < 0 ? 0 : slice.pocLsb;
+
+  // 8.3.1 : IRAP pictures with NoRaslOutputFlag equal to 1 reset the MSB, otherwise it follows prevTid0Pic
+  int pocMsb = 0;
+  if (!noRaslOutput)
+  {
+    const int prevPocLsb = m_prevTid0Poc[layer] & (maxPocLsb - 1);
+    pocMsb = derivePocMsb(pocLsb, prevPocLsb, m_prevTid0Poc[layer] - prevPocLsb, maxPocLsb);
+  }
+  m_cur.poc = m_cur.topPoc = m_cur.bottomPoc = pocMsb + pocLsb;
+  m_cur.valid = true;
+
+  const bool subLayerNonRef = nalUnitType <= hevc::hevc_nal_type::NAL_UNIT_RESERVED_VCL_N14 && (nal.nal_unit_type % 2) == 0;
+  const bool leading = nalUnitType >= hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_RADL_N && nalUnitType <= hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_RASL_R;
+  if (nal.temporal_id == 0 && !subLayerNonRef && !leading)
+    m_prevTid0Poc[layer] = m_cur.poc;
+  if (irap)
+    m_firstPicInLayer[layer] = false;
+}
+
+void PocCalculator::vvcPoc(const nal_info &nal)
+{
+  const slice_prefix &slice = nal.slice;
+  const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+  if (slice.pocLsb < 0 || !sps)
+    return;
+
+  const int layer = std::min(nal.nuh_layer_id, MAX_LAYERS - 1);
+  const int maxPocLsb = 1 << sps->m_uiBitsForPOC;
+  const bool irapOrGdr = nal.nal_unit_type >= vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL && nal.nal_unit_type <= vvc::NAL_UNIT_CODED_SLICE_GDR;
+  const bool idr = nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL || nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_IDR_N_LP;
+  const bool clvss = irapOrGdr && (idr || m_firstPicInLayer[layer]);
+
+  // 8.3.1 : explicit MSB cycle, CLVSS pictures, otherwise the MSB follows prevTid0Pic
+  int pocMsb = 0;
+  if (slice.pocMsbCycle >= 0)
+  {
+    pocMsb = slice.pocMsbCycle * maxPocLsb;
+  }
+  else if (!clvss)
+  {
+    const int prevPocLsb = m_prevTid0Poc[layer] & (maxPocLsb - 1);
+    pocMsb = derivePocMsb(slice.pocLsb, prevPocLsb, m_prevTid0Poc[layer] - prevPocLsb, maxPocLsb);
+  }
+  m_cur.poc = m_cur.topPoc = m_cur.bottomPoc = pocMsb + slice.pocLsb;
+  m_cur.valid = true;
+
+  const bool leading = nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_RADL || nal.nal_unit_type == vvc::NAL_UNIT_CODED_SLICE_RASL;
+  if (nal.temporal_id == 0 && !leading && !slice.nonRefPic)
+    m_prevTid0Poc[layer] = m_cur.poc;
+  if (irapOrGdr)
+    m_firstPicInLayer[layer] = false;
+}
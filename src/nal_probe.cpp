@@ -0,0 +1,514 @@
+#include "nal_probe.h"
+#include "nal_visitor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Score of a NAL unit header breaking the syntax of a codec, and of a reserved or unspecified NAL unit type
+static const int PROBE_INVALID = -8;
+static const int PROBE_RESERVED = -4;
+
+struct probe_state
+{
+  bool vps;
+  bool sps;
+  bool pps;
+};
+
+static int scoreH264(const uint8_t *nal, size_t avail, probe_state &state)
+{
+  if (nal[0] & 0x80)
+    return PROBE_INVALID;
+  const int nalRefIdc = (nal[0] >> 5) & 0x03;
+  const int nalUnitType = nal[0] & 0x1f;
+  switch (nalUnitType)
+  {
+  case 1: case 2: case 3: case 4: case 5:
+    if (nalUnitType == 5 && nalRefIdc == 0)
+      return PROBE_INVALID;
+    return state.sps && state.pps ? 2 : 1;
+  case 6: case 9: case 10: case 11: case 12:
+    if (nalRefIdc != 0)
+      return PROBE_RESERVED;
+    // Access unit delimiter : primary_pic_type and rbsp_stop_one_bit
+    if (nalUnitType == 9 && avail >= 2 && (nal[1] & 0x1f) == 0x10)
+      return 3;
+    return 1;
+  case 7:
+  {
+    if (nalRefIdc == 0)
+      return PROBE_INVALID;
+    state.sps = true;
+    if (avail < 3)
+      return 2;
+    static const uint8_t profiles[] = {44, 66, 77, 83, 86, 88, 100, 110, 118, 122, 128, 134, 135, 138, 139, 244};
+    for (size_t i = 0; i < sizeof(profiles); i++)
+      if (nal[1] == profiles[i])
+        return (nal[2] & 0x03) == 0 ? 6 : 4; // reserved_zero_2bits
+    return -2;
+  }
+  case 8:
+    if (nalRefIdc == 0)
+      return PROBE_INVALID;
+    state.pps = true;
+    return state.sps ? 3 : 1;
+  case 13: case 14: case 15: case 19: case 20:
+    return 1;
+  case 0: case 24: case 25: case 26: case 27: case 28: case 29: case 30: case 31:
+    return PROBE_RESERVED; // Unspecified, not carried in byte streams
+  default:
+    return -1;
+  }
+}
+
+static int scoreH265(const uint8_t *nal, size_t avail, probe_state &state)
+{
+  if (avail < 2 || (nal[0] & 0x80) || (nal[1] & 0x07) == 0)
+    return PROBE_INVALID;
+  const int nalUnitType = (nal[0] >> 1) & 0x3f;
+  const int layerId = ((nal[0] & 0x01) << 5) | (nal[1] >> 3);
+  const int temporalId = (nal[1] & 0x07) - 1;
+  const int layerScore = layerId ? -1 : 0;
+
+  if (nalUnitType <= 9 || (nalUnitType >= 16 && nalUnitType <= 21))
+  {
+    if (nalUnitType >= 16 && temporalId != 0)
+      return PROBE_INVALID;
+    return layerScore + (state.vps && state.sps && state.pps ? 2 : 1);
+  }
+  switch (nalUnitType)
+  {
+  case 32:
+    if (temporalId != 0)
+      return PROBE_INVALID;
+    state.vps = true;
+    // vps_reserved_0xffff_16bits
+    return layerScore + (avail >= 6 && nal[4] == 0xff && nal[5] == 0xff ? 6 : 2);
+  case 33:
+    if (temporalId != 0)
+      return PROBE_INVALID;
+    state.sps = true;
+    if (avail < 4)
+      return layerScore + 2;
+    // general_profile_space equal to 0, general_profile_idc of a known profile
+    return layerScore + ((nal[3] & 0xc0) == 0 && (nal[3] & 0x1f) >= 1 && (nal[3] & 0x1f) <= 11 ? (state.vps ? 6 : 4) : -2);
+  case 34:
+    if (temporalId != 0)
+      return PROBE_INVALID;
+    state.pps = true;
+    return layerScore + (state.sps ? 3 : 1);
+  case 35: case 36: case 37: case 38: case 39: case 40:
+    return layerScore + 1;
+  default:
+    return PROBE_RESERVED; // Reserved (10..15, 22..31, 41..47) and unspecified (48..63)
+  }
+}
+
+static int scoreH266(const uint8_t *nal, size_t avail, probe_state &state)
+{
+  // forbidden_zero_bit, nuh_reserved_zero_bit, nuh_temporal_id_plus1
+  if (avail < 2 || (nal[0] & 0xc0) || (nal[1] & 0x07) == 0)
+    return PROBE_INVALID;
+  const int nalUnitType = nal[1] >> 3;
+  const int layerId = nal[0] & 0x3f;
+  const int temporalId = (nal[1] & 0x07) - 1;
+  const int layerScore = layerId ? -1 : 0;
+
+  if (nalUnitType <= 3 || (nalUnitType >= 7 && nalUnitType <= 10))
+  {
+    if (nalUnitType >= 7 && nalUnitType <= 9 && temporalId != 0)
+      return PROBE_INVALID;
+    return layerScore + (state.sps && state.pps ? 2 : 1);
+  }
+  switch (nalUnitType)
+  {
+  case 12: case 13:
+    return temporalId != 0 ? PROBE_INVALID : 1;
+  case 14:
+    if (temporalId != 0)
+      return PROBE_INVALID;
+    state.vps = true;
+    return 2;
+  case 15:
+  {
+    if (temporalId != 0)
+      return PROBE_INVALID;
+    state.sps = true;
+    if (avail < 4)
+      return layerScore + 2;
+    // sps_log2_ctu_size_minus5 up to 2
+    if (((nal[3] >> 1) & 0x03) == 3)
+      return -2;
+    if (!(nal[3] & 0x01) || avail < 5)
+      return layerScore + 3;
+    static const uint8_t profiles[] = {1, 2, 10, 17, 33, 34, 35, 42, 43, 49, 65, 66, 97, 98, 99};
+    for (size_t i = 0; i < sizeof(profiles); i++)
+      if ((nal[4] >> 1) == profiles[i])
+        return layerScore + 6;
+    return -2;
+  }
+  case 16:
+    state.pps = true;
+    return layerScore + (state.sps ? 3 : 1);
+  case 17: case 18: case 19: case 20: case 21: case 22: case 23: case 24: case 25:
+    return layerScore + 1;
+  default:
+    return PROBE_RESERVED; // Reserved (4..6, 11, 26, 27) and unspecified (28..31)
+  }
+}
+
+videoCodecType DetectCodec(const uint8_t *data, size_t size, codec_probe &probe, size_t maxBytes)
+{
+  probe.codecType = videoCodecType::UNDEFINED;
+  probe.confidence = 0;
+  probe.score[0] = probe.score[1] = probe.score[2] = 0;
+  probe.numNalUnits = 0;
+  probe.bytesProbed = size < maxBytes ? size : maxBytes;
+  if (!data)
+    return probe.codecType;
+
+  probe_state state[3] = {};
+  const size_t end = probe.bytesProbed;
+  for (size_t i = 0; i + 3 < end; i++)
+  {
+    if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+      continue;
+    const uint8_t *nal = data + i + 3;
+    const size_t avail = end - (i + 3);
+    probe.score[0] += scoreH264(nal, avail, state[0]);
+    probe.score[1] += scoreH265(nal, avail, state[1]);
+    probe.score[2] += scoreH266(nal, avail, state[2]);
+    probe.numNalUnits++;
+    i += 2;
+  }
+
+  int best = 0;
+  for (int c = 1; c < 3; c++)
+    if (probe.score[c] > probe.score[best])
+      best = c;
+  int second = -1;
+  for (int c = 0; c < 3; c++)
+    if (c != best && (second < 0 || probe.score[c] > probe.score[second]))
+      second = c;
+  if (probe.score[best] <= 0)
+    return probe.codecType;
+
+  const int runnerUp = probe.score[second] > 0 ? probe.score[second] : 0;
+  probe.confidence = static_cast<double>(probe.score[best] - runnerUp) / probe.score[best];
+  if (probe.confidence <= 0)
+    return probe.codecType;
+  probe.codecType = best == 0 ? videoCodecType::H264_AVC : (best == 1 ? videoCodecType::H265_HEVC : videoCodecType::H266_VVC);
+  return probe.codecType;
+}
+
+struct media_probe_state
+{
+  NALParse parser;
+  videoCodecType codecType;
+  bool pps;
+  bool vps;
+  bool needVps;  // Multi-layer H266 stream : the VPS is part of the media information
+  bool recovery; // H264 recovery point SEI seen, the next slice starts decoding
+};
+
+static void setLevel(media_info &info, int levelIdc, double level)
+{
+  info.levelIdc = levelIdc;
+  info.level = level;
+}
+
+static void setColour(media_info &info, bool colourDescription, int primaries, int transfer, int matrix, bool fullRange)
+{
+  info.colourDescription = colourDescription;
+  info.colourPrimaries = colourDescription ? primaries : 2;
+  info.transferCharacteristics = colourDescription ? transfer : 2;
+  info.matrixCoefficients = colourDescription ? matrix : 2;
+  info.fullRange = fullRange;
+  info.hdr = info.transferCharacteristics == 16 || info.transferCharacteristics == 18;
+  info.wideColourGamut = info.colourPrimaries == 9;
+}
+
+static void setTiming(media_info &info, uint32_t numUnitsInTick, uint32_t timeScale, double ticksPerFrame)
+{
+  info.numUnitsInTick = numUnitsInTick;
+  info.timeScale = timeScale;
+  info.frameRate = numUnitsInTick ? timeScale / (ticksPerFrame * numUnitsInTick) : 0;
+}
+
+static void fillH264(const avc::sps &sps, media_info &info)
+{
+  // 6.2 SubWidthC / SubHeightC, 7.4.2.1.1 CropUnitX / CropUnitY
+  const int chroma = static_cast<int>(sps.chroma_format_idc);
+  const bool monochrome = chroma == 0 || sps.separate_colour_plane_flag;
+  const uint32_t frameHeightFactor = sps.frame_mbs_only_flag ? 1 : 2;
+  const uint32_t cropUnitX = monochrome || chroma == 3 ? 1 : 2;
+  const uint32_t cropUnitY = (monochrome || chroma != 1 ? 1 : 2) * frameHeightFactor;
+
+  info.codedWidth = (sps.pic_width_in_mbs_minus1 + 1) * 16;
+  info.codedHeight = frameHeightFactor * (sps.pic_height_in_map_units_minus1 + 1) * 16;
+  info.width = info.codedWidth;
+  info.height = info.codedHeight;
+  if (sps.frame_cropping_flag)
+  {
+    info.width -= cropUnitX * (sps.frame_crop_left_offset + sps.frame_crop_right_offset);
+    info.height -= cropUnitY * (sps.frame_crop_top_offset + sps.frame_crop_bottom_offset);
+  }
+  info.interlaced = !sps.frame_mbs_only_flag;
+  info.bitDepthLuma = 8 + static_cast<int>(sps.bit_depth_luma_minus8);
+  info.bitDepthChroma = 8 + static_cast<int>(sps.bit_depth_chroma_minus8);
+  info.chromaFormatIdc = chroma;
+  info.profileIdc = static_cast<int>(sps.profile_idc);
+  setLevel(info, static_cast<int>(sps.level_idc), sps.level_idc / 10.0);
+  info.highTier = false;
+
+  const avc::vui_seq_parameters_t &vui = sps.vui_seq_parameters;
+  const bool signalType = sps.vui_parameters_present_flag && vui.video_signal_type_present_flag;
+  setColour(info, signalType && vui.colour_description_present_flag, vui.colour_primaries, vui.transfer_characteristics, vui.matrix_coefficients,
+            signalType && vui.video_full_range_flag);
+  // Clock ticks count fields
+  if (sps.vui_parameters_present_flag && vui.timing_info_present_flag)
+    setTiming(info, vui.num_units_in_tick, vui.time_scale, 2);
+}
+
+static void fillH265(const hevc::sps &sps, const hevc::vps *vps, media_info &info)
+{
+  const hevc::Window &conf = sps.m_conformanceWindow; // In luma samples
+  info.codedWidth = sps.m_picWidthInLumaSamples;
+  info.codedHeight = sps.m_picHeightInLumaSamples;
+  info.width = info.codedWidth - conf.m_winLeftOffset - conf.m_winRightOffset;
+  info.height = info.codedHeight - conf.m_winTopOffset - conf.m_winBottomOffset;
+  info.bitDepthLuma = sps.m_bitDepths.recon[hevc::CHANNEL_TYPE_LUMA];
+  info.bitDepthChroma = sps.m_bitDepths.recon[hevc::CHANNEL_TYPE_CHROMA];
+  info.chromaFormatIdc = static_cast<int>(sps.m_chromaFormatIdc);
+
+  const hevc::ProfileTierLevel &ptl = sps.m_pcPTL.m_generalPTL;
+  info.profileIdc = static_cast<int>(ptl.m_profileIdc);
+  setLevel(info, static_cast<int>(ptl.m_levelIdc), ptl.m_levelIdc / 30.0);
+  info.highTier = ptl.m_tierFlag == hevc::Level::HIGH;
+
+  const hevc::TComVUI &vui = sps.m_vuiParameters;
+  const bool vuiPresent = sps.m_vuiParametersPresentFlag;
+  const bool signalType = vuiPresent && vui.m_videoSignalTypePresentFlag;
+  setColour(info, signalType && vui.m_colourDescriptionPresentFlag, vui.m_colourPrimaries, vui.m_transferCharacteristics, vui.m_matrixCoefficients,
+            signalType && vui.m_videoFullRangeFlag);
+  info.interlaced = vuiPresent && vui.m_fieldSeqFlag;
+
+  // Pictures are fields with field_seq_flag
+  const double ticksPerFrame = info.interlaced ? 2 : 1;
+  if (vuiPresent && vui.m_timingInfo.m_timingInfoPresentFlag)
+    setTiming(info, vui.m_timingInfo.m_numUnitsInTick, vui.m_timingInfo.m_timeScale, ticksPerFrame);
+  else if (vps && vps->m_timingInfo.m_timingInfoPresentFlag)
+    setTiming(info, vps->m_timingInfo.m_numUnitsInTick, vps->m_timingInfo.m_timeScale, ticksPerFrame);
+}
+
+static void fillH266(const vvc::SPS &sps, media_info &info)
+{
+  // Conformance window offsets are coded in chroma samples
+  static const uint32_t subWidthC[vvc::NUM_CHROMA_FORMAT] = {1, 2, 2, 1};
+  static const uint32_t subHeightC[vvc::NUM_CHROMA_FORMAT] = {1, 2, 1, 1};
+  const int chroma = static_cast<int>(sps.m_chromaFormatIdc) & 3;
+  const vvc::Window &conf = sps.m_conformanceWindow;
+  info.codedWidth = sps.m_maxWidthInLumaSamples;
+  info.codedHeight = sps.m_maxHeightInLumaSamples;
+  info.width = info.codedWidth - subWidthC[chroma] * (conf.m_winLeftOffset + conf.m_winRightOffset);
+  info.height = info.codedHeight - subHeightC[chroma] * (conf.m_winTopOffset + conf.m_winBottomOffset);
+  info.bitDepthLuma = sps.m_bitDepths.recon[vvc::CHANNEL_TYPE_LUMA];
+  info.bitDepthChroma = sps.m_bitDepths.recon[vvc::CHANNEL_TYPE_CHROMA];
+  info.chromaFormatIdc = chroma;
+  info.interlaced = sps.m_fieldSeqFlag;
+
+  if (sps.m_ptlDpbHrdParamsPresentFlag)
+  {
+    // general_level_idc is major_level * 16 + minor_level * 3
+    const vvc::ProfileTierLevel &ptl = sps.m_profileTierLevel;
+    const int levelIdc = static_cast<int>(ptl.m_levelIdc);
+    info.profileIdc = static_cast<int>(ptl.m_profileIdc);
+    setLevel(info, levelIdc, levelIdc / 16 + (levelIdc % 16) / 3 / 10.0);
+    info.highTier = ptl.m_tierFlag == vvc::Level::HIGH;
+    if (sps.m_generalHrdParametersPresentFlag)
+      setTiming(info, sps.m_generalHrdParams.m_numUnitsInTick, sps.m_generalHrdParams.m_timeScale, info.interlaced ? 2 : 1);
+  }
+
+  const vvc::VUI &vui = sps.m_vuiParameters;
+  const bool colour = sps.m_vuiParametersPresentFlag && vui.m_colourDescriptionPresentFlag;
+  setColour(info, colour, vui.m_colourPrimaries, vui.m_transferCharacteristics, vui.m_matrixCoefficients, colour && vui.m_videoFullRangeFlag);
+}
+
+static uint32_t readBytes(const uint8_t *p, int n)
+{
+  uint32_t value = 0;
+  for (int i = 0; i < n; i++)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+// Mastering display colour volume and content light level SEI messages, same payload syntax in every codec
+static void readHdrSei(const NALParse &parser, media_info &info)
+{
+  size_t pos = 0;
+  sei_view sei;
+  while (NextSeiMessage(parser.rbsp(), parser.rbspSize(), pos, sei))
+  {
+    if (sei.payloadType == SEI::MASTERING_DISPLAY_COLOUR_VOLUME && sei.payloadSize >= 24)
+    {
+      info.masteringDisplay = true;
+      info.maxDisplayLuminance = readBytes(sei.payload + 16, 4);
+      info.minDisplayLuminance = readBytes(sei.payload + 20, 4);
+    }
+    else if (sei.payloadType == SEI::CONTENT_LIGHT_LEVEL_INFO && sei.payloadSize >= 4)
+    {
+      info.contentLightLevel = true;
+      info.maxContentLightLevel = static_cast<uint16_t>(readBytes(sei.payload, 2));
+      info.maxPicAverageLightLevel = static_cast<uint16_t>(readBytes(sei.payload + 2, 2));
+    }
+  }
+}
+
+// Returns true when the probe is complete
+static bool probeNal(media_probe_state &state, media_info &info)
+{
+  const nal_info &nal = *state.parser.nal;
+  const param_set &ps = nal.mpegParamSet;
+  const int type = nal.nal_unit_type;
+
+  const bool sps = NALParse::nal_is_sps(state.codecType, type);
+  const bool pps = NALParse::nal_is_pps(state.codecType, type);
+  const bool vps = NALParse::nal_is_vps(state.codecType, type);
+  const bool vcl = NALParse::nal_is_vcl(state.codecType, type);
+  bool irap = NALParse::nal_is_irap(state.codecType, type);
+  bool sei = false;
+  if (state.codecType == videoCodecType::H264_AVC)
+  {
+    sei = type == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SEI);
+    irap = irap || (vcl && state.recovery);
+  }
+  else if (state.codecType == videoCodecType::H265_HEVC)
+  {
+    sei = type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI) || type == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI);
+  }
+  else
+  {
+    sei = type == vvc::NAL_UNIT_PREFIX_SEI || type == vvc::NAL_UNIT_SUFFIX_SEI;
+    irap = irap || type == vvc::NAL_UNIT_CODED_SLICE_GDR;
+  }
+
+  // The first SPS of the base layer describes the stream
+  if (sps && !info.valid && nal.nuh_layer_id == 0 && ps.sps)
+  {
+    if (state.codecType == videoCodecType::H264_AVC)
+      fillH264(*static_cast<const avc::sps *>(ps.sps), info);
+    else if (state.codecType == videoCodecType::H265_HEVC)
+      fillH265(*static_cast<const hevc::sps *>(ps.sps), static_cast<const hevc::vps *>(ps.vps), info);
+    else
+    {
+      const vvc::SPS &vvcSps = *static_cast<const vvc::SPS *>(ps.sps);
+      fillH266(vvcSps, info);
+      state.needVps = vvcSps.m_VPSId != 0;
+    }
+    info.valid = true;
+  }
+  state.pps |= pps && info.valid;
+  state.vps |= vps;
+  if (sei)
+  {
+    readHdrSei(state.parser, info);
+    for (size_t i = 0; i < nal.sei_types.size(); i++)
+      state.recovery |= nal.sei_types[i] == SEI::RECOVERY_POINT;
+  }
+  return vcl && irap && info.valid && state.pps && (state.vps || !state.needVps);
+}
+
+// Parse the NAL units of [0, size), returns true as soon as the probe is complete
+static bool probeBuffer(media_probe_state &state, unsigned char *buffer, int size, media_info &info)
+{
+  int nextNalPos = 0;
+  while (nextNalPos < size)
+  {
+    const int nalPos = nextNalPos;
+    state.parser.nal_parse(buffer, state.codecType, nextNalPos, size, parsingLevel::PARSING_FULL);
+    if (nextNalPos <= nalPos)
+      break;
+    if (probeNal(state, info))
+      return true;
+  }
+  return false;
+}
+
+static void initMediaInfo(media_info &info, videoCodecType codecType)
+{
+  info = media_info();
+  info.codecType = codecType;
+  info.colourPrimaries = info.transferCharacteristics = info.matrixCoefficients = 2;
+}
+
+bool ProbeMediaInfo(const uint8_t *data, size_t size, media_info &info, videoCodecType codecType)
+{
+  codec_probe probe;
+  if (codecType == videoCodecType::UNDEFINED)
+    codecType = DetectCodec(data, size, probe);
+  initMediaInfo(info, codecType);
+  if (codecType == videoCodecType::UNDEFINED || !data)
+    return false;
+
+  // The parsers only read the buffer : the constness is dropped for their interfaces
+  media_probe_state state = {};
+  state.codecType = codecType;
+  info.complete = probeBuffer(state, const_cast<unsigned char *>(data), static_cast<int>(size), info);
+  info.bytesRead = size;
+  return info.valid;
+}
+
+bool ProbeMediaInfo(const char *streamPath, media_info &info, videoCodecType codecType, uint64_t maxBytes)
+{
+  static const size_t PROBE_CHUNK = 64 << 10;
+
+  initMediaInfo(info, codecType);
+  FILE *fp = fopen(streamPath, "rb");
+  if (!fp)
+    return false;
+
+  media_probe_state state = {};
+  state.codecType = codecType;
+  std::vector<unsigned char> buf;
+  size_t pending = 0; // Bytes at the start of buf not parsed yet
+  bool last = false;
+  while (!last && !info.complete && info.bytesRead < maxBytes)
+  {
+    const size_t chunk = static_cast<size_t>(std::min<uint64_t>(PROBE_CHUNK, maxBytes - info.bytesRead));
+    buf.resize(pending + chunk + 4);
+    const size_t got = fread(buf.data() + pending, 1, chunk, fp);
+    info.bytesRead += got;
+    last = got < chunk || info.bytesRead >= maxBytes;
+    const size_t len = pending + got;
+    memset(buf.data() + len, 0, 4);
+
+    if (state.codecType == videoCodecType::UNDEFINED)
+    {
+      codec_probe probe;
+      if (DetectCodec(buf.data(), len, probe) == videoCodecType::UNDEFINED)
+        break;
+      state.codecType = info.codecType = probe.codecType;
+    }
+
+    // Stop at the last start code so that nal_parse() never sees a truncated NAL unit
+    size_t seqSize = len;
+    if (!last)
+    {
+      seqSize = 0;
+      for (size_t i = len - 3; i > 0; i--)
+      {
+        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+        {
+          seqSize = (buf[i - 1] == 0) ? i - 1 : i;
+          break;
+        }
+      }
+    }
+    info.complete = seqSize > 0 && probeBuffer(state, buf.data(), static_cast<int>(seqSize), info);
+    memmove(buf.data(), buf.data() + seqSize, len - seqSize);
+    pending = len - seqSize;
+  }
+  fclose(fp);
+  return info.valid;
+}
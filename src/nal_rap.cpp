@@ -0,0 +1,179 @@
+#include "nal_rap.h"
+
+RapClassifier::RapClassifier(videoCodecType codecType, parsingLevel level)
+{
+  m_codecType = codecType;
+  m_slicePrefix = (level >= parsingLevel::PARSING_SLICE_PREFIX);
+  clear();
+}
+
+RapClassifier::~RapClassifier()
+{
+}
+
+void RapClassifier::clear()
+{
+  m_nalIndex = 0;
+  m_inPicture = false;
+  m_lastVclNalUnitType = -1;
+  m_lastIdrPicId = -1;
+  m_auStartValid = false;
+  m_auStartPosition = 0;
+  m_auStartNalIndex = 0;
+  m_pendingRecoveryPoint = false;
+  m_pendingDrap = false;
+  m_pendingEdrap = false;
+  m_recoveryPoint = SEIRecoveryPoint{};
+  m_points.clear();
+}
+
+bool RapClassifier::startsPicture(const nal_info &nal) const
+{
+  if (!m_inPicture)
+    return true;
+
+  // Without slice headers : following slices of the same picture have the NAL unit type of the first one
+  if (!m_slicePrefix)
+    return nal.nal_unit_type != m_lastVclNalUnitType;
+
+  if (m_codecType == videoCodecType::H264_AVC)
+    return nal.slice.firstSliceInPic || (nal.slice.idrPicId >= 0 && nal.slice.idrPicId != m_lastIdrPicId);
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return nal.slice.firstSliceInPic;
+  if (m_codecType == videoCodecType::H266_VVC)
+    return nal.slice.picHeaderInSliceHeader; // Otherwise a picture header NAL unit opened the picture
+  return false;
+}
+
+rapType RapClassifier::classifyVcl(int nalUnitType) const
+{
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_IDR))
+      return rapType::RAP_IDR;
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    switch (static_cast<hevc::hevc_nal_type>(nalUnitType))
+    {
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_LP:
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_W_RADL:
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_BLA_N_LP:
+      return rapType::RAP_BLA;
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_W_RADL:
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_IDR_N_LP:
+      return rapType::RAP_IDR;
+    case hevc::hevc_nal_type::NAL_UNIT_CODED_SLICE_CRA:
+      return rapType::RAP_CRA;
+    default:
+      break;
+    }
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    switch (nalUnitType)
+    {
+    case vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL:
+    case vvc::NAL_UNIT_CODED_SLICE_IDR_N_LP:
+      return rapType::RAP_IDR;
+    case vvc::NAL_UNIT_CODED_SLICE_CRA:
+      return rapType::RAP_CRA;
+    case vvc::NAL_UNIT_CODED_SLICE_GDR:
+      return rapType::RAP_GDR;
+    default:
+      break;
+    }
+  }
+  return rapType::RAP_NONE;
+}
+
+void RapClassifier::collectSei(const nal_info &nal)
+{
+  for (size_t i = 0; i < nal.sei_types.size(); i++)
+  {
+    const int payloadType = nal.sei_types[i];
+    if (payloadType == SEI::RECOVERY_POINT)
+    {
+      m_pendingRecoveryPoint = true;
+      m_recoveryPoint = nal.mpegCommonSEI.common_sei_rp;
+    }
+    else if (m_codecType != videoCodecType::H264_AVC && payloadType == SEI::DEPENDENT_RAP_INDICATION)
+    {
+      m_pendingDrap = true;
+    }
+    else if (m_codecType == videoCodecType::H266_VVC && payloadType == SEI::EXTENDED_DRAP_INDICATION)
+    {
+      m_pendingEdrap = true;
+    }
+  }
+}
+
+rapType RapClassifier::push(const nal_info &nal, int64_t position)
+{
+  const uint64_t nalIndex = m_nalIndex++;
+  const int nalUnitType = nal.nal_unit_type;
+
+  if (!NALParse::nal_is_vcl(m_codecType, nalUnitType))
+  {
+    if (NALParse::nal_is_suffix(m_codecType, nalUnitType))
+      return rapType::RAP_NONE;
+
+    if (!m_auStartValid)
+    {
+      m_auStartValid = true;
+      m_auStartPosition = position;
+      m_auStartNalIndex = nalIndex;
+    }
+    m_inPicture = false;
+    collectSei(nal);
+    return rapType::RAP_NONE;
+  }
+
+  // Following slices of the same picture
+  if (!startsPicture(nal))
+    return rapType::RAP_NONE;
+  m_inPicture = true;
+  m_lastVclNalUnitType = nalUnitType;
+  m_lastIdrPicId = (m_codecType == videoCodecType::H264_AVC && m_slicePrefix) ? nal.slice.idrPicId : -1;
+
+  rap_point point;
+  point.position = m_auStartValid ? m_auStartPosition : position;
+  point.nalIndex = m_auStartValid ? m_auStartNalIndex : nalIndex;
+  point.type = classifyVcl(nalUnitType);
+  point.recoveryPocCnt = 0;
+  point.exactMatch = true;
+  point.brokenLink = (point.type == rapType::RAP_BLA);
+
+  if (point.type == rapType::RAP_GDR)
+  {
+    // ph_recovery_poc_cnt of the picture header, kept in the slice prefix with parsingLevel::PARSING_SLICE_PREFIX
+    point.recoveryPocCnt = (m_slicePrefix && nal.slice.valid) ? nal.slice.recoveryPocCnt : -1;
+  }
+  else if (point.type == rapType::RAP_NONE)
+  {
+    if (m_pendingRecoveryPoint)
+    {
+      point.type = rapType::RAP_RECOVERY_POINT;
+      point.recoveryPocCnt = m_recoveryPoint.recoveryPocCnt;
+      point.exactMatch = m_recoveryPoint.exactMatchingFlag;
+      point.brokenLink = m_recoveryPoint.brokenLinkFlag;
+    }
+    else if (m_pendingEdrap)
+    {
+      point.type = rapType::RAP_EDRAP;
+    }
+    else if (m_pendingDrap)
+    {
+      point.type = rapType::RAP_DRAP;
+    }
+  }
+
+  m_auStartValid = false;
+  m_pendingRecoveryPoint = false;
+  m_pendingDrap = false;
+  m_pendingEdrap = false;
+
+  if (point.type != rapType::RAP_NONE)
+    m_points.push_back(point);
+  return point.type;
+}
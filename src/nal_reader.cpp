@@ -0,0 +1,437 @@
+#include "nal_reader.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+static const size_t READ_ALIGNMENT = 4096;
+
+#ifdef HAVE_IO_URING
+// Submission and completion rings of io_uring, used through the raw system calls (no liburing dependency)
+struct AsyncFileReader::uring_queue
+{
+  int fd;
+  void *sqRing;
+  void *cqRing;
+  size_t sqRingSize;
+  size_t cqRingSize;
+  io_uring_sqe *sqes;
+  size_t sqesSize;
+
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  io_uring_cqe *cqes;
+};
+#else
+struct AsyncFileReader::uring_queue
+{
+};
+#endif
+
+AsyncFileReader::AsyncFileReader(size_t bufferSize, unsigned depth, unsigned threads)
+{
+  m_bufferSize = ((bufferSize ? bufferSize : READ_BUFFER_SIZE) + READ_ALIGNMENT - 1) / READ_ALIGNMENT * READ_ALIGNMENT;
+  m_depth = depth ? depth : 1;
+  m_threads = threads ? threads : (m_depth < 4 ? m_depth : 4);
+  m_fd = -1;
+  m_size = 0;
+  m_numReads = 0;
+  m_slots = NULL;
+  m_uring = NULL;
+  m_claimSequence.store(0, std::memory_order_relaxed);
+  m_stop.store(false, std::memory_order_relaxed);
+  m_error.store(false, std::memory_order_relaxed);
+  m_acquireSequence = 0;
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+  close();
+}
+
+bool AsyncFileReader::open(const char *streamPath, bool direct, bool useUring)
+{
+  close();
+#ifdef O_DIRECT
+  m_fd = direct ? ::open(streamPath, O_RDONLY | O_DIRECT) : -1;
+#else
+  m_fd = -1;
+#endif
+  if (m_fd < 0)
+    m_fd = ::open(streamPath, O_RDONLY);
+  if (m_fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0)
+  {
+    close();
+    return false;
+  }
+  m_size = static_cast<uint64_t>(st.st_size);
+  m_numReads = (m_size + m_bufferSize - 1) / m_bufferSize;
+#ifdef POSIX_FADV_SEQUENTIAL
+  if (!direct)
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  m_slots = new slot[m_depth];
+  for (unsigned i = 0; i < m_depth; i++)
+  {
+    void *data = NULL;
+    if (posix_memalign(&data, READ_ALIGNMENT, m_bufferSize + READ_ALIGNMENT) != 0)
+    {
+      close();
+      return false;
+    }
+    m_buffers.push_back(static_cast<unsigned char *>(data));
+    m_slots[i].data = static_cast<unsigned char *>(data);
+    m_slots[i].size = 0;
+    m_slots[i].length = 0;
+    m_slots[i].offset = 0;
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    m_slots[i].state.store(SLOT_FREE, std::memory_order_relaxed);
+  }
+
+  m_stop.store(false, std::memory_order_relaxed);
+  m_error.store(false, std::memory_order_relaxed);
+  m_claimSequence.store(0, std::memory_order_relaxed);
+  m_acquireSequence = 0;
+  if (useUring && setupUring())
+    m_workers.push_back(std::thread(&AsyncFileReader::uringLoop, this));
+  else
+  {
+    for (unsigned i = 0; i < m_threads; i++)
+      m_workers.push_back(std::thread(&AsyncFileReader::preadLoop, this));
+  }
+  return true;
+}
+
+void AsyncFileReader::close()
+{
+  m_stop.store(true, std::memory_order_release);
+  for (size_t i = 0; i < m_workers.size(); i++)
+    m_workers[i].join();
+  m_workers.clear();
+
+#ifdef HAVE_IO_URING
+  if (m_uring)
+  {
+    munmap(m_uring->sqes, m_uring->sqesSize);
+    if (m_uring->cqRing != m_uring->sqRing)
+      munmap(m_uring->cqRing, m_uring->cqRingSize);
+    munmap(m_uring->sqRing, m_uring->sqRingSize);
+    ::close(m_uring->fd);
+    delete m_uring;
+    m_uring = NULL;
+  }
+#endif
+  for (size_t i = 0; i < m_buffers.size(); i++)
+    free(m_buffers[i]);
+  m_buffers.clear();
+  delete[] m_slots;
+  m_slots = NULL;
+  if (m_fd >= 0)
+    ::close(m_fd);
+  m_fd = -1;
+  m_size = 0;
+  m_numReads = 0;
+  m_carry.clear();
+}
+
+#ifdef HAVE_IO_URING
+bool AsyncFileReader::setupUring()
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int fd = static_cast<int>(syscall(__NR_io_uring_setup, m_depth, &params));
+  if (fd < 0)
+    return false;
+
+  // IORING_OP_READ needs Linux 5.6, older kernels fall back to the pread workers
+  std::vector<uint64_t> probeData((sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op) + 7) / 8, 0);
+  io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(probeData.data());
+  if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0 || probe->last_op < IORING_OP_READ ||
+      !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  uring_queue *q = new uring_queue;
+  q->fd = fd;
+  q->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  q->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    q->sqRingSize = q->cqRingSize = q->sqRingSize > q->cqRingSize ? q->sqRingSize : q->cqRingSize;
+  q->sqRing = mmap(NULL, q->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  q->cqRing = q->sqRing;
+  if (q->sqRing != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+    q->cqRing = mmap(NULL, q->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  q->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  q->sqes = static_cast<io_uring_sqe *>(mmap(NULL, q->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+  if (q->sqRing == MAP_FAILED || q->cqRing == MAP_FAILED || q->sqes == MAP_FAILED)
+  {
+    if (q->sqes != MAP_FAILED)
+      munmap(q->sqes, q->sqesSize);
+    if (q->cqRing != MAP_FAILED && q->cqRing != q->sqRing)
+      munmap(q->cqRing, q->cqRingSize);
+    if (q->sqRing != MAP_FAILED)
+      munmap(q->sqRing, q->sqRingSize);
+    ::close(fd);
+    delete q;
+    return false;
+  }
+
+  unsigned char *sq = static_cast<unsigned char *>(q->sqRing);
+  unsigned char *cq = static_cast<unsigned char *>(q->cqRing);
+  q->sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  q->sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  q->sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  q->cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  q->cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  q->cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  q->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  m_uring = q;
+  return true;
+}
+
+void AsyncFileReader::finishSlot(slot &s, bool ok)
+{
+  if (!ok)
+  {
+    s.size = 0;
+    m_error.store(true, std::memory_order_release);
+  }
+  memset(s.data + s.size, 0, READ_BUFFER_PADDING);
+  s.state.store(SLOT_FILLED, std::memory_order_release);
+}
+
+void AsyncFileReader::uringLoop()
+{
+  uring_queue &q = *m_uring;
+  uint64_t submitSequence = 0;
+  unsigned inFlight = 0;
+  unsigned spins = 0;
+  for (;;)
+  {
+    // Queue a read for every released slot, in file order, plus the remainders of short reads
+    unsigned tail = *q.sqTail;
+    unsigned toSubmit = 0;
+    const bool stop = m_stop.load(std::memory_order_acquire);
+    while (!stop && submitSequence < m_numReads)
+    {
+      slot &s = m_slots[submitSequence % m_depth];
+      if (s.state.load(std::memory_order_acquire) != SLOT_FREE || s.sequence.load(std::memory_order_acquire) != submitSequence)
+        break;
+      s.offset = submitSequence * m_bufferSize;
+      s.length = static_cast<size_t>(m_size - s.offset < m_bufferSize ? m_size - s.offset : m_bufferSize);
+      s.size = 0;
+      s.state.store(SLOT_READING, std::memory_order_relaxed);
+
+      const unsigned index = tail & *q.sqMask;
+      io_uring_sqe &sqe = q.sqes[index];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = m_fd;
+      sqe.addr = reinterpret_cast<uint64_t>(s.data);
+      sqe.len = static_cast<uint32_t>((s.length + READ_ALIGNMENT - 1) / READ_ALIGNMENT * READ_ALIGNMENT);
+      sqe.off = s.offset;
+      sqe.user_data = submitSequence % m_depth;
+      q.sqArray[index] = index;
+      tail++;
+      toSubmit++;
+      submitSequence++;
+    }
+    __atomic_store_n(q.sqTail, tail, __ATOMIC_RELEASE);
+
+    if (!toSubmit && !inFlight)
+    {
+      if (stop || submitSequence >= m_numReads)
+        return;
+      backoff(spins); // Every slot is held by the consumer
+      continue;
+    }
+    spins = 0;
+
+    // Wait for one completion when nothing else can be queued
+    const unsigned waitFor = inFlight + toSubmit > 0 && toSubmit == 0 ? 1 : 0;
+    if (syscall(__NR_io_uring_enter, q.fd, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, NULL, 0) < 0 && errno != EINTR)
+    {
+      m_error.store(true, std::memory_order_release);
+      return;
+    }
+    inFlight += toSubmit;
+
+    unsigned head = *q.cqHead;
+    const unsigned cqTail = __atomic_load_n(q.cqTail, __ATOMIC_ACQUIRE);
+    unsigned resubmit = 0;
+    for (; head != cqTail; head++)
+    {
+      const io_uring_cqe &cqe = q.cqes[head & *q.cqMask];
+      slot &s = m_slots[cqe.user_data];
+      inFlight--;
+      if (cqe.res < 0 || (cqe.res == 0 && s.size < s.length))
+      {
+        finishSlot(s, false);
+        continue;
+      }
+      s.size += static_cast<size_t>(cqe.res);
+      if (s.size >= s.length || stop)
+      {
+        s.size = s.size < s.length ? s.size : s.length;
+        finishSlot(s, s.size == s.length);
+        continue;
+      }
+
+      // Short read : the remainder is read into the same slot
+      const unsigned index = (*q.sqTail + resubmit) & *q.sqMask;
+      io_uring_sqe &sqe = q.sqes[index];
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = m_fd;
+      sqe.addr = reinterpret_cast<uint64_t>(s.data + s.size);
+      sqe.len = static_cast<uint32_t>(s.length - s.size);
+      sqe.off = s.offset + s.size;
+      sqe.user_data = cqe.user_data;
+      q.sqArray[index] = index;
+      resubmit++;
+    }
+    __atomic_store_n(q.cqHead, head, __ATOMIC_RELEASE);
+    if (resubmit)
+    {
+      __atomic_store_n(q.sqTail, *q.sqTail + resubmit, __ATOMIC_RELEASE);
+      if (syscall(__NR_io_uring_enter, q.fd, resubmit, 0, 0, NULL, 0) < 0)
+      {
+        m_error.store(true, std::memory_order_release);
+        return;
+      }
+      inFlight += resubmit;
+    }
+  }
+}
+
+#else
+// Built without io_uring : the pread workers read
+bool AsyncFileReader::setupUring()
+{
+  return false;
+}
+
+void AsyncFileReader::uringLoop()
+{
+}
+#endif
+
+bool AsyncFileReader::readSlot(slot &s)
+{
+  while (s.size < s.length)
+  {
+    // Whole blocks are requested for direct I/O, the last one ends at the end of the file
+    const size_t request = (s.length - s.size + READ_ALIGNMENT - 1) / READ_ALIGNMENT * READ_ALIGNMENT;
+    const ssize_t got = pread(m_fd, s.data + s.size, request, static_cast<off_t>(s.offset + s.size));
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return false;
+    s.size += static_cast<size_t>(got);
+  }
+  s.size = s.length;
+  return true;
+}
+
+void AsyncFileReader::preadLoop()
+{
+  unsigned spins = 0;
+  while (!m_stop.load(std::memory_order_acquire))
+  {
+    uint64_t sequence = m_claimSequence.load(std::memory_order_acquire);
+    if (sequence >= m_numReads)
+      return;
+    slot &s = m_slots[sequence % m_depth];
+    if (s.state.load(std::memory_order_acquire) != SLOT_FREE || s.sequence.load(std::memory_order_acquire) != sequence)
+    {
+      backoff(spins);
+      continue;
+    }
+    if (!m_claimSequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acq_rel))
+      continue;
+    spins = 0;
+
+    s.state.store(SLOT_READING, std::memory_order_relaxed);
+    s.offset = sequence * m_bufferSize;
+    s.length = static_cast<size_t>(m_size - s.offset < m_bufferSize ? m_size - s.offset : m_bufferSize);
+    s.size = 0;
+    finishSlot(s, readSlot(s));
+  }
+}
+
+bool AsyncFileReader::acquire(read_buffer &buffer)
+{
+  if (!m_slots || m_acquireSequence >= m_numReads)
+    return false;
+
+  slot &s = m_slots[m_acquireSequence % m_depth];
+  unsigned spins = 0;
+  while (s.state.load(std::memory_order_acquire) != SLOT_FILLED || s.sequence.load(std::memory_order_relaxed) != m_acquireSequence)
+  {
+    if (m_error.load(std::memory_order_acquire) || m_workers.empty())
+      return false;
+    backoff(spins);
+  }
+  if (m_error.load(std::memory_order_acquire))
+    return false;
+
+  buffer.data = s.data;
+  buffer.size = s.size;
+  buffer.offset = s.offset;
+  buffer.sequence = m_acquireSequence++;
+  return true;
+}
+
+void AsyncFileReader::release(const read_buffer &buffer)
+{
+  slot &s = m_slots[buffer.sequence % m_depth];
+  s.sequence.store(buffer.sequence + m_depth, std::memory_order_relaxed);
+  s.state.store(SLOT_FREE, std::memory_order_release);
+}
+
+void AsyncFileReader::backoff(unsigned &spins)
+{
+  // Spin, then yield, then sleep : waits are short while the other side runs, long only when it is stalled
+  if (++spins < 64)
+    return;
+  if (spins < 128)
+  {
+    std::this_thread::yield();
+    return;
+  }
+  struct timespec ts = {0, 50000};
+  nanosleep(&ts, NULL);
+}
+
+size_t AsyncFileReader::lastStartCode(const unsigned char *data, size_t size, size_t from)
+{
+  for (size_t i = size - 3; size >= 3 && i > from; i--)
+  {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+    {
+      const size_t pos = (data[i - 1] == 0) ? i - 1 : i;
+      return pos > from ? pos : from;
+    }
+  }
+  return from;
+}
@@ -0,0 +1,512 @@
+#include "nal_rtp.h"
+
+#include <algorithm>
+
+static uint16_t Read16(const uint8_t *p)
+{
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// Packet types of the payload formats, in the NAL unit type field of the payload header
+static const int RTP_H264_STAP_A = 24;
+static const int RTP_H264_STAP_B = 25;
+static const int RTP_H264_MTAP16 = 26;
+static const int RTP_H264_MTAP24 = 27;
+static const int RTP_H264_FU_A = 28;
+static const int RTP_H264_FU_B = 29;
+static const int RTP_H265_AP = 48;
+static const int RTP_H265_FU = 49;
+static const int RTP_H265_PACI = 50;
+static const int RTP_H266_AP = 28;
+static const int RTP_H266_FU = 29;
+
+// Size of the start code counted in front of every NAL unit for the access unit offsets
+static const uint32_t RTP_START_CODE_SIZE = 4;
+
+// Sequence number validation of RFC 3550 A.1
+static const uint32_t RTP_SEQ_MOD = 1 << 16;
+static const uint32_t RTP_MAX_DROPOUT = 3000;
+static const uint32_t RTP_MAX_MISORDER = 100;
+
+RtpDepacketizer::RtpDepacketizer(videoCodecType codecType, parsingLevel level, int payloadType, bool donl)
+    : m_assembler(codecType, level)
+{
+  m_codecType = codecType;
+  m_level = level;
+  m_payloadType = payloadType;
+  m_donl = donl && codecType != videoCodecType::H264_AVC;
+  clear();
+}
+
+RtpDepacketizer::~RtpDepacketizer()
+{
+}
+
+void RtpDepacketizer::clear()
+{
+  m_parser = NALParse();
+  m_assembler.clear();
+  m_stats = rtp_stats{};
+  m_started = false;
+  m_ssrc = 0;
+  m_sequence = 0;
+  m_badSequence = RTP_SEQ_MOD + 1;
+  m_lastTimestamp = 0;
+  m_timestampWraps = 0;
+  m_timestamps.clear();
+  m_offset = 0;
+  m_inFragment = false;
+  m_fragmentCounted = false;
+  m_fragment.clear();
+  m_fragmentSize = 0;
+  m_fragmentNeeded = 0;
+}
+
+void RtpDepacketizer::push(const uint8_t *packet, size_t size, std::vector<access_unit> &aus)
+{
+  m_stats.packets++;
+
+  // RTP fixed header (RFC 3550 5.1), CSRC list, header extension and padding
+  if (size < 12 || (packet[0] >> 6) != 2 || (m_payloadType >= 0 && (packet[1] & 0x7f) != m_payloadType))
+  {
+    m_stats.invalid++;
+    return;
+  }
+  size_t header = 12 + 4 * static_cast<size_t>(packet[0] & 0x0f);
+  if (packet[0] & 0x10)
+  {
+    if (size < header + 4)
+    {
+      m_stats.invalid++;
+      return;
+    }
+    header += 4 + 4 * static_cast<size_t>(Read16(packet + header + 2));
+  }
+  size_t end = size;
+  if (packet[0] & 0x20)
+    end -= std::min(end, static_cast<size_t>(packet[size - 1]));
+  if (header >= end)
+  {
+    m_stats.invalid++;
+    return;
+  }
+
+  const bool marker = (packet[1] & 0x80) != 0;
+  const uint16_t sequence = Read16(packet + 2);
+  const uint32_t timestamp = Read32(packet + 4);
+  const uint32_t ssrc = Read32(packet + 8);
+  bool restart = !m_started || ssrc != m_ssrc;
+  if (!restart)
+  {
+    const uint16_t delta = static_cast<uint16_t>(sequence - m_sequence);
+    if (delta == 0 || delta > RTP_SEQ_MOD - RTP_MAX_MISORDER)
+    {
+      // Duplicated or reordered packet
+      m_stats.late++;
+      return;
+    }
+    if (delta >= RTP_MAX_DROPOUT)
+    {
+      // A very large jump : the source is taken as restarted only when the next packet follows this one
+      if (sequence != m_badSequence)
+      {
+        m_badSequence = (sequence + 1u) & (RTP_SEQ_MOD - 1);
+        m_stats.invalid++;
+        return;
+      }
+      restart = true;
+    }
+    else if (delta > 1)
+    {
+      m_stats.lost += delta - 1u;
+      if (m_inFragment)
+        m_stats.droppedNals++;
+      m_fragmentCounted = m_inFragment;
+      m_inFragment = false;
+    }
+  }
+  if (restart)
+  {
+    // New source or restarted sequence : its sequence numbers and time stamps start anywhere. The remaining fragments of
+    // the same source belong to the NAL unit counted here
+    if (m_inFragment)
+      m_stats.droppedNals++;
+    m_fragmentCounted = m_inFragment && m_started && ssrc == m_ssrc;
+    m_inFragment = false;
+    m_started = true;
+    m_ssrc = ssrc;
+    m_timestampWraps = 0;
+    m_lastTimestamp = timestamp;
+    m_timestamps.clear();
+  }
+  m_sequence = sequence;
+  m_badSequence = RTP_SEQ_MOD + 1;
+
+  // 32-bit time stamps are extended across their wrap-around
+  if (m_timestamps.empty() || timestamp != m_lastTimestamp)
+  {
+    if (timestamp < m_lastTimestamp && m_lastTimestamp - timestamp > 0x80000000u)
+      m_timestampWraps++;
+    m_lastTimestamp = timestamp;
+    rtp_timestamp ts = {m_offset, (m_timestampWraps << 32) | timestamp};
+    m_timestamps.push_back(ts);
+  }
+
+  payload(packet + header, end - header, aus);
+
+  // The marker bit is set on the last packet of an access unit
+  if (marker && !m_inFragment && m_assembler.flush())
+    complete(aus);
+}
+
+void RtpDepacketizer::flush(std::vector<access_unit> &aus)
+{
+  if (m_inFragment)
+    m_stats.droppedNals++;
+  m_inFragment = false;
+  if (m_assembler.flush())
+    complete(aus);
+}
+
+void RtpDepacketizer::parameterSet(const uint8_t *nal, uint32_t size)
+{
+  m_parser.nal_parse_unit(nal, size, m_codecType, m_level);
+}
+
+void RtpDepacketizer::payload(const uint8_t *data, size_t size, std::vector<access_unit> &aus)
+{
+  // A single NAL unit packet may hold the NAL unit header alone (end of sequence, end of bitstream)
+  const size_t headerSize = m_codecType == videoCodecType::H264_AVC ? 1 : 2;
+  if (size < headerSize)
+  {
+    m_stats.invalid++;
+    return;
+  }
+
+  int type = 0;
+  bool aggregationPacket = false, fragmentationUnit = false, unsupported = false;
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    type = data[0] & 0x1f;
+    aggregationPacket = type == RTP_H264_STAP_A;
+    fragmentationUnit = type == RTP_H264_FU_A;
+    unsupported = type == 0 || type == RTP_H264_STAP_B || type == RTP_H264_MTAP16 || type == RTP_H264_MTAP24 || type >= RTP_H264_FU_B;
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    type = (data[0] >> 1) & 0x3f;
+    aggregationPacket = type == RTP_H265_AP;
+    fragmentationUnit = type == RTP_H265_FU;
+    unsupported = type >= RTP_H265_PACI;
+  }
+  else
+  {
+    type = data[1] >> 3;
+    aggregationPacket = type == RTP_H266_AP;
+    fragmentationUnit = type == RTP_H266_FU;
+  }
+
+  // Aggregation packets and fragmentation units carry more than their payload header
+  if ((aggregationPacket || fragmentationUnit) && size <= headerSize)
+  {
+    m_stats.invalid++;
+    return;
+  }
+
+  if (!fragmentationUnit)
+    m_fragmentCounted = false;
+  if (unsupported)
+    m_stats.unsupported++;
+  else if (aggregationPacket)
+    aggregation(data, size, headerSize, aus);
+  else if (fragmentationUnit)
+    fragment(data, size, aus);
+  else if (m_donl)
+  {
+    // Single NAL unit packet : the DONL field sits between the NAL unit header and its payload
+    if (size < headerSize + 2)
+    {
+      m_stats.invalid++;
+      return;
+    }
+    const nal_buffer pieces[2] = {{data, static_cast<uint32_t>(headerSize)}, {data + headerSize + 2, static_cast<uint32_t>(size - headerSize - 2)}};
+    nalUnit(pieces, 2, static_cast<uint32_t>(size - 2), aus);
+  }
+  else
+  {
+    const nal_buffer piece = {data, static_cast<uint32_t>(size)};
+    nalUnit(&piece, 1, static_cast<uint32_t>(size), aus);
+  }
+}
+
+void RtpDepacketizer::aggregation(const uint8_t *data, size_t size, size_t headerSize, std::vector<access_unit> &aus)
+{
+  // STAP-A (RFC 6184 5.7.1) and AP (RFC 7798 4.4.2, RFC 9328 4.3.2) : 16-bit sizes, DONL then DOND with sprop-max-don-diff
+  const uint8_t *p = data + headerSize + (m_donl ? 2 : 0);
+  const uint8_t *end = data + size;
+  for (bool first = true; p < end; first = false)
+  {
+    if (m_donl && !first)
+      p++;
+    if (end - p < 2)
+      break;
+    const uint32_t length = Read16(p);
+    p += 2;
+    if (length == 0 || length > static_cast<uint32_t>(end - p))
+    {
+      m_stats.invalid++;
+      return;
+    }
+    const nal_buffer piece = {p, length};
+    nalUnit(&piece, 1, length, aus);
+    m_stats.aggregated++;
+    p += length;
+  }
+}
+
+void RtpDepacketizer::fragment(const uint8_t *data, size_t size, std::vector<access_unit> &aus)
+{
+  // FU-A (RFC 6184 5.8) and FU (RFC 7798 4.4.3, RFC 9328 4.3.3) : the NAL unit header is rebuilt from the payload header
+  // and the type of the FU header
+  uint8_t header[2] = {0, 0};
+  uint32_t headerSize = 2;
+  size_t skip = 3;
+  const uint8_t fuHeader = data[m_codecType == videoCodecType::H264_AVC ? 1 : 2];
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    header[0] = static_cast<uint8_t>((data[0] & 0xe0) | (fuHeader & 0x1f));
+    headerSize = 1;
+    skip = 2;
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    header[0] = static_cast<uint8_t>((data[0] & 0x81) | ((fuHeader & 0x3f) << 1));
+    header[1] = data[1];
+  }
+  else
+  {
+    header[0] = data[0];
+    header[1] = static_cast<uint8_t>((data[1] & 0x07) | ((fuHeader & 0x1f) << 3));
+  }
+  const bool start = (fuHeader & 0x80) != 0;
+  const bool end = (fuHeader & 0x40) != 0;
+  if (start && m_donl)
+    skip += 2;
+  if (size < skip)
+  {
+    m_stats.invalid++;
+    return;
+  }
+
+  if (start)
+  {
+    if (m_inFragment)
+      m_stats.droppedNals++;
+    m_inFragment = true;
+    m_fragmentCounted = false;
+    m_fragment.assign(header, header + headerSize);
+    m_fragmentSize = headerSize;
+    m_fragmentNeeded = NALParse::nal_bytes_needed(header, m_codecType, m_level);
+  }
+  else if (!m_inFragment)
+  {
+    // The start fragment was lost, counted once at the end fragment unless the gap already counted this NAL unit
+    if (end)
+    {
+      if (!m_fragmentCounted)
+        m_stats.droppedNals++;
+      m_fragmentCounted = false;
+    }
+    return;
+  }
+
+  // Slices keep only the bytes the parser reads, their size still counts the whole NAL unit
+  const uint32_t length = static_cast<uint32_t>(size - skip);
+  if (m_fragment.size() < m_fragmentNeeded)
+  {
+    const size_t take = std::min<size_t>(length, m_fragmentNeeded - m_fragment.size());
+    m_fragment.insert(m_fragment.end(), data + skip, data + skip + take);
+  }
+  m_fragmentSize += length;
+
+  if (end)
+  {
+    m_inFragment = false;
+    const nal_buffer piece = {m_fragment.data(), static_cast<uint32_t>(m_fragment.size())};
+    nalUnit(&piece, 1, m_fragmentSize, aus);
+    m_stats.fragmented++;
+  }
+}
+
+void RtpDepacketizer::nalUnit(const nal_buffer *fragments, size_t count, uint32_t fullSize, std::vector<access_unit> &aus)
+{
+  m_parser.nal_parse_scatter(fragments, count, m_codecType, m_level);
+  m_stats.nalUnits++;
+  if (m_parser.nal->nal_unit_type >= 0 && m_assembler.push(*m_parser.nal, static_cast<int64_t>(m_offset), RTP_START_CODE_SIZE + fullSize))
+    complete(aus);
+  m_offset += RTP_START_CODE_SIZE + fullSize;
+}
+
+void RtpDepacketizer::complete(std::vector<access_unit> &aus)
+{
+  aus.push_back(m_assembler.au());
+  access_unit &au = aus.back();
+
+  // Time stamp of the packet carrying the first NAL unit of the access unit, RTP has no decoding time stamp
+  while (m_timestamps.size() > 1 && m_timestamps[1].offset <= static_cast<uint64_t>(au.offset))
+    m_timestamps.pop_front();
+  if (!m_timestamps.empty() && m_timestamps.front().offset <= static_cast<uint64_t>(au.offset))
+    au.pts = m_timestamps.front().timestamp;
+}
+
+PcapRtpReader::PcapRtpReader()
+{
+  m_data = NULL;
+  m_size = 0;
+  m_pos = 0;
+  m_bigEndian = false;
+  m_linkType = 0;
+  m_udpPort = -1;
+}
+
+PcapRtpReader::~PcapRtpReader()
+{
+  close();
+}
+
+bool PcapRtpReader::open(const char *path, int udpPort)
+{
+  close();
+  if (!m_file.open(path, 0, fileAccess::ACCESS_SEQUENTIAL))
+    return false;
+  m_data = m_file.data();
+  m_size = m_file.size();
+  if (m_size < 24)
+  {
+    close();
+    return false;
+  }
+
+  // Global header : magic number of microsecond or nanosecond captures, written in either byte order
+  const uint32_t magic = Read32(m_data);
+  if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d)
+    m_bigEndian = true;
+  else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1)
+    m_bigEndian = false;
+  else
+  {
+    close();
+    return false;
+  }
+  m_linkType = read32(m_data + 20) & 0x0fffffff;
+  m_udpPort = udpPort;
+  m_pos = 24;
+  return true;
+}
+
+void PcapRtpReader::close()
+{
+  m_file.close();
+  m_data = NULL;
+  m_size = 0;
+  m_pos = 0;
+}
+
+uint32_t PcapRtpReader::read32(const uint8_t *p) const
+{
+  return m_bigEndian ? Read32(p) : (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[0];
+}
+
+bool PcapRtpReader::next(const uint8_t *&payload, size_t &size)
+{
+  // Record header : ts_sec, ts_usec, incl_len, orig_len
+  while (m_data && m_size - m_pos >= 16)
+  {
+    const uint32_t captured = read32(m_data + m_pos + 8);
+    if (captured > m_size - m_pos - 16)
+      return false;
+    const uint8_t *frame = m_data + m_pos + 16;
+    m_pos += 16 + captured;
+    if (udpPayload(frame, captured, payload, size))
+      return true;
+  }
+  return false;
+}
+
+bool PcapRtpReader::udpPayload(const uint8_t *frame, size_t size, const uint8_t *&payload, size_t &payloadSize) const
+{
+  // Link layer : Ethernet with VLAN tags, Linux cooked capture v1 / v2, BSD loopback or raw IP
+  size_t offset = 0;
+  int etherType = -1;
+  if (m_linkType == 1)
+  {
+    if (size < 14)
+      return false;
+    etherType = Read16(frame + 12);
+    offset = 14;
+    while ((etherType == 0x8100 || etherType == 0x88a8) && size >= offset + 4)
+    {
+      etherType = Read16(frame + offset + 2);
+      offset += 4;
+    }
+  }
+  else if (m_linkType == 113)
+  {
+    if (size < 16)
+      return false;
+    etherType = Read16(frame + 14);
+    offset = 16;
+  }
+  else if (m_linkType == 276)
+  {
+    if (size < 20)
+      return false;
+    etherType = Read16(frame);
+    offset = 20;
+  }
+  else if (m_linkType == 0)
+    offset = 4;
+  else if (m_linkType != 101 && m_linkType != 12 && m_linkType != 228 && m_linkType != 229)
+    return false;
+  if (size <= offset || (etherType >= 0 && etherType != 0x0800 && etherType != 0x86dd))
+    return false;
+
+  const uint8_t *ip = frame + offset;
+  const size_t ipSize = size - offset;
+  const uint8_t *udp = NULL;
+  size_t udpSize = 0;
+  if ((ip[0] >> 4) == 4)
+  {
+    // IPv4 : fragmented datagrams are skipped
+    const size_t headerLength = 4 * static_cast<size_t>(ip[0] & 0x0f);
+    if (ipSize < headerLength + 8 || ip[9] != 17 || (Read16(ip + 6) & 0x3fff) != 0)
+      return false;
+    const size_t totalLength = std::min<size_t>(ipSize, Read16(ip + 2));
+    if (totalLength < headerLength + 8)
+      return false;
+    udp = ip + headerLength;
+    udpSize = totalLength - headerLength;
+  }
+  else if ((ip[0] >> 4) == 6)
+  {
+    // IPv6 : UDP directly behind the fixed header
+    if (ipSize < 48 || ip[6] != 17)
+      return false;
+    udp = ip + 40;
+    udpSize = std::min<size_t>(ipSize - 40, Read16(ip + 4));
+  }
+  else
+    return false;
+
+  udpSize = std::min<size_t>(udpSize, Read16(udp + 4));
+  if (udpSize < 8 || (m_udpPort >= 0 && Read16(udp + 2) != m_udpPort))
+    return false;
+  payload = udp + 8;
+  payloadSize = udpSize - 8;
+  return true;
+}
@@ -0,0 +1,145 @@
+#include "nal_sample.h"
+#include "nal_probe.h"
+
+#include <algorithm>
+
+// Bytes handed to one nal_parse() / nal_resync() call, which count in int
+static const uint64_t SAMPLE_WINDOW = 1 << 30;
+// Zero page after the stream, read by the start code searches and nalUnitType()
+static const size_t SAMPLE_PADDING = 4096;
+
+StreamSampler::StreamSampler(videoCodecType codecType, parsingLevel level)
+{
+  m_codecType = codecType;
+  m_level = level;
+  m_data = NULL;
+  m_size = 0;
+  m_synced = false;
+  m_pos = 0;
+  m_syncOffset = 0;
+  m_nalOffset = 0;
+  m_nalSize = 0;
+  m_sps = false;
+  m_pps = false;
+}
+
+StreamSampler::~StreamSampler()
+{
+  close();
+}
+
+bool StreamSampler::open(const char *streamPath)
+{
+  close();
+  if (!m_file.open(streamPath, SAMPLE_PADDING, fileAccess::ACCESS_RANDOM))
+    return false;
+  m_data = m_file.data();
+  m_size = m_file.size();
+
+  if (m_codecType == videoCodecType::UNDEFINED)
+  {
+    codec_probe probe;
+    m_codecType = DetectCodec(m_data, m_size, probe);
+    if (m_codecType == videoCodecType::UNDEFINED)
+    {
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void StreamSampler::close()
+{
+  m_file.close();
+  m_data = NULL;
+  m_size = 0;
+  m_synced = false;
+  m_nalSize = 0;
+}
+
+int StreamSampler::nalUnitType(uint64_t pos) const
+{
+  // 'pos' is a start code found by nal_resync() or left by nal_parse(), the zero page covers the header bytes
+  const unsigned char *p = m_data + pos;
+  int i = 0;
+  while (i < 3 && p[i] == 0)
+    i++;
+  if (i < 2 || p[i] != 1)
+    return -1;
+  const unsigned char *header = p + i + 1;
+  if (m_codecType == videoCodecType::H264_AVC)
+    return header[0] & 0x1f;
+  if (m_codecType == videoCodecType::H265_HEVC)
+    return (header[0] >> 1) & 0x3f;
+  return header[1] >> 3;
+}
+
+bool StreamSampler::isSyncPoint(int nalUnitType) const
+{
+  return NALParse::nal_is_vps(m_codecType, nalUnitType) || NALParse::nal_is_sps(m_codecType, nalUnitType) ||
+         NALParse::nal_is_irap(m_codecType, nalUnitType) ||
+         (m_codecType == videoCodecType::H266_VVC && nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR);
+}
+
+bool StreamSampler::seek(uint64_t offset, uint64_t maxScan)
+{
+  m_parser = NALParse();
+  m_synced = false;
+  m_sps = false;
+  m_pps = false;
+  m_nalSize = 0;
+  if (!m_data || offset >= m_size)
+    return false;
+
+  const uint64_t end = offset + std::min(maxScan, m_size - offset);
+  uint64_t pos = offset;
+  while (pos < end)
+  {
+    const int window = static_cast<int>(std::min(end - pos, SAMPLE_WINDOW));
+    int next = 0;
+    if (!m_parser.nal_resync(m_data + pos, next, window))
+    {
+      // A start code may straddle two windows
+      if (pos + window >= end)
+        break;
+      pos += window - 3;
+      continue;
+    }
+
+    const uint64_t nalPos = pos + next;
+    if (isSyncPoint(nalUnitType(nalPos)))
+    {
+      m_pos = nalPos;
+      m_syncOffset = nalPos;
+      m_synced = true;
+      return true;
+    }
+    pos = nalPos + 3;
+  }
+  return false;
+}
+
+bool StreamSampler::next()
+{
+  if (!m_synced || m_pos >= m_size)
+    return false;
+
+  const int type = nalUnitType(m_pos);
+  const bool sps = NALParse::nal_is_sps(m_codecType, type);
+  const bool pps = NALParse::nal_is_pps(m_codecType, type);
+
+  // A PPS is parsed against the SPS, which is unknown before the first SPS of the sample
+  int nextNalPos = 0;
+  const int window = static_cast<int>(std::min(m_size - m_pos, SAMPLE_WINDOW));
+  m_parser.nal_parse(m_data + m_pos, m_codecType, nextNalPos, window, pps && !m_sps ? parsingLevel::PARSING_NONE : m_level);
+  if (nextNalPos <= 0)
+    return false;
+
+  m_nalOffset = m_pos;
+  m_nalSize = static_cast<uint32_t>(nextNalPos);
+  m_pos += static_cast<uint64_t>(nextNalPos);
+  m_sps |= sps;
+  m_pps |= pps && m_sps;
+  return true;
+}
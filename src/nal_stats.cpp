@@ -0,0 +1,212 @@
+#include "nal_stats.h"
+
+#include <cmath>
+#include <climits>
+
+static const int64_t NO_BUCKET = LLONG_MIN;
+
+NalStatistics::NalStatistics(videoCodecType codecType, double windowSeconds)
+{
+  m_codecType = codecType;
+  m_bucketSeconds = (windowSeconds > 0 ? windowSeconds : 1.0) / NUM_BUCKETS;
+  clear();
+}
+
+NalStatistics::~NalStatistics()
+{
+}
+
+void NalStatistics::clear()
+{
+  // Not safe against concurrent readers : call before sharing the object
+  m_sequence.store(0, std::memory_order_relaxed);
+  m_total.count.store(0, std::memory_order_relaxed);
+  m_total.bytes.store(0, std::memory_order_relaxed);
+  for (int i = 0; i < MAX_NAL_TYPES; i++)
+  {
+    m_byType[i].count.store(0, std::memory_order_relaxed);
+    m_byType[i].bytes.store(0, std::memory_order_relaxed);
+    for (int t = 0; t < MAX_TLAYER; t++)
+    {
+      m_byTypeAndTemporalId[i][t].count.store(0, std::memory_order_relaxed);
+      m_byTypeAndTemporalId[i][t].bytes.store(0, std::memory_order_relaxed);
+    }
+  }
+  for (int i = 0; i < NUM_CATEGORIES; i++)
+  {
+    m_byCategory[i].count.store(0, std::memory_order_relaxed);
+    m_byCategory[i].bytes.store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < MAX_TLAYER; i++)
+  {
+    m_byTemporalId[i].count.store(0, std::memory_order_relaxed);
+    m_byTemporalId[i].bytes.store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < MAX_LAYERS; i++)
+  {
+    m_byLayer[i].count.store(0, std::memory_order_relaxed);
+    m_byLayer[i].bytes.store(0, std::memory_order_relaxed);
+  }
+  for (int b = 0; b < NUM_BUCKETS; b++)
+    for (int i = 0; i < MAX_NAL_TYPES; i++)
+      m_bucketBytes[b][i].store(0, std::memory_order_relaxed);
+  m_lastBucket.store(NO_BUCKET, std::memory_order_relaxed);
+  m_firstBucket.store(NO_BUCKET, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+nalCategory NalStatistics::category(int nalUnitType) const
+{
+  if (m_codecType == videoCodecType::H264_AVC)
+  {
+    // Slice extensions of SVC / MVC (20) and 3D-AVC (21) are counted with the slices
+    if (NALParse::nal_is_vcl(m_codecType, nalUnitType) || nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SLC_EXT) || nalUnitType == 21)
+      return nalCategory::NAL_CATEGORY_VCL;
+    if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SPS) || nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_PPS) ||
+        nalUnitType == 13 || nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SUB_SPS))
+      return nalCategory::NAL_CATEGORY_PARAMETER_SET;
+    if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_SEI))
+      return nalCategory::NAL_CATEGORY_SEI;
+    if (nalUnitType == static_cast<int>(avc::h264_nal_type::NALU_TYPE_FILL))
+      return nalCategory::NAL_CATEGORY_FILLER;
+  }
+  else if (m_codecType == videoCodecType::H265_HEVC)
+  {
+    if (NALParse::nal_is_vcl(m_codecType, nalUnitType))
+      return nalCategory::NAL_CATEGORY_VCL;
+    if (nalUnitType >= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_VPS) && nalUnitType <= static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PPS))
+      return nalCategory::NAL_CATEGORY_PARAMETER_SET;
+    if (nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_PREFIX_SEI) || nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_SUFFIX_SEI))
+      return nalCategory::NAL_CATEGORY_SEI;
+    if (nalUnitType == static_cast<int>(hevc::hevc_nal_type::NAL_UNIT_FILLER_DATA))
+      return nalCategory::NAL_CATEGORY_FILLER;
+  }
+  else if (m_codecType == videoCodecType::H266_VVC)
+  {
+    if (NALParse::nal_is_vcl(m_codecType, nalUnitType))
+      return nalCategory::NAL_CATEGORY_VCL;
+    if (nalUnitType >= vvc::NAL_UNIT_OPI && nalUnitType <= vvc::NAL_UNIT_SUFFIX_APS)
+      return nalCategory::NAL_CATEGORY_PARAMETER_SET;
+    if (nalUnitType == vvc::NAL_UNIT_PREFIX_SEI || nalUnitType == vvc::NAL_UNIT_SUFFIX_SEI)
+      return nalCategory::NAL_CATEGORY_SEI;
+    if (nalUnitType == vvc::NAL_UNIT_FD)
+      return nalCategory::NAL_CATEGORY_FILLER;
+  }
+  return nalCategory::NAL_CATEGORY_OTHER;
+}
+
+void NalStatistics::add(atomic_counter &c, uint64_t bytes)
+{
+  // Single writer : a plain load and store, no read-modify-write
+  c.count.store(c.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  c.bytes.store(c.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+}
+
+void NalStatistics::load(const atomic_counter &c, nal_counter &out)
+{
+  out.count = c.count.load(std::memory_order_relaxed);
+  out.bytes = c.bytes.load(std::memory_order_relaxed);
+}
+
+void NalStatistics::advanceWindow(int64_t bucket)
+{
+  const int64_t last = m_lastBucket.load(std::memory_order_relaxed);
+  if (last != NO_BUCKET && bucket <= last && bucket > last - NUM_BUCKETS)
+    return; // Late access unit still inside the window
+
+  // Clear the buckets leaving the window, or all of them when the window restarts
+  const bool restart = last == NO_BUCKET || bucket <= last - NUM_BUCKETS || bucket - last >= NUM_BUCKETS;
+  const int64_t from = restart ? bucket - NUM_BUCKETS + 1 : last + 1;
+  for (int64_t b = from; b <= bucket; b++)
+  {
+    const int index = static_cast<int>(((b % NUM_BUCKETS) + NUM_BUCKETS) % NUM_BUCKETS);
+    for (int i = 0; i < MAX_NAL_TYPES; i++)
+      m_bucketBytes[index][i].store(0, std::memory_order_relaxed);
+  }
+  if (last == NO_BUCKET || bucket <= last - NUM_BUCKETS)
+    m_firstBucket.store(bucket, std::memory_order_relaxed);
+  m_lastBucket.store(bucket, std::memory_order_relaxed);
+}
+
+void NalStatistics::push(const nal_info &nal, uint32_t size, double timestamp)
+{
+  const int type = nal.nal_unit_type & (MAX_NAL_TYPES - 1);
+  const int category = static_cast<int>(this->category(type));
+  int tid = 0, layer = 0;
+  if (m_codecType != videoCodecType::H264_AVC)
+  {
+    tid = nal.temporal_id < 0 ? 0 : (nal.temporal_id >= MAX_TLAYER ? MAX_TLAYER - 1 : nal.temporal_id);
+    layer = nal.nuh_layer_id & (MAX_LAYERS - 1);
+  }
+  const int64_t bucket = static_cast<int64_t>(std::floor(timestamp / m_bucketSeconds));
+
+  // Sequence lock : odd while the counters change
+  const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+  m_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  add(m_total, size);
+  add(m_byType[type], size);
+  add(m_byCategory[category], size);
+  add(m_byTemporalId[tid], size);
+  add(m_byLayer[layer], size);
+  add(m_byTypeAndTemporalId[type][tid], size);
+
+  advanceWindow(bucket);
+  std::atomic<uint64_t> &bytes = m_bucketBytes[((bucket % NUM_BUCKETS) + NUM_BUCKETS) % NUM_BUCKETS][type];
+  bytes.store(bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+
+  m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void NalStatistics::snapshot(nal_stats_snapshot &out) const
+{
+  uint64_t bucketBytes[MAX_NAL_TYPES];
+  int64_t first, last;
+  for (;;)
+  {
+    const uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+      continue;
+
+    out.sequence = sequence / 2;
+    load(m_total, out.total);
+    for (int i = 0; i < MAX_NAL_TYPES; i++)
+    {
+      load(m_byType[i], out.byType[i]);
+      for (int t = 0; t < MAX_TLAYER; t++)
+        load(m_byTypeAndTemporalId[i][t], out.byTypeAndTemporalId[i][t]);
+    }
+    for (int i = 0; i < NUM_CATEGORIES; i++)
+      load(m_byCategory[i], out.byCategory[i]);
+    for (int i = 0; i < MAX_TLAYER; i++)
+      load(m_byTemporalId[i], out.byTemporalId[i]);
+    for (int i = 0; i < MAX_LAYERS; i++)
+      load(m_byLayer[i], out.byLayer[i]);
+
+    for (int i = 0; i < MAX_NAL_TYPES; i++)
+    {
+      bucketBytes[i] = 0;
+      for (int b = 0; b < NUM_BUCKETS; b++)
+        bucketBytes[i] += m_bucketBytes[b][i].load(std::memory_order_relaxed);
+    }
+    first = m_firstBucket.load(std::memory_order_relaxed);
+    last = m_lastBucket.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_sequence.load(std::memory_order_relaxed) == sequence)
+      break;
+  }
+
+  const int64_t span = last == NO_BUCKET ? 0 : (last - first + 1 < NUM_BUCKETS ? last - first + 1 : NUM_BUCKETS);
+  out.windowSeconds = span * m_bucketSeconds;
+  out.windowBitrate = 0;
+  for (int i = 0; i < NUM_CATEGORIES; i++)
+    out.windowBitrateByCategory[i] = 0;
+  for (int i = 0; i < MAX_NAL_TYPES; i++)
+  {
+    out.windowBitrateByType[i] = span ? 8.0 * bucketBytes[i] / out.windowSeconds : 0;
+    out.windowBitrate += out.windowBitrateByType[i];
+    out.windowBitrateByCategory[static_cast<int>(category(i))] += out.windowBitrateByType[i];
+  }
+}
@@ -0,0 +1,254 @@
+#include "nal_timecode.h"
+
+#include <algorithm>
+
+// NumClockTS of Table D-1 (H264), 0 for the reserved pic_struct values
+static int NumClockTs(uint8_t picStruct)
+{
+  static const int numClockTs[9] = {1, 1, 1, 2, 2, 3, 3, 2, 3};
+  return picStruct < 9 ? numClockTs[picStruct] : 0;
+}
+
+// Labels skipped at every minute except each tenth : n_frames 0 and 1 at 30 frames per second, 0 to 3 at 60
+static int64_t DroppedLabels(int64_t fps)
+{
+  return fps / 30 * 2;
+}
+
+TimecodeEngine::TimecodeEngine()
+{
+  m_numUnitsInTick = 0;
+  m_timeScale = 0;
+  clear();
+}
+
+TimecodeEngine::~TimecodeEngine()
+{
+}
+
+void TimecodeEngine::clear()
+{
+  m_prevTimeSet = SEITimeSet{};
+  m_prevFrameNumber = -1;
+  m_prevFieldBased = false;
+  m_prevDropFrame = false;
+  m_entries.clear();
+  m_segmentStart.clear();
+}
+
+void TimecodeEngine::setTiming(uint32_t numUnitsInTick, uint32_t timeScale)
+{
+  m_numUnitsInTick = numUnitsInTick;
+  m_timeScale = timeScale;
+}
+
+void TimecodeEngine::setTiming(const avc::sps *sps)
+{
+  if (sps && sps->vui_parameters_present_flag && sps->vui_seq_parameters.timing_info_present_flag)
+    setTiming(sps->vui_seq_parameters.num_units_in_tick, sps->vui_seq_parameters.time_scale);
+}
+
+void TimecodeEngine::setTiming(const hevc::sps *sps)
+{
+  if (sps && sps->m_vuiParametersPresentFlag && sps->m_vuiParameters.m_timingInfo.m_timingInfoPresentFlag)
+    setTiming(sps->m_vuiParameters.m_timingInfo.m_numUnitsInTick, sps->m_vuiParameters.m_timingInfo.m_timeScale);
+}
+
+bool TimecodeEngine::push(const SEITimeCode &sei)
+{
+  for (uint32_t i = 0; i < sei.numClockTs && i < MAX_TIMECODE_SEI_SETS; i++)
+  {
+    if (sei.timeSetArray[i].clockTimeStampFlag)
+    {
+      append(sei.timeSetArray[i]);
+      return true;
+    }
+  }
+  pushWithoutTimecode();
+  return false;
+}
+
+bool TimecodeEngine::push(const SEIPictureTimingH264 &sei)
+{
+  if (sei.pic_struct_present_flag)
+  {
+    const int numClockTs = std::min(NumClockTs(sei.pic_struct), (int)MAX_TIMECODE_SEI_SETS);
+    for (int i = 0; i < numClockTs; i++)
+    {
+      if (!sei.clock_timestamp_flag[i])
+        continue;
+
+      SEITimeSet ts{};
+      ts.clockTimeStampFlag = true;
+      ts.numUnitFieldBasedFlag = sei.nuit_field_based_flag[i];
+      ts.countingType = sei.counting_type[i];
+      ts.fullTimeStampFlag = sei.full_timestamp_flag[i];
+      ts.discontinuityFlag = sei.discontinuity_flag[i];
+      ts.cntDroppedFlag = sei.cnt_dropped_flag[i];
+      ts.numberOfFrames = sei.nframes[i];
+      ts.secondsValue = sei.seconds_value[i];
+      ts.minutesValue = sei.minutes_value[i];
+      ts.hoursValue = sei.hours_value[i];
+      ts.secondsFlag = sei.seconds_flag[i];
+      ts.minutesFlag = sei.minutes_flag[i];
+      ts.hoursFlag = sei.hours_flag[i];
+      ts.timeOffsetValue = sei.time_offset[i];
+      append(ts);
+      return true;
+    }
+  }
+  pushWithoutTimecode();
+  return false;
+}
+
+void TimecodeEngine::pushWithoutTimecode()
+{
+  timecode_entry entry{};
+  entry.timestamp = -1;
+
+  if (!m_entries.empty() && (m_entries.back().flags & TIMECODE_VALID) && m_prevFrameNumber >= 0)
+  {
+    const timecode_entry &prev = m_entries.back();
+    entry.flags = TIMECODE_VALID | TIMECODE_EXTRAPOLATED | (prev.flags & (TIMECODE_DROP_FRAME | TIMECODE_FIELD_BASED));
+    entry.timestamp = prev.timestamp + (int64_t)m_numUnitsInTick * (m_prevFieldBased ? 2 : 1);
+    m_prevFrameNumber++;
+    frameNumberToLabel(m_prevFrameNumber, m_prevDropFrame, entry);
+  }
+  else if (m_entries.empty() || (m_entries.back().flags & TIMECODE_VALID))
+  {
+    m_segmentStart.push_back(m_entries.size());
+  }
+  m_entries.push_back(entry);
+}
+
+void TimecodeEngine::append(const SEITimeSet &ts)
+{
+  SEITimeSet cur = ts;
+
+  // Values which are not present are equal to the ones of the previous clock timestamp in decoding order
+  if (!cur.fullTimeStampFlag)
+  {
+    if (!cur.secondsFlag)
+      cur.secondsValue = m_prevTimeSet.secondsValue;
+    if (!cur.secondsFlag || !cur.minutesFlag)
+      cur.minutesValue = m_prevTimeSet.minutesValue;
+    if (!cur.secondsFlag || !cur.minutesFlag || !cur.hoursFlag)
+      cur.hoursValue = m_prevTimeSet.hoursValue;
+  }
+  m_prevTimeSet = cur;
+
+  const bool dropFrame = (cur.countingType == 4);
+  const bool fieldBased = cur.numUnitFieldBasedFlag;
+
+  timecode_entry entry{};
+  entry.flags = TIMECODE_VALID;
+  if (dropFrame)
+    entry.flags |= TIMECODE_DROP_FRAME;
+  if (fieldBased)
+    entry.flags |= TIMECODE_FIELD_BASED;
+
+  bool discontinuity = cur.discontinuityFlag || m_entries.empty() || !(m_entries.back().flags & TIMECODE_VALID);
+  if (dropFrame != m_prevDropFrame || fieldBased != m_prevFieldBased)
+    discontinuity = true;
+
+  m_prevDropFrame = dropFrame;
+  m_prevFieldBased = fieldBased;
+
+  int64_t frameNumber = labelToFrameNumber(cur.hoursValue, cur.minutesValue, cur.secondsValue, cur.numberOfFrames, dropFrame);
+  if (frameNumber >= 0)
+  {
+    // clockTimestamp of D.2.3 (H264) / D.3.27 (H265) with the dropped labels taken out of the frame count
+    entry.timestamp = frameNumber * (int64_t)m_numUnitsInTick * (fieldBased ? 2 : 1) + cur.timeOffsetValue;
+    frameNumberToLabel(frameNumber, dropFrame, entry);
+
+    // Keep timestamps strictly increasing inside a segment
+    if (m_prevFrameNumber >= 0 && frameNumber <= m_prevFrameNumber)
+      discontinuity = true;
+  }
+  else
+  {
+    entry.timestamp = -1;
+    entry.hours = (uint8_t)cur.hoursValue;
+    entry.minutes = (uint8_t)cur.minutesValue;
+    entry.seconds = (uint8_t)cur.secondsValue;
+    entry.frames = (uint16_t)cur.numberOfFrames;
+  }
+  m_prevFrameNumber = frameNumber;
+
+  if (discontinuity)
+  {
+    if (!m_entries.empty())
+      entry.flags |= TIMECODE_DISCONTINUITY;
+    m_segmentStart.push_back(m_entries.size());
+  }
+  m_entries.push_back(entry);
+}
+
+int64_t TimecodeEngine::labelToFrameNumber(int hours, int minutes, int seconds, int frames, bool dropFrame) const
+{
+  if (m_numUnitsInTick == 0 || m_timeScale == 0)
+    return -1;
+
+  const int unitTicks = m_numUnitsInTick * (m_prevFieldBased ? 2 : 1);
+  const int64_t fps = ((int64_t)m_timeScale + unitTicks / 2) / unitTicks;
+  if (fps == 0)
+    return -1;
+
+  int64_t frameNumber = ((int64_t)hours * 3600 + minutes * 60 + seconds) * fps + frames;
+  if (dropFrame)
+  {
+    const int64_t totalMinutes = (int64_t)hours * 60 + minutes;
+    frameNumber -= DroppedLabels(fps) * (totalMinutes - totalMinutes / 10);
+  }
+  return frameNumber;
+}
+
+void TimecodeEngine::frameNumberToLabel(int64_t frameNumber, bool dropFrame, timecode_entry &entry) const
+{
+  const int unitTicks = m_numUnitsInTick * (m_prevFieldBased ? 2 : 1);
+  const int64_t fps = ((int64_t)m_timeScale + unitTicks / 2) / unitTicks;
+
+  if (dropFrame)
+  {
+    const int64_t dropped = DroppedLabels(fps);
+    const int64_t framesPer10Minutes = fps * 600 - 9 * dropped;
+    const int64_t framesPerMinute = fps * 60 - dropped;
+    const int64_t tens = frameNumber / framesPer10Minutes;
+    const int64_t remainder = frameNumber % framesPer10Minutes;
+
+    frameNumber += 9 * dropped * tens;
+    if (remainder > dropped)
+      frameNumber += dropped * ((remainder - dropped) / framesPerMinute);
+  }
+
+  entry.frames = (uint16_t)(frameNumber % fps);
+  entry.seconds = (uint8_t)((frameNumber / fps) % 60);
+  entry.minutes = (uint8_t)((frameNumber / (fps * 60)) % 60);
+  entry.hours = (uint8_t)((frameNumber / (fps * 3600)) % 24);
+}
+
+size_t TimecodeEngine::find(int64_t timestamp) const
+{
+  for (size_t s = 0; s < m_segmentStart.size(); s++)
+  {
+    const size_t first = m_segmentStart[s];
+    const size_t last = (s + 1 < m_segmentStart.size()) ? m_segmentStart[s + 1] : m_entries.size();
+    if (m_entries[first].timestamp < 0 || timestamp < m_entries[first].timestamp || timestamp > m_entries[last - 1].timestamp)
+      continue;
+
+    std::vector<timecode_entry>::const_iterator it =
+        std::lower_bound(m_entries.begin() + first, m_entries.begin() + last, timestamp,
+                         [](const timecode_entry &e, int64_t t)
+                         { return e.timestamp < t; });
+    return (size_t)(it - m_entries.begin());
+  }
+  return m_entries.size();
+}
+
+std::string TimecodeEngine::toString(const timecode_entry &entry)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%02u:%02u:%02u%c%02u", entry.hours, entry.minutes, entry.seconds,
+           (entry.flags & TIMECODE_DROP_FRAME) ? ';' : ':', entry.frames);
+  return std::string(buf);
+}
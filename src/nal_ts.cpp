@@ -0,0 +1,450 @@
+#include "nal_ts.h"
+
+#include <algorithm>
+#include <cstring>
+
+// CRC_32 of the PSI sections (Annex A of ISO/IEC 13818-1), 0 over a section followed by its CRC
+static uint32_t SectionCrc(const uint8_t *data, int size)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  for (int i = 0; i < size; i++)
+  {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+  }
+  return crc;
+}
+
+// PTS / DTS field of the PES header : 33 bits split by marker bits
+static int64_t ReadTimestamp(const uint8_t *p)
+{
+  return (static_cast<int64_t>((p[0] >> 1) & 0x07) << 30) | (static_cast<int64_t>(p[1]) << 22) | (static_cast<int64_t>(p[2] >> 1) << 15) |
+         (static_cast<int64_t>(p[3]) << 7) | static_cast<int64_t>(p[4] >> 1);
+}
+
+static videoCodecType StreamTypeCodec(int streamType)
+{
+  if (streamType == TS_STREAM_TYPE_H264)
+    return videoCodecType::H264_AVC;
+  if (streamType == TS_STREAM_TYPE_H265)
+    return videoCodecType::H265_HEVC;
+  if (streamType == TS_STREAM_TYPE_H266)
+    return videoCodecType::H266_VVC;
+  return videoCodecType::UNDEFINED;
+}
+
+TsDemuxer::TsDemuxer(parsingLevel level, int pid)
+{
+  m_level = level;
+  m_pidFixed = pid >= 0;
+  m_pid = pid;
+  m_assembler = NULL;
+  m_out = NULL;
+  clear();
+}
+
+TsDemuxer::~TsDemuxer()
+{
+  delete m_assembler;
+}
+
+void TsDemuxer::clear()
+{
+  delete m_assembler;
+  m_assembler = NULL;
+  m_codecType = videoCodecType::UNDEFINED;
+  if (!m_pidFixed)
+    m_pid = -1;
+  m_parser = NALParse();
+  m_stats = ts_stats{};
+  m_pmtPids.clear();
+  m_sections.clear();
+  m_continuity = -1;
+  m_partialSize = 0;
+  m_inPes = false;
+  m_timestamps.clear();
+  m_esOffset = 0;
+  m_zeros = 0;
+  dropNal();
+}
+
+void TsDemuxer::push(const uint8_t *data, size_t size, std::vector<access_unit> &aus)
+{
+  m_out = &aus;
+  size_t pos = 0;
+  if (m_partialSize > 0)
+  {
+    const size_t take = std::min(size, static_cast<size_t>(TS_PACKET_SIZE - m_partialSize));
+    memcpy(m_partial + m_partialSize, data, take);
+    m_partialSize += static_cast<int>(take);
+    pos = take;
+    if (m_partialSize < TS_PACKET_SIZE)
+    {
+      m_out = NULL;
+      return;
+    }
+    m_partialSize = 0;
+    packet(m_partial);
+  }
+
+  while (pos + TS_PACKET_SIZE <= size)
+  {
+    // Sync byte, confirmed by the next one when it is available
+    if (data[pos] != 0x47 || (pos + 2 * TS_PACKET_SIZE <= size && data[pos + TS_PACKET_SIZE] != 0x47))
+    {
+      m_stats.syncLosses++;
+      pos++;
+      continue;
+    }
+    packet(data + pos);
+    pos += TS_PACKET_SIZE;
+  }
+
+  // Pieces of the open NAL unit may point into the data and into m_partial, both go away
+  keepOpenNal();
+  for (; pos < size && data[pos] != 0x47; pos++)
+    m_stats.syncLosses++;
+  m_partialSize = static_cast<int>(size - pos);
+  memcpy(m_partial, data + pos, size - pos);
+  m_out = NULL;
+}
+
+void TsDemuxer::flush(std::vector<access_unit> &aus)
+{
+  m_out = &aus;
+  if (m_inNal)
+    endNal(0);
+  if (m_assembler && m_assembler->flush())
+    complete(aus);
+  m_partialSize = 0;
+  m_out = NULL;
+}
+
+void TsDemuxer::packet(const uint8_t *p)
+{
+  m_stats.packets++;
+  if (p[1] & 0x80)
+  {
+    m_stats.transportErrors++;
+    return;
+  }
+  const bool unitStart = (p[1] & 0x40) != 0;
+  const int pid = ((p[1] & 0x1f) << 8) | p[2];
+  const int adaptationFieldControl = (p[3] >> 4) & 0x03;
+  const int continuity = p[3] & 0x0f;
+
+  int pos = 4;
+  bool discontinuity = false;
+  if (adaptationFieldControl & 0x02)
+  {
+    discontinuity = p[4] > 0 && (p[5] & 0x80);
+    pos += 1 + p[4];
+  }
+  if (!(adaptationFieldControl & 0x01) || pos >= TS_PACKET_SIZE)
+    return;
+
+  if (pid == 0 || m_pmtPids.count(pid))
+  {
+    psiPayload(pid, p + pos, TS_PACKET_SIZE - pos, unitStart);
+    return;
+  }
+  if (pid != m_pid || m_codecType == videoCodecType::UNDEFINED)
+    return;
+
+  if (m_continuity >= 0 && !discontinuity)
+  {
+    if (continuity == m_continuity)
+      return; // Duplicate packet
+    if (continuity != ((m_continuity + 1) & 0x0f))
+    {
+      // Bytes are missing : the NAL unit in progress and the rest of the PES packet are lost
+      m_stats.continuityErrors++;
+      dropNal();
+      m_inPes = false;
+    }
+  }
+  m_continuity = continuity;
+  pesPayload(p + pos, TS_PACKET_SIZE - pos, unitStart);
+}
+
+void TsDemuxer::psiPayload(int pid, const uint8_t *payload, int size, bool unitStart)
+{
+  psi_section &s = m_sections[pid];
+  if (unitStart)
+  {
+    // pointer_field : the bytes before the new section end the previous one
+    const int pointer = payload[0];
+    if (1 + pointer > size)
+    {
+      s.data.clear();
+      return;
+    }
+    if (!s.data.empty())
+      s.data.insert(s.data.end(), payload + 1, payload + 1 + pointer);
+    while (s.data.size() >= 3)
+    {
+      const size_t length = 3 + (((s.data[1] & 0x0f) << 8) | s.data[2]);
+      if (s.data.size() < length)
+        break;
+      section(pid, s.data.data(), static_cast<int>(length));
+      s.data.erase(s.data.begin(), s.data.begin() + length);
+    }
+    s.data.assign(payload + 1 + pointer, payload + size);
+  }
+  else if (!s.data.empty())
+    s.data.insert(s.data.end(), payload, payload + size);
+
+  // Sections complete in the packet, stuffing bytes (0xFF) end the packet
+  while (s.data.size() >= 3 && s.data[0] != 0xFF)
+  {
+    const size_t length = 3 + (((s.data[1] & 0x0f) << 8) | s.data[2]);
+    if (s.data.size() < length)
+      return;
+    section(pid, s.data.data(), static_cast<int>(length));
+    s.data.erase(s.data.begin(), s.data.begin() + length);
+  }
+  if (!s.data.empty() && s.data[0] == 0xFF)
+    s.data.clear();
+}
+
+void TsDemuxer::section(int pid, const uint8_t *data, int size)
+{
+  if (size < 12 || !(data[1] & 0x80) || !(data[5] & 0x01)) // section_syntax_indicator, current_next_indicator
+    return;
+  if (SectionCrc(data, size) != 0)
+  {
+    m_stats.crcErrors++;
+    return;
+  }
+
+  const int tableId = data[0];
+  const int end = size - 4; // CRC_32
+  if (pid == 0 && tableId == 0x00)
+  {
+    // program_association_section() : program_number 0 is the network PID
+    for (int i = 8; i + 4 <= end; i += 4)
+    {
+      const int programNumber = (data[i] << 8) | data[i + 1];
+      const int pmtPid = ((data[i + 2] & 0x1f) << 8) | data[i + 3];
+      if (programNumber != 0)
+        m_pmtPids[pmtPid] = programNumber;
+    }
+  }
+  else if (tableId == 0x02 && m_codecType == videoCodecType::UNDEFINED)
+  {
+    // TS_program_map_section() : the first video stream of a codec the parser knows, or the PID asked for
+    const int programInfoLength = ((data[10] & 0x0f) << 8) | data[11];
+    for (int i = 12 + programInfoLength; i + 5 <= end;)
+    {
+      const int streamType = data[i];
+      const int esPid = ((data[i + 1] & 0x1f) << 8) | data[i + 2];
+      const int esInfoLength = ((data[i + 3] & 0x0f) << 8) | data[i + 4];
+      const videoCodecType codecType = StreamTypeCodec(streamType);
+      if (codecType != videoCodecType::UNDEFINED && (!m_pidFixed || esPid == m_pid))
+      {
+        m_pid = esPid;
+        m_codecType = codecType;
+        m_assembler = new AccessUnitAssembler(codecType, m_level);
+        return;
+      }
+      i += 5 + esInfoLength;
+    }
+  }
+}
+
+void TsDemuxer::pesPayload(const uint8_t *payload, int size, bool unitStart)
+{
+  if (unitStart)
+  {
+    // PES_packet() header : packet_start_code_prefix, stream_id, PES_packet_length, flags, PES_header_data_length
+    m_inPes = false;
+    if (size < 9 || payload[0] != 0 || payload[1] != 0 || payload[2] != 1)
+      return;
+    const int headerLength = 9 + payload[8];
+    if (headerLength > size)
+      return;
+    // Every PES packet is recorded, an access unit starting in one without PTS must not take the previous time stamps
+    const int ptsDtsFlags = payload[7] >> 6;
+    pes_timestamp ts;
+    ts.offset = m_esOffset;
+    ts.pts = -1;
+    ts.dts = -1;
+    ts.used = false;
+    if ((ptsDtsFlags & 0x02) && size >= 14)
+    {
+      ts.pts = ReadTimestamp(payload + 9);
+      ts.dts = (ptsDtsFlags == 0x03 && size >= 19) ? ReadTimestamp(payload + 14) : ts.pts;
+    }
+    if (m_timestamps.size() >= TS_MAX_PES_TIMESTAMPS)
+      m_timestamps.pop_front();
+    m_timestamps.push_back(ts);
+    m_stats.pesPackets++;
+    m_inPes = true;
+    payload += headerLength;
+    size -= headerLength;
+  }
+  if (m_inPes && size > 0)
+    esBytes(payload, static_cast<size_t>(size));
+}
+
+void TsDemuxer::esBytes(const uint8_t *data, size_t size)
+{
+  // Start codes are found on their 0x01 byte, the zero bytes in front of it may end the previous piece
+  size_t begin = 0; // Piece of the open NAL unit in data
+  size_t i = 0;
+  while (i < size)
+  {
+    const uint8_t *one = static_cast<const uint8_t *>(memchr(data + i, 1, size - i));
+    if (!one)
+      break;
+    const size_t j = static_cast<size_t>(one - data);
+    size_t zeros = 0;
+    while (zeros < 3 && zeros < j && data[j - 1 - zeros] == 0)
+      zeros++;
+    size_t previousZeros = 0; // Zero bytes of the start code at the end of the previous pieces
+    if (zeros == j && zeros < 3)
+      previousZeros = std::min(static_cast<size_t>(m_zeros), 3 - zeros);
+    i = j + 1;
+    if (zeros + previousZeros < 2)
+      continue;
+
+    if (m_inNal)
+    {
+      appendNal(data + begin, j - zeros - begin);
+      endNal(previousZeros);
+    }
+    m_inNal = true;
+    m_startCodeSize = zeros + previousZeros == 3 ? 4 : 3;
+    m_nalOffset = m_esOffset + j + 1 - m_startCodeSize;
+    m_nalSize = 0;
+    m_nalKept = 0;
+    m_nalNeeded = 0;
+    m_fragments.clear();
+    m_carry.clear();
+    begin = j + 1;
+  }
+  if (m_inNal)
+    appendNal(data + begin, size - begin);
+
+  size_t trailing = 0;
+  while (trailing < 3 && trailing < size && data[size - 1 - trailing] == 0)
+    trailing++;
+  m_zeros = static_cast<int>(trailing == size ? std::min<size_t>(3, m_zeros + trailing) : trailing);
+  m_esOffset += size;
+}
+
+void TsDemuxer::appendNal(const uint8_t *data, size_t size)
+{
+  if (size == 0)
+    return;
+  m_nalSize += size;
+  if (m_nalNeeded && m_nalKept >= m_nalNeeded)
+    return;
+
+  const uint64_t take = m_nalNeeded ? std::min<uint64_t>(size, m_nalNeeded - m_nalKept) : size;
+  nal_buffer piece = {data, static_cast<uint32_t>(take)};
+  m_fragments.push_back(piece);
+  m_nalKept += take;
+
+  // Once the NAL unit header is known, slices keep only the bytes the parser reads
+  const uint32_t headerSize = m_codecType == videoCodecType::H264_AVC ? 1 : 2;
+  if (!m_nalNeeded && m_nalKept >= headerSize)
+  {
+    uint8_t header[2] = {0, 0};
+    uint32_t got = 0;
+    for (size_t f = 0; f < m_fragments.size() && got < headerSize; f++)
+      for (uint32_t b = 0; b < m_fragments[f].size && got < headerSize; b++)
+        header[got++] = m_fragments[f].data[b];
+    m_nalNeeded = NALParse::nal_bytes_needed(header, m_codecType, m_level);
+    while (m_nalKept > m_nalNeeded)
+    {
+      nal_buffer &last = m_fragments.back();
+      const uint64_t excess = m_nalKept - m_nalNeeded;
+      if (excess >= last.size)
+      {
+        m_nalKept -= last.size;
+        m_fragments.pop_back();
+      }
+      else
+      {
+        last.size -= static_cast<uint32_t>(excess);
+        m_nalKept -= excess;
+      }
+    }
+  }
+}
+
+void TsDemuxer::endNal(size_t trailingZeros)
+{
+  // Zero bytes appended before the 0x01 of the next start code was seen belong to that start code
+  m_nalSize -= std::min<uint64_t>(trailingZeros, m_nalSize);
+  while (m_nalKept > m_nalSize)
+  {
+    nal_buffer &last = m_fragments.back();
+    const uint64_t excess = m_nalKept - m_nalSize;
+    if (excess >= last.size)
+    {
+      m_nalKept -= last.size;
+      m_fragments.pop_back();
+    }
+    else
+    {
+      last.size -= static_cast<uint32_t>(excess);
+      m_nalKept -= excess;
+    }
+  }
+
+  if (m_nalSize > 0)
+  {
+    m_parser.nal_parse_scatter(m_fragments.data(), m_fragments.size(), m_codecType, m_level);
+    m_stats.nalUnits++;
+    if (m_parser.nal->nal_unit_type >= 0 && m_assembler->push(*m_parser.nal, static_cast<int64_t>(m_nalOffset), static_cast<uint32_t>(m_startCodeSize + m_nalSize)) && m_out)
+      complete(*m_out);
+  }
+  m_inNal = false;
+  m_fragments.clear();
+  m_carry.clear();
+}
+
+void TsDemuxer::keepOpenNal()
+{
+  if (!m_inNal || m_fragments.empty())
+    return;
+  const size_t first = m_carry.empty() ? 0 : 1;
+  for (size_t f = first; f < m_fragments.size(); f++)
+  {
+    m_carry.insert(m_carry.end(), m_fragments[f].data, m_fragments[f].data + m_fragments[f].size);
+    m_stats.copiedBytes += m_fragments[f].size;
+  }
+  m_fragments.resize(1);
+  m_fragments[0].data = m_carry.data();
+  m_fragments[0].size = static_cast<uint32_t>(m_carry.size());
+}
+
+void TsDemuxer::dropNal()
+{
+  m_inNal = false;
+  m_zeros = 0;
+  m_nalSize = 0;
+  m_nalKept = 0;
+  m_nalNeeded = 0;
+  m_fragments.clear();
+  m_carry.clear();
+}
+
+void TsDemuxer::complete(std::vector<access_unit> &aus)
+{
+  aus.push_back(m_assembler->au());
+  access_unit &au = aus.back();
+
+  // The time stamps of a PES packet belong to the first access unit starting in its payload
+  while (m_timestamps.size() > 1 && m_timestamps[1].offset <= static_cast<uint64_t>(au.offset))
+    m_timestamps.pop_front();
+  if (!m_timestamps.empty() && m_timestamps.front().offset <= static_cast<uint64_t>(au.offset) && !m_timestamps.front().used)
+  {
+    au.pts = m_timestamps.front().pts;
+    au.dts = m_timestamps.front().dts;
+    m_timestamps.front().used = true;
+  }
+}
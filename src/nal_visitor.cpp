@@ -0,0 +1,39 @@
+#include "nal_visitor.h"
+
+bool NextSeiMessage(const uint8_t *rbsp, size_t size, size_t &pos, sei_view &sei)
+{
+  // more_rbsp_data() : a message takes at least two bytes, a last byte alone is rbsp_trailing_bits()
+  if (!rbsp || pos + 1 >= size)
+    return false;
+
+  uint32_t payloadType = 0;
+  while (pos < size && rbsp[pos] == 0xFF)
+  {
+    payloadType += 255;
+    pos++;
+  }
+  if (pos >= size)
+    return false;
+  payloadType += rbsp[pos++];
+
+  uint32_t payloadSize = 0;
+  while (pos < size && rbsp[pos] == 0xFF)
+  {
+    payloadSize += 255;
+    pos++;
+  }
+  if (pos >= size)
+    return false;
+  payloadSize += rbsp[pos++];
+
+  if (payloadSize > size - pos)
+  {
+    pos = size;
+    return false;
+  }
+  sei.payloadType = static_cast<int>(payloadType);
+  sei.payload = rbsp + pos;
+  sei.payloadSize = payloadSize;
+  pos += payloadSize;
+  return true;
+}
@@ -2,57 +2,6 @@
 #include "vvc_nal.h"
 #include "vvc_vlc.h"
 
-static inline int floorLog2(uint32_t x)
-{
-  if (x == 0)
-  {
-    // note: ceilLog2() expects -1 as return value
-    return -1;
-  }
-#ifdef __GNUC__
-  return 31 - __builtin_clz(x);
-#else
-#ifdef _MSC_VER
-  unsigned long r = 0;
-  _BitScanReverse(&r, x);
-  return r;
-#else
-  int result = 0;
-  if (x & 0xffff0000)
-  {
-    x >>= 16;
-    result += 16;
-  }
-  if (x & 0xff00)
-  {
-    x >>= 8;
-    result += 8;
-  }
-  if (x & 0xf0)
-  {
-    x >>= 4;
-    result += 4;
-  }
-  if (x & 0xc)
-  {
-    x >>= 2;
-    result += 2;
-  }
-  if (x & 0x2)
-  {
-    x >>= 1;
-    result += 1;
-  }
-  return result;
-#endif
-#endif
-}
-
-static inline int ceilLog2(uint32_t x)
-{
-  return (x == 0) ? -1 : floorLog2(x - 1) + 1;
-}
-
 void parseNalH266::copyRefPicList(vvc::SPS *sps, vvc::ReferencePictureList *source_rpl, vvc::ReferencePictureList *dest_rp)
 {
   dest_rp->m_numberOfShorttermPictures = source_rpl->m_numberOfShorttermPictures;
@@ -473,6 +422,7 @@ void parseNalH266::pps_parse(unsigned char *nal_bitstream, vvc::PPS *pcPPS,  vvc
   else
   {
     pcPPS->m_singleSlicePerSubPicFlag = 1;
+    pcPPS->m_sliceMap.clear();
   }
 
   READ_FLAG(uiCode, "pps_cabac_init_present_flag");
@@ -553,6 +503,7 @@ void parseNalH266::pps_parse(unsigned char *nal_bitstream, vvc::PPS *pcPPS,  vvc
       uint32_t tableSizeMinus1 = 0;
       READ_UVLC(tableSizeMinus1, "pps_chroma_qp_offset_list_len_minus1");
       CHECK(tableSizeMinus1 >= vvc::MAX_QP_OFFSET_LIST_SIZE, "Table size exceeds maximum");
+      pcPPS->m_chromaQpOffsetListLen = 0;
 
       for (int cuChromaQpOffsetIdx = 0; cuChromaQpOffsetIdx <= (int)tableSizeMinus1; cuChromaQpOffsetIdx++)
       {
@@ -655,6 +606,7 @@ void parseNalH266::pps_parse(unsigned char *nal_bitstream, vvc::PPS *pcPPS,  vvc
   else
   {
     pcPPS->m_deblockingFilterOverrideEnabledFlag = false;
+    pcPPS->m_ppsDeblockingFilterDisabledFlag = false;
     pcPPS->m_dbfInfoInPhFlag = false;
   }
 
@@ -1107,7 +1059,7 @@ void parseNalH266::parseOlsHrdParameters(vvc::GeneralHrdParams *generalHrd, vvc:
         for (int j = 0; j <= (int)generalHrd->m_hrdCpbCntMinus1; j++)
         {
           READ_UVLC(symbol, "bit_rate_value_minus1");
-          hrd->m_duBitRateValueMinus1[j][nalOrVcl] = symbol;
+          hrd->m_bitRateValueMinus1[j][nalOrVcl] = symbol;
           READ_UVLC(symbol, "cpb_size_value_minus1");
           hrd->m_cpbSizeValueMinus1[j][nalOrVcl] = symbol;
           if (generalHrd->m_generalDecodingUnitHrdParamsPresentFlag)
@@ -1185,7 +1137,30 @@ void parseNalH266::dpb_parameters(int maxSubLayersMinus1, bool subLayerInfoFlag,
 
 void parseNalH266::vps_parse(unsigned char *nal_bitstream, vvc::VPS *pcVPS, int curLen, parsingLevel level)
 {
+  uint32_t uiCode;
+
+  for (int i = 0; i < curLen; i++)
+    m_bits->m_fifo.push_back(nal_bitstream[i]);
+  setBitstream(m_bits);
+
+  // The same object is reused for every VPS : start from the inferred values (7.4.3.3)
+  *pcVPS = vvc::VPS();
+  pcVPS->m_vpsAllIndependentLayersFlag = true;
+  pcVPS->m_vpsEachLayerIsAnOlsFlag = true;
+  pcVPS->m_vpsNumPtls = 1;
+  pcVPS->m_totalNumOLSs = 1;
+  pcVPS->m_targetOlsIdx = -1;
+  for (int i = 0; i < vvc::MAX_VPS_LAYERS; i++)
+    pcVPS->m_vpsIndependentLayerFlag[i] = true;
+
+  if (level == parsingLevel::PARSING_PARAM_ID)
+  {
+    READ_CODE(4, uiCode, "vps_video_parameter_set_id");
+    pcVPS->m_VPSId = uiCode;
+    return;
+  }
 
+  parseVPS(pcVPS);
 }
 
 void parseNalH266::sps_parse(unsigned char *nal_bitstream, vvc::SPS *pcSPS, int curLen, parsingLevel level)
@@ -1265,6 +1240,8 @@ void parseNalH266::sps_parse(unsigned char *nal_bitstream, vvc::SPS *pcSPS, int
   READ_UVLC(uiCode, "sps_pic_height_max_in_luma_samples");
   pcSPS->m_maxHeightInLumaSamples = uiCode;
   READ_FLAG(uiCode, "sps_conformance_window_flag");
+  pcSPS->m_conformanceWindow = vvc::Window();
+  pcSPS->m_conformanceWindow.m_enabledFlag = uiCode;
   if (uiCode != 0)
   {
     vvc::Window &conf = pcSPS->m_conformanceWindow;
@@ -1614,6 +1591,7 @@ void parseNalH266::sps_parse(unsigned char *nal_bitstream, vvc::SPS *pcSPS, int
   READ_FLAG(uiCode, "sps_lfnst_enabled_flag");
   pcSPS->m_LFNST = uiCode != 0;
 
+  pcSPS->m_JointCbCrEnabledFlag = false;
   if (pcSPS->m_chromaFormatIdc != vvc::CHROMA_400)
   {
     READ_FLAG(uiCode, "sps_joint_cbcr_enabled_flag");
@@ -2056,6 +2034,7 @@ void parseNalH266::sps_parse(unsigned char *nal_bitstream, vvc::SPS *pcSPS, int
     parseVUI(&pcSPS->m_vuiParameters, pcSPS);
   }
 
+  pcSPS->m_spsRangeExtension = vvc::SPSRExt();
   READ_FLAG(uiCode, "sps_extension_present_flag");
 
   if (uiCode)
@@ -2220,7 +2199,7 @@ void parseNalH266::parseVPS(vvc::VPS *pcVPS)
   {
     READ_CODE(6, uiCode, "vps_layer_id");
     pcVPS->m_vpsLayerId[i] = uiCode;
-    pcVPS->m_generalLayerIdx[i] = uiCode;
+    pcVPS->m_generalLayerIdx[uiCode] = i;
 
     if (i > 0 && !pcVPS->m_vpsAllIndependentLayersFlag)
     {
@@ -2234,14 +2213,14 @@ void parseNalH266::parseVPS(vvc::VPS *pcVPS)
         for (int j = 0, k = 0; j < (int)i; j++)
         {
           READ_FLAG(uiCode, "vps_direct_ref_layer_flag");
-          pcVPS->m_directRefLayerIdx[i][j] = uiCode;
+          pcVPS->m_vpsDirectRefLayerFlag[i][j] = uiCode;
           if (uiCode)
           {
             pcVPS->m_interLayerRefIdx[i][j] = k;
             pcVPS->m_directRefLayerIdx[i][k++] = j;
             sumUiCode++;
           }
-          if (presentFlag && pcVPS->m_directRefLayerIdx[i][j])
+          if (presentFlag && pcVPS->m_vpsDirectRefLayerFlag[i][j])
           {
             READ_CODE(3, uiCode, "max_tid_il_ref_pics_plus1[ i ][ j ]");
             pcVPS->m_vpsMaxTidIlRefPicsPlus1[i][j] = uiCode;
@@ -2540,6 +2519,8 @@ void parseNalH266::parseVPS(vvc::VPS *pcVPS)
       READ_FLAG(uiCode, "vps_extension_data_flag");
     }
   }
+  // NumSubLayersInLayerInOLS depends on vps_ols_ptl_idx, parsed after the first derivation
+  pcVPS->deriveOutputLayerSets();
   pcVPS->checkVPS();
   xReadRbspTrailingBits();
 }
@@ -3035,276 +3016,846 @@ void parseNalH266::alfFilter(vvc::AlfParam &alfParam, const bool isChroma, const
 
 void parseNalH266::sei_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen)
 {
-  /*
-  int payloadType = 0;
-  uint32_t val = 0;
+  m_bits->m_fifo.assign(nal_bitstream, nal_bitstream + curLen);
+  setBitstream(m_bits);
 
+  parseSeiH266 sei_handler;
   do
   {
-    sei_read_scode(8, val, "payload_type");
-    payloadType += val;
-  } while (val == 0xFF);
+    int payloadType = 0;
+    uint32_t val = 0;
+    do
+    {
+      READ_CODE(8, val, "payload_type");
+      payloadType += val;
+    } while (val == 0xFF);
 
-  uint32_t payloadSize = 0;
-  do
+    uint32_t payloadSize = 0;
+    do
+    {
+      READ_CODE(8, val, "payload_size");
+      payloadSize += val;
+    } while (val == 0xFF);
+
+    const uint32_t payloadStart = m_bits->getByteLocation();
+    if (payloadStart + payloadSize > m_bits->m_fifo.size())
+    {
+      vvc::msg(vvc::WARNING, "Warning: SEI payload exceeds the NAL unit, remaining messages are ignored\n");
+      break;
+    }
+
+    bool parsed = true;
+    try
+    {
+      sei_handler.xReadSEIPayloadData(payloadType, payloadSize, nal, (vvc::NalUnitType)nal.nal_unit_type, nal.temporal_id, m_bits);
+    }
+    catch (const std::exception &)
+    {
+      parsed = false;
+    }
+    // A payload shorter than its syntax is read into the next message or past the end of the NAL unit : it is dropped,
+    // a buffering period no longer applies to the following picture timing
+    if (!parsed || m_bits->getByteLocation() > payloadStart + payloadSize)
+    {
+      vvc::msg(vvc::WARNING, "Warning: SEI payload of type %d is shorter than its syntax, ignored\n", payloadType);
+      if (payloadType == vvc::SEIMessageType::BUFFERING_PERIOD && nal.nal_unit_type == vvc::NAL_UNIT_PREFIX_SEI)
+        nal.vvcSEI.vvc_bp_available = false;
+    }
+    else
+    {
+      nal.sei_type = payloadType;
+      nal.sei_length = payloadSize;
+      nal.sei_types.push_back(payloadType);
+    }
+
+    // Skip to the next message by the signalled size, whether or not the payload was interpreted
+    m_bits->m_fifo_idx = payloadStart + payloadSize;
+    m_bits->m_num_held_bits = 0;
+  } while (m_bits->getNumBitsLeft() > 0 && xMoreRbspData());
+}
+
+bool parseNalH266::xActivateParamSets(nal_info &nal)
+{
+  // ph_pic_parameter_set_id of the picture header, then pps_seq_parameter_set_id, they become the active parameter sets
+  vvc::PPS *pps = static_cast<vvc::PPS *>(nal.mpegParamSet.findPps(nal.slice.ppsId));
+  vvc::SPS *sps = pps ? static_cast<vvc::SPS *>(nal.mpegParamSet.findSps(pps->m_SPSId)) : NULL;
+  if (!sps || !pps)
+    return false;
+  nal.mpegParamSet.sps = sps;
+  nal.mpegParamSet.pps = pps;
+  return true;
+}
+
+bool parseNalH266::xParsePictureHeaderPrefix(nal_info &nal)
+{
+  uint32_t uiCode;
+  slice_prefix &slice = nal.slice;
+
+  READ_FLAG(uiCode, "ph_gdr_or_irap_pic_flag");
+  slice.gdrOrIrapPic = uiCode;
+  READ_FLAG(uiCode, "ph_non_ref_pic_flag");
+  slice.nonRefPic = uiCode;
+  slice.gdrPic = false;
+  if (slice.gdrOrIrapPic)
+  {
+    READ_FLAG(uiCode, "ph_gdr_pic_flag");
+    slice.gdrPic = uiCode;
+  }
+  READ_FLAG(uiCode, "ph_inter_slice_allowed_flag");
+  slice.interSliceAllowed = uiCode;
+  slice.intraSliceAllowed = true;
+  if (slice.interSliceAllowed)
   {
-    sei_read_scode(8, val, "payload_size");
-    payloadSize += val;
-  } while (val == 0xFF);
+    READ_FLAG(uiCode, "ph_intra_slice_allowed_flag");
+    slice.intraSliceAllowed = uiCode;
+  }
+  READ_UVLC(uiCode, "ph_pic_parameter_set_id");
+  slice.ppsId = uiCode;
 
-  InputBitstream *bs = getBitstream();
-  setBitstream(bs->extractSubstream(payloadSize * 8));
+  slice.pocLsb = -1;
+  slice.recoveryPocCnt = -1;
+  slice.pocMsbCycle = -1;
+  if (!xActivateParamSets(nal))
+    return false;
+  const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+
+  READ_CODE(sps->m_uiBitsForPOC, uiCode, "ph_pic_order_cnt_lsb");
+  slice.pocLsb = uiCode;
+  slice.recoveryPocCnt = -1;
+  if (slice.gdrPic)
+  {
+    READ_UVLC(uiCode, "ph_recovery_poc_cnt");
+    slice.recoveryPocCnt = uiCode;
+  }
+  for (size_t i = 0; i < sps->m_extraPHBitPresentFlag.size(); i++)
+  {
+    if (sps->m_extraPHBitPresentFlag[i])
+      READ_FLAG(uiCode, "ph_extra_bit[i]");
+  }
+  slice.pocMsbCycle = -1;
+  if (sps->m_pocMsbCycleFlag)
+  {
+    READ_FLAG(uiCode, "ph_poc_msb_cycle_present_flag");
+    if (uiCode)
+    {
+      READ_CODE(sps->m_pocMsbCycleLen, uiCode, "ph_poc_msb_cycle_val");
+      slice.pocMsbCycle = uiCode;
+    }
+  }
+  return true;
+}
+
+void parseNalH266::slice_prefix_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen)
+{
+  for (int i = 0; i < curLen; i++)
+    m_bits->m_fifo.push_back(nal_bitstream[i]);
+  setBitstream(m_bits);
+
+  xParseSliceHeader(nal, curLen, NULL);
+}
 
-  SEI *sei = nullptr;
-  const SEIBufferingPeriod *bp = nullptr;
+bool parseNalH266::slice_header_parse(unsigned char *nal_bitstream, nal_info &nal, int curLen, int dataLen, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize)
+{
+  slice_entry_points &entry = nal.entry;
+  entry.valid = false;
+  entry.substreamOffset.clear();
+  entry.substreamSize.clear();
+  entry.substreamCtuAddr.clear();
 
-  if (nal.nal_unit_type == vvc::NAL_UNIT_PREFIX_SEI)
+  for (int i = 0; i < curLen; i++)
+    m_bits->m_fifo.push_back(nal_bitstream[i]);
+  setBitstream(m_bits);
+
+  std::vector<uint32_t> entryPointOffset;
+  m_ctuAddrInSlice.clear();
+  if (!xParseSliceHeader(nal, dataLen, &entryPointOffset))
+    return false;
+
+  if (nal.nal_unit_type != vvc::NAL_UNIT_PH && !m_ctuAddrInSlice.empty())
+    xSetSubstreams(nal, entryPointOffset, epbLocation, headerOffset, nalSize);
+  return true;
+}
+
+// Reads running into the padding after dataLen bytes : the header continues past the unescaped bytes
+#define HEADER_TRUNCATED() (8ul * m_pcBitstream->m_fifo.size() - m_pcBitstream->getNumBitsLeft() > 8ul * dataLen)
+
+bool parseNalH266::xParseSliceHeader(nal_info &nal, int dataLen, std::vector<uint32_t> *entryPointOffset)
+{
+  static const sliceType sliceTypes[3] = {sliceType::SLICE_B, sliceType::SLICE_P, sliceType::SLICE_I};
+
+  uint32_t uiCode;
+  int iCode;
+  const bool full = entryPointOffset != NULL;
+
+  slice_prefix &slice = nal.slice;
+  slice.valid = false;
+  slice.dependentSlice = false;
+
+  if (nal.nal_unit_type == vvc::NAL_UNIT_PH)
+  {
+    // Picture header NAL unit : the fields are kept for the slices of the picture
+    slice.picHeaderInSliceHeader = false;
+    slice.sliceAddress = -1;
+    slice.type = sliceType::SLICE_UNKNOWN;
+    slice.valid = xParsePictureHeaderPrefix(nal);
+    return !full || !slice.valid || xParsePictureHeaderRest(nal, dataLen);
+  }
+
+  READ_FLAG(uiCode, "sh_picture_header_in_slice_header_flag");
+  slice.picHeaderInSliceHeader = uiCode;
+  if (slice.picHeaderInSliceHeader)
+  {
+    // Single slice picture, the slice type follows the whole picture header and is only known for intra pictures
+    slice.sliceAddress = 0;
+    slice.firstSliceInPic = true;
+    slice.valid = xParsePictureHeaderPrefix(nal);
+    slice.type = slice.interSliceAllowed ? sliceType::SLICE_UNKNOWN : sliceType::SLICE_I;
+    if (!full || !slice.valid)
+      return true;
+    if (!xParsePictureHeaderRest(nal, dataLen))
+      return false;
+    slice.valid = false;
+  }
+
+  slice.sliceAddress = -1;
+  slice.type = sliceType::SLICE_UNKNOWN;
+  if (!xActivateParamSets(nal))
+    return true;
+  vvc::SPS *sps = static_cast<vvc::SPS *>(nal.mpegParamSet.sps);
+  vvc::PPS *pps = static_cast<vvc::PPS *>(nal.mpegParamSet.pps);
+  if (pps->m_sliceMap.empty() && (pps->m_noPicPartitionFlag || pps->m_rectSliceFlag))
+    pps->initRectSliceMap(sps);
+
+  uint32_t subPicIdx = 0;
+  if (sps->m_subPicInfoPresentFlag)
   {
-    switch (payloadType)
+    READ_CODE(sps->m_subPicIdLen, uiCode, "sh_subpic_id");
+    subPicIdx = uiCode;
+    if (sps->m_subPicIdMappingExplicitlySignalledFlag)
     {
-    case SEI::USER_DATA_UNREGISTERED:
-      sei = new SEIuserDataUnregistered;
-      xParseSEIuserDataUnregistered((SEIuserDataUnregistered &)*sei, payloadSize, pDecodedMessageOutputStream);
-      break;
-    // case SEI::DECODING_UNIT_INFO:
-    //   bp = hrd.getBufferingPeriodSEI();
-    //   if (!bp)
-    //   {
-    //     msg(WARNING, "Warning: Found Decoding unit information SEI message, but no active buffering period is available. Ignoring.");
-    //   }
-    //   else
-    //   {
-    //     sei = new SEIDecodingUnitInfo;
-    //     xParseSEIDecodingUnitInfo((SEIDecodingUnitInfo &)*sei, payloadSize, *bp, temporalId, pDecodedMessageOutputStream);
-    //   }
-    //   break;
-    // case SEI::BUFFERING_PERIOD:
-    //   sei = new SEIBufferingPeriod;
-    //   xParseSEIBufferingPeriod((SEIBufferingPeriod &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   hrd.setBufferingPeriodSEI((SEIBufferingPeriod *)sei);
-    //   break;
-    case SEI::PICTURE_TIMING:
-    {
-      bp = hrd.getBufferingPeriodSEI();
-      if (!bp)
-      {
-        vvc::msg(vvc::WARNING, "Warning: Found Picture timing SEI message, but no active buffering period is available. Ignoring.");
-      }
-      else
+      const std::vector<uint16_t> &subPicIds = pps->m_subPicIdMappingInPpsFlag ? pps->m_subPicId : sps->m_subPicId;
+      for (uint32_t i = 0; i < subPicIds.size(); i++)
       {
-        sei = new SEIPictureTimingH266;
-        xParseSEIPictureTiming((SEIPictureTimingH266 &)*sei, payloadSize, temporalId, *bp, pDecodedMessageOutputStream);
-        hrd.setPictureTimingSEI((SEIPictureTimingH266 *)sei);
-      }
-    }
-    break;
-    // case SEI::SCALABLE_NESTING:
-    //   sei = new SEIScalableNesting;
-    //   xParseSEIScalableNesting((SEIScalableNesting &)*sei, nalUnitType, nuh_layer_id, payloadSize, vps, sps, hrd, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::FRAME_FIELD_INFO:
-    //   sei = new SEIFrameFieldInfo;
-    //   xParseSEIFrameFieldinfo((SEIFrameFieldInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::DEPENDENT_RAP_INDICATION:
-    //   sei = new SEIDependentRAPIndication;
-    //   xParseSEIDependentRAPIndication((SEIDependentRAPIndication &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::EXTENDED_DRAP_INDICATION:
-    //   sei = new SEIExtendedDrapIndication;
-    //   xParseSEIExtendedDrapIndication((SEIExtendedDrapIndication &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::FRAME_PACKING:
-    //   sei = new SEIFramePacking;
-    //   xParseSEIFramePacking((SEIFramePacking &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::DISPLAY_ORIENTATION:
-    //   sei = new SEIDisplayOrientation;
-    //   xParseSEIDisplayOrientation((SEIDisplayOrientation &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::ANNOTATED_REGIONS:
-    //   sei = new SEIAnnotatedRegions;
-    //   xParseSEIAnnotatedRegions((SEIAnnotatedRegions &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::PARAMETER_SETS_INCLUSION_INDICATION:
-    //   sei = new SEIParameterSetsInclusionIndication;
-    //   xParseSEIParameterSetsInclusionIndication((SEIParameterSetsInclusionIndication &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    case SEI::MASTERING_DISPLAY_COLOUR_VOLUME:
-      sei = new SEIMasteringDisplayColourVolume;
-      xParseSEIMasteringDisplayColourVolume((SEIMasteringDisplayColourVolume &)*sei, payloadSize, pDecodedMessageOutputStream);
-      break;
-    // case SEI::EQUIRECTANGULAR_PROJECTION:
-    //   sei = new SEIEquirectangularProjection;
-    //   xParseSEIEquirectangularProjection((SEIEquirectangularProjection &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SPHERE_ROTATION:
-    //   sei = new SEISphereRotation;
-    //   xParseSEISphereRotation((SEISphereRotation &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::OMNI_VIEWPORT:
-    //   sei = new SEIOmniViewport;
-    //   xParseSEIOmniViewport((SEIOmniViewport &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::REGION_WISE_PACKING:
-    //   sei = new SEIRegionWisePacking;
-    //   xParseSEIRegionWisePacking((SEIRegionWisePacking &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::GENERALIZED_CUBEMAP_PROJECTION:
-    //   sei = new SEIGeneralizedCubemapProjection;
-    //   xParseSEIGeneralizedCubemapProjection((SEIGeneralizedCubemapProjection &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SCALABILITY_DIMENSION_INFO:
-    //   sei = new SEIScalabilityDimensionInfo;
-    //   xParseSEIScalabilityDimensionInfo((SEIScalabilityDimensionInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::GREEN_METADATA:
-    //   sei = new SEIGreenMetadataInfo;
-    //   xParseSEIGreenMetadataInfo((SEIGreenMetadataInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::MULTIVIEW_ACQUISITION_INFO:
-    //   sei = new SEIMultiviewAcquisitionInfo;
-    //   xParseSEIMultiviewAcquisitionInfo((SEIMultiviewAcquisitionInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::MULTIVIEW_VIEW_POSITION:
-    //   sei = new SEIMultiviewViewPosition;
-    //   xParseSEIMultiviewViewPosition((SEIMultiviewViewPosition &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::ALPHA_CHANNEL_INFO:
-    //   sei = new SEIAlphaChannelInfo;
-    //   xParseSEIAlphaChannelInfo((SEIAlphaChannelInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::DEPTH_REPRESENTATION_INFO:
-    //   sei = new SEIDepthRepresentationInfo;
-    //   xParseSEIDepthRepresentationInfo((SEIDepthRepresentationInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SUBPICTURE_LEVEL_INFO:
-    //   sei = new SEISubpicureLevelInfo;
-    //   xParseSEISubpictureLevelInfo((SEISubpicureLevelInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SAMPLE_ASPECT_RATIO_INFO:
-    //   sei = new SEISampleAspectRatioInfo;
-    //   xParseSEISampleAspectRatioInfo((SEISampleAspectRatioInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    case SEI::USER_DATA_REGISTERED_ITU_T_T35:
-      sei = new SEIUserDataRegistered;
-      xParseSEIUserDataRegistered((SEIUserDataRegistered &)*sei, payloadSize, pDecodedMessageOutputStream);
-      break;
-    // case SEI::FILM_GRAIN_CHARACTERISTICS:
-    //   sei = new SEIFilmGrainCharacteristics;
-    //   xParseSEIFilmGrainCharacteristics((SEIFilmGrainCharacteristics &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    case SEI::CONTENT_LIGHT_LEVEL_INFO:
-      sei = new SEIContentLightLevelInfo;
-      xParseSEIContentLightLevelInfo((SEIContentLightLevelInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-      break;
-    // case SEI::AMBIENT_VIEWING_ENVIRONMENT:
-    //   sei = new SEIAmbientViewingEnvironment;
-    //   xParseSEIAmbientViewingEnvironment((SEIAmbientViewingEnvironment &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::CONTENT_COLOUR_VOLUME:
-    //   sei = new SEIContentColourVolume;
-    //   xParseSEIContentColourVolume((SEIContentColourVolume &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::COLOUR_TRANSFORM_INFO:
-    //   sei = new SEIColourTransformInfo;
-    //   xParseSEIColourTransformInfo((SEIColourTransformInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::CONSTRAINED_RASL_ENCODING:
-    //   sei = new SEIConstrainedRaslIndication;
-    //   xParseSEIConstrainedRaslIndication((SEIConstrainedRaslIndication &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SHUTTER_INTERVAL_INFO:
-    //   sei = new SEIShutterIntervalInfo;
-    //   xParseSEIShutterInterval((SEIShutterIntervalInfo &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::NEURAL_NETWORK_POST_FILTER_CHARACTERISTICS:
-    //   sei = new SEINeuralNetworkPostFilterCharacteristics;
-    //   xParseSEINNPostFilterCharacteristics((SEINeuralNetworkPostFilterCharacteristics &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::NEURAL_NETWORK_POST_FILTER_ACTIVATION:
-    //   sei = new SEINeuralNetworkPostFilterActivation;
-    //   xParseSEINNPostFilterActivation((SEINeuralNetworkPostFilterActivation &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    default:
-      for (uint32_t i = 0; i < payloadSize; i++)
-      {
-        uint32_t seiByte;
-        sei_read_scode(8, seiByte, "unknown prefix SEI payload byte");
-      }
-      vvc::msg(vvc::WARNING, "Unknown prefix SEI message (payloadType = %d) was found!\n", payloadType);
-      if (pDecodedMessageOutputStream)
-      {
-        (*pDecodedMessageOutputStream) << "Unknown prefix SEI message (payloadType = " << payloadType << ") was found!\n";
+        if (subPicIds[i] == uiCode)
+        {
+          subPicIdx = i;
+          break;
+        }
       }
-      break;
     }
   }
+
+  // Rectangular slices of the current subpicture, in increasing slice index (SliceSubpicToPicIdx)
+  const bool rectSlice = pps->m_noPicPartitionFlag || pps->m_rectSliceFlag;
+  const uint32_t numTilesInPic = pps->m_noPicPartitionFlag ? 1 : pps->m_numTileCols * pps->m_numTileRows;
+  std::vector<uint32_t> subPicSlices;
+  if (rectSlice)
+  {
+    for (uint32_t i = 0; i < pps->m_sliceMap.size(); i++)
+    {
+      const std::vector<uint32_t> &ctus = pps->m_sliceMap[i].m_ctuAddrInSlice;
+      if (!ctus.empty() && ctus[0] < pps->m_ctuToSubPicIdx.size() && pps->m_ctuToSubPicIdx[ctus[0]] == subPicIdx)
+        subPicSlices.push_back(i);
+    }
+  }
+
+  uiCode = 0;
+  if (rectSlice && subPicSlices.size() > 1)
+    READ_CODE(ceilLog2((uint32_t)subPicSlices.size()), uiCode, "sh_slice_address");
+  else if (!rectSlice && numTilesInPic > 1)
+    READ_CODE(ceilLog2(numTilesInPic), uiCode, "sh_slice_address");
+  slice.sliceAddress = uiCode;
+  slice.firstSliceInPic = (slice.sliceAddress == 0 && subPicIdx == 0);
+
+  for (size_t i = 0; i < sps->m_extraSHBitPresentFlag.size(); i++)
+  {
+    if (sps->m_extraSHBitPresentFlag[i])
+      READ_FLAG(uiCode, "sh_extra_bit[i]");
+  }
+  uint32_t numTilesInSlice = 1;
+  if (!rectSlice && numTilesInPic - slice.sliceAddress > 1)
+  {
+    READ_UVLC(uiCode, "sh_num_tiles_in_slice_minus1");
+    numTilesInSlice = uiCode + 1;
+  }
+
+  if (slice.interSliceAllowed)
+  {
+    READ_UVLC(uiCode, "sh_slice_type");
+    slice.type = uiCode < 3 ? sliceTypes[uiCode] : sliceType::SLICE_UNKNOWN;
+  }
+  else
+  {
+    slice.type = sliceType::SLICE_I;
+  }
+  if (slice.sliceAddress < 0)
+    return true;
+  const uint32_t sliceAddress = static_cast<uint32_t>(slice.sliceAddress);
+  if (rectSlice && sliceAddress >= subPicSlices.size())
+    return true;
+  slice.valid = true;
+  if (!full)
+    return true;
+
+  // CtbAddrInCurrSlice
+  slice_entry_points &entry = nal.entry;
+  entry.subPicIdx = subPicIdx;
+  entry.sliceIdx = -1;
+  if (rectSlice)
+  {
+    entry.sliceIdx = subPicSlices[sliceAddress];
+    m_ctuAddrInSlice = pps->m_sliceMap[entry.sliceIdx].m_ctuAddrInSlice;
+  }
   else
   {
-    switch (payloadType)
+    if (sliceAddress + numTilesInSlice > numTilesInPic)
+      return false;
+    for (uint32_t tileIdx = sliceAddress; tileIdx < sliceAddress + numTilesInSlice; tileIdx++)
     {
-    case SEI::USER_DATA_UNREGISTERED:
-      sei = new SEIuserDataUnregistered;
-      xParseSEIuserDataUnregistered((SEIuserDataUnregistered &)*sei, payloadSize, pDecodedMessageOutputStream);
-      break;
-    // case SEI::DECODED_PICTURE_HASH:
-    //   sei = new SEIDecodedPictureHash;
-    //   xParseSEIDecodedPictureHash((SEIDecodedPictureHash &)*sei, payloadSize, pDecodedMessageOutputStream);
-    //   break;
-    // case SEI::SCALABLE_NESTING:
-    //   sei = new SEIScalableNesting;
-    //   xParseSEIScalableNesting((SEIScalableNesting &)*sei, nalUnitType, nuh_layer_id, payloadSize, vps, sps, hrd, pDecodedMessageOutputStream);
-    //   break;
-    default:
-      for (uint32_t i = 0; i < payloadSize; i++)
-      {
-        uint32_t seiByte;
-        sei_read_scode(8, seiByte, "unknown suffix SEI payload byte");
-      }
-      vvc::msg(vvc::WARNING, "Unknown suffix SEI message (payloadType = %d) was found!\n", payloadType);
-      break;
+      const uint32_t tileX = tileIdx % pps->m_numTileCols, tileY = tileIdx / pps->m_numTileCols;
+      for (uint32_t ctbY = pps->m_tileRowBd[tileY]; ctbY < pps->m_tileRowBd[tileY + 1]; ctbY++)
+        for (uint32_t ctbX = pps->m_tileColBd[tileX]; ctbX < pps->m_tileColBd[tileX + 1]; ctbX++)
+          m_ctuAddrInSlice.push_back(ctbY * pps->m_picWidthInCtu + ctbX);
     }
   }
+  const bool bSlice = slice.type == sliceType::SLICE_B;
+  const bool pSlice = slice.type == sliceType::SLICE_P;
 
-  if (sei != nullptr)
+  const int nalUnitType = nal.nal_unit_type;
+  if (nalUnitType == vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL || nalUnitType == vvc::NAL_UNIT_CODED_SLICE_IDR_N_LP ||
+      nalUnitType == vvc::NAL_UNIT_CODED_SLICE_CRA || nalUnitType == vvc::NAL_UNIT_CODED_SLICE_GDR)
   {
-    seis.push_back(sei);
+    READ_FLAG(uiCode, "sh_no_output_of_prior_pics_flag");
   }
+  if (sps->m_alfEnabledFlag && !pps->m_alfInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "sh_alf_enabled_flag");
+    if (uiCode)
+      xParseAlfInfo(sps);
+  }
+  if (entry.phLmcsEnabled && !slice.picHeaderInSliceHeader)
+    READ_FLAG(uiCode, "sh_lmcs_used_flag");
+  if (entry.phExplicitScalingListEnabled && !slice.picHeaderInSliceHeader)
+    READ_FLAG(uiCode, "sh_explicit_scaling_list_used_flag");
 
-  int payloadBitsRemaining = getBitstream()->getNumBitsLeft();
-  if (payloadBitsRemaining)
+  uint32_t numRefEntries[2] = {0, 0};
+  if (pps->m_rplInfoInPhFlag)
   {
-    for (; payloadBitsRemaining > 9; payloadBitsRemaining--)
+    numRefEntries[0] = entry.phNumRefEntries[0];
+    numRefEntries[1] = entry.phNumRefEntries[1];
+  }
+  else if ((nalUnitType != vvc::NAL_UNIT_CODED_SLICE_IDR_W_RADL && nalUnitType != vvc::NAL_UNIT_CODED_SLICE_IDR_N_LP) || sps->m_idrRefParamList)
+  {
+    xParseRefPicLists(sps, pps, numRefEntries);
+  }
+  if (HEADER_TRUNCATED())
+    return false;
+
+  // NumRefIdxActive
+  uint32_t numRefIdx[2] = {0, 0};
+  bool numRefIdxOverride = true;
+  uint32_t numRefIdxMinus1[2] = {0, 0};
+  if ((!bSlice && !pSlice) || slice.type == sliceType::SLICE_UNKNOWN)
+  {
+    if (slice.type == sliceType::SLICE_UNKNOWN)
+      return false;
+  }
+  else
+  {
+    if (numRefEntries[0] > 1 || (bSlice && numRefEntries[1] > 1))
+    {
+      READ_FLAG(uiCode, "sh_num_ref_idx_active_override_flag");
+      numRefIdxOverride = uiCode;
+      if (numRefIdxOverride)
+      {
+        for (int i = 0; i < (bSlice ? 2 : 1); i++)
+        {
+          if (numRefEntries[i] > 1)
+          {
+            READ_UVLC(uiCode, "sh_num_ref_idx_active_minus1[i]");
+            numRefIdxMinus1[i] = uiCode;
+          }
+        }
+      }
+    }
+    for (int i = 0; i < (bSlice ? 2 : 1); i++)
     {
-      uint32_t reservedPayloadExtensionData;
-      sei_read_scode(1, reservedPayloadExtensionData, "reserved_payload_extension_data");
+      const uint32_t defaultActive = i ? pps->m_numRefIdxL1DefaultActive : pps->m_numRefIdxL0DefaultActive;
+      numRefIdx[i] = numRefIdxOverride ? numRefIdxMinus1[i] + 1 : std::min(numRefEntries[i], defaultActive);
     }
+    if (numRefIdx[0] > (uint32_t)vvc::MAX_NUM_REF_PICS || numRefIdx[1] > (uint32_t)vvc::MAX_NUM_REF_PICS)
+      return false;
 
-    int finalBits = getBitstream()->peekBits(payloadBitsRemaining);
-    int finalPayloadBits = 0;
-    for (int mask = 0xff; finalBits & (mask >> finalPayloadBits); finalPayloadBits++)
+    if (pps->m_cabacInitPresentFlag)
+      READ_FLAG(uiCode, "sh_cabac_init_flag");
+    if (entry.phTemporalMvpEnabled && !pps->m_rplInfoInPhFlag)
     {
-      continue;
+      uint32_t collocatedFromL0 = 1;
+      if (bSlice)
+        READ_FLAG(collocatedFromL0, "sh_collocated_from_l0_flag");
+      if ((collocatedFromL0 && numRefIdx[0] > 1) || (!collocatedFromL0 && numRefIdx[1] > 1))
+        READ_UVLC(uiCode, "sh_collocated_ref_idx");
     }
+    if (!pps->m_wpInfoInPhFlag && ((pps->m_bUseWeightPred && pSlice) || (pps->m_useWeightedBiPred && bSlice)))
+    {
+      xParsePredWeightTable(sps, pps, numRefIdx, numRefEntries);
+      if (HEADER_TRUNCATED())
+        return false;
+    }
+  }
 
-    for (; payloadBitsRemaining > 9 - finalPayloadBits; payloadBitsRemaining--)
+  if (!pps->m_qpDeltaInfoInPhFlag)
+    READ_SVLC(iCode, "sh_qp_delta");
+  if (pps->m_bSliceChromaQpFlag)
+  {
+    READ_SVLC(iCode, "sh_cb_qp_offset");
+    READ_SVLC(iCode, "sh_cr_qp_offset");
+    if (sps->m_JointCbCrEnabledFlag)
+      READ_SVLC(iCode, "sh_joint_cbcr_qp_offset");
+  }
+  if (pps->m_chromaQpOffsetListLen > 0)
+    READ_FLAG(uiCode, "sh_cu_chroma_qp_offset_enabled_flag");
+  if (sps->m_saoEnabledFlag && !pps->m_saoInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "sh_sao_luma_used_flag");
+    if (sps->m_chromaFormatIdc != vvc::CHROMA_400)
+      READ_FLAG(uiCode, "sh_sao_chroma_used_flag");
+  }
+  if (pps->m_deblockingFilterOverrideEnabledFlag && !pps->m_dbfInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "sh_deblocking_params_present_flag");
+    if (uiCode)
+      xParseDeblockingParams(pps);
+  }
+  uint32_t depQuant = 0, signDataHiding = 0;
+  if (sps->m_depQuantEnabledFlag)
+    READ_FLAG(depQuant, "sh_dep_quant_used_flag");
+  if (sps->m_signDataHidingEnabledFlag && !depQuant)
+    READ_FLAG(signDataHiding, "sh_sign_data_hiding_used_flag");
+  if (sps->m_transformSkipEnabledFlag && !depQuant && !signDataHiding)
+    READ_FLAG(uiCode, "sh_ts_residual_coding_disabled_flag");
+  if (sps->m_spsRangeExtension.m_tsrcRicePresentFlag)
+    READ_CODE(3, uiCode, "sh_ts_residual_coding_rice_idx_minus1");
+  if (sps->m_spsRangeExtension.m_reverseLastSigCoeffEnabledFlag)
+    READ_FLAG(uiCode, "sh_reverse_last_sig_coeff_flag");
+  if (pps->m_sliceHeaderExtensionPresentFlag)
+  {
+    uint32_t extensionLength;
+    READ_UVLC(extensionLength, "sh_slice_header_extension_length");
+    if (8ul * extensionLength > m_pcBitstream->getNumBitsLeft())
+      return false;
+    for (uint32_t i = 0; i < extensionLength; i++)
+      READ_CODE(8, uiCode, "sh_slice_header_extension_data_byte[i]");
+  }
+  if (HEADER_TRUNCATED())
+    return false;
+
+  // NumEntryPoints : a new tile, or a new CTU row with WPP
+  uint32_t numEntryPoints = 0;
+  if (sps->m_entryPointPresentFlag)
+  {
+    const uint32_t picWidthInCtu = pps->m_picWidthInCtu;
+    for (size_t i = 1; i < m_ctuAddrInSlice.size(); i++)
     {
-      uint32_t reservedPayloadExtensionData;
-      sei_read_flag(0, reservedPayloadExtensionData, "reserved_payload_extension_data");
+      const uint32_t ctbX = m_ctuAddrInSlice[i] % picWidthInCtu, ctbY = m_ctuAddrInSlice[i] / picWidthInCtu;
+      const uint32_t prevCtbX = m_ctuAddrInSlice[i - 1] % picWidthInCtu, prevCtbY = m_ctuAddrInSlice[i - 1] / picWidthInCtu;
+      if (pps->m_ctuToTileRow[ctbY] != pps->m_ctuToTileRow[prevCtbY] || pps->m_ctuToTileCol[ctbX] != pps->m_ctuToTileCol[prevCtbX] ||
+          (ctbY != prevCtbY && sps->m_entropyCodingSyncEnabledFlag))
+        numEntryPoints++;
     }
+  }
+  if (numEntryPoints > 0)
+  {
+    READ_UVLC(uiCode, "sh_entry_offset_len_minus1");
+    if (uiCode > 31)
+      return false;
+    const uint32_t offsetLen = uiCode + 1;
+    if ((unsigned long)numEntryPoints * offsetLen > m_pcBitstream->getNumBitsLeft())
+      return false;
+    entryPointOffset->resize(numEntryPoints);
+    for (uint32_t i = 0; i < numEntryPoints; i++)
+    {
+      READ_CODE(offsetLen, uiCode, "sh_entry_point_offset_minus1[i]");
+      (*entryPointOffset)[i] = uiCode + 1;
+    }
+  }
+
+  // byte_alignment() ends on the byte after the current one
+  if (((8ul * m_pcBitstream->m_fifo.size() - m_pcBitstream->getNumBitsLeft()) / 8 + 1) * 8 > 8ul * dataLen)
+    return false;
+  READ_FLAG(uiCode, "byte_alignment_bit_equal_to_one");
+  if (uiCode != 1)
+    return false;
+  while (!isByteAligned())
+  {
+    READ_FLAG(uiCode, "byte_alignment_bit_equal_to_zero");
+    if (uiCode != 0)
+      return false;
+  }
+  return true;
+}
+
+bool parseNalH266::xParsePictureHeaderRest(nal_info &nal, int dataLen)
+{
+  uint32_t uiCode;
+  int iCode;
+  const slice_prefix &slice = nal.slice;
+  slice_entry_points &entry = nal.entry;
+  vvc::SPS *sps = static_cast<vvc::SPS *>(nal.mpegParamSet.sps);
+  const vvc::PPS *pps = static_cast<const vvc::PPS *>(nal.mpegParamSet.pps);
+
+  entry.phLmcsEnabled = false;
+  entry.phExplicitScalingListEnabled = false;
+  entry.phTemporalMvpEnabled = false;
+  entry.phNumRefEntries[0] = 0;
+  entry.phNumRefEntries[1] = 0;
 
-    uint32_t dummy;
-    sei_read_flag(0, dummy, "payload_bit_equal_to_one");
-    payloadBitsRemaining--;
-    while (payloadBitsRemaining)
+  if (sps->m_alfEnabledFlag && pps->m_alfInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "ph_alf_enabled_flag");
+    if (uiCode)
+      xParseAlfInfo(sps);
+  }
+  if (sps->m_lmcsEnabled)
+  {
+    READ_FLAG(uiCode, "ph_lmcs_enabled_flag");
+    entry.phLmcsEnabled = uiCode;
+    if (entry.phLmcsEnabled)
+    {
+      READ_CODE(2, uiCode, "ph_lmcs_aps_id");
+      if (sps->m_chromaFormatIdc != vvc::CHROMA_400)
+        READ_FLAG(uiCode, "ph_chroma_residual_scale_flag");
+    }
+  }
+  if (sps->m_scalingListEnabledFlag)
+  {
+    READ_FLAG(uiCode, "ph_explicit_scaling_list_enabled_flag");
+    entry.phExplicitScalingListEnabled = uiCode;
+    if (entry.phExplicitScalingListEnabled)
+      READ_CODE(3, uiCode, "ph_scaling_list_aps_id");
+  }
+  if (sps->m_virtualBoundariesEnabledFlag && !sps->m_virtualBoundariesPresentFlag)
+  {
+    READ_FLAG(uiCode, "ph_virtual_boundaries_present_flag");
+    if (uiCode)
     {
-      sei_read_flag(0, dummy, "payload_bit_equal_to_zero");
-      payloadBitsRemaining--;
+      uint32_t numBoundaries;
+      READ_UVLC(numBoundaries, "ph_num_ver_virtual_boundaries");
+      if (numBoundaries > 3)
+        return false;
+      for (uint32_t i = 0; i < numBoundaries; i++)
+        READ_UVLC(uiCode, "ph_virtual_boundary_pos_x_minus1[i]");
+      READ_UVLC(numBoundaries, "ph_num_hor_virtual_boundaries");
+      if (numBoundaries > 3)
+        return false;
+      for (uint32_t i = 0; i < numBoundaries; i++)
+        READ_UVLC(uiCode, "ph_virtual_boundary_pos_y_minus1[i]");
     }
   }
+  if (pps->m_OutputFlagPresentFlag && !slice.nonRefPic)
+    READ_FLAG(uiCode, "ph_pic_output_flag");
+  if (pps->m_rplInfoInPhFlag)
+    xParseRefPicLists(sps, pps, entry.phNumRefEntries);
+  if (HEADER_TRUNCATED())
+    return false;
 
-  delete getBitstream();
-  setBitstream(bs);
-  */
-}
\ No newline at end of file
+  uint32_t partitionOverride = 0;
+  if (sps->m_partitionOverrideEnalbed)
+    READ_FLAG(partitionOverride, "ph_partition_constraints_override_flag");
+  if (slice.intraSliceAllowed)
+  {
+    if (partitionOverride)
+    {
+      READ_UVLC(uiCode, "ph_log2_diff_min_qt_min_cb_intra_slice_luma");
+      READ_UVLC(uiCode, "ph_max_mtt_hierarchy_depth_intra_slice_luma");
+      if (uiCode)
+      {
+        READ_UVLC(uiCode, "ph_log2_diff_max_bt_min_qt_intra_slice_luma");
+        READ_UVLC(uiCode, "ph_log2_diff_max_tt_min_qt_intra_slice_luma");
+      }
+      if (sps->m_dualITree)
+      {
+        READ_UVLC(uiCode, "ph_log2_diff_min_qt_min_cb_intra_slice_chroma");
+        READ_UVLC(uiCode, "ph_max_mtt_hierarchy_depth_intra_slice_chroma");
+        if (uiCode)
+        {
+          READ_UVLC(uiCode, "ph_log2_diff_max_bt_min_qt_intra_slice_chroma");
+          READ_UVLC(uiCode, "ph_log2_diff_max_tt_min_qt_intra_slice_chroma");
+        }
+      }
+    }
+    if (pps->m_useDQP)
+      READ_UVLC(uiCode, "ph_cu_qp_delta_subdiv_intra_slice");
+    if (pps->m_chromaQpOffsetListLen > 0)
+      READ_UVLC(uiCode, "ph_cu_chroma_qp_offset_subdiv_intra_slice");
+  }
+  if (slice.interSliceAllowed)
+  {
+    if (partitionOverride)
+    {
+      READ_UVLC(uiCode, "ph_log2_diff_min_qt_min_cb_inter_slice");
+      READ_UVLC(uiCode, "ph_max_mtt_hierarchy_depth_inter_slice");
+      if (uiCode)
+      {
+        READ_UVLC(uiCode, "ph_log2_diff_max_bt_min_qt_inter_slice");
+        READ_UVLC(uiCode, "ph_log2_diff_max_tt_min_qt_inter_slice");
+      }
+    }
+    if (pps->m_useDQP)
+      READ_UVLC(uiCode, "ph_cu_qp_delta_subdiv_inter_slice");
+    if (pps->m_chromaQpOffsetListLen > 0)
+      READ_UVLC(uiCode, "ph_cu_chroma_qp_offset_subdiv_inter_slice");
+    if (sps->m_SPSTemporalMVPEnabledFlag)
+    {
+      READ_FLAG(uiCode, "ph_temporal_mvp_enabled_flag");
+      entry.phTemporalMvpEnabled = uiCode;
+      if (entry.phTemporalMvpEnabled && pps->m_rplInfoInPhFlag)
+      {
+        uint32_t collocatedFromL0 = 1;
+        if (entry.phNumRefEntries[1] > 0)
+          READ_FLAG(collocatedFromL0, "ph_collocated_from_l0_flag");
+        if ((collocatedFromL0 && entry.phNumRefEntries[0] > 1) || (!collocatedFromL0 && entry.phNumRefEntries[1] > 1))
+          READ_UVLC(uiCode, "ph_collocated_ref_idx");
+      }
+    }
+    if (sps->m_fpelMmvdEnabledFlag)
+      READ_FLAG(uiCode, "ph_mmvd_fullpel_only_flag");
+    if (!pps->m_rplInfoInPhFlag || entry.phNumRefEntries[1] > 0)
+    {
+      READ_FLAG(uiCode, "ph_mvd_l1_zero_flag");
+      if (sps->m_BdofControlPresentInPhFlag)
+        READ_FLAG(uiCode, "ph_bdof_disabled_flag");
+      if (sps->m_DmvrControlPresentInPhFlag)
+        READ_FLAG(uiCode, "ph_dmvr_disabled_flag");
+    }
+    if (sps->m_ProfControlPresentInPhFlag)
+      READ_FLAG(uiCode, "ph_prof_disabled_flag");
+    if ((pps->m_bUseWeightPred || pps->m_useWeightedBiPred) && pps->m_wpInfoInPhFlag)
+    {
+      xParsePredWeightTable(sps, pps, entry.phNumRefEntries, entry.phNumRefEntries);
+      if (HEADER_TRUNCATED())
+        return false;
+    }
+  }
+  if (pps->m_qpDeltaInfoInPhFlag)
+    READ_SVLC(iCode, "ph_qp_delta");
+  if (sps->m_JointCbCrEnabledFlag)
+    READ_FLAG(uiCode, "ph_joint_cbcr_sign_flag");
+  if (sps->m_saoEnabledFlag && pps->m_saoInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "ph_sao_luma_enabled_flag");
+    if (sps->m_chromaFormatIdc != vvc::CHROMA_400)
+      READ_FLAG(uiCode, "ph_sao_chroma_enabled_flag");
+  }
+  if (pps->m_dbfInfoInPhFlag)
+  {
+    READ_FLAG(uiCode, "ph_deblocking_params_present_flag");
+    if (uiCode)
+      xParseDeblockingParams(pps);
+  }
+  if (pps->m_pictureHeaderExtensionPresentFlag)
+  {
+    uint32_t extensionLength;
+    READ_UVLC(extensionLength, "ph_extension_length");
+    if (8ul * extensionLength > m_pcBitstream->getNumBitsLeft())
+      return false;
+    for (uint32_t i = 0; i < extensionLength; i++)
+      READ_CODE(8, uiCode, "ph_extension_data_byte[i]");
+  }
+  return !HEADER_TRUNCATED();
+}
+
+#undef HEADER_TRUNCATED
+
+void parseNalH266::xParseAlfInfo(const vvc::SPS *sps)
+{
+  uint32_t uiCode, numApsLuma;
+  READ_CODE(3, numApsLuma, "alf_num_aps_ids_luma");
+  for (uint32_t i = 0; i < numApsLuma; i++)
+    READ_CODE(3, uiCode, "alf_aps_id_luma[i]");
+  uint32_t cb = 0, cr = 0;
+  if (sps->m_chromaFormatIdc != vvc::CHROMA_400)
+  {
+    READ_FLAG(cb, "alf_cb_enabled_flag");
+    READ_FLAG(cr, "alf_cr_enabled_flag");
+  }
+  if (cb || cr)
+    READ_CODE(3, uiCode, "alf_aps_id_chroma");
+  if (sps->m_ccalfEnabledFlag)
+  {
+    READ_FLAG(uiCode, "alf_cc_cb_enabled_flag");
+    if (uiCode)
+      READ_CODE(3, uiCode, "alf_cc_cb_aps_id");
+    READ_FLAG(uiCode, "alf_cc_cr_enabled_flag");
+    if (uiCode)
+      READ_CODE(3, uiCode, "alf_cc_cr_aps_id");
+  }
+}
+
+void parseNalH266::xParseDeblockingParams(const vvc::PPS *pps)
+{
+  uint32_t disabled = 0;
+  int iCode;
+  if (!pps->m_ppsDeblockingFilterDisabledFlag)
+    READ_FLAG(disabled, "deblocking_filter_disabled_flag");
+  if (!disabled)
+  {
+    READ_SVLC(iCode, "luma_beta_offset_div2");
+    READ_SVLC(iCode, "luma_tc_offset_div2");
+    if (pps->m_usePPSChromaTool)
+    {
+      READ_SVLC(iCode, "cb_beta_offset_div2");
+      READ_SVLC(iCode, "cb_tc_offset_div2");
+      READ_SVLC(iCode, "cr_beta_offset_div2");
+      READ_SVLC(iCode, "cr_tc_offset_div2");
+    }
+  }
+}
+
+void parseNalH266::xParseRefPicLists(vvc::SPS *sps, const vvc::PPS *pps, uint32_t numRefEntries[2])
+{
+  uint32_t uiCode;
+  uint32_t rplSpsFlag[2] = {0, 0};
+  uint32_t rplIdx[2] = {0, 0};
+  for (int i = 0; i < 2; i++)
+  {
+    const uint32_t numRpl = i ? sps->m_numRPL1 : sps->m_numRPL0;
+    vvc::RPLList &rplList = i ? sps->m_RPLList1 : sps->m_RPLList0;
+    const bool idxPresent = i == 0 || pps->m_rpl1IdxPresentFlag;
+
+    if (numRpl > 0 && idxPresent)
+      READ_FLAG(rplSpsFlag[i], "rpl_sps_flag[i]");
+    else
+      rplSpsFlag[i] = numRpl == 0 ? 0 : rplSpsFlag[0];
+
+    vvc::ReferencePictureList localRpl;
+    const vvc::ReferencePictureList *rpl = &localRpl;
+    if (rplSpsFlag[i])
+    {
+      if (numRpl > 1 && idxPresent)
+        READ_CODE(ceilLog2(numRpl), rplIdx[i], "rpl_idx[i]");
+      else
+        rplIdx[i] = idxPresent ? 0 : rplIdx[0];
+      if (rplIdx[i] >= numRpl)
+        rplIdx[i] = numRpl - 1;
+      rpl = rplList.getReferencePictureList(rplIdx[i]);
+    }
+    else
+    {
+      localRpl.m_ltrp_in_slice_header_flag = false;
+      parseRefPicList(sps, &localRpl, -1);
+    }
+    numRefEntries[i] = rpl->m_numberOfShorttermPictures + rpl->m_numberOfLongtermPictures + rpl->m_numberOfInterLayerPictures;
+
+    for (int j = 0; j < rpl->m_numberOfLongtermPictures; j++)
+    {
+      if (rpl->m_ltrp_in_slice_header_flag)
+        READ_CODE(sps->m_uiBitsForPOC, uiCode, "poc_lsb_lt[i][j]");
+      READ_FLAG(uiCode, "delta_poc_msb_cycle_present_flag[i][j]");
+      if (uiCode)
+        READ_UVLC(uiCode, "delta_poc_msb_cycle_lt[i][j]");
+    }
+  }
+}
+
+void parseNalH266::xParsePredWeightTable(const vvc::SPS *sps, const vvc::PPS *pps, const uint32_t numRefIdx[2], const uint32_t numRefEntries[2])
+{
+  uint32_t uiCode;
+  int iCode;
+  const bool chroma = sps->m_chromaFormatIdc != vvc::CHROMA_400;
+
+  READ_UVLC(uiCode, "luma_log2_weight_denom");
+  if (chroma)
+    READ_SVLC(iCode, "delta_chroma_log2_weight_denom");
+
+  for (int list = 0; list < 2; list++)
+  {
+    // NumWeightsL0 / NumWeightsL1
+    uint32_t numWeights = numRefIdx[list];
+    if (list == 1 && (!pps->m_useWeightedBiPred || (pps->m_wpInfoInPhFlag && numRefEntries[1] == 0)))
+    {
+      numWeights = 0;
+    }
+    else if (pps->m_wpInfoInPhFlag)
+    {
+      READ_UVLC(numWeights, list ? "num_l1_weights" : "num_l0_weights");
+    }
+    if (numWeights > (uint32_t)vvc::MAX_NUM_REF_PICS)
+      return;
+
+    bool lumaWeight[vvc::MAX_NUM_REF_PICS] = {false};
+    bool chromaWeight[vvc::MAX_NUM_REF_PICS] = {false};
+    for (uint32_t i = 0; i < numWeights; i++)
+    {
+      READ_FLAG(uiCode, "luma_weight_lX_flag[i]");
+      lumaWeight[i] = uiCode;
+    }
+    if (chroma)
+    {
+      for (uint32_t i = 0; i < numWeights; i++)
+      {
+        READ_FLAG(uiCode, "chroma_weight_lX_flag[i]");
+        chromaWeight[i] = uiCode;
+      }
+    }
+    for (uint32_t i = 0; i < numWeights; i++)
+    {
+      if (lumaWeight[i])
+      {
+        READ_SVLC(iCode, "delta_luma_weight_lX[i]");
+        READ_SVLC(iCode, "luma_offset_lX[i]");
+      }
+      if (chromaWeight[i])
+      {
+        for (int j = 0; j < 2; j++)
+        {
+          READ_SVLC(iCode, "delta_chroma_weight_lX[i][j]");
+          READ_SVLC(iCode, "delta_chroma_offset_lX[i][j]");
+        }
+      }
+    }
+  }
+}
+
+void parseNalH266::xSetSubstreams(nal_info &nal, const std::vector<uint32_t> &entryPointOffset, const std::vector<uint32_t> &epbLocation, uint32_t headerOffset, uint32_t nalSize)
+{
+  slice_entry_points &entry = nal.entry;
+  const vvc::SPS *sps = static_cast<const vvc::SPS *>(nal.mpegParamSet.sps);
+  const vvc::PPS *pps = static_cast<const vvc::PPS *>(nal.mpegParamSet.pps);
+
+  entry.firstCtuAddr = m_ctuAddrInSlice[0];
+  entry.numCtus = static_cast<uint32_t>(m_ctuAddrInSlice.size());
+
+  // Position of slice_data() in the RBSP, moved past every emulation prevention byte in front of it
+  uint32_t sliceData = m_pcBitstream->getByteLocation();
+  for (size_t i = 0; i < epbLocation.size() && epbLocation[i] <= sliceData; i++)
+    sliceData++;
+  entry.sliceDataOffset = headerOffset + sliceData;
+
+  uint32_t offset = entry.sliceDataOffset;
+  entry.substreamOffset.push_back(offset);
+  for (size_t i = 0; i < entryPointOffset.size(); i++)
+  {
+    offset += entryPointOffset[i];
+    if (offset >= nalSize)
+      return;
+    entry.substreamSize.push_back(offset - entry.substreamOffset.back());
+    entry.substreamOffset.push_back(offset);
+  }
+  if (offset >= nalSize)
+    return;
+  entry.substreamSize.push_back(nalSize - offset);
+
+  // First CTU of every substream, in the order of CtbAddrInCurrSlice
+  entry.substreamCtuAddr.push_back(m_ctuAddrInSlice[0]);
+  const uint32_t picWidthInCtu = pps->m_picWidthInCtu;
+  for (size_t i = 1; i < m_ctuAddrInSlice.size() && !entryPointOffset.empty(); i++)
+  {
+    const uint32_t ctbX = m_ctuAddrInSlice[i] % picWidthInCtu, ctbY = m_ctuAddrInSlice[i] / picWidthInCtu;
+    const uint32_t prevCtbX = m_ctuAddrInSlice[i - 1] % picWidthInCtu, prevCtbY = m_ctuAddrInSlice[i - 1] / picWidthInCtu;
+    if (pps->m_ctuToTileRow[ctbY] != pps->m_ctuToTileRow[prevCtbY] || pps->m_ctuToTileCol[ctbX] != pps->m_ctuToTileCol[prevCtbX] ||
+        (ctbY != prevCtbY && sps->m_entropyCodingSyncEnabledFlag))
+      entry.substreamCtuAddr.push_back(m_ctuAddrInSlice[i]);
+  }
+  entry.valid = true;
+}
@@ -174,6 +174,153 @@ void vvc::PPS::initRectSlices()
   m_rectSlices.resize(m_numSlicesInPic);
 }
 
+void vvc::PPS::initRectSliceMap(const SPS *sps)
+{
+  if (m_noPicPartitionFlag)
+  {
+    // Single tile and single slice, the partitioning syntax is absent from the PPS
+    resetTileSliceInfo();
+    m_log2CtuSize = floorLog2(sps->m_CTUSize);
+    m_picWidthInCtu = (m_picWidthInLumaSamples + sps->m_CTUSize - 1) >> m_log2CtuSize;
+    m_picHeightInCtu = (m_picHeightInLumaSamples + sps->m_CTUSize - 1) >> m_log2CtuSize;
+    m_numTileCols = 1;
+    m_numTileRows = 1;
+    m_tileColWidth.push_back(m_picWidthInCtu);
+    m_tileRowHeight.push_back(m_picHeightInCtu);
+    m_tileColBd = {0, m_picWidthInCtu};
+    m_tileRowBd = {0, m_picHeightInCtu};
+    m_ctuToTileCol.assign(m_picWidthInCtu + 1, 0);
+    m_ctuToTileRow.assign(m_picHeightInCtu + 1, 0);
+  }
+
+  // CtbToSubpicIdx
+  const uint32_t numSubPics = sps->m_subPicInfoPresentFlag ? sps->m_numSubPics : 1;
+  m_ctuToSubPicIdx.assign(m_picWidthInCtu * m_picHeightInCtu, 0);
+  if (numSubPics > 1)
+  {
+    for (uint32_t i = 0; i < numSubPics; i++)
+    {
+      for (uint32_t y = sps->m_subPicCtuTopLeftY[i]; y < sps->m_subPicCtuTopLeftY[i] + sps->m_subPicHeight[i] && y < m_picHeightInCtu; y++)
+      {
+        for (uint32_t x = sps->m_subPicCtuTopLeftX[i]; x < sps->m_subPicCtuTopLeftX[i] + sps->m_subPicWidth[i] && x < m_picWidthInCtu; x++)
+        {
+          m_ctuToSubPicIdx[y * m_picWidthInCtu + x] = i;
+        }
+      }
+    }
+  }
+
+  m_sliceMap.clear();
+  if (!m_noPicPartitionFlag && !m_rectSliceFlag)
+    return; // Raster scan slices are specified in the slice headers
+
+  if (m_noPicPartitionFlag || m_singleSlicePerSubPicFlag)
+  {
+    // One slice per subpicture, made of whole tiles or of CTU rows of a tile
+    m_numSlicesInPic = numSubPics;
+    m_sliceMap.resize(m_numSlicesInPic);
+    for (uint32_t i = 0; i < numSubPics; i++)
+    {
+      m_sliceMap[i].initSliceMap(i);
+      if (numSubPics == 1)
+      {
+        for (uint32_t tileY = 0; tileY < m_numTileRows; tileY++)
+        {
+          for (uint32_t tileX = 0; tileX < m_numTileCols; tileX++)
+          {
+            m_sliceMap[i].addCtusToSlice(m_tileColBd[tileX], m_tileColBd[tileX + 1], m_tileRowBd[tileY], m_tileRowBd[tileY + 1], m_picWidthInCtu);
+          }
+        }
+        continue;
+      }
+
+      const uint32_t leftX = sps->m_subPicCtuTopLeftX[i], topY = sps->m_subPicCtuTopLeftY[i];
+      const uint32_t rightX = std::min(leftX + sps->m_subPicWidth[i], m_picWidthInCtu) - 1;
+      const uint32_t bottomY = std::min(topY + sps->m_subPicHeight[i], m_picHeightInCtu) - 1;
+      const uint32_t widthInTiles = m_ctuToTileCol[rightX] + 1 - m_ctuToTileCol[leftX];
+      const uint32_t heightInTiles = m_ctuToTileRow[bottomY] + 1 - m_ctuToTileRow[topY];
+      if (heightInTiles == 1 && bottomY + 1 - topY < m_tileRowHeight[m_ctuToTileRow[topY]])
+      {
+        m_sliceMap[i].addCtusToSlice(leftX, rightX + 1, topY, bottomY + 1, m_picWidthInCtu);
+      }
+      else
+      {
+        const uint32_t tileX = m_ctuToTileCol[leftX], tileY = m_ctuToTileRow[topY];
+        for (uint32_t j = 0; j < heightInTiles; j++)
+        {
+          for (uint32_t k = 0; k < widthInTiles; k++)
+          {
+            m_sliceMap[i].addCtusToSlice(m_tileColBd[tileX + k], m_tileColBd[tileX + k + 1], m_tileRowBd[tileY + j], m_tileRowBd[tileY + j + 1], m_picWidthInCtu);
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  CHECK(m_numSlicesInPic > MAX_SLICES || m_rectSlices.size() < m_numSlicesInPic, "Number of slices in picture exceeds valid range");
+  m_sliceMap.resize(m_numSlicesInPic);
+  for (uint32_t i = 0; i < m_numSlicesInPic; i++)
+  {
+    const uint32_t tileX = m_rectSlices[i].m_tileIdx % m_numTileCols;
+    const uint32_t tileY = m_rectSlices[i].m_tileIdx / m_numTileCols;
+
+    // The last slice covers the remaining tiles of the picture
+    if (i == m_numSlicesInPic - 1)
+    {
+      m_rectSlices[i].m_sliceWidthInTiles = m_numTileCols - tileX;
+      m_rectSlices[i].m_sliceHeightInTiles = m_numTileRows - tileY;
+      m_rectSlices[i].m_numSlicesInTile = 1;
+    }
+
+    m_sliceMap[i].initSliceMap(i);
+    if (m_rectSlices[i].m_sliceWidthInTiles > 1 || m_rectSlices[i].m_sliceHeightInTiles > 1 || m_rectSlices[i].m_numSlicesInTile <= 1)
+    {
+      for (uint32_t j = 0; j < m_rectSlices[i].m_sliceHeightInTiles; j++)
+      {
+        for (uint32_t k = 0; k < m_rectSlices[i].m_sliceWidthInTiles; k++)
+        {
+          m_sliceMap[i].addCtusToSlice(m_tileColBd[tileX + k], m_tileColBd[tileX + k + 1], m_tileRowBd[tileY + j], m_tileRowBd[tileY + j + 1], m_picWidthInCtu);
+        }
+      }
+    }
+    else
+    {
+      // Several slices of CTU rows in a single tile
+      const uint32_t numSlicesInTile = m_rectSlices[i].m_numSlicesInTile;
+      uint32_t ctuY = m_tileRowBd[tileY];
+      for (uint32_t j = 0; j < numSlicesInTile && i < m_numSlicesInPic; j++, i++)
+      {
+        m_sliceMap[i].initSliceMap(i);
+        const uint32_t stopY = std::min(ctuY + m_rectSlices[i].m_sliceHeightInCtu, m_tileRowBd[tileY + 1]);
+        m_sliceMap[i].addCtusToSlice(m_tileColBd[tileX], m_tileColBd[tileX + 1], ctuY, stopY, m_picWidthInCtu);
+        ctuY = stopY;
+      }
+      i--;
+    }
+  }
+}
+
+void vvc::SliceMap::initSliceMap(uint32_t sliceID)
+{
+  m_sliceID = sliceID;
+  m_numTilesInSlice = 0;
+  m_numCtuInSlice = 0;
+  m_ctuAddrInSlice.clear();
+}
+
+void vvc::SliceMap::addCtusToSlice(uint32_t startX, uint32_t stopX, uint32_t startY, uint32_t stopY, uint32_t picWidthInCtbs)
+{
+  for (uint32_t ctbY = startY; ctbY < stopY; ctbY++)
+  {
+    for (uint32_t ctbX = startX; ctbX < stopX; ctbX++)
+    {
+      m_ctuAddrInSlice.push_back(ctbY * picWidthInCtbs + ctbX);
+      m_numCtuInSlice++;
+    }
+  }
+}
+
 void vvc::PPS::setChromaQpOffsetListEntry(int cuChromaQpOffsetIdxPlus1, int cbOffset, int crOffset, int jointCbCrOffset)
 {
   CHECK(cuChromaQpOffsetIdxPlus1 == 0 || cuChromaQpOffsetIdxPlus1 > MAX_QP_OFFSET_LIST_SIZE, "Invalid chroma QP offset");
@@ -1,2 +1,728 @@
 #include "nal_parse.h"
 #include "vvc_vlc.h"
+#include "vvc_nal.h"
+
+bool parseSeiH266::xParseSEIBufferingPeriod(SEIBufferingPeriod &sei)
+{
+  int i, nalOrVcl;
+  uint32_t code;
+
+  sei_read_flag(code, "bp_nal_hrd_params_present_flag");
+  sei.bpNalCpbParamsPresentFlag = code;
+  sei_read_flag(code, "bp_vcl_hrd_params_present_flag");
+  sei.bpVclCpbParamsPresentFlag = code;
+
+  sei_read_code(5, code, "initial_cpb_removal_delay_length_minus1");
+  sei.initialCpbRemovalDelayLength = code + 1;
+  sei_read_code(5, code, "cpb_removal_delay_length_minus1");
+  sei.cpbRemovalDelayLength = code + 1;
+  sei_read_code(5, code, "dpb_output_delay_length_minus1");
+  sei.dpbOutputDelayLength = code + 1;
+  sei_read_flag(code, "bp_decoding_unit_hrd_params_present_flag");
+  sei.bpDecodingUnitHrdParamsPresentFlag = code;
+  if (sei.bpDecodingUnitHrdParamsPresentFlag)
+  {
+    sei_read_code(5, code, "du_cpb_removal_delay_increment_length_minus1");
+    sei.duCpbRemovalDelayIncrementLength = code + 1;
+    sei_read_code(5, code, "dpb_output_delay_du_length_minus1");
+    sei.dpbOutputDelayDuLength = code + 1;
+    sei_read_flag(code, "decoding_unit_cpb_params_in_pic_timing_sei_flag");
+    sei.decodingUnitCpbParamsInPicTimingSeiFlag = code;
+    sei_read_flag(code, "decoding_unit_dpb_du_params_in_pic_timing_sei_flag");
+    sei.decodingUnitDpbDuParamsInPicTimingSeiFlag = code;
+  }
+  else
+  {
+    sei.duCpbRemovalDelayIncrementLength = 24;
+    sei.dpbOutputDelayDuLength = 24;
+    sei.decodingUnitCpbParamsInPicTimingSeiFlag = false;
+    sei.decodingUnitDpbDuParamsInPicTimingSeiFlag = false;
+  }
+
+  sei_read_flag(code, "bp_concatenation_flag");
+  sei.concatenationFlag = code;
+  sei_read_flag(code, "additional_concatenation_info_present_flag");
+  sei.additionalConcatenationInfoPresentFlag = code;
+  if (sei.additionalConcatenationInfoPresentFlag)
+  {
+    sei_read_code(sei.initialCpbRemovalDelayLength, code, "max_initial_removal_delay_for_concatenation");
+    sei.maxInitialRemovalDelayForConcatenation = code;
+  }
+
+  sei_read_code(sei.cpbRemovalDelayLength, code, "au_cpb_removal_delay_delta_minus1");
+  sei.auCpbRemovalDelayDelta = code + 1;
+
+  sei_read_code(3, code, "bp_max_sub_layers_minus1");
+  if (code + 1 > MAX_TLAYER)
+  {
+    vvc::msg(vvc::WARNING, "Warning: bp_max_sub_layers_minus1 exceeds the supported number of sub-layers, buffering period SEI ignored\n");
+    return false;
+  }
+  sei.bpMaxSubLayers = code + 1;
+  if (sei.bpMaxSubLayers > 1)
+  {
+    sei_read_flag(code, "cpb_removal_delay_deltas_present_flag");
+    sei.cpbRemovalDelayDeltasPresentFlag = code;
+  }
+  else
+  {
+    sei.cpbRemovalDelayDeltasPresentFlag = false;
+  }
+  if (sei.cpbRemovalDelayDeltasPresentFlag)
+  {
+    sei_read_uvlc(code, "num_cpb_removal_delay_deltas_minus1");
+    if (code > 15)
+    {
+      vvc::msg(vvc::WARNING, "Warning: num_cpb_removal_delay_deltas_minus1 shall be in the range of 0 to 15, buffering period SEI ignored\n");
+      return false;
+    }
+    sei.numCpbRemovalDelayDeltas = code + 1;
+    for (i = 0; i < (int)sei.numCpbRemovalDelayDeltas; i++)
+    {
+      sei_read_code(sei.cpbRemovalDelayLength, code, "cpb_removal_delay_delta[i]");
+      sei.cpbRemovalDelayDelta[i] = code;
+    }
+  }
+  else
+  {
+    sei.numCpbRemovalDelayDeltas = 0;
+  }
+
+  sei_read_uvlc(code, "bp_cpb_cnt_minus1");
+  if (code >= MAX_CPB_CNT)
+  {
+    vvc::msg(vvc::WARNING, "Warning: bp_cpb_cnt_minus1 exceeds the supported number of CPBs, buffering period SEI ignored\n");
+    return false;
+  }
+  sei.bpCpbCnt = code + 1;
+  if (sei.bpMaxSubLayers > 1)
+  {
+    sei_read_flag(code, "bp_sublayer_initial_cpb_removal_delay_present_flag");
+    sei.sublayerInitialCpbRemovalDelayPresentFlag = code;
+  }
+  else
+  {
+    sei.sublayerInitialCpbRemovalDelayPresentFlag = false;
+  }
+  for (i = (sei.sublayerInitialCpbRemovalDelayPresentFlag ? 0 : sei.bpMaxSubLayers - 1); i < (int)sei.bpMaxSubLayers; i++)
+  {
+    for (nalOrVcl = 0; nalOrVcl < 2; nalOrVcl++)
+    {
+      if (((nalOrVcl == 0) && sei.bpNalCpbParamsPresentFlag) ||
+          ((nalOrVcl == 1) && sei.bpVclCpbParamsPresentFlag))
+      {
+        for (int j = 0; j < (int)sei.bpCpbCnt; j++)
+        {
+          sei_read_code(sei.initialCpbRemovalDelayLength, code, nalOrVcl ? "vcl_initial_cpb_removal_delay[i][j]" : "nal_initial_cpb_removal_delay[i][j]");
+          sei.sublayerInitialCpbRemovalDelay[i][j][nalOrVcl] = code;
+          sei_read_code(sei.initialCpbRemovalDelayLength, code, nalOrVcl ? "vcl_initial_cpb_removal_offset[i][j]" : "nal_initial_cpb_removal_offset[i][j]");
+          sei.sublayerInitialCpbRemovalOffset[i][j][nalOrVcl] = code;
+        }
+      }
+    }
+  }
+
+  // Keep the codec independent view of the buffering period on the highest sub-layer
+  for (nalOrVcl = 0; nalOrVcl < 2; nalOrVcl++)
+  {
+    for (int j = 0; j < (int)sei.bpCpbCnt; j++)
+    {
+      sei.initialCpbRemovalDelay[j][nalOrVcl] = sei.sublayerInitialCpbRemovalDelay[sei.bpMaxSubLayers - 1][j][nalOrVcl];
+      sei.initialCpbRemovalDelayOffset[j][nalOrVcl] = sei.sublayerInitialCpbRemovalOffset[sei.bpMaxSubLayers - 1][j][nalOrVcl];
+    }
+  }
+
+  if (sei.bpMaxSubLayers > 1)
+  {
+    sei_read_flag(code, "bp_sublayer_dpb_output_offsets_present_flag");
+    sei.sublayerDpbOutputOffsetsPresentFlag = code;
+  }
+  else
+  {
+    sei.sublayerDpbOutputOffsetsPresentFlag = false;
+  }
+  if (sei.sublayerDpbOutputOffsetsPresentFlag)
+  {
+    for (i = 0; i < (int)sei.bpMaxSubLayers - 1; i++)
+    {
+      sei_read_uvlc(code, "dpb_output_tid_offset[i]");
+      sei.dpbOutputTidOffset[i] = code;
+    }
+    sei.dpbOutputTidOffset[sei.bpMaxSubLayers - 1] = 0;
+  }
+
+  sei_read_flag(code, "bp_alt_cpb_params_present_flag");
+  sei.altCpbParamsPresentFlag = code;
+  if (sei.altCpbParamsPresentFlag)
+  {
+    sei_read_flag(code, "use_alt_cpb_params_flag");
+    sei.useAltCpbParamsFlag = code;
+  }
+  else
+  {
+    sei.useAltCpbParamsFlag = false;
+  }
+  return true;
+}
+
+void parseSeiH266::xParseSEIPictureTiming(SEIPictureTimingH266 &sei, uint32_t payloadSize, const uint32_t temporalId, const SEIBufferingPeriod &bp)
+{
+  uint32_t code;
+  const int maxSubLayers = (int)bp.bpMaxSubLayers;
+
+  if ((int)temporalId >= maxSubLayers)
+  {
+    vvc::msg(vvc::WARNING, "Warning: picture timing SEI of a sub-layer above bp_max_sub_layers_minus1, ignored\n");
+    return;
+  }
+
+  // Sub-layers below temporalId are not signalled in this message, nothing is kept from the previous one
+  for (int i = 0; i < MAX_TLAYER; i++)
+  {
+    sei.m_ptSubLayerDelaysPresentFlag[i] = false;
+    sei.m_cpbRemovalDelayDeltaEnabledFlag[i] = false;
+  }
+  sei_read_code(bp.cpbRemovalDelayLength, code, "pt_cpb_removal_delay_minus1[bp_max_sub_layers_minus1]");
+  sei.m_auCpbRemovalDelay[maxSubLayers - 1] = code + 1;
+  sei.m_ptSubLayerDelaysPresentFlag[maxSubLayers - 1] = true;
+  for (int i = temporalId; i < maxSubLayers - 1; i++)
+  {
+    sei_read_flag(code, "pt_sub_layer_delays_present_flag[i]");
+    sei.m_ptSubLayerDelaysPresentFlag[i] = code;
+    if (sei.m_ptSubLayerDelaysPresentFlag[i])
+    {
+      if (bp.cpbRemovalDelayDeltasPresentFlag)
+      {
+        sei_read_flag(code, "pt_cpb_removal_delay_delta_enabled_flag[i]");
+        sei.m_cpbRemovalDelayDeltaEnabledFlag[i] = code;
+      }
+      else
+      {
+        sei.m_cpbRemovalDelayDeltaEnabledFlag[i] = false;
+      }
+      if (sei.m_cpbRemovalDelayDeltaEnabledFlag[i])
+      {
+        if (bp.numCpbRemovalDelayDeltas > 1)
+        {
+          sei_read_code(ceilLog2(bp.numCpbRemovalDelayDeltas), code, "pt_cpb_removal_delay_delta_idx[i]");
+          sei.m_cpbRemovalDelayDeltaIdx[i] = code;
+        }
+        else
+        {
+          sei.m_cpbRemovalDelayDeltaIdx[i] = 0;
+        }
+      }
+      else
+      {
+        sei_read_code(bp.cpbRemovalDelayLength, code, "pt_cpb_removal_delay_minus1[i]");
+        sei.m_auCpbRemovalDelay[i] = code + 1;
+      }
+    }
+  }
+  sei_read_code(bp.dpbOutputDelayLength, code, "pt_dpb_output_delay");
+  sei.m_picDpbOutputDelay = code;
+
+  if (bp.altCpbParamsPresentFlag)
+  {
+    sei_read_flag(code, "cpb_alt_timing_info_present_flag");
+    sei.m_cpbAltTimingInfoPresentFlag = code;
+  }
+  else
+  {
+    sei.m_cpbAltTimingInfoPresentFlag = false;
+  }
+  if (sei.m_cpbAltTimingInfoPresentFlag)
+  {
+    for (int nalOrVcl = 0; nalOrVcl < 2; nalOrVcl++)
+    {
+      if ((nalOrVcl == 0 && !bp.bpNalCpbParamsPresentFlag) || (nalOrVcl == 1 && !bp.bpVclCpbParamsPresentFlag))
+        continue;
+
+      std::vector<std::vector<uint32_t>> &delayDelta = nalOrVcl ? sei.m_vclCpbAltInitialRemovalDelayDelta : sei.m_nalCpbAltInitialRemovalDelayDelta;
+      std::vector<std::vector<uint32_t>> &offsetDelta = nalOrVcl ? sei.m_vclCpbAltInitialRemovalOffsetDelta : sei.m_nalCpbAltInitialRemovalOffsetDelta;
+      std::vector<uint32_t> &cpbDelayOffset = nalOrVcl ? sei.m_vclCpbDelayOffset : sei.m_nalCpbDelayOffset;
+      std::vector<uint32_t> &dpbDelayOffset = nalOrVcl ? sei.m_vclDpbDelayOffset : sei.m_nalDpbDelayOffset;
+
+      delayDelta.assign(maxSubLayers, std::vector<uint32_t>(bp.bpCpbCnt, 0));
+      offsetDelta.assign(maxSubLayers, std::vector<uint32_t>(bp.bpCpbCnt, 0));
+      cpbDelayOffset.assign(maxSubLayers, 0);
+      dpbDelayOffset.assign(maxSubLayers, 0);
+      for (int i = (bp.sublayerInitialCpbRemovalDelayPresentFlag ? 0 : maxSubLayers - 1); i < maxSubLayers; i++)
+      {
+        for (int j = 0; j < (int)bp.bpCpbCnt; j++)
+        {
+          sei_read_code(bp.initialCpbRemovalDelayLength, code, nalOrVcl ? "vcl_cpb_alt_initial_removal_delay_delta[i][j]" : "nal_cpb_alt_initial_removal_delay_delta[i][j]");
+          delayDelta[i][j] = code;
+          sei_read_code(bp.initialCpbRemovalDelayLength, code, nalOrVcl ? "vcl_cpb_alt_initial_removal_offset_delta[i][j]" : "nal_cpb_alt_initial_removal_offset_delta[i][j]");
+          offsetDelta[i][j] = code;
+        }
+        sei_read_code(bp.cpbRemovalDelayLength, code, nalOrVcl ? "vcl_cpb_delay_offset[i]" : "nal_cpb_delay_offset[i]");
+        cpbDelayOffset[i] = code;
+        sei_read_code(bp.dpbOutputDelayLength, code, nalOrVcl ? "vcl_dpb_delay_offset[i]" : "nal_dpb_delay_offset[i]");
+        dpbDelayOffset[i] = code;
+      }
+    }
+  }
+
+  if (bp.bpDecodingUnitHrdParamsPresentFlag && bp.decodingUnitDpbDuParamsInPicTimingSeiFlag)
+  {
+    sei_read_code(bp.dpbOutputDelayDuLength, code, "pt_dpb_output_du_delay");
+    sei.m_picDpbOutputDuDelay = code;
+  }
+  sei.m_duCommonCpbRemovalDelayFlag = false;
+  if (bp.bpDecodingUnitHrdParamsPresentFlag && bp.decodingUnitCpbParamsInPicTimingSeiFlag)
+  {
+    sei_read_uvlc(code, "pt_num_decoding_units_minus1");
+    // Every decoding unit takes at least one bit of the payload (pt_num_nalus_in_du_minus1)
+    if (code >= 8 * payloadSize)
+    {
+      vvc::msg(vvc::WARNING, "Warning: pt_num_decoding_units_minus1 exceeds the picture timing SEI payload, read as a single decoding unit\n");
+      sei.m_numDecodingUnitsMinus1 = 0;
+      sei.m_numNalusInDuMinus1.assign(1, 0);
+      sei.m_duCpbRemovalDelayMinus1.assign(maxSubLayers, 0);
+      return;
+    }
+    sei.m_numDecodingUnitsMinus1 = code;
+    sei.m_numNalusInDuMinus1.resize(sei.m_numDecodingUnitsMinus1 + 1);
+    sei.m_duCpbRemovalDelayMinus1.resize((sei.m_numDecodingUnitsMinus1 + 1) * maxSubLayers);
+
+    if (sei.m_numDecodingUnitsMinus1 > 0)
+    {
+      sei_read_flag(code, "pt_du_common_cpb_removal_delay_flag");
+      sei.m_duCommonCpbRemovalDelayFlag = code;
+      if (sei.m_duCommonCpbRemovalDelayFlag)
+      {
+        for (int i = temporalId; i < maxSubLayers; i++)
+        {
+          if (sei.m_ptSubLayerDelaysPresentFlag[i])
+          {
+            sei_read_code(bp.duCpbRemovalDelayIncrementLength, code, "pt_du_common_cpb_removal_delay_increment_minus1[i]");
+            sei.m_duCommonCpbRemovalDelayMinus1[i] = code;
+          }
+        }
+      }
+      for (uint32_t i = 0; i <= sei.m_numDecodingUnitsMinus1; i++)
+      {
+        sei_read_uvlc(code, "pt_num_nalus_in_du_minus1[i]");
+        sei.m_numNalusInDuMinus1[i] = code;
+        if (!sei.m_duCommonCpbRemovalDelayFlag && i < sei.m_numDecodingUnitsMinus1)
+        {
+          for (int j = temporalId; j < maxSubLayers; j++)
+          {
+            if (sei.m_ptSubLayerDelaysPresentFlag[j])
+            {
+              sei_read_code(bp.duCpbRemovalDelayIncrementLength, code, "pt_du_cpb_removal_delay_increment_minus1[i][j]");
+              sei.m_duCpbRemovalDelayMinus1[i * maxSubLayers + j] = code;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (bp.additionalConcatenationInfoPresentFlag)
+  {
+    sei_read_flag(code, "pt_delay_for_concatenation_ensured_flag");
+    sei.m_delayForConcatenationEnsureFlag = code;
+  }
+  sei_read_code(8, code, "pt_display_elemental_periods_minus1");
+  sei.m_ptDisplayElementalPeriodsMinus1 = code;
+}
+
+void parseSeiH266::xParseSEIUserDataRegistered(SEIUserDataRegistered &sei, uint32_t payloadSize)
+{
+  uint32_t code;
+  if (payloadSize == 0)
+  {
+    vvc::msg(vvc::WARNING, "Warning: no payload for user_data_registered_itu_t_t35 SEI\n");
+    return;
+  }
+  sei_read_code(8, code, "itu_t_t35_country_code");
+  payloadSize--;
+  if (code == 255)
+  {
+    if (payloadSize == 0)
+    {
+      vvc::msg(vvc::WARNING, "Warning: no country code extension byte in user_data_registered_itu_t_t35 SEI\n");
+      return;
+    }
+    sei_read_code(8, code, "itu_t_t35_country_code_extension_byte");
+    payloadSize--;
+    code += 255;
+  }
+  sei.ituCountryCode = code;
+  sei.userData.resize(payloadSize);
+  for (uint32_t i = 0; i < sei.userData.size(); i++)
+  {
+    sei_read_code(8, code, "itu_t_t35_payload_byte");
+    sei.userData[i] = code;
+  }
+}
+
+void parseSeiH266::xParseSEIUserDataUnregistered(SEIUserDataUnregistered &sei, uint32_t payloadSize)
+{
+  uint32_t code;
+  if (payloadSize < ISO_IEC_11578_LEN)
+  {
+    vvc::msg(vvc::WARNING, "Warning: user_data_unregistered SEI is shorter than its UUID\n");
+    return;
+  }
+
+  for (uint32_t i = 0; i < ISO_IEC_11578_LEN; i++)
+  {
+    sei_read_code(8, code, "uuid_iso_iec_11578");
+    sei.uuid_iso_iec_11578[i] = code;
+  }
+
+  sei.userData.resize(payloadSize - ISO_IEC_11578_LEN);
+  for (uint32_t i = 0; i < sei.userData.size(); i++)
+  {
+    sei_read_code(8, code, "user_data_payload_byte");
+    sei.userData[i] = code;
+  }
+}
+
+void parseSeiH266::xParseSEIRecoveryPoint(SEIRecoveryPoint &sei)
+{
+  int iCode;
+  uint32_t code;
+
+  sei_read_svlc(iCode, "recovery_poc_cnt");
+  sei.recoveryPocCnt = iCode;
+  sei_read_flag(code, "exact_match_flag");
+  sei.exactMatchingFlag = code;
+  sei_read_flag(code, "broken_link_flag");
+  sei.brokenLinkFlag = code;
+}
+
+void parseSeiH266::xParseSEIDecodingUnitInfo(SEIDecodingUnitInfo &sei, const SEIBufferingPeriod &bp, const uint32_t temporalId)
+{
+  uint32_t code;
+
+  for (int i = 0; i < MAX_TLAYER; i++)
+    sei.subLayerDelaysPresentFlag[i] = false;
+
+  sei_read_uvlc(code, "dui_decoding_unit_idx");
+  sei.decodingUnitIdx = code;
+  if (temporalId >= bp.bpMaxSubLayers)
+  {
+    vvc::msg(vvc::WARNING, "Warning: decoding unit information SEI of a sub-layer above bp_max_sub_layers_minus1, ignored\n");
+    return;
+  }
+
+  if (!bp.decodingUnitCpbParamsInPicTimingSeiFlag)
+  {
+    for (uint32_t i = temporalId; i < bp.bpMaxSubLayers; i++)
+    {
+      if (i < bp.bpMaxSubLayers - 1)
+      {
+        sei_read_flag(code, "dui_sub_layer_delays_present_flag[i]");
+        sei.subLayerDelaysPresentFlag[i] = code;
+      }
+      else
+      {
+        sei.subLayerDelaysPresentFlag[i] = true;
+      }
+      if (sei.subLayerDelaysPresentFlag[i])
+      {
+        sei_read_code(bp.duCpbRemovalDelayIncrementLength, code, "dui_du_cpb_removal_delay_increment[i]");
+        sei.duSptCpbRemovalDelayIncrement[i] = code;
+      }
+    }
+  }
+
+  if (!bp.decodingUnitDpbDuParamsInPicTimingSeiFlag)
+  {
+    sei_read_flag(code, "dui_dpb_output_du_delay_present_flag");
+    sei.dpbOutputDuDelayPresentFlag = code;
+  }
+  else
+  {
+    sei.dpbOutputDuDelayPresentFlag = false;
+  }
+  if (sei.dpbOutputDuDelayPresentFlag)
+  {
+    sei_read_code(bp.dpbOutputDelayDuLength, code, "dui_dpb_output_du_delay");
+    sei.picSptDpbOutputDuDelay = code;
+  }
+}
+
+void parseSeiH266::xParseSEIExtendedDrapIndication(SEIExtendedDrapIndication &sei, uint32_t payloadSize)
+{
+  uint32_t code;
+
+  // 4 bytes up to edrap_num_ref_rap_pics_minus1, then 2 bytes per reference
+  if (payloadSize < 4)
+  {
+    vvc::msg(vvc::WARNING, "Warning: extended DRAP indication SEI is shorter than its fixed fields\n");
+    return;
+  }
+  sei_read_code(16, code, "edrap_rap_id_minus1");
+  sei.edrapIdx = code + 1;
+  sei_read_flag(code, "edrap_leading_pictures_decodable_flag");
+  sei.edrapLeadingPicDecodableFlag = code;
+  sei_read_code(12, code, "edrap_reserved_zero_12bits");
+  sei.edrapReservedZero12Bits = code;
+  sei_read_code(3, code, "edrap_num_ref_rap_pics_minus1");
+  sei.edrapNumRefRapPicsMinus1 = code;
+  if (4 + 2 * (code + 1) > payloadSize)
+  {
+    vvc::msg(vvc::WARNING, "Warning: edrap_num_ref_rap_pics_minus1 exceeds the extended DRAP indication SEI payload\n");
+    sei.edrapRefRapId.clear();
+    return;
+  }
+  sei.edrapRefRapId.resize(sei.edrapNumRefRapPicsMinus1 + 1);
+  for (uint32_t i = 0; i <= sei.edrapNumRefRapPicsMinus1; i++)
+  {
+    sei_read_code(16, code, "edrap_ref_rap_id[i]");
+    sei.edrapRefRapId[i] = code;
+  }
+}
+
+void parseSeiH266::xParseSEIScalableNesting(SEIScalableNesting &sei, nal_info &nal, vvc::NalUnitType nalUnitType, uint32_t temporalId, uint32_t payloadSize)
+{
+  uint32_t code;
+  const uint32_t payloadEnd = m_pcBitstream->getByteLocation() + payloadSize;
+
+  sei.olsIdx.clear();
+  sei.maxTemporalId.clear();
+  sei.layerId.clear();
+  sei.subpicId.clear();
+  sei.nestedMessages.clear();
+  sei.bitstreamSubsetFlag = false;
+  sei.defaultOpFlag = false;
+  sei.allLayersFlag = false;
+
+  sei_read_flag(code, "sn_ols_flag");
+  sei.olsFlag = code;
+  sei_read_flag(code, "sn_subpic_flag");
+  sei.subpicFlag = code;
+  if (sei.olsFlag)
+  {
+    sei_read_uvlc(code, "sn_num_olss_minus1");
+    const uint32_t numOlss = code + 1;
+    for (uint32_t i = 0; i < numOlss; i++)
+    {
+      sei_read_uvlc(code, "sn_ols_idx_delta_minus1[i]");
+      sei.olsIdx.push_back(i == 0 ? code : sei.olsIdx[i - 1] + code + 1);
+    }
+  }
+  else
+  {
+    sei_read_flag(code, "sn_all_layers_flag");
+    sei.allLayersFlag = code;
+    if (!sei.allLayersFlag)
+    {
+      sei_read_uvlc(code, "sn_num_layers_minus1");
+      const uint32_t numLayers = code + 1;
+      sei.layerId.push_back(nal.nuh_layer_id);
+      for (uint32_t i = 1; i < numLayers; i++)
+      {
+        sei_read_code(6, code, "sn_layer_id[i]");
+        sei.layerId.push_back(code);
+      }
+    }
+  }
+  if (sei.subpicFlag)
+  {
+    sei_read_uvlc(code, "sn_num_subpics_minus1");
+    const uint32_t numSubpics = code + 1;
+    sei_read_uvlc(code, "sn_subpic_id_len_minus1");
+    const uint32_t idLen = code + 1;
+    for (uint32_t i = 0; i < numSubpics; i++)
+    {
+      sei_read_code(idLen, code, "sn_subpic_id[i]");
+      sei.subpicId.push_back(code);
+    }
+  }
+  sei.maxTemporalId.push_back(MAX_TLAYER - 1);
+
+  sei_read_uvlc(code, "sn_num_seis_minus1");
+  if (code > 63)
+  {
+    vvc::msg(vvc::WARNING, "Warning: sn_num_seis_minus1 shall be in the range of 0 to 63, nested SEI messages ignored\n");
+    return;
+  }
+  const uint32_t numSeis = code + 1;
+  while (!isByteAligned())
+  {
+    sei_read_flag(code, "sn_zero_bit");
+  }
+
+  // Nested messages stay in the SEI RBSP, only the ones of the target OLS / layer are interpreted
+  const bool applies = xNestingAppliesToTarget(sei, nal);
+  for (uint32_t i = 0; i < numSeis && m_pcBitstream->getByteLocation() < payloadEnd; i++)
+  {
+    int nestedType = 0;
+    uint32_t nestedSize = 0;
+    do
+    {
+      sei_read_code(8, code, "payload_type");
+      nestedType += code;
+    } while (code == 0xFF);
+    do
+    {
+      sei_read_code(8, code, "payload_size");
+      nestedSize += code;
+    } while (code == 0xFF);
+
+    SEINestedMessage msg;
+    msg.payloadType = nestedType;
+    msg.payloadSize = nestedSize;
+    msg.payloadOffset = m_pcBitstream->getByteLocation();
+    msg.applied = applies && nestedType != vvc::SCALABLE_NESTING;
+    if (msg.payloadOffset + nestedSize > payloadEnd)
+    {
+      vvc::msg(vvc::WARNING, "Warning: nested SEI message exceeds the scalable nesting payload\n");
+      break;
+    }
+    sei.nestedMessages.push_back(msg);
+
+    if (msg.applied)
+    {
+      xReadSEIPayloadData(nestedType, nestedSize, nal, nalUnitType, temporalId, m_pcBitstream);
+    }
+    m_pcBitstream->m_fifo_idx = msg.payloadOffset + nestedSize;
+    m_pcBitstream->m_num_held_bits = 0;
+  }
+}
+
+bool parseSeiH266::xNestingAppliesToTarget(const SEIScalableNesting &sei, const nal_info &nal)
+{
+  // Sub-picture specific messages do not describe the whole picture
+  if (sei.subpicFlag)
+    return false;
+
+  if (sei.olsFlag)
+  {
+    for (size_t i = 0; i < sei.olsIdx.size(); i++)
+    {
+      if ((int)sei.olsIdx[i] == nal.target_ols_idx)
+        return true;
+    }
+    return false;
+  }
+
+  if (sei.allLayersFlag)
+    return true;
+  for (size_t i = 0; i < sei.layerId.size(); i++)
+  {
+    if ((int)sei.layerId[i] == nal.target_layer_id)
+      return true;
+  }
+  return false;
+}
+
+void parseSeiH266::xParseSEIMasteringDisplayColourVolume(SEIMasteringDisplayColourVolume &sei, uint32_t payloadSize)
+{
+  uint32_t code;
+
+  if (payloadSize < 24)
+  {
+    vvc::msg(vvc::WARNING, "Warning: mastering display colour volume SEI is shorter than its 24 bytes\n");
+    return;
+  }
+  for (int i = 0; i < 3; i++)
+  {
+    sei_read_code(16, code, "mdcv_display_primaries_x[i]");
+    sei.primaries[i][0] = code;
+    sei_read_code(16, code, "mdcv_display_primaries_y[i]");
+    sei.primaries[i][1] = code;
+  }
+  sei_read_code(16, code, "mdcv_white_point_x");
+  sei.white_point[0] = code;
+  sei_read_code(16, code, "mdcv_white_point_y");
+  sei.white_point[1] = code;
+
+  sei_read_code(32, code, "mdcv_max_display_mastering_luminance");
+  sei.max_luminance = code;
+  sei_read_code(32, code, "mdcv_min_display_mastering_luminance");
+  sei.min_luminance = code;
+}
+
+void parseSeiH266::xParseSEIContentLightLevelInfo(SEIContentLightLevelInfo &sei, uint32_t payloadSize)
+{
+  uint32_t code;
+
+  if (payloadSize < 4)
+  {
+    vvc::msg(vvc::WARNING, "Warning: content light level information SEI is shorter than its 4 bytes\n");
+    return;
+  }
+  sei_read_code(16, code, "clli_max_content_light_level");
+  sei.max_content_light_level = code;
+  sei_read_code(16, code, "clli_max_pic_average_light_level");
+  sei.max_pic_average_light_level = code;
+}
+
+void parseSeiH266::xReadSEIPayloadData(int payloadType, int payloadSize, nal_info &nal, vvc::NalUnitType nalUnitType, uint32_t temporalId, InputBitstream *bits)
+{
+  setBitstream(bits);
+  if (nalUnitType == vvc::NAL_UNIT_PREFIX_SEI)
+  {
+    switch (static_cast<vvc::SEIMessageType>(payloadType))
+    {
+    case vvc::SEIMessageType::BUFFERING_PERIOD:
+      nal.vvcSEI.vvc_bp_available = xParseSEIBufferingPeriod(nal.vvcSEI.vvc_sei_bp);
+      break;
+    case vvc::SEIMessageType::PICTURE_TIMING:
+      if (!nal.vvcSEI.vvc_bp_available)
+      {
+        vvc::msg(vvc::WARNING, "Warning: Found Picture timing SEI message, but no active buffering period is available. Ignoring.\n");
+      }
+      else
+      {
+        xParseSEIPictureTiming(nal.vvcSEI.vvc_sei_pt, payloadSize, temporalId, nal.vvcSEI.vvc_sei_bp);
+      }
+      break;
+    case vvc::SEIMessageType::DECODING_UNIT_INFO:
+      if (!nal.vvcSEI.vvc_bp_available)
+      {
+        vvc::msg(vvc::WARNING, "Warning: Found Decoding unit information SEI message, but no active buffering period is available. Ignoring.\n");
+      }
+      else
+      {
+        xParseSEIDecodingUnitInfo(nal.mpegCommonSEI.common_sei_dui, nal.vvcSEI.vvc_sei_bp, temporalId);
+      }
+      break;
+    case vvc::SEIMessageType::USER_DATA_REGISTERED_ITU_T_T35:
+      xParseSEIUserDataRegistered(nal.mpegCommonSEI.common_sei_dr, payloadSize);
+      break;
+    case vvc::SEIMessageType::USER_DATA_UNREGISTERED:
+      xParseSEIUserDataUnregistered(nal.mpegCommonSEI.common_sei_du, payloadSize);
+      break;
+    case vvc::SEIMessageType::RECOVERY_POINT:
+      xParseSEIRecoveryPoint(nal.mpegCommonSEI.common_sei_rp);
+      break;
+    case vvc::SEIMessageType::DEPENDENT_RAP_INDICATION:
+      // dependent_rap_indication( ) has no syntax element, its payload type in nal.sei_types is the indication
+      break;
+    case vvc::SEIMessageType::EXTENDED_DRAP_INDICATION:
+      xParseSEIExtendedDrapIndication(nal.mpegCommonSEI.common_sei_edrap, payloadSize);
+      break;
+    case vvc::SEIMessageType::SCALABLE_NESTING:
+      xParseSEIScalableNesting(nal.mpegCommonSEI.common_sei_sn, nal, nalUnitType, temporalId, payloadSize);
+      break;
+    case vvc::SEIMessageType::MASTERING_DISPLAY_COLOUR_VOLUME:
+      xParseSEIMasteringDisplayColourVolume(nal.mpegCommonSEI.common_sei_mdcv, payloadSize);
+      break;
+    case vvc::SEIMessageType::CONTENT_LIGHT_LEVEL_INFO:
+      xParseSEIContentLightLevelInfo(nal.mpegCommonSEI.common_sei_cll, payloadSize);
+      break;
+    default:
+      // Not interpreted yet, the caller skips the payload by its size
+      break;
+    }
+  }
+  else
+  {
+    switch (static_cast<vvc::SEIMessageType>(payloadType))
+    {
+    case vvc::SEIMessageType::USER_DATA_UNREGISTERED:
+      xParseSEIUserDataUnregistered(nal.mpegCommonSEI.common_sei_du, payloadSize);
+      break;
+    default:
+      break;
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#include <string>
+#include <vector>
+
+#include "nal_parse.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+static bool sameSlice(const slice_prefix &a, const slice_prefix &b)
+{
+    if (a.valid != b.valid)
+        return false;
+    return !a.valid || (a.ppsId == b.ppsId && a.frameNum == b.frameNum && a.pocLsb == b.pocLsb && a.type == b.type &&
+                        a.recoveryPocCnt == b.recoveryPocCnt);
+}
+
+// nal_parse_batch() gives every NAL unit the result nal_parse() gives it on the byte stream, with or without start codes
+static void check(const std::string &label, const std::vector<test_bytes> &nals, videoCodecType codecType)
+{
+    const parsingLevel level = parsingLevel::PARSING_SLICE_PREFIX;
+    NALParse batch;
+    const std::vector<nal_result> results = parseNals(batch, nals, codecType, level);
+
+    // Same NAL units behind their start codes
+    std::vector<test_bytes> withStartCodes;
+    for (size_t i = 0; i < nals.size(); i++)
+        withStartCodes.push_back(byteStream(std::vector<test_bytes>(1, nals[i])));
+    NALParse framedBatch;
+    const std::vector<nal_result> framedResults = parseNals(framedBatch, withStartCodes, codecType, level);
+
+    test_bytes stream = byteStream(nals);
+    NALParse sequential;
+    int pos = 0;
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        sequential.nal_parse(stream.data(), codecType, pos, static_cast<int>(stream.size()), level);
+        const nal_info &nal = *sequential.nal;
+        const std::string what = label + " NAL unit " + std::to_string(i);
+        expect(results[i].nal_unit_type == nal.nal_unit_type && results[i].temporal_id == nal.temporal_id &&
+                   results[i].nuh_layer_id == nal.nuh_layer_id && results[i].sei_type == nal.sei_type,
+               what + " header");
+        expect(sameSlice(results[i].slice, nal.slice), what + " slice prefix");
+        expect(framedResults[i].nal_unit_type == nal.nal_unit_type && sameSlice(framedResults[i].slice, nal.slice),
+               what + " behind a start code");
+    }
+    expect(pos == static_cast<int>(stream.size()), label + " whole stream parsed");
+}
+
+int main()
+{
+    std::vector<test_bytes> h264;
+    h264.push_back(h264Sps(0, 0, 2));
+    h264.push_back(h264Sps(1, 4, 6));
+    h264.push_back(h264Pps(0, 0));
+    h264.push_back(h264Pps(1, 1));
+    h264.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    h264.push_back(h264Slice(false, 5, 1, 200, 8, 900, 10));
+    h264.push_back(h264Slice(false, 5, 0, 3, 4, 40, 6));
+    check("H264", h264, videoCodecType::H264_AVC);
+
+    std::vector<test_bytes> vvc;
+    vvc.push_back(vvcSps(0, 4, true, 0));
+    vvc.push_back(vvcPps(0, 0));
+    vvc.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    vvc.push_back(vvcPh(0, true, 0, 2, 8));
+    vvc.push_back(vvcSlice(0, 1, true));
+    vvc.push_back(seiNal(vvcHeader(23, 0), std::vector<std::pair<int, test_bytes> >(1, std::make_pair(144, test_bytes(4, 1)))));
+    vvc.push_back(vvcSliceWithPh(10, 0, 3, 8, 4));
+    vvc.push_back(vvcHeader(21, 0));
+    check("H266", vvc, videoCodecType::H266_VVC);
+
+    // Buffers shorter than the NAL unit header are skipped
+    std::vector<nal_buffer> buffers(3);
+    const uint8_t header = 0x67;
+    buffers[0].data = vvc[0].data();
+    buffers[0].size = static_cast<uint32_t>(vvc[0].size());
+    buffers[1].data = &header;
+    buffers[1].size = 1;
+    buffers[2].data = vvc[1].data();
+    buffers[2].size = static_cast<uint32_t>(vvc[1].size());
+    std::vector<nal_result> results(3);
+    NALParse parser;
+    const size_t parsed = parser.nal_parse_batch(buffers.data(), buffers.size(), videoCodecType::H266_VVC, parsingLevel::PARSING_SLICE_PREFIX, results.data());
+    expect(parsed == 2 && results[1].nal_unit_type == -1 && results[2].nal_unit_type == 16, "short buffer skipped");
+    return testResult("test_batch");
+}
@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "test_streams.h"
+#include "test_util.h"
+
+// H266/VVC IDR slice carrying its picture header with every slice header field up to byte_alignment(), followed by the given
+// slice data bytes, written as they are (emulation prevention bytes included)
+static test_bytes idrSlice(int numEntryPoints, uint32_t firstSubstreamSize, const test_bytes &sliceData)
+{
+    BitWriter w;
+    w.u(1, 1); // sh_picture_header_in_slice_header_flag
+    vvcPictureHeader(w, 8, false, 0, 0, 8, 0, -1, 0);
+    w.u(1, 0); // sh_no_output_of_prior_pics_flag
+    w.se(0);   // sh_qp_delta
+    if (numEntryPoints > 0)
+    {
+        w.ue(7); // sh_entry_offset_len_minus1
+        w.u(8, firstSubstreamSize - 1);
+    }
+    test_bytes nal = w.nal(vvcHeader(8, 0)); // byte_alignment()
+    nal.insert(nal.end(), sliceData.begin(), sliceData.end());
+    return nal;
+}
+
+static void parse(NALParse &parser, const test_bytes &nal)
+{
+    parser.nal_parse_unit(nal.data(), static_cast<uint32_t>(nal.size()), videoCodecType::H266_VVC,
+                          parsingLevel::PARSING_ENTRY_POINTS);
+}
+
+// 64x64 picture of 2x2 CTUs : with WPP the second CTU row starts the second substream
+static void checkWpp()
+{
+    NALParse parser;
+    parse(parser, vvcSps(0, 4, false, 0, true));
+    parse(parser, vvcPps(0, 0));
+
+    const uint8_t data[] = {0x00, 0x00, 0x03, 0x01, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77};
+    const test_bytes sliceData(data, data + sizeof(data));
+    const test_bytes nal = idrSlice(1, 5, sliceData);
+    const uint32_t sliceDataOffset = static_cast<uint32_t>(nal.size() - sliceData.size());
+    parse(parser, nal);
+
+    const slice_entry_points &entry = parser.nal->entry;
+    expect(parser.nal->slice.valid && parser.nal->slice.type == sliceType::SLICE_I, "WPP slice prefix");
+    expect(entry.valid, "WPP entry points");
+    if (!entry.valid)
+        return;
+    expect(entry.sliceDataOffset == sliceDataOffset, "WPP slice data offset");
+    expect(entry.firstCtuAddr == 0 && entry.numCtus == 4, "WPP CTUs of the slice");
+    expect(entry.sliceIdx == 0 && entry.subPicIdx == 0, "WPP slice index");
+    expect(entry.substreamOffset.size() == 2 && entry.substreamSize.size() == 2 && entry.substreamCtuAddr.size() == 2,
+           "WPP substream count");
+    if (entry.substreamOffset.size() != 2 || entry.substreamSize.size() != 2 || entry.substreamCtuAddr.size() != 2)
+        return;
+    // The emulation prevention byte of the first substream is counted in its entry point offset
+    expect(entry.substreamOffset[0] == sliceDataOffset && entry.substreamSize[0] == 5, "WPP first substream");
+    expect(entry.substreamOffset[1] == sliceDataOffset + 5 && entry.substreamSize[1] == sliceData.size() - 5,
+           "WPP second substream");
+    expect(entry.substreamCtuAddr[0] == 0 && entry.substreamCtuAddr[1] == 2, "WPP first CTU of each substream");
+
+    // Entry point past the end of the NAL unit
+    const test_bytes overrun = idrSlice(1, 200, sliceData);
+    parse(parser, overrun);
+    expect(!parser.nal->entry.valid, "WPP entry point past the NAL unit");
+}
+
+// Without WPP nor tiles the slice data is a single substream and no entry point is signalled
+static void checkSingleSubstream()
+{
+    NALParse parser;
+    parse(parser, vvcSps(0, 4, false, 0));
+    parse(parser, vvcPps(0, 0));
+
+    const test_bytes sliceData(6, 0x5a);
+    const test_bytes nal = idrSlice(0, 0, sliceData);
+    parse(parser, nal);
+
+    const slice_entry_points &entry = parser.nal->entry;
+    expect(entry.valid, "single substream entry points");
+    if (!entry.valid)
+        return;
+    expect(entry.numCtus == 4, "single substream CTUs");
+    expect(entry.substreamOffset.size() == 1 && entry.substreamSize.size() == 1 && entry.substreamCtuAddr.size() == 1,
+           "single substream count");
+    if (entry.substreamOffset.size() == 1 && entry.substreamSize.size() == 1)
+        expect(entry.substreamOffset[0] == nal.size() - sliceData.size() && entry.substreamSize[0] == sliceData.size(),
+               "single substream position");
+
+    // Below PARSING_ENTRY_POINTS the slice header is not read past its prefix
+    parser.nal_parse_unit(nal.data(), static_cast<uint32_t>(nal.size()), videoCodecType::H266_VVC,
+                          parsingLevel::PARSING_SLICE_PREFIX);
+    expect(parser.nal->slice.valid && !parser.nal->entry.valid, "slice prefix without entry points");
+}
+
+int main()
+{
+    checkWpp();
+    checkSingleSubstream();
+    return testResult("test_entry");
+}
@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+
+#include "nal_extract.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+static test_bytes join(const std::vector<struct iovec> &iov)
+{
+    test_bytes out;
+    for (size_t i = 0; i < iov.size(); i++)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(iov[i].iov_base);
+        out.insert(out.end(), p, p + iov[i].iov_len);
+    }
+    return out;
+}
+
+// H266/VVC pictures of TemporalId 0, 2, 1, 2, 0 : extracting up to TemporalId 1 drops the two TemporalId 2 pictures
+static void checkVvc()
+{
+    std::vector<test_bytes> nals;
+    std::vector<test_bytes> kept;
+    const int temporalIds[] = {0, 2, 1, 2, 0};
+    nals.push_back(vvcSps(0, 4, false, 0));
+    nals.push_back(vvcPps(0, 0));
+    kept = nals;
+    for (size_t i = 0; i < 5; i++)
+    {
+        nals.push_back(vvcSlice(i == 0 ? 8 : 0, temporalIds[i], i != 0));
+        if (temporalIds[i] <= 1)
+            kept.push_back(nals.back());
+    }
+    const test_bytes stream = byteStream(nals);
+
+    SubLayerExtractor extractor(videoCodecType::H266_VVC, 1);
+    std::vector<struct iovec> iov;
+    extractor.extract(stream.data(), stream.size(), iov);
+    expect(join(iov) == byteStream(kept), "H266 sub-layers 0 and 1");
+    expect(extractor.keptNals() == 5 && extractor.droppedNals() == 2, "H266 counters");
+    expect(iov.size() == 3, "H266 contiguous NAL units merged : " + std::to_string(iov.size()));
+
+    // Streaming mode gives the same bytes
+    SubLayerExtractor streaming(videoCodecType::H266_VVC, 1);
+    std::vector<struct iovec> streamed;
+    NALParse parser;
+    size_t pos = 0;
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        parser.nal_parse_unit(nals[i].data(), static_cast<uint32_t>(nals[i].size()), videoCodecType::H266_VVC, parsingLevel::PARSING_PARAM_ID);
+        streaming.push(*parser.nal, stream.data() + pos, nals[i].size() + 4, streamed);
+        pos += nals[i].size() + 4;
+    }
+    expect(join(streamed) == byteStream(kept), "H266 streaming mode");
+}
+
+// H264/AVC SVC prefix NAL unit of temporal_id 1 before a base layer slice : the slice follows its prefix
+static void checkH264Prefix()
+{
+    test_bytes prefix(4, 0);
+    prefix[0] = 0x6e; // nal_ref_idc 3, nal_unit_type 14
+    prefix[1] = 0x80; // svc_extension_flag
+    prefix[3] = 1 << 5;
+
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2));
+    nals.push_back(h264Pps(0, 0));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(prefix);
+    nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    nals.push_back(h264Slice(false, 5, 0, 2, 4, 4, 6));
+    std::vector<test_bytes> kept(nals.begin(), nals.begin() + 3);
+    kept.push_back(nals[5]);
+
+    SubLayerExtractor extractor(videoCodecType::H264_AVC, 0);
+    std::vector<struct iovec> iov;
+    const test_bytes stream = byteStream(nals);
+    extractor.extract(stream.data(), stream.size(), iov);
+    expect(join(iov) == byteStream(kept), "H264 prefix and slice of temporal_id 1 dropped");
+    expect(extractor.droppedNals() == 2, "H264 counters");
+}
+
+int main()
+{
+    checkVvc();
+    checkH264Prefix();
+    return testResult("test_extract");
+}
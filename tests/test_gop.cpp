@@ -0,0 +1,50 @@
+#include <string>
+#include <vector>
+
+#include "nal_gop.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// H266/VVC IDR picture and two pictures output in reverse order, end of sequence, then a CRA picture restarting POC at 0
+// followed by two more pictures in reverse order : the reorder depth of the second GOP does not count the first one
+int main()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(vvcSps(0, 4, false, 0));
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    nals.push_back(vvcPh(0, true, 0, 2, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcPh(0, true, 0, 1, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcHeader(21, 0)); // End of sequence
+    nals.push_back(vvcSliceWithPh(9, 0, 0, 8));
+    nals.push_back(vvcPh(0, true, 0, 4, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcPh(0, true, 0, 3, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+
+    NALParse parser;
+    GopAnalyzer analyzer(videoCodecType::H266_VVC);
+    std::vector<gop_stats> gops;
+    int64_t offset = 0;
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        parser.nal_parse_unit(nals[i].data(), static_cast<uint32_t>(nals[i].size()), videoCodecType::H266_VVC,
+                              parsingLevel::PARSING_SLICE_PREFIX);
+        if (analyzer.push(*parser.nal, offset, static_cast<uint32_t>(nals[i].size())))
+            gops.push_back(analyzer.gop());
+        offset += nals[i].size();
+    }
+    while (analyzer.flush())
+        gops.push_back(analyzer.gop());
+
+    expect(gops.size() == 2, "GOPs : " + std::to_string(gops.size()));
+    if (gops.size() != 2)
+        return testResult("test_gop");
+    expect(gops[0].keyNalUnitType == 8 && gops[0].numPictures == 3, "first GOP");
+    expect(gops[0].maxReorder == 1, "reorder depth of the first GOP : " + std::to_string(gops[0].maxReorder));
+    expect(gops[1].keyNalUnitType == 9 && gops[1].numPictures == 3, "second GOP");
+    expect(gops[1].maxReorder == 1, "reorder depth of the GOP after the end of sequence : " + std::to_string(gops[1].maxReorder));
+    return testResult("test_gop");
+}
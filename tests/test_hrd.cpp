@@ -0,0 +1,100 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "nal_hrd.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// H264/AVC SPS of h264Sps(0, 0, 2) with 60 ticks per second and one NAL HRD schedule of 64000 bit/s, 16000 bits
+static test_bytes h264HrdSps()
+{
+    BitWriter w;
+    w.u(8, 66); // profile_idc
+    w.u(8, 0);  // constraint flags
+    w.u(8, 30); // level_idc
+    w.ue(0);    // seq_parameter_set_id
+    w.ue(0);    // log2_max_frame_num_minus4
+    w.ue(0);    // pic_order_cnt_type
+    w.ue(2);    // log2_max_pic_order_cnt_lsb_minus4
+    w.ue(1);    // max_num_ref_frames
+    w.u(1, 0);
+    w.ue(0);   // pic_width_in_mbs_minus1
+    w.ue(0);   // pic_height_in_map_units_minus1
+    w.u(1, 1); // frame_mbs_only_flag
+    w.u(1, 1); // direct_8x8_inference_flag
+    w.u(1, 0); // frame_cropping_flag
+    w.u(1, 1); // vui_parameters_present_flag
+    w.u(1, 0); // aspect_ratio_info_present_flag
+    w.u(1, 0); // overscan_info_present_flag
+    w.u(1, 0); // video_signal_type_present_flag
+    w.u(1, 0); // chroma_loc_info_present_flag
+    w.u(1, 1); // timing_info_present_flag
+    w.u(32, 1);
+    w.u(32, 60);
+    w.u(1, 1); // fixed_frame_rate_flag
+    w.u(1, 1); // nal_hrd_parameters_present_flag
+    w.ue(0);   // cpb_cnt_minus1
+    w.u(4, 0); // bit_rate_scale
+    w.u(4, 0); // cpb_size_scale
+    w.ue(999); // bit_rate_value_minus1 : 1000 * 2^6
+    w.ue(999); // cpb_size_value_minus1 : 1000 * 2^4
+    w.u(1, 0); // cbr_flag
+    w.u(5, 23); // initial_cpb_removal_delay_length_minus1
+    w.u(5, 15); // cpb_removal_delay_length_minus1
+    w.u(5, 15); // dpb_output_delay_length_minus1
+    w.u(5, 0);  // time_offset_length
+    w.u(1, 0); // vcl_hrd_parameters_present_flag
+    w.u(1, 0); // low_delay_hrd_flag
+    w.u(1, 0); // pic_struct_present_flag
+    w.u(1, 0); // bitstream_restriction_flag
+    return w.nal(test_bytes(1, 0x67));
+}
+
+// One IDR then P pictures of 'bytes' bytes each, 'bigBytes' for the picture 'bigIndex'
+static void simulate(CpbAnalyzer &analyzer, size_t numPictures, size_t bytes, size_t bigIndex, size_t bigBytes, uint64_t &streamBits)
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(h264HrdSps());
+    nals.push_back(h264Pps(0, 0));
+    for (size_t i = 0; i < numPictures; i++)
+    {
+        test_bytes slice = h264Slice(i == 0, i == 0 ? 7 : 5, 0, static_cast<int>(i % 16), 4, static_cast<int>(2 * i % 64), 6);
+        slice.resize(i == bigIndex ? bigBytes : bytes, 0x55);
+        nals.push_back(slice);
+    }
+
+    NALParse parser;
+    streamBits = 0;
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        const test_bytes nal = byteStream(std::vector<test_bytes>(1, nals[i]));
+        parser.nal_parse_unit(nal.data(), static_cast<uint32_t>(nal.size()), videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX);
+        analyzer.push(*parser.nal, static_cast<int64_t>(streamBits / 8), static_cast<uint32_t>(nal.size()));
+        streamBits += 8 * nal.size();
+    }
+    analyzer.flush();
+}
+
+int main()
+{
+    // 30 pictures per second of 200 bytes : 48000 bit/s under the 64000 bit/s of the schedule, the CPB is full (16000
+    // bits, 0.25 s) when the first picture is removed and never overflows
+    CpbAnalyzer analyzer(videoCodecType::H264_AVC, 1.0);
+    uint64_t streamBits = 0;
+    simulate(analyzer, 10, 200, 10, 0, streamBits);
+    expect(analyzer.hrdValid() && analyzer.numSchedules() == 1, "schedule of the SPS");
+    const cpb_schedule &s = analyzer.schedule(0);
+    expect(s.bitRate == 64000 && s.cpbSize == 16000 && !s.cbr && std::abs(s.initialDelay - 0.25) < 1e-9, "HRD parameters");
+    expect(analyzer.numAccessUnits() == 10 && s.numAccessUnits == 10, "access units : " + std::to_string(analyzer.numAccessUnits()));
+    expect(s.overflows == 0 && s.underflows == 0 && s.peakFullness <= s.cpbSize && s.minArrivalMargin > 0, "conforming stream");
+    // The ten pictures are removed within 0.3 s : the one second window holds every bit of the stream
+    expect(std::abs(analyzer.peakBitrate() - static_cast<double>(streamBits)) < 1e-6, "peak bitrate of the window");
+
+    // A picture of 3000 bytes (24000 bits) does not fit in the CPB : it arrives after its removal time
+    analyzer.clear();
+    simulate(analyzer, 10, 200, 5, 3000, streamBits);
+    const cpb_schedule &big = analyzer.schedule(0);
+    expect(big.numAccessUnits == 10 && big.underflows > 0 && big.minArrivalMargin < 0, "underflow of a big picture");
+    return testResult("test_hrd");
+}
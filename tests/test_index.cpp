@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "nal_index.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// Access units of a 16x16 H264 stream : IDR, P, P, IDR, P (the last one is still open, auCount leaves it out)
+static std::vector<test_bytes> gop(int firstFrame)
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    nals.push_back(h264Slice(false, 5, 0, 2, 4, 4, 6));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(h264Slice(false, 5, 0, firstFrame, 4, 2 * firstFrame, 6));
+    return nals;
+}
+
+static void checkSeek(const RandomAccessIndex &index, const std::string &label)
+{
+    rai_seek seek;
+    expect(index.size() == 2 && index.header().auCount == 4, label + " entries : " + std::to_string(index.size()));
+    expect(index.seekFrame(2, seek) && seek.point.auIndex == 0 && seek.point.offset == 0, label + " seek to access unit 2");
+    expect(index.seekFrame(4, seek) && seek.point.auIndex == 3 && seek.point.pocLsb == 0 && seek.point.frameNum == 0,
+           label + " seek to access unit 4");
+    expect(seek.paramSets.size() == 2 && seek.paramSets[0].kind == static_cast<uint8_t>(raiParamSetKind::RAI_SPS) &&
+               seek.paramSets[1].kind == static_cast<uint8_t>(raiParamSetKind::RAI_PPS),
+           label + " parameter sets in effect");
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2));
+    nals.push_back(h264Pps(0, 0));
+    const std::vector<test_bytes> slices = gop(1);
+    nals.insert(nals.end(), slices.begin(), slices.end());
+    const test_bytes stream = byteStream(nals);
+
+    const std::string dir = argc > 1 ? argv[1] : ".";
+    const std::string streamPath = dir + "/test_index.264";
+    const std::string indexPath = dir + "/test_index.rai";
+    writeFile(streamPath, stream);
+
+    RandomAccessIndex built;
+    expect(built.build(streamPath.c_str(), videoCodecType::UNDEFINED), "build");
+    checkSeek(built, "built");
+    expect(built.save(indexPath.c_str()), "save");
+
+    // The sidecar is read back through MappedFile, then copied before an update extends it
+    RandomAccessIndex loaded;
+    expect(loaded.load(indexPath.c_str()), "load");
+    checkSeek(loaded, "loaded");
+    expect(loaded.header().codecType == static_cast<int32_t>(videoCodecType::H264_AVC), "codec of the sidecar");
+
+    const std::vector<test_bytes> more = gop(1);
+    test_bytes grown = stream;
+    const test_bytes tail = byteStream(more);
+    grown.insert(grown.end(), tail.begin(), tail.end());
+    writeFile(streamPath, grown);
+    expect(loaded.update(streamPath.c_str()) && loaded.size() == 4, "update of a loaded index : " + std::to_string(loaded.size()));
+
+    // A truncated sidecar is rejected
+    test_bytes sidecar = readFile(indexPath);
+    sidecar.resize(sidecar.size() - 4);
+    writeFile(indexPath, sidecar);
+    expect(!loaded.load(indexPath.c_str()) && loaded.size() == 0, "truncated sidecar");
+    expect(!loaded.load((dir + "/missing.rai").c_str()), "missing sidecar");
+
+    remove(streamPath.c_str());
+    remove(indexPath.c_str());
+    return testResult("test_index");
+}
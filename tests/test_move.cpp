@@ -0,0 +1,94 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test_streams.h"
+#include "test_util.h"
+
+static void parse(NALParse &parser, const test_bytes &nal, videoCodecType codecType)
+{
+    parser.nal_parse_unit(nal.data(), static_cast<uint32_t>(nal.size()), codecType, parsingLevel::PARSING_SLICE_PREFIX);
+}
+
+static void parseParamSets(NALParse &parser)
+{
+    parse(parser, vvcSps(0, 4, false, 0), videoCodecType::H266_VVC);
+    parse(parser, vvcPps(0, 0), videoCodecType::H266_VVC);
+}
+
+// IDR slice of ph_pic_order_cnt_lsb 3 : its prefix is only read with the SPS and the PPS of the parser
+static void checkSlice(NALParse &parser, const std::string &label)
+{
+    parse(parser, vvcSliceWithPh(8, 0, 3, 8), videoCodecType::H266_VVC);
+    expect(parser.nal->slice.valid && parser.nal->slice.pocLsb == 3, "slice prefix " + label);
+}
+
+// The parameter sets and the SEI messages are held in the nal_info of the parser : they follow it when it is moved
+static void checkMove()
+{
+    NALParse first;
+    parseParamSets(first);
+    test_bytes cll(4, 0);
+    cll[1] = 100;
+    cll[3] = 50;
+    parse(first, seiNal(vvcHeader(23, 0), std::vector<std::pair<int, test_bytes> >(1, std::make_pair(144, cll))),
+          videoCodecType::H266_VVC);
+    expect(first.nal->mpegCommonSEI.common_sei_cll.max_content_light_level == 100, "content light level");
+
+    NALParse second(std::move(first));
+    expect(second.nal != first.nal, "moved parser points to its own nal_info");
+    expect(second.nal->mpegParamSet.sps != NULL && second.nal->mpegParamSet.pps != NULL, "parameter sets moved");
+    expect(first.nal->mpegParamSet.sps == NULL && first.nal->mpegParamSet.pps == NULL && first.nal->mpegParamSet.spsList.empty(),
+           "parameter sets left the moved-from parser");
+    expect(second.nal->mpegCommonSEI.common_sei_cll.max_content_light_level == 100 &&
+               second.nal->mpegCommonSEI.common_sei_cll.max_pic_average_light_level == 50,
+           "content light level moved");
+    checkSlice(second, "after a move");
+
+    // Move assignment over a parser of another codec : its own parameter sets are released
+    NALParse third;
+    parse(third, h264Sps(0, 0, 2), videoCodecType::H264_AVC);
+    expect(third.nal->mpegParamSet.codecType == videoCodecType::H264_AVC, "H264 parameter sets");
+    third = std::move(second);
+    expect(third.nal->mpegParamSet.codecType == videoCodecType::H266_VVC, "codec of the assigned parameter sets");
+    checkSlice(third, "after a move assignment");
+
+    // The moved-from parser starts again from its next parameter sets
+    parseParamSets(first);
+    checkSlice(first, "of the moved-from parser");
+}
+
+// Parsers relocated by a growing vector keep their parameter sets
+static void checkVector()
+{
+    std::vector<NALParse> parsers;
+    for (int i = 0; i < 8; i++)
+    {
+        parsers.push_back(NALParse());
+        parseParamSets(parsers.back());
+    }
+    for (size_t i = 0; i < parsers.size(); i++)
+        checkSlice(parsers[i], "of parser " + std::to_string(i) + " in a vector");
+}
+
+// Parameter sets of another codec are dropped when the parser switches codec
+static void checkCodecSwitch()
+{
+    NALParse parser;
+    parse(parser, h264Sps(0, 0, 2), videoCodecType::H264_AVC);
+    parse(parser, h264Pps(0, 0), videoCodecType::H264_AVC);
+    parseParamSets(parser);
+    expect(parser.nal->mpegParamSet.codecType == videoCodecType::H266_VVC, "codec of the parameter sets");
+    checkSlice(parser, "after H264 parameter sets");
+
+    parse(parser, h264Slice(false, 5, 0, 1, 4, 2, 6), videoCodecType::H264_AVC);
+    expect(!parser.nal->slice.valid, "H264 slice without its parameter sets");
+}
+
+int main()
+{
+    checkMove();
+    checkVector();
+    checkCodecSwitch();
+    return testResult("test_move");
+}
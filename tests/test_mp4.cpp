@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "nal_au.h"
+#include "nal_mp4.h"
+#include "test_util.h"
+
+// NAL units of the elementary stream the MP4 files were made from, start codes and trailing zero bytes removed
+static std::vector<std::vector<nal_buffer> > reference(std::vector<unsigned char> &es)
+{
+    const int size = static_cast<int>(es.size());
+    es.resize(es.size() + 16, 0);
+    AccessUnitAssembler assembler(videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX);
+    std::vector<access_unit> aus;
+    assembler.assemble(es.data(), size, aus);
+
+    std::vector<std::vector<nal_buffer> > nals(aus.size());
+    for (size_t i = 0; i < aus.size(); i++)
+    {
+        for (size_t j = 0; j < aus[i].nals.size(); j++)
+        {
+            int64_t start = aus[i].nals[j].offset;
+            int64_t end = std::min<int64_t>(start + aus[i].nals[j].size, size);
+            while (start < end && es[start] == 0)
+                start++;
+            start++; // 0x01 of the start code
+            while (end > start && es[end - 1] == 0)
+                end--;
+            nal_buffer nal;
+            nal.data = es.data() + start;
+            nal.size = static_cast<uint32_t>(end - start);
+            nals[i].push_back(nal);
+        }
+    }
+    return nals;
+}
+
+static bool sameBytes(const nal_buffer &a, const nal_buffer &b)
+{
+    return a.size == b.size && memcmp(a.data, b.data, a.size) == 0;
+}
+
+// small.mp4 (moov sample tables, 4-byte lengths) and small_frag.mp4 (moof with two track fragments, the second one
+// without base data offset, 2-byte lengths) carry the 100 access units of small.264 in track 7 at 30000 Hz, one sample
+// every 1001 ticks with composition offsets of 0, 2002 and 4004, the SPS and PPS of the first IDR in the avcC box
+static void checkFile(const std::string &path, int lengthSize, bool fragmented, const std::vector<std::vector<nal_buffer> > &ref)
+{
+    const std::string label = " (" + path + ")";
+    Mp4Reader reader;
+    expect(reader.open(path.c_str()), "open" + label);
+    expect(reader.codecType() == videoCodecType::H264_AVC, "codec" + label);
+    expect(reader.trackId() == 7 && reader.timescale() == 30000, "track" + label);
+    expect(reader.lengthSize() == lengthSize, "length size" + label);
+    expect(reader.fragmented() == fragmented, "fragmented" + label);
+    expect(reader.numSamples() == 100, "samples" + label + " : " + std::to_string(reader.numSamples()));
+    if (reader.numSamples() != 100 || ref.size() != 100)
+        return;
+
+    const std::vector<nal_buffer> &paramSets = reader.parameterSets();
+    expect(paramSets.size() == 2 && sameBytes(paramSets[0], ref[0][0]) && sameBytes(paramSets[1], ref[0][1]),
+           "parameter sets" + label);
+
+    std::vector<nal_buffer> nals;
+    std::vector<nal_result> results;
+    for (size_t i = 0; i < reader.numSamples(); i++)
+    {
+        const std::string sample = " of sample " + std::to_string(i) + label;
+        const mp4_sample &s = reader.sample(i);
+        const int64_t dts = 1001 * static_cast<int64_t>(i);
+        expect(s.dts == dts && s.pts == dts + 2002 * static_cast<int64_t>(i % 3), "time stamps" + sample);
+        expect(s.sync == (i % 25 == 0), "sync" + sample);
+
+        // The first access unit has its parameter sets in the sample entry only
+        const size_t first = i == 0 ? 2 : 0;
+        expect(reader.sampleNals(i, nals), "length prefixes" + sample);
+        bool same = nals.size() + first == ref[i].size();
+        uint32_t size = 0;
+        for (size_t j = 0; same && j < nals.size(); j++)
+        {
+            same = sameBytes(nals[j], ref[i][first + j]);
+            size += lengthSize + nals[j].size;
+        }
+        expect(same && s.size == size, "NAL units" + sample);
+
+        results.clear();
+        const size_t parsed = reader.parseSample(i, &results);
+        bool valid = parsed == nals.size() && results.size() == nals.size();
+        for (size_t j = 0; valid && j < results.size(); j++)
+        {
+            const int type = results[j].nal_unit_type;
+            valid = type == (nals[j].data[0] & 0x1f) && ((type != 1 && type != 5) || results[j].slice.valid);
+        }
+        expect(valid, "parsed NAL units" + sample);
+    }
+}
+
+// Last track run of small_frag.mp4 rewritten without per-sample fields and with a count of 2^32 - 1 samples : the run
+// does not fit in the file and is skipped instead of reserving memory for its count
+static void checkHugeRun(const std::string &dir)
+{
+    std::vector<unsigned char> file = readFile(dir + "/small_frag.mp4");
+    const unsigned char type[] = {'t', 'r', 'u', 'n'};
+    std::vector<unsigned char>::iterator run = std::find_end(file.begin(), file.end(), type, type + 4);
+    expect(run != file.end(), "last track run");
+    if (run == file.end())
+        return;
+    const unsigned char fields[] = {1, 0, 0, 0, 0xff, 0xff, 0xff, 0xff}; // version, tr_flags, sample_count
+    std::copy(fields, fields + 8, run + 4);
+
+    const std::string path = "test_mp4_trun.mp4";
+    writeFile(path, file);
+    Mp4Reader reader;
+    expect(reader.open(path.c_str()) && reader.numSamples() == 98, "run of 2^32 - 1 samples skipped : " + std::to_string(reader.numSamples()));
+    reader.close();
+    remove(path.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string dir = argc > 1 ? argv[1] : "data";
+    std::vector<unsigned char> es = readFile(dir + "/small.264");
+    expect(!es.empty(), "fixtures in " + dir);
+    if (es.empty())
+        return 1;
+
+    const std::vector<std::vector<nal_buffer> > ref = reference(es);
+    expect(ref.size() == 100, "reference access units");
+
+    checkFile(dir + "/small.mp4", 4, false, ref);
+    checkFile(dir + "/small_frag.mp4", 2, true, ref);
+    checkHugeRun(dir);
+
+    return testResult("test_mp4");
+}
@@ -0,0 +1,41 @@
+#include <string>
+
+#include "nal_parse.h"
+#include "test_util.h"
+
+// Classes of every nal_unit_type value, compared with the tables of the specifications
+static void check(videoCodecType codecType, const std::string &label, int maxType, int vps, int sps, int pps, int aud,
+                  int firstIrap, int lastIrap, int lastVcl)
+{
+    for (int type = 0; type <= maxType; type++)
+    {
+        const std::string what = label + " type " + std::to_string(type);
+        expect(NALParse::nal_is_vps(codecType, type) == (type == vps), what + " VPS");
+        expect(NALParse::nal_is_sps(codecType, type) == (type == sps), what + " SPS");
+        expect(NALParse::nal_is_pps(codecType, type) == (type == pps), what + " PPS");
+        expect(NALParse::nal_is_aud(codecType, type) == (type == aud), what + " AUD");
+        expect(NALParse::nal_is_irap(codecType, type) == (type >= firstIrap && type <= lastIrap), what + " IRAP");
+        const int firstVcl = codecType == videoCodecType::H264_AVC ? 1 : 0;
+        expect(NALParse::nal_is_vcl(codecType, type) == (type >= firstVcl && type <= lastVcl), what + " VCL");
+    }
+}
+
+int main()
+{
+    check(videoCodecType::H264_AVC, "H264", 31, -1, 7, 8, 9, 5, 5, 5);
+    check(videoCodecType::H265_HEVC, "H265", 63, 32, 33, 34, 35, 16, 23, 31);
+    check(videoCodecType::H266_VVC, "H266", 31, 14, 15, 16, 20, 7, 9, 11);
+
+    for (int type = 0; type <= 31; type++)
+    {
+        expect(NALParse::nal_is_aps(videoCodecType::H266_VVC, type) == (type == 17 || type == 18), "H266 APS " + std::to_string(type));
+        expect(NALParse::nal_is_end_of_sequence(videoCodecType::H266_VVC, type) == (type == 21 || type == 22), "H266 EOS " + std::to_string(type));
+        expect(!NALParse::nal_is_aps(videoCodecType::H265_HEVC, type), "H265 APS " + std::to_string(type));
+    }
+    expect(NALParse::nal_is_end_of_sequence(videoCodecType::H264_AVC, 10) && NALParse::nal_is_end_of_sequence(videoCodecType::H264_AVC, 11),
+           "H264 end of sequence and end of stream");
+    expect(NALParse::nal_is_suffix(videoCodecType::H265_HEVC, 40) && !NALParse::nal_is_suffix(videoCodecType::H265_HEVC, 39),
+           "H265 suffix SEI");
+    expect(!NALParse::nal_is_sps(videoCodecType::UNDEFINED, 7), "undefined codec");
+    return testResult("test_nal_types");
+}
@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "nal_ols.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+static test_bytes onLayer(test_bytes nal, int layerId)
+{
+    nal[0] = static_cast<uint8_t>(layerId);
+    return nal;
+}
+
+static test_bytes join(const std::vector<struct iovec> &iov)
+{
+    test_bytes out;
+    for (size_t i = 0; i < iov.size(); i++)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(iov[i].iov_base);
+        out.insert(out.end(), p, p + iov[i].iov_len);
+    }
+    return out;
+}
+
+// OLS 1 of a two-layer VPS where layer 1 uses no sub-layer of layer 0 : of layer 0 only the IRAP pictures and the GDR pictures
+// of ph_recovery_poc_cnt 0 are kept, the layer outside the VPS is dropped, an invalid VPS leaves the layer set in place
+int main()
+{
+    std::vector<test_bytes> nals;
+    std::vector<bool> kept;
+    nals.push_back(vvcVps(1, 0));
+    nals.push_back(vvcSps(0, 4, true, 0));
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    nals.push_back(onLayer(vvcSlice(8, 0, false), 1));
+    kept.insert(kept.end(), 5, true);
+    nals.push_back(vvcPh(0, true, 0, 1, 8));
+    nals.push_back(vvcSlice(0, 0, true)); // Sub-layer 0 of layer 0 is not needed
+    nals.push_back(onLayer(vvcSlice(0, 0, true), 1));
+    nals.push_back(onLayer(vvcSlice(0, 0, true), 2));
+    kept.push_back(true);
+    kept.push_back(false);
+    kept.push_back(true);
+    kept.push_back(false);
+    nals.push_back(vvcSliceWithPh(10, 0, 2, 8, 5));
+    nals.push_back(vvcSliceWithPh(10, 0, 3, 8, 0));
+    kept.push_back(false);
+    kept.push_back(true);
+    nals.push_back(vvcPh(10, false, 0, 4, 8, 0));
+    nals.push_back(vvcSlice(10, 0, false));
+    nals.push_back(vvcPh(10, false, 0, 5, 8, 3));
+    nals.push_back(vvcSlice(10, 0, false));
+    kept.push_back(true);
+    kept.push_back(true);
+    kept.push_back(true);
+    kept.push_back(false);
+    nals.push_back(vvcVps(0, 2)); // vps_video_parameter_set_id 0 is reserved
+    nals.push_back(vvcSlice(0, 0, true));
+    kept.push_back(true);
+    kept.push_back(false);
+
+    std::vector<test_bytes> keptNals;
+    for (size_t i = 0; i < nals.size(); i++)
+        if (kept[i])
+            keptNals.push_back(nals[i]);
+    const test_bytes expected = byteStream(keptNals);
+    test_bytes stream = byteStream(nals);
+
+    // Streaming mode, the GDR pictures known from the slice prefixes
+    NALParse parser;
+    OlsExtractor streaming(1, -1);
+    std::vector<struct iovec> iov;
+    int pos = 0;
+    for (size_t i = 0; i < nals.size() && pos < static_cast<int>(stream.size()); i++)
+    {
+        const int start = pos;
+        parser.nal_parse(stream.data(), videoCodecType::H266_VVC, pos, static_cast<int>(stream.size()), parsingLevel::PARSING_SLICE_PREFIX);
+        const bool k = streaming.push(*parser.nal, stream.data() + start, static_cast<size_t>(pos - start), iov);
+        expect(k == kept[i], "streaming mode NAL unit " + std::to_string(i));
+    }
+    expect(join(iov) == expected, "streaming mode output");
+    expect(streaming.olsValid() && streaming.numLayersInOls() == 2, "streaming mode layer set");
+    expect(streaming.vpsErrors() == 1, "streaming mode VPS errors : " + std::to_string(streaming.vpsErrors()));
+    expect(streaming.keptNals() == 12 && streaming.droppedNals() == 5, "streaming mode counters");
+
+    // Whole-buffer mode, leading zero bytes forwarded
+    OlsExtractor whole(1, -1);
+    iov.clear();
+    stream.insert(stream.begin(), 2, 0);
+    expect(!whole.extract(stream.data(), stream.size(), iov), "whole-buffer mode VPS error");
+    test_bytes leading(2, 0);
+    leading.insert(leading.end(), expected.begin(), expected.end());
+    expect(join(iov) == leading, "whole-buffer mode output");
+    expect(whole.vpsErrors() == 1 && whole.keptNals() == 12 && whole.droppedNals() == 5, "whole-buffer mode counters");
+
+    // OLS 0 is layer 0 alone, with every sub-layer
+    OlsExtractor base(0, -1);
+    iov.clear();
+    expect(!base.extract(stream.data(), stream.size(), iov), "OLS 0 VPS error");
+    expect(base.numLayersInOls() == 1 && base.droppedNals() == 3, "OLS 0 drops the layer 1 and 2 slices");
+    return testResult("test_ols");
+}
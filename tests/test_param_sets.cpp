@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+
+#include "nal_parse.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// Two SPS of different frame_num and pic_order_cnt_lsb lengths, three PPS, slices switching between them : every slice
+// prefix is parsed with the lengths of the parameter sets it refers to, which become the active ones
+static void checkH264()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2)); // frame_num on 4 bits, pic_order_cnt_lsb on 6 bits
+    nals.push_back(h264Sps(1, 4, 6)); // 8 and 10 bits
+    nals.push_back(h264Pps(0, 0));
+    nals.push_back(h264Pps(1, 1));
+    nals.push_back(h264Pps(7, 0));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(h264Slice(false, 5, 1, 200, 8, 900, 10));
+    nals.push_back(h264Slice(false, 5, 7, 3, 4, 40, 6));
+    nals.push_back(h264Slice(false, 5, 2, 1, 4, 2, 6)); // PPS 2 never received
+
+    NALParse parser;
+    const std::vector<nal_result> results = parseNals(parser, nals, videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX);
+    expect(parser.nal->mpegParamSet.findSps(1) && parser.nal->mpegParamSet.findPps(7) && !parser.nal->mpegParamSet.findPps(2),
+           "H264 parameter sets by id");
+
+    const slice_prefix &idr = results[5].slice;
+    expect(idr.valid && idr.ppsId == 0 && idr.frameNum == 0 && idr.pocLsb == 0, "H264 slice of PPS 0");
+    const slice_prefix &p1 = results[6].slice;
+    expect(p1.valid && p1.ppsId == 1 && p1.frameNum == 200 && p1.pocLsb == 900, "H264 slice of PPS 1");
+    const slice_prefix &p7 = results[7].slice;
+    expect(p7.valid && p7.ppsId == 7 && p7.frameNum == 3 && p7.pocLsb == 40, "H264 slice of PPS 7");
+    expect(!results[8].slice.valid, "H264 slice of a missing PPS");
+
+    const avc::pps *pps = static_cast<const avc::pps *>(parser.nal->mpegParamSet.pps);
+    const avc::sps *sps = static_cast<const avc::sps *>(parser.nal->mpegParamSet.sps);
+    expect(pps && pps->pic_parameter_set_id == 7 && sps && sps->seq_parameter_set_id == 0, "H264 active parameter sets");
+}
+
+// Same with H266/VVC : the picture header gives the PPS, the PPS gives the SPS, slices follow their picture header
+static void checkVvc()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(vvcSps(0, 4, false, 0)); // ph_pic_order_cnt_lsb on 8 bits
+    nals.push_back(vvcSps(1, 0, false, 0)); // on 4 bits
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcPps(3, 1));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    nals.push_back(vvcPh(0, true, 3, 9, 4));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcPh(0, true, 0, 200, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcPh(0, true, 5, 1, 8)); // PPS 5 never received
+    nals.push_back(vvcSlice(0, 0, true));
+
+    NALParse parser;
+    const std::vector<nal_result> results = parseNals(parser, nals, videoCodecType::H266_VVC, parsingLevel::PARSING_SLICE_PREFIX);
+    expect(parser.nal->mpegParamSet.findSps(1) && parser.nal->mpegParamSet.findPps(3) && !parser.nal->mpegParamSet.findPps(5),
+           "H266 parameter sets by id");
+
+    const slice_prefix &idr = results[4].slice;
+    expect(idr.valid && idr.ppsId == 0 && idr.pocLsb == 0 && idr.type == sliceType::SLICE_I, "H266 slice of PPS 0");
+    expect(results[5].slice.valid && results[5].slice.pocLsb == 9, "H266 picture header of PPS 3");
+    const slice_prefix &p3 = results[6].slice;
+    expect(p3.valid && p3.ppsId == 3 && p3.pocLsb == 9 && p3.type == sliceType::SLICE_P, "H266 slice of PPS 3");
+    const slice_prefix &p0 = results[8].slice;
+    expect(p0.valid && p0.ppsId == 0 && p0.pocLsb == 200, "H266 slice of PPS 0 after PPS 3");
+    expect(!results[9].slice.valid && !results[10].slice.valid, "H266 picture of a missing PPS");
+
+    const vvc::PPS *pps = static_cast<const vvc::PPS *>(parser.nal->mpegParamSet.pps);
+    const vvc::SPS *sps = static_cast<const vvc::SPS *>(parser.nal->mpegParamSet.sps);
+    expect(pps && pps->m_PPSId == 0 && sps && sps->m_SPSId == 0, "H266 active parameter sets");
+}
+
+int main()
+{
+    checkH264();
+    checkVvc();
+    return testResult("test_param_sets");
+}
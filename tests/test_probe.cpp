@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "nal_probe.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+static test_bytes h264Stream()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2));
+    nals.push_back(h264Pps(0, 0));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    return byteStream(nals);
+}
+
+// H265/HEVC NAL unit headers with the leading bytes of a VPS and an SPS of the Main profile, the remaining bytes are not scored
+static test_bytes h265Stream()
+{
+    const uint8_t vps[] = {0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60};
+    const uint8_t sps[] = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00};
+    const uint8_t pps[] = {0x44, 0x01, 0xc1, 0x72};
+    const uint8_t idr[] = {0x26, 0x01, 0xaf, 0x06};
+    const uint8_t trail[] = {0x02, 0x01, 0xd0, 0x0a};
+    std::vector<test_bytes> nals;
+    nals.push_back(test_bytes(vps, vps + sizeof(vps)));
+    nals.push_back(test_bytes(sps, sps + sizeof(sps)));
+    nals.push_back(test_bytes(pps, pps + sizeof(pps)));
+    nals.push_back(test_bytes(idr, idr + sizeof(idr)));
+    nals.push_back(test_bytes(trail, trail + sizeof(trail)));
+    return byteStream(nals);
+}
+
+static test_bytes h266Stream()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(vvcSps(0, 4, false, 0));
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    nals.push_back(vvcPh(0, true, 0, 1, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    return byteStream(nals);
+}
+
+// H264 filler data NAL unit of 1000 bytes
+static test_bytes filler()
+{
+    test_bytes nal(1000, 0xff);
+    nal[0] = 0x0c;
+    nal.back() = 0x80;
+    return nal;
+}
+
+// Mastering display colour volume and content light level messages ahead of the first IDR picture, then fillerCount filler
+// data NAL units placed after the PPS or after the IDR picture
+static test_bytes h264HdrStream(int fillerCount, bool fillerBeforeIdr)
+{
+    test_bytes mdcv(24, 0);
+    const uint8_t luminance[] = {0x00, 0x98, 0x96, 0x80, 0x00, 0x00, 0x00, 0x32}; // 1000 and 0.005 cd/m2
+    std::copy(luminance, luminance + sizeof(luminance), mdcv.begin() + 16);
+    const uint8_t cll[] = {0x03, 0xe8, 0x01, 0x90};
+    std::vector<std::pair<int, test_bytes> > messages;
+    messages.push_back(std::make_pair(137, mdcv));
+    messages.push_back(std::make_pair(144, test_bytes(cll, cll + sizeof(cll))));
+
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2));
+    nals.push_back(h264Pps(0, 0));
+    nals.insert(nals.end(), fillerBeforeIdr ? fillerCount : 0, filler());
+    nals.push_back(seiNal(test_bytes(1, 6), messages));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.insert(nals.end(), fillerBeforeIdr ? 0 : fillerCount, filler());
+    nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    return byteStream(nals);
+}
+
+static void checkDetect(const test_bytes &stream, videoCodecType codecType, uint32_t numNalUnits, const std::string &label)
+{
+    codec_probe probe;
+    expect(DetectCodec(stream.data(), stream.size(), probe) == codecType && probe.codecType == codecType, label + " detected");
+    expect(probe.numNalUnits == numNalUnits && probe.bytesProbed == stream.size(), label + " NAL units probed");
+    expect(probe.confidence > 0.5 && probe.confidence <= 1, label + " confidence");
+}
+
+static void checkUndetected(const test_bytes &stream, const std::string &label)
+{
+    codec_probe probe;
+    expect(DetectCodec(stream.data(), stream.size(), probe) == videoCodecType::UNDEFINED && probe.confidence == 0, label);
+}
+
+static void checkMediaInfo(const std::string &dir)
+{
+    media_info info;
+    const test_bytes h264 = h264HdrStream(0, false);
+    expect(ProbeMediaInfo(h264.data(), h264.size(), info), "H264 media information");
+    expect(info.valid && info.complete && info.codecType == videoCodecType::H264_AVC, "H264 probe complete");
+    expect(info.width == 16 && info.height == 16 && info.codedWidth == 16 && info.codedHeight == 16 && !info.interlaced, "H264 picture size");
+    expect(info.profileIdc == 66 && info.levelIdc == 30 && info.level == 3.0 && !info.highTier, "H264 profile and level");
+    expect(info.chromaFormatIdc == 1 && info.bitDepthLuma == 8 && info.bitDepthChroma == 8, "H264 sample format");
+    expect(!info.colourDescription && info.colourPrimaries == 2 && !info.hdr && info.frameRate == 0, "H264 without VUI");
+    expect(info.masteringDisplay && info.maxDisplayLuminance == 10000000 && info.minDisplayLuminance == 50, "mastering display");
+    expect(info.contentLightLevel && info.maxContentLightLevel == 1000 && info.maxPicAverageLightLevel == 400, "content light level");
+
+    // The multi-layer H266 stream is complete once its VPS is found too
+    std::vector<test_bytes> nals;
+    nals.push_back(vvcSps(0, 4, false, 0));
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    test_bytes vvc = byteStream(nals);
+    expect(ProbeMediaInfo(vvc.data(), vvc.size(), info) && info.codecType == videoCodecType::H266_VVC && !info.complete,
+           "H266 probe without VPS");
+    nals.insert(nals.begin(), vvcVps(1, 1));
+    vvc = byteStream(nals);
+    expect(ProbeMediaInfo(vvc.data(), vvc.size(), info) && info.complete, "H266 probe with VPS");
+    expect(info.width == 64 && info.height == 64 && info.chromaFormatIdc == 0 && info.bitDepthLuma == 8, "H266 picture format");
+
+    // A file is read by chunks until the first IDR picture : the filler data behind it is not read
+    const std::string path = dir + "/test_probe.264";
+    const test_bytes longStream = h264HdrStream(300, false);
+    writeFile(path, longStream);
+    expect(ProbeMediaInfo(path.c_str(), info) && info.complete && info.contentLightLevel, "H264 file probe");
+    expect(info.bytesRead < longStream.size() / 2, "file probe stops at the first IDR picture");
+
+    // Bounded by maxBytes before the IDR picture
+    writeFile(path, h264HdrStream(300, true));
+    expect(ProbeMediaInfo(path.c_str(), info, videoCodecType::H264_AVC, 100000) && info.valid && !info.complete, "file probe bounded");
+    expect(info.bytesRead == 100000 && !info.contentLightLevel, "bytes read by a bounded file probe");
+    remove(path.c_str());
+
+    expect(!ProbeMediaInfo(path.c_str(), info) && !info.valid, "missing file");
+    const test_bytes garbage(100, 0x5a);
+    expect(!ProbeMediaInfo(garbage.data(), garbage.size(), info) && info.codecType == videoCodecType::UNDEFINED, "no codec detected");
+}
+
+int main(int argc, char *argv[])
+{
+    const test_bytes h264 = h264Stream();
+    checkDetect(h264, videoCodecType::H264_AVC, 4, "H264");
+    checkDetect(h265Stream(), videoCodecType::H265_HEVC, 5, "H265");
+    checkDetect(h266Stream(), videoCodecType::H266_VVC, 5, "H266");
+
+    // No start code, or only NAL unit headers with forbidden_zero_bit set
+    test_bytes garbage(1000);
+    for (size_t i = 0; i < garbage.size(); i++)
+        garbage[i] = static_cast<uint8_t>(i * 37 + 11);
+    checkUndetected(garbage, "bytes without start code");
+    std::vector<test_bytes> forbidden(4, test_bytes(4, 0xff));
+    checkUndetected(byteStream(forbidden), "forbidden_zero_bit set");
+    codec_probe probe;
+    expect(DetectCodec(NULL, 0, probe) == videoCodecType::UNDEFINED && probe.numNalUnits == 0, "no data");
+
+    // Only the first maxBytes are read : the SPS alone
+    expect(DetectCodec(h264.data(), h264.size(), probe, 12) == videoCodecType::H264_AVC && probe.bytesProbed == 12 && probe.numNalUnits == 1,
+           "first bytes only");
+
+    // nal_parse() given UNDEFINED detects the codec from its first buffer and keeps it
+    NALParse parser;
+    test_bytes buffer = h264;
+    int pos = 0;
+    parser.nal_parse(buffer.data(), videoCodecType::UNDEFINED, pos, static_cast<int>(buffer.size()), parsingLevel::PARSING_SLICE_PREFIX);
+    expect(parser.nal->codecType == videoCodecType::H264_AVC && parser.nal->nal_unit_type == 7, "codec detected by nal_parse()");
+    while (pos < static_cast<int>(buffer.size()))
+        parser.nal_parse(buffer.data(), videoCodecType::UNDEFINED, pos, static_cast<int>(buffer.size()), parsingLevel::PARSING_SLICE_PREFIX);
+    expect(parser.nal->nal_unit_type == 1 && parser.nal->slice.valid && parser.nal->slice.frameNum == 1, "detected codec kept");
+
+    NALParse undetected;
+    pos = 0;
+    undetected.nal_parse(garbage.data(), videoCodecType::UNDEFINED, pos, static_cast<int>(garbage.size()), parsingLevel::PARSING_SLICE_PREFIX);
+    expect(undetected.nal->nal_unit_type == -1 && pos == static_cast<int>(garbage.size()), "nal_parse() without a detected codec");
+
+    checkMediaInfo(argc > 1 ? argv[1] : ".");
+    return testResult("test_probe");
+}
@@ -0,0 +1,44 @@
+#include <string>
+#include <vector>
+
+#include "nal_rap.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// H266/VVC IDR picture then GDR pictures of ph_recovery_poc_cnt 5 and 0, in picture header NAL units or in the slice header
+int main()
+{
+    std::vector<test_bytes> nals;
+    nals.push_back(vvcSps(0, 4, true, 0));
+    nals.push_back(vvcPps(0, 0));
+    nals.push_back(vvcSliceWithPh(8, 0, 0, 8));
+    nals.push_back(vvcPh(10, false, 0, 1, 8, 5));
+    nals.push_back(vvcSlice(10, 0, false));
+    nals.push_back(vvcPh(0, true, 0, 2, 8));
+    nals.push_back(vvcSlice(0, 0, true));
+    nals.push_back(vvcSliceWithPh(10, 0, 3, 8, 0));
+
+    const parsingLevel levels[] = {parsingLevel::PARSING_SLICE_PREFIX, parsingLevel::PARSING_PARAM_ID};
+    for (size_t l = 0; l < 2; l++)
+    {
+        const std::string label = l == 0 ? " with slice prefixes" : " without slice prefixes";
+        NALParse parser;
+        RapClassifier classifier(videoCodecType::H266_VVC, levels[l]);
+        for (size_t i = 0; i < nals.size(); i++)
+        {
+            parser.nal_parse_unit(nals[i].data(), static_cast<uint32_t>(nals[i].size()), videoCodecType::H266_VVC, levels[l]);
+            classifier.push(*parser.nal, static_cast<int64_t>(i));
+        }
+
+        const std::vector<rap_point> &points = classifier.points();
+        expect(points.size() == 3, "random access points" + label);
+        if (points.size() != 3)
+            continue;
+        expect(points[0].type == rapType::RAP_IDR && points[0].recoveryPocCnt == 0, "IDR picture" + label);
+        expect(points[1].type == rapType::RAP_GDR && points[1].position == 3, "GDR picture" + label);
+        expect(points[1].recoveryPocCnt == (l == 0 ? 5 : -1), "recovery_poc_cnt of the GDR picture" + label);
+        expect(points[2].type == rapType::RAP_GDR && points[2].recoveryPocCnt == (l == 0 ? 0 : -1),
+               "GDR picture with its picture header in the slice header" + label);
+    }
+    return testResult("test_rap");
+}
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "nal_reader.h"
+#include "test_util.h"
+
+static const size_t BUFFER_SIZE = 4096;
+
+// Append a start code of 'startCodeSize' bytes and a NAL unit ending where the next start code begins at 'nextStart'
+static void appendNal(std::vector<unsigned char> &stream, int startCodeSize, size_t nextStart)
+{
+    if (startCodeSize == 4)
+        stream.push_back(0);
+    stream.push_back(0);
+    stream.push_back(0);
+    stream.push_back(1);
+    stream.push_back(0x41);
+    for (size_t i = 0; stream.size() < nextStart; i++)
+        stream.push_back(static_cast<unsigned char>(i % 250 + 2));
+}
+
+static size_t countStartCodes(const unsigned char *data, size_t size)
+{
+    size_t count = 0;
+    for (size_t i = 0; i + 2 < size; i++)
+        count += (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1);
+    return count;
+}
+
+static bool startCodeAt(const std::vector<unsigned char> &stream, size_t pos)
+{
+    if (pos + 3 <= stream.size() && stream[pos] == 0 && stream[pos + 1] == 0 && stream[pos + 2] == 1)
+        return true;
+    return pos + 4 <= stream.size() && stream[pos] == 0 && stream[pos + 1] == 0 && stream[pos + 2] == 0 && stream[pos + 3] == 1;
+}
+
+static void checkChunks(const char *path, const std::vector<unsigned char> &stream, size_t numNals, unsigned depth, bool useUring)
+{
+    const std::string label = std::string(useUring ? " (io_uring" : " (pread") + ", depth " + std::to_string(depth) + ")";
+    AsyncFileReader reader(BUFFER_SIZE, depth);
+    expect(reader.open(path, false, useUring), "open" + label);
+
+    uint64_t next = 0;
+    size_t startCodes = 0;
+    bool contiguous = true, sameBytes = true, cutAtStartCode = true;
+    const bool ok = reader.readNalChunks([&](unsigned char *data, int size, uint64_t offset) {
+        contiguous = contiguous && offset == next && offset + size <= stream.size();
+        if (!contiguous)
+            return;
+        sameBytes = sameBytes && memcmp(data, stream.data() + offset, size) == 0;
+        next = offset + size;
+        cutAtStartCode = cutAtStartCode && (next == stream.size() || startCodeAt(stream, next));
+        startCodes += countStartCodes(data, size);
+    });
+
+    expect(ok, "read" + label);
+    expect(contiguous && next == stream.size(), "pieces cover the file in order" + label);
+    expect(sameBytes, "piece bytes" + label);
+    expect(cutAtStartCode, "pieces end at a start code" + label);
+    expect(startCodes == numNals, "start codes kept whole across buffers" + label + " : " + std::to_string(startCodes));
+}
+
+int main(int argc, char *argv[])
+{
+    // Start codes split at every position over the buffer boundaries, a NAL unit longer than two buffers
+    std::vector<unsigned char> stream;
+    appendNal(stream, 4, BUFFER_SIZE - 1);       // 00 | 00 00 01
+    appendNal(stream, 4, 2 * BUFFER_SIZE - 2);   // 00 00 | 00 01
+    appendNal(stream, 4, 3 * BUFFER_SIZE - 3);   // 00 00 00 | 01
+    appendNal(stream, 3, 4 * BUFFER_SIZE - 2);   // 00 00 | 01
+    appendNal(stream, 3, 5 * BUFFER_SIZE - 1);   // 00 | 00 01
+    appendNal(stream, 3, 6 * BUFFER_SIZE);       // At the boundary
+    appendNal(stream, 4, 8 * BUFFER_SIZE + 100); // Across two boundaries
+    for (int i = 0; i < 4; i++)
+        appendNal(stream, 3, stream.size() + 40);
+    appendNal(stream, 4, stream.size() + 20);    // Last NAL unit ends with the file
+    const size_t numNals = countStartCodes(stream.data(), stream.size());
+
+    const std::string path = argc > 1 ? argv[1] : "test_reader.264";
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(stream.data()), stream.size());
+    file.close();
+
+    for (unsigned depth = 1; depth <= 3; depth++)
+    {
+        checkChunks(path.c_str(), stream, numNals, depth, true);
+        checkChunks(path.c_str(), stream, numNals, depth, false);
+    }
+    remove(path.c_str());
+
+    return testResult("test_reader");
+}
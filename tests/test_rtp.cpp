@@ -0,0 +1,105 @@
+#include <string>
+#include <vector>
+
+#include "nal_rtp.h"
+#include "test_util.h"
+
+// Access units of the elementary stream the capture was made from
+static std::vector<access_unit> reference(std::vector<unsigned char> es)
+{
+    const int size = static_cast<int>(es.size());
+    es.resize(es.size() + 16, 0);
+    AccessUnitAssembler assembler(videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX);
+    std::vector<access_unit> aus;
+    assembler.assemble(es.data(), size, aus);
+    return aus;
+}
+
+// RTP packet of payload type 96 and SSRC 1
+static std::vector<uint8_t> rtpPacket(uint16_t sequence, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> packet(12, 0);
+    packet[0] = 0x80;
+    packet[1] = 0x80 | 96; // Marker bit
+    packet[2] = static_cast<uint8_t>(sequence >> 8);
+    packet[3] = static_cast<uint8_t>(sequence);
+    packet[11] = 1;
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return packet;
+}
+
+// A single NAL unit packet holding a NAL unit header alone is a NAL unit, an aggregation packet or a fragmentation unit
+// without anything after its payload header is invalid
+static void checkHeaderOnly(videoCodecType codecType, bool donl, const std::vector<uint8_t> &eos, int eosType,
+                            const std::vector<uint8_t> &empty, const std::string &label)
+{
+    RtpDepacketizer depacketizer(codecType, parsingLevel::PARSING_SLICE_PREFIX, 96, donl);
+    std::vector<access_unit> aus;
+    std::vector<uint8_t> packet = rtpPacket(1, eos);
+    depacketizer.push(packet.data(), packet.size(), aus);
+    expect(depacketizer.stats().nalUnits == 1 && depacketizer.stats().invalid == 0 && depacketizer.nal().nal_unit_type == eosType,
+           label + " end of sequence packet");
+
+    packet = rtpPacket(2, empty);
+    depacketizer.push(packet.data(), packet.size(), aus);
+    expect(depacketizer.stats().nalUnits == 1 && depacketizer.stats().invalid == 1, label + " empty aggregation or fragment");
+}
+
+// small.pcap carries small.264 to UDP port 5004 in RTP packets of at most 300 bytes : the parameter sets, SEI and P slices
+// in STAP-A packets, the IDR slices in FU-A packets. Time stamps start at 0xFFFFF000 and wrap, a fragment of the IDR slice
+// of access unit 25 arrives five packets late : it is counted lost then late and the IDR slice is dropped
+int main(int argc, char *argv[])
+{
+    checkHeaderOnly(videoCodecType::H264_AVC, false, std::vector<uint8_t>(1, 0x0a), 10, std::vector<uint8_t>(1, 0x7c), "H264");
+    const uint8_t h265Eos[] = {0x48, 0x01, 0x00, 0x05}; // NAL unit header, DONL
+    const uint8_t h265Ap[] = {0x60, 0x01};
+    checkHeaderOnly(videoCodecType::H265_HEVC, false, std::vector<uint8_t>(h265Eos, h265Eos + 2), 36,
+                    std::vector<uint8_t>(h265Ap, h265Ap + 2), "H265");
+    checkHeaderOnly(videoCodecType::H265_HEVC, true, std::vector<uint8_t>(h265Eos, h265Eos + 4), 36,
+                    std::vector<uint8_t>(h265Ap, h265Ap + 2), "H265 with DONL");
+    const uint8_t h266Eob[] = {0x00, 0xb1};
+    const uint8_t h266Fu[] = {0x00, 0xe9};
+    checkHeaderOnly(videoCodecType::H266_VVC, false, std::vector<uint8_t>(h266Eob, h266Eob + 2), 22,
+                    std::vector<uint8_t>(h266Fu, h266Fu + 2), "H266");
+
+    const std::string dir = argc > 1 ? argv[1] : "data";
+    const std::vector<unsigned char> es = readFile(dir + "/small.264");
+    const std::vector<access_unit> ref = reference(es);
+    expect(ref.size() == 100, "reference access units");
+
+    PcapRtpReader pcap;
+    expect(pcap.open((dir + "/small.pcap").c_str(), 5004), "open " + dir + "/small.pcap");
+
+    RtpDepacketizer depacketizer(videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX, 96, false);
+    std::vector<access_unit> aus;
+    const uint8_t *payload;
+    size_t size;
+    while (pcap.next(payload, size))
+        depacketizer.push(payload, size, aus);
+    depacketizer.flush(aus);
+
+    const rtp_stats &stats = depacketizer.stats();
+    expect(stats.packets == 108 && stats.invalid == 0 && stats.unsupported == 0, "packets");
+    expect(stats.lost == 1, "lost packets : " + std::to_string(stats.lost));
+    expect(stats.late == 1, "late packets : " + std::to_string(stats.late));
+    expect(stats.droppedNals == 1, "dropped NAL units : " + std::to_string(stats.droppedNals));
+    expect(stats.aggregated == 204 && stats.fragmented == 3 && stats.nalUnits == 207, "NAL units");
+    expect(aus.size() == 100, "access units : " + std::to_string(aus.size()));
+    if (aus.size() != 100 || ref.size() != 100)
+        return 1;
+
+    for (size_t i = 0; i < aus.size(); i++)
+    {
+        const std::string au = " of access unit " + std::to_string(i);
+        expect(aus[i].pts == 0xFFFFF000LL + 3003 * static_cast<int64_t>(i), "time stamp" + au);
+
+        // Without its IDR slice access unit 25 keeps its parameter sets and SEI
+        const size_t count = i == 25 ? 3 : ref[i].nals.size();
+        bool same = aus[i].nals.size() == count;
+        for (size_t j = 0; same && j < count; j++)
+            same = aus[i].nals[j].nalUnitType == ref[i].nals[j].nalUnitType;
+        expect(same, "NAL units" + au);
+    }
+
+    return testResult("test_rtp");
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "nal_sample.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+int main(int argc, char *argv[])
+{
+    // Two GOPs of a 16x16 H264 stream, each behind its SPS and PPS
+    std::vector<test_bytes> nals;
+    for (int gop = 0; gop < 2; gop++)
+    {
+        nals.push_back(h264Sps(0, 0, 2));
+        nals.push_back(h264Pps(0, 0));
+        nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+        nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    }
+    const test_bytes stream = byteStream(nals);
+    std::vector<uint64_t> offsets(1, 0);
+    for (size_t i = 0; i < nals.size(); i++)
+        offsets.push_back(offsets.back() + 4 + nals[i].size());
+
+    const std::string path = (argc > 1 ? std::string(argv[1]) : std::string(".")) + "/test_sample.264";
+    writeFile(path, stream);
+
+    StreamSampler sampler(videoCodecType::UNDEFINED);
+    expect(sampler.open(path.c_str()) && sampler.codecType() == videoCodecType::H264_AVC, "open and detect the codec");
+    expect(sampler.size() == stream.size(), "stream size");
+
+    // From the head : the slices are trusted once the SPS and the PPS are parsed
+    expect(sampler.seek(0) && sampler.syncOffset() == offsets[0], "sync on the first SPS");
+    expect(sampler.next() && sampler.nal().nal_unit_type == 7 && !sampler.trusted(), "SPS alone is not trusted");
+    expect(sampler.next() && sampler.nal().nal_unit_type == 8 && sampler.trusted(), "trusted after the PPS");
+    expect(sampler.next() && sampler.nal().nal_unit_type == 5 && sampler.nal().slice.valid && sampler.nal().slice.pocLsb == 0,
+           "IDR slice prefix");
+    expect(sampler.nalOffset() == offsets[2] && sampler.nalSize() == offsets[3] - offsets[2], "IDR position");
+
+    // Inside the first P slice : the next sync point is the SPS of the second GOP
+    expect(sampler.seek(offsets[3] + 2) && sampler.syncOffset() == offsets[4], "sync on the second SPS");
+    expect(sampler.next() && sampler.next() && sampler.next() && sampler.trusted() && sampler.nal().slice.valid,
+           "second IDR trusted");
+    expect(sampler.next() && sampler.nal().slice.frameNum == 1 && sampler.nal().slice.pocLsb == 2, "second P slice");
+    expect(!sampler.next(), "end of the stream");
+
+    // After the second SPS : the IDR is a sync point but parameter sets were forgotten at the seek
+    expect(sampler.seek(offsets[5] + 1) && sampler.syncOffset() == offsets[6], "sync on the second IDR");
+    expect(sampler.next() && sampler.nal().nal_unit_type == 5 && !sampler.trusted() && !sampler.nal().slice.valid,
+           "IDR without its parameter sets");
+
+    expect(!sampler.seek(offsets[7] + 1), "no sync point in the last P slice");
+    expect(!sampler.seek(offsets[3] + 2, 4), "sync point beyond maxScan");
+    expect(!sampler.seek(stream.size()), "seek past the end");
+
+    sampler.close();
+    remove(path.c_str());
+    return testResult("test_sample");
+}
@@ -0,0 +1,241 @@
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nal_du_timing.h"
+#include "nal_parse.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+typedef std::vector<std::pair<int, test_bytes> > sei_messages;
+
+static void parse(NALParse &parser, const test_bytes &nal)
+{
+    parser.nal_parse_unit(nal.data(), static_cast<uint32_t>(nal.size()), videoCodecType::H266_VVC, parsingLevel::PARSING_SLICE_PREFIX);
+}
+
+// H266/VVC buffering period of two sub-layers, NAL HRD with one CPB, 16-bit removal and output delays
+static test_bytes vvcBufferingPeriod()
+{
+    BitWriter w;
+    w.u(1, 1);   // bp_nal_hrd_params_present_flag
+    w.u(1, 0);   // bp_vcl_hrd_params_present_flag
+    w.u(5, 23);  // initial_cpb_removal_delay_length_minus1
+    w.u(5, 15);  // cpb_removal_delay_length_minus1
+    w.u(5, 15);  // dpb_output_delay_length_minus1
+    w.u(1, 0);   // bp_decoding_unit_hrd_params_present_flag
+    w.u(1, 0);   // bp_concatenation_flag
+    w.u(1, 0);   // additional_concatenation_info_present_flag
+    w.u(16, 0);  // au_cpb_removal_delay_delta_minus1
+    w.u(3, 1);   // bp_max_sub_layers_minus1
+    w.u(1, 0);   // cpb_removal_delay_deltas_present_flag
+    w.ue(0);     // bp_cpb_cnt_minus1
+    w.u(1, 0);   // bp_sublayer_initial_cpb_removal_delay_present_flag
+    w.u(24, 9000);
+    w.u(24, 0);
+    w.u(1, 0);   // bp_sublayer_dpb_output_offsets_present_flag
+    w.u(1, 0);   // bp_alt_cpb_params_present_flag
+    return w.bytes();
+}
+
+// Picture timing of the buffering period above, sub-layer 0 signalling its own removal delay
+static test_bytes vvcPictureTiming(int temporalId, int cpbRemovalDelayMinus1)
+{
+    BitWriter w;
+    w.u(16, cpbRemovalDelayMinus1);
+    if (temporalId == 0)
+    {
+        w.u(1, 1); // pt_sub_layer_delays_present_flag[0]
+        w.u(16, 7);
+    }
+    w.u(16, 2); // pt_dpb_output_delay
+    w.u(8, 0);  // pt_display_elemental_periods_minus1
+    return w.bytes();
+}
+
+// A buffering period of one byte (payloadSize 1, payload 0xFF) is read past the end of the NAL unit : the message is
+// dropped without an exception and the picture timing that follows has no buffering period
+static void checkTruncatedPayload()
+{
+    NALParse parser;
+    sei_messages messages(1, std::make_pair(0, test_bytes(1, 0xFF)));
+    parse(parser, seiNal(vvcHeader(23, 0), messages));
+    expect(parser.nal->nal_unit_type == 23 && parser.nal->sei_types.empty(), "truncated buffering period dropped");
+    expect(!parser.nal->vvcSEI.vvc_bp_available, "no buffering period after a truncated one");
+
+    // Read into the next message instead : the next message is still parsed
+    parse(parser, seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(0, vvcBufferingPeriod()))));
+    expect(parser.nal->vvcSEI.vvc_bp_available, "buffering period");
+    messages.clear();
+    messages.push_back(std::make_pair(0, test_bytes(2, 0xFF)));
+    test_bytes cll(4, 0);
+    cll[1] = 100;
+    cll[3] = 50;
+    messages.push_back(std::make_pair(144, cll));
+    parse(parser, seiNal(vvcHeader(23, 0), messages));
+    expect(parser.nal->sei_types.size() == 1 && parser.nal->sei_types[0] == 144, "message after a truncated one");
+    expect(parser.nal->mpegCommonSEI.common_sei_cll.max_content_light_level == 100 &&
+               parser.nal->mpegCommonSEI.common_sei_cll.max_pic_average_light_level == 50,
+           "content light level after a truncated message");
+    expect(!parser.nal->vvcSEI.vvc_bp_available, "buffering period replaced by a truncated one");
+}
+
+// pt_sub_layer_delays_present_flag[0] of a sub-layer 0 picture does not stay set for the next sub-layer 1 picture
+static void checkPictureTimingSubLayers()
+{
+    NALParse parser;
+    parse(parser, seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(0, vvcBufferingPeriod()))));
+    const SEIBufferingPeriod &bp = parser.nal->vvcSEI.vvc_sei_bp;
+    expect(parser.nal->vvcSEI.vvc_bp_available && bp.bpMaxSubLayers == 2 && bp.initialCpbRemovalDelay[0][0] == 9000,
+           "buffering period of two sub-layers");
+
+    const SEIPictureTimingH266 &pt = parser.nal->vvcSEI.vvc_sei_pt;
+    parse(parser, seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(1, vvcPictureTiming(0, 3)))));
+    expect(pt.m_auCpbRemovalDelay[1] == 4 && pt.m_ptSubLayerDelaysPresentFlag[0] && pt.m_auCpbRemovalDelay[0] == 8,
+           "picture timing of sub-layer 0");
+    parse(parser, seiNal(vvcHeader(23, 1), sei_messages(1, std::make_pair(1, vvcPictureTiming(1, 5)))));
+    expect(parser.nal->sei_types.size() == 1 && pt.m_auCpbRemovalDelay[1] == 6, "picture timing of sub-layer 1");
+    expect(!pt.m_ptSubLayerDelaysPresentFlag[0], "sub-layer 0 delays of a sub-layer 1 picture timing");
+}
+
+// Scalable nesting of a content light level message for OLS 1 : kept in the RBSP for every target, interpreted only when
+// OLS 1 is the selected operation point
+static void checkScalableNesting()
+{
+    BitWriter w;
+    w.u(1, 1); // sn_ols_flag
+    w.u(1, 0); // sn_subpic_flag
+    w.ue(0);   // sn_num_olss_minus1
+    w.ue(1);   // sn_ols_idx_delta_minus1[0]
+    w.ue(0);   // sn_num_seis_minus1
+    test_bytes nesting = w.bytes(); // sn_zero_bit up to the byte boundary
+    const uint8_t cll[] = {144, 4, 0, 100, 0, 50};
+    nesting.insert(nesting.end(), cll, cll + 6);
+    const test_bytes nal = seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(133, nesting)));
+
+    NALParse parser;
+    parse(parser, nal);
+    const SEIScalableNesting &sn = parser.nal->mpegCommonSEI.common_sei_sn;
+    expect(sn.olsFlag && sn.olsIdx.size() == 1 && sn.olsIdx[0] == 1, "nesting OLS");
+    expect(sn.nestedMessages.size() == 1 && sn.nestedMessages[0].payloadType == 144 && sn.nestedMessages[0].payloadSize == 4,
+           "nested message");
+    expect(sn.nestedMessages[0].payloadOffset == nal.size() - 5 - 2, "nested payload offset in the RBSP");
+    expect(!sn.nestedMessages[0].applied && parser.nal->mpegCommonSEI.common_sei_cll.max_content_light_level == 0,
+           "nested message of another OLS not interpreted");
+
+    parser.nal->target_ols_idx = 1;
+    parse(parser, nal);
+    expect(sn.nestedMessages.size() == 1 && sn.nestedMessages[0].applied, "nested message of the target OLS");
+    expect(parser.nal->mpegCommonSEI.common_sei_cll.max_content_light_level == 100 &&
+               parser.nal->mpegCommonSEI.common_sei_cll.max_pic_average_light_level == 50,
+           "content light level of the target OLS");
+}
+
+// H266/VVC buffering period of one sub-layer with decoding unit HRD parameters, 8-bit DU removal delay increments in
+// decoding unit information SEI
+static test_bytes vvcDuBufferingPeriod()
+{
+    BitWriter w;
+    w.u(1, 1);  // bp_nal_hrd_params_present_flag
+    w.u(1, 0);  // bp_vcl_hrd_params_present_flag
+    w.u(5, 23); // initial_cpb_removal_delay_length_minus1
+    w.u(5, 15); // cpb_removal_delay_length_minus1
+    w.u(5, 15); // dpb_output_delay_length_minus1
+    w.u(1, 1);  // bp_decoding_unit_hrd_params_present_flag
+    w.u(5, 7);  // du_cpb_removal_delay_increment_length_minus1
+    w.u(5, 7);  // dpb_output_delay_du_length_minus1
+    w.u(1, 0);  // bp_du_cpb_params_in_pic_timing_sei_flag
+    w.u(1, 0);  // bp_du_dpb_params_in_pic_timing_sei_flag
+    w.u(1, 0);  // bp_concatenation_flag
+    w.u(1, 0);  // additional_concatenation_info_present_flag
+    w.u(16, 0); // au_cpb_removal_delay_delta_minus1
+    w.u(3, 0);  // bp_max_sub_layers_minus1
+    w.ue(0);    // bp_cpb_cnt_minus1
+    w.u(24, 9000);
+    w.u(24, 0);
+    w.u(1, 0); // bp_alt_cpb_params_present_flag
+    return w.bytes();
+}
+
+static test_bytes vvcDuPictureTiming(int cpbRemovalDelayMinus1)
+{
+    BitWriter w;
+    w.u(16, cpbRemovalDelayMinus1);
+    w.u(16, 2); // pt_dpb_output_delay
+    w.u(8, 0);  // pt_display_elemental_periods_minus1
+    return w.bytes();
+}
+
+static test_bytes vvcDecodingUnitInfo(int duIdx, int increment)
+{
+    BitWriter w;
+    w.ue(duIdx);
+    w.u(8, increment); // dui_du_cpb_removal_delay_increment of the highest sub-layer
+    w.u(1, 0);         // dui_dpb_output_du_delay_present_flag
+    return w.bytes();
+}
+
+// Two access units of two decoding units each : every decoding unit is removed its increment of clock sub-ticks before
+// the removal of its access unit
+static void checkDecodingUnitTiming()
+{
+    NALParse parser;
+    // The test SPS has no general_timing_hrd_parameters() : the timing of the HRD is set on a parsed-like SPS
+    vvc::SPS *sps = new vvc::SPS();
+    sps->m_generalHrdParametersPresentFlag = true;
+    sps->m_generalHrdParams.m_numUnitsInTick = 1001;
+    sps->m_generalHrdParams.m_timeScale = 60000;
+    sps->m_generalHrdParams.m_tickDivisorMinus2 = 0;
+    parser.nal->mpegParamSet.setCodec(videoCodecType::H266_VVC);
+    parser.nal->mpegParamSet.storeSps(0, sps);
+
+    const double tick = 1001.0 / 60000;
+    const double subTick = tick / 2;
+    DuTimingCalculator calculator(videoCodecType::H266_VVC);
+    const test_bytes slice = vvcHeader(8, 0);
+
+    sei_messages messages;
+    messages.push_back(std::make_pair(0, vvcDuBufferingPeriod()));
+    messages.push_back(std::make_pair(1, vvcDuPictureTiming(0)));
+    parse(parser, seiNal(vvcHeader(23, 0), messages));
+    const du_timing &timing = calculator.push(*parser.nal);
+    expect(calculator.subPicHrd() && timing.auIndex == 0 && std::abs(timing.auRemovalTime - 0.1) < 1e-9 && timing.duRemovalTime < 0,
+           "access unit 0 removal time");
+
+    const int increments[2][2] = {{4, 0}, {3, 0}};
+    for (int au = 0; au < 2; au++)
+    {
+        if (au == 1)
+        {
+            parse(parser, seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(1, vvcDuPictureTiming(1)))));
+            calculator.push(*parser.nal);
+        }
+        const double auTime = 0.1 + 2 * tick * au;
+        for (int du = 0; du < 2; du++)
+        {
+            const std::string what = "access unit " + std::to_string(au) + " decoding unit " + std::to_string(du);
+            parse(parser, seiNal(vvcHeader(23, 0), sei_messages(1, std::make_pair(130, vvcDecodingUnitInfo(du, increments[au][du])))));
+            const SEIDecodingUnitInfo &dui = parser.nal->mpegCommonSEI.common_sei_dui;
+            expect(dui.decodingUnitIdx == static_cast<uint32_t>(du) && dui.subLayerDelaysPresentFlag[0] &&
+                       dui.duSptCpbRemovalDelayIncrement[0] == static_cast<uint32_t>(increments[au][du]),
+                   what + " information SEI");
+            calculator.push(*parser.nal);
+
+            parser.nal_parse_unit(slice.data(), static_cast<uint32_t>(slice.size()), videoCodecType::H266_VVC, parsingLevel::PARSING_NONE);
+            const du_timing &t = calculator.push(*parser.nal);
+            expect(t.auIndex == static_cast<uint64_t>(au) && t.duIndex == static_cast<uint32_t>(du) &&
+                       std::abs(t.auRemovalTime - auTime) < 1e-9 && std::abs(t.duRemovalTime - (auTime - subTick * increments[au][du])) < 1e-9,
+                   what + " removal time");
+        }
+    }
+}
+
+int main()
+{
+    checkTruncatedPayload();
+    checkPictureTimingSubLayers();
+    checkScalableNesting();
+    checkDecodingUnitTiming();
+    return testResult("test_sei");
+}
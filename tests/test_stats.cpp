@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nal_stats.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// NAL unit of 'size' bytes with the header of the given type, TemporalId and layer
+static void push(NalStatistics &stats, NALParse &parser, int type, int tid, int layer, uint32_t size, double timestamp)
+{
+    const test_bytes header = vvcHeader(type, tid, layer);
+    parser.nal_parse_unit(header.data(), static_cast<uint32_t>(header.size()), videoCodecType::H266_VVC, parsingLevel::PARSING_NONE);
+    stats.push(*parser.nal, size, timestamp);
+}
+
+static bool near(double a, double b)
+{
+    return std::abs(a - b) < 1e-6 * std::max(1.0, std::abs(b));
+}
+
+int main()
+{
+    // Window of 1.6 s in 16 buckets of 0.1 s
+    NalStatistics stats(videoCodecType::H266_VVC, 1.6);
+    NALParse parser;
+    push(stats, parser, 15, 0, 0, 100, 0.05);  // SPS
+    push(stats, parser, 16, 0, 0, 50, 0.05);   // PPS
+    push(stats, parser, 8, 0, 0, 1000, 0.05);  // IDR_N_LP
+    push(stats, parser, 0, 1, 1, 200, 0.05);   // TRAIL of layer 1, sub-layer 1
+
+    nal_stats_snapshot s;
+    stats.snapshot(s);
+    expect(s.sequence == 4 && s.total.count == 4 && s.total.bytes == 1350, "totals");
+    expect(s.byType[15].bytes == 100 && s.byType[8].count == 1 && s.byType[0].bytes == 200, "by NAL unit type");
+    expect(s.byCategory[static_cast<int>(nalCategory::NAL_CATEGORY_PARAMETER_SET)].count == 2 &&
+               s.byCategory[static_cast<int>(nalCategory::NAL_CATEGORY_PARAMETER_SET)].bytes == 150 &&
+               s.byCategory[static_cast<int>(nalCategory::NAL_CATEGORY_VCL)].bytes == 1200,
+           "by category");
+    expect(s.byTemporalId[0].count == 3 && s.byTemporalId[1].bytes == 200 && s.byLayer[1].count == 1 && s.byTypeAndTemporalId[0][1].count == 1,
+           "by TemporalId and layer");
+    expect(near(s.windowSeconds, 0.1) && near(s.windowBitrate, 8 * 1350 / 0.1), "window of the first bucket");
+
+    // One trailing picture of 100 bytes per bucket for 3 s : the window keeps the last 16 of them
+    for (int k = 1; k <= 30; k++)
+        push(stats, parser, 0, 1, 0, 100, (k + 0.5) * 0.1);
+    stats.snapshot(s);
+    expect(near(s.windowSeconds, 1.6) && near(s.windowBitrateByType[0], 8 * 100 * 16 / 1.6) && near(s.windowBitrateByType[8], 0),
+           "sliding window : " + std::to_string(s.windowBitrateByType[0]));
+    expect(near(s.windowBitrateByCategory[static_cast<int>(nalCategory::NAL_CATEGORY_VCL)], s.windowBitrate), "window by category");
+
+    // A timestamp further back than the window restarts it
+    push(stats, parser, 8, 0, 0, 400, 0.05);
+    stats.snapshot(s);
+    expect(near(s.windowSeconds, 0.1) && near(s.windowBitrate, 8 * 400 / 0.1) && s.total.count == 35, "window restarted");
+
+    // Snapshots taken while another thread pushes are consistent
+    stats.clear();
+    std::atomic<bool> done(false);
+    bool consistent = true;
+    std::thread reader([&]() {
+        nal_stats_snapshot r;
+        while (!done.load())
+        {
+            stats.snapshot(r);
+            uint64_t count = 0, bytes = 0;
+            for (int i = 0; i < nal_stats_snapshot::NUM_CATEGORIES; i++)
+            {
+                count += r.byCategory[i].count;
+                bytes += r.byCategory[i].bytes;
+            }
+            consistent = consistent && count == r.total.count && bytes == r.total.bytes && r.total.count == r.sequence;
+        }
+    });
+    for (int k = 0; k < 20000; k++)
+        push(stats, parser, k % 2 ? 0 : 23, 0, 0, 10 + k % 7, k * 0.001);
+    done.store(true);
+    reader.join();
+    expect(consistent, "concurrent snapshots");
+
+    return testResult("test_stats");
+}
@@ -0,0 +1,354 @@
+#pragma once
+
+// Bitstream builders of the unit tests : NAL units are written field by field, the way the specifications list them
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "nal_parse.h"
+
+typedef std::vector<uint8_t> test_bytes;
+
+class BitWriter
+{
+public:
+    void u(int n, uint32_t value)
+    {
+        for (int i = n - 1; i >= 0; i--)
+            m_bits.push_back(static_cast<uint8_t>((value >> i) & 1));
+    }
+
+    void ue(uint32_t value)
+    {
+        const uint64_t code = static_cast<uint64_t>(value) + 1;
+        int len = 0;
+        while ((code >> (len + 1)) != 0)
+            len++;
+        u(len, 0);
+        for (int i = len; i >= 0; i--)
+            m_bits.push_back(static_cast<uint8_t>((code >> i) & 1));
+    }
+
+    void se(int value) { ue(value > 0 ? 2 * value - 1 : -2 * value); }
+
+    // NAL unit header bytes then the RBSP with its trailing bits, emulation prevented, no start code
+    test_bytes nal(const test_bytes &header) const
+    {
+        std::vector<uint8_t> bits = m_bits;
+        bits.push_back(1);
+        while (bits.size() % 8)
+            bits.push_back(0);
+
+        test_bytes out = header;
+        int zeros = 0;
+        for (size_t i = 0; i < bits.size(); i += 8)
+        {
+            uint8_t byte = 0;
+            for (size_t j = 0; j < 8; j++)
+                byte = static_cast<uint8_t>((byte << 1) | bits[i + j]);
+            if (zeros >= 2 && byte <= 3)
+            {
+                out.push_back(3);
+                zeros = 0;
+            }
+            out.push_back(byte);
+            zeros = byte == 0 ? zeros + 1 : 0;
+        }
+        return out;
+    }
+
+    // Bytes written so far, the last one completed with zero bits (SEI payloads, boxes)
+    test_bytes bytes() const
+    {
+        test_bytes out((m_bits.size() + 7) / 8, 0);
+        for (size_t i = 0; i < m_bits.size(); i++)
+            out[i / 8] = static_cast<uint8_t>(out[i / 8] | (m_bits[i] << (7 - i % 8)));
+        return out;
+    }
+
+private:
+    std::vector<uint8_t> m_bits;
+};
+
+// SEI NAL unit of the given messages, each payload behind its payload_type and payload_size bytes
+inline test_bytes seiNal(const test_bytes &header, const std::vector<std::pair<int, test_bytes> > &messages)
+{
+    BitWriter w;
+    for (size_t i = 0; i < messages.size(); i++)
+    {
+        int type = messages[i].first;
+        for (; type >= 255; type -= 255)
+            w.u(8, 255);
+        w.u(8, type);
+        size_t size = messages[i].second.size();
+        for (; size >= 255; size -= 255)
+            w.u(8, 255);
+        w.u(8, static_cast<uint32_t>(size));
+        for (size_t j = 0; j < messages[i].second.size(); j++)
+            w.u(8, messages[i].second[j]);
+    }
+    return w.nal(header);
+}
+
+// NAL units behind 4-byte start codes
+inline test_bytes byteStream(const std::vector<test_bytes> &nals)
+{
+    test_bytes stream;
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        const uint8_t startCode[] = {0, 0, 0, 1};
+        stream.insert(stream.end(), startCode, startCode + 4);
+        stream.insert(stream.end(), nals[i].begin(), nals[i].end());
+    }
+    return stream;
+}
+
+// One result per NAL unit, parsed in order by nal_parse_batch()
+inline std::vector<nal_result> parseNals(NALParse &parser, const std::vector<test_bytes> &nals, videoCodecType codecType,
+                                         parsingLevel level)
+{
+    std::vector<nal_buffer> buffers(nals.size());
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        buffers[i].data = nals[i].data();
+        buffers[i].size = static_cast<uint32_t>(nals[i].size());
+    }
+    std::vector<nal_result> results(nals.size());
+    parser.nal_parse_batch(buffers.data(), buffers.size(), codecType, level, results.data());
+    return results;
+}
+
+// H264/AVC baseline profile, 16x16 frames, pic_order_cnt_type 0
+inline test_bytes h264Sps(int spsId, int log2MaxFrameNumMinus4, int log2MaxPocLsbMinus4)
+{
+    BitWriter w;
+    w.u(8, 66); // profile_idc
+    w.u(8, 0);  // constraint flags
+    w.u(8, 30); // level_idc
+    w.ue(spsId);
+    w.ue(log2MaxFrameNumMinus4);
+    w.ue(0); // pic_order_cnt_type
+    w.ue(log2MaxPocLsbMinus4);
+    w.ue(1); // max_num_ref_frames
+    w.u(1, 0);
+    w.ue(0); // pic_width_in_mbs_minus1
+    w.ue(0); // pic_height_in_map_units_minus1
+    w.u(1, 1); // frame_mbs_only_flag
+    w.u(1, 1); // direct_8x8_inference_flag
+    w.u(1, 0); // frame_cropping_flag
+    w.u(1, 0); // vui_parameters_present_flag
+    return w.nal(test_bytes(1, 0x67));
+}
+
+inline test_bytes h264Pps(int ppsId, int spsId)
+{
+    BitWriter w;
+    w.ue(ppsId);
+    w.ue(spsId);
+    w.u(1, 0); // entropy_coding_mode_flag
+    w.u(1, 0); // bottom_field_pic_order_in_frame_present_flag
+    w.ue(0);   // num_slice_groups_minus1
+    w.ue(0);   // num_ref_idx_l0_default_active_minus1
+    w.ue(0);   // num_ref_idx_l1_default_active_minus1
+    w.u(1, 0); // weighted_pred_flag
+    w.u(2, 0); // weighted_bipred_idc
+    w.se(0);   // pic_init_qp_minus26
+    w.se(0);   // pic_init_qs_minus26
+    w.se(0);   // chroma_qp_index_offset
+    w.u(1, 0); // deblocking_filter_control_present_flag
+    w.u(1, 0); // constrained_intra_pred_flag
+    w.u(1, 0); // redundant_pic_cnt_present_flag
+    return w.nal(test_bytes(1, 0x68));
+}
+
+// Slice header up to pic_order_cnt_lsb, the field lengths are those of the SPS the PPS refers to
+inline test_bytes h264Slice(bool idr, int sliceType, int ppsId, int frameNum, int frameNumBits, int pocLsb, int pocLsbBits)
+{
+    BitWriter w;
+    w.ue(0); // first_mb_in_slice
+    w.ue(sliceType);
+    w.ue(ppsId);
+    w.u(frameNumBits, frameNum);
+    if (idr)
+        w.ue(0); // idr_pic_id
+    w.u(pocLsbBits, pocLsb);
+    w.u(16, 0);
+    return w.nal(test_bytes(1, idr ? 0x65 : 0x41));
+}
+
+// H266/VVC NAL unit header
+inline test_bytes vvcHeader(int nalUnitType, int temporalId, int layerId = 0)
+{
+    test_bytes header(2, static_cast<uint8_t>(layerId));
+    header[1] = static_cast<uint8_t>((nalUnitType << 3) | (temporalId + 1));
+    return header;
+}
+
+// H266/VVC VPS of two sub-layers and two layers, layer 1 predicted from the sub-layers of layer 0 below
+// maxTidIlRefPicsPlus1 : OLS 0 is layer 0, OLS 1 outputs layer 1
+inline test_bytes vvcVps(int vpsId, int maxTidIlRefPicsPlus1)
+{
+    BitWriter w;
+    w.u(4, vpsId);
+    w.u(6, 1); // vps_max_layers_minus1
+    w.u(3, 1); // vps_max_sublayers_minus1
+    w.u(1, 1); // vps_default_ptl_dpb_hrd_max_tid_flag
+    w.u(1, 0); // vps_all_independent_layers_flag
+    w.u(6, 0); // vps_layer_id[0]
+    w.u(6, 1); // vps_layer_id[1]
+    w.u(1, 0); // vps_independent_layer_flag[1]
+    w.u(1, 1); // vps_max_tid_ref_present_flag[1]
+    w.u(1, 1); // vps_direct_ref_layer_flag[1][0]
+    w.u(3, maxTidIlRefPicsPlus1);
+    w.u(2, 0); // vps_ols_mode_idc
+    w.u(8, 0); // vps_num_ptls_minus1
+    w.u(5, 0); // vps_ptl_alignment_zero_bit
+    w.u(7, 0); // general_profile_idc
+    w.u(1, 0); // general_tier_flag
+    w.u(8, 51); // general_level_idc
+    w.u(1, 1); // ptl_frame_only_constraint_flag
+    w.u(1, 1); // ptl_multilayer_enabled_flag
+    w.u(1, 0); // gci_present_flag
+    w.u(5, 0); // gci_alignment_zero_bit
+    w.u(1, 0); // ptl_sublayer_level_present_flag[0]
+    w.u(7, 0); // ptl_reserved_zero_bit
+    w.u(8, 0); // ptl_num_sub_profiles
+    w.ue(0);   // vps_num_dpb_params_minus1
+    w.u(1, 0); // vps_sublayer_dpb_params_present_flag
+    w.ue(1);   // dpb_max_dec_pic_buffering_minus1
+    w.ue(0);   // dpb_max_num_reorder_pics
+    w.ue(0);   // dpb_max_latency_increase_plus1
+    w.ue(64);  // vps_ols_dpb_pic_width[1]
+    w.ue(64);
+    w.u(2, 1); // vps_ols_dpb_chroma_format[1]
+    w.ue(2);   // vps_ols_dpb_bitdepth_minus8[1]
+    w.u(1, 0); // vps_general_hrd_params_present_flag
+    w.u(1, 0); // vps_extension_flag
+    return w.nal(vvcHeader(14, 0));
+}
+
+// H266/VVC 64x64 monochrome SPS of a VPS (no profile, DPB nor HRD parameters) with every coding tool disabled
+// wpp : entropy coding sync with entry points, one substream per row of 32x32 CTUs
+inline test_bytes vvcSps(int spsId, int log2MaxPocLsbMinus4, bool gdrEnabled, int pocMsbCycleLen, bool wpp = false)
+{
+    BitWriter w;
+    w.u(4, spsId);
+    w.u(4, 1); // sps_video_parameter_set_id
+    w.u(3, 0); // sps_max_sub_layers_minus1
+    w.u(2, 0); // sps_chroma_format_idc
+    w.u(2, 0); // sps_log2_ctu_size_minus5
+    w.u(1, 0); // sps_ptl_dpb_hrd_params_present_flag
+    w.u(1, gdrEnabled);
+    w.u(1, 0); // sps_ref_pic_resampling_enabled_flag
+    w.ue(64);
+    w.ue(64);
+    w.u(1, 0); // sps_conformance_window_flag
+    w.u(1, 0); // sps_subpic_info_present_flag
+    w.ue(0);   // sps_bitdepth_minus8
+    w.u(1, wpp); // sps_entropy_coding_sync_enabled_flag
+    w.u(1, wpp); // sps_entry_point_offsets_present_flag
+    w.u(4, log2MaxPocLsbMinus4);
+    w.u(1, pocMsbCycleLen > 0);
+    if (pocMsbCycleLen > 0)
+        w.ue(pocMsbCycleLen - 1);
+    w.u(2, 0); // sps_num_extra_ph_bytes
+    w.u(2, 0); // sps_num_extra_sh_bytes
+    w.ue(0);   // sps_log2_min_luma_coding_block_size_minus2
+    w.u(1, 0); // sps_partition_constraints_override_enabled_flag
+    for (int i = 0; i < 4; i++)
+        w.ue(0); // quadtree and multi-type tree depths of intra and inter slices
+    w.u(9, 0); // transform skip, MTS, LFNST, SAO, ALF, LMCS, weighted prediction, weighted bi-prediction, long-term references
+    w.u(1, 0); // sps_inter_layer_prediction_enabled_flag
+    w.u(1, 0); // sps_idr_rpl_present_flag
+    w.u(1, 1); // sps_rpl1_same_as_rpl0_flag
+    w.ue(0);   // sps_num_ref_pic_lists[0]
+    w.u(7, 0); // wraparound, TMVP, AMVR, BDOF, SMVD, DMVR, MMVD
+    w.ue(0);   // sps_six_minus_max_num_merge_cand
+    w.u(5, 0); // SBT, affine, BCW, CIIP, GPM
+    w.ue(0);   // sps_log2_parallel_merge_level_minus2
+    w.u(11, 0); // ISP, MRL, MIP, palette, IBC, scaling lists, dependent quantization, sign data hiding, virtual boundaries,
+                // field_seq, VUI
+    w.u(1, 0); // sps_extension_present_flag
+    return w.nal(vvcHeader(15, 0));
+}
+
+// H266/VVC PPS of a single slice picture
+inline test_bytes vvcPps(int ppsId, int spsId)
+{
+    BitWriter w;
+    w.u(6, ppsId);
+    w.u(4, spsId);
+    w.u(1, 0); // pps_mixed_nalu_types_in_pic_flag
+    w.ue(64);
+    w.ue(64);
+    w.u(1, 0); // pps_conformance_window_flag
+    w.u(1, 0); // pps_scaling_window_explicit_signalling_flag
+    w.u(1, 0); // pps_output_flag_present_flag
+    w.u(1, 1); // pps_no_pic_partition_flag
+    w.u(1, 0); // pps_subpic_id_mapping_present_flag
+    w.u(1, 0); // pps_cabac_init_present_flag
+    w.ue(0);   // pps_num_ref_idx_default_active_minus1[0]
+    w.ue(0);   // pps_num_ref_idx_default_active_minus1[1]
+    w.u(4, 0); // rpl1_idx_present, weighted_pred, weighted_bipred, ref_wraparound
+    w.se(0);   // pps_init_qp_minus26
+    w.u(3, 0); // cu_qp_delta, chroma_tool_offsets, deblocking_filter_control
+    w.u(3, 0); // picture header extension, slice header extension, pps extension
+    return w.nal(vvcHeader(16, 0));
+}
+
+// H266/VVC picture header fields up to ph_poc_msb_cycle_val, in a PH NAL unit or at the start of a slice header
+inline void vvcPictureHeader(BitWriter &w, int nalUnitType, bool inter, int ppsId, int pocLsb, int pocLsbBits, int recoveryPocCnt,
+                             int pocMsbCycle, int pocMsbCycleLen)
+{
+    const bool gdr = nalUnitType == 10;
+    const bool irap = nalUnitType >= 7 && nalUnitType <= 9;
+    w.u(1, gdr || irap); // ph_gdr_or_irap_pic_flag
+    w.u(1, 0);           // ph_non_ref_pic_flag
+    if (gdr || irap)
+        w.u(1, gdr);
+    w.u(1, inter); // ph_inter_slice_allowed_flag
+    if (inter)
+        w.u(1, 1); // ph_intra_slice_allowed_flag
+    w.ue(ppsId);
+    w.u(pocLsbBits, pocLsb);
+    if (gdr)
+        w.ue(recoveryPocCnt);
+    if (pocMsbCycleLen > 0)
+    {
+        w.u(1, pocMsbCycle >= 0); // ph_poc_msb_cycle_present_flag
+        if (pocMsbCycle >= 0)
+            w.u(pocMsbCycleLen, pocMsbCycle);
+    }
+}
+
+// Picture header NAL unit, its remaining fields are not written
+inline test_bytes vvcPh(int nalUnitType, bool inter, int ppsId, int pocLsb, int pocLsbBits, int recoveryPocCnt = 0,
+                        int pocMsbCycle = -1, int pocMsbCycleLen = 0)
+{
+    BitWriter w;
+    vvcPictureHeader(w, nalUnitType, inter, ppsId, pocLsb, pocLsbBits, recoveryPocCnt, pocMsbCycle, pocMsbCycleLen);
+    w.u(16, 0);
+    return w.nal(vvcHeader(19, 0));
+}
+
+// Slice of a picture header NAL unit, up to sh_slice_type
+inline test_bytes vvcSlice(int nalUnitType, int temporalId, bool inter)
+{
+    BitWriter w;
+    w.u(1, 0); // sh_picture_header_in_slice_header_flag
+    if (inter)
+        w.ue(1); // sh_slice_type P
+    w.u(16, 0);
+    return w.nal(vvcHeader(nalUnitType, temporalId));
+}
+
+// Intra slice carrying its picture header
+inline test_bytes vvcSliceWithPh(int nalUnitType, int ppsId, int pocLsb, int pocLsbBits, int recoveryPocCnt = 0)
+{
+    BitWriter w;
+    w.u(1, 1); // sh_picture_header_in_slice_header_flag
+    vvcPictureHeader(w, nalUnitType, false, ppsId, pocLsb, pocLsbBits, recoveryPocCnt, -1, 0);
+    w.u(16, 0);
+    return w.nal(vvcHeader(nalUnitType, 0));
+}
@@ -0,0 +1,70 @@
+#include <string>
+
+#include "nal_timecode.h"
+#include "test_util.h"
+
+static SEITimeCode dropFrameTimecode(int hours, int minutes, int seconds, int frames)
+{
+    SEITimeCode sei{};
+    sei.numClockTs = 1;
+    SEITimeSet &ts = sei.timeSetArray[0];
+    ts.clockTimeStampFlag = true;
+    ts.countingType = 4;
+    ts.fullTimeStampFlag = true;
+    ts.hoursValue = hours;
+    ts.minutesValue = minutes;
+    ts.secondsValue = seconds;
+    ts.numberOfFrames = frames;
+    return sei;
+}
+
+// Start from a signalled label and extrapolate 'count' access units without clock timestamp
+static void checkRun(uint32_t timeScale, int fps, int minutes, const char *first, const char *next)
+{
+    TimecodeEngine engine;
+    engine.setTiming(1001, timeScale);
+    engine.push(dropFrameTimecode(0, minutes, 59, fps - 1));
+    engine.pushWithoutTimecode();
+
+    const std::vector<timecode_entry> &entries = engine.entries();
+    const std::string label = std::string(" at ") + std::to_string(fps) + " fps minute " + std::to_string(minutes);
+    expect(TimecodeEngine::toString(entries[0]) == first, "signalled label" + label + " : " + TimecodeEngine::toString(entries[0]));
+    expect(TimecodeEngine::toString(entries[1]) == next, "extrapolated label" + label + " : " + TimecodeEngine::toString(entries[1]));
+    expect(entries[1].timestamp - entries[0].timestamp == 1001, "timestamp step" + label);
+
+    // The extrapolated label read back gives the same clock time
+    TimecodeEngine readBack;
+    readBack.setTiming(1001, timeScale);
+    readBack.push(dropFrameTimecode(entries[1].hours, entries[1].minutes, entries[1].seconds, entries[1].frames));
+    expect(readBack.entries()[0].timestamp == entries[1].timestamp, "round trip" + label);
+}
+
+int main()
+{
+    // 29.97 : two labels dropped at every minute except each tenth
+    checkRun(30000, 30, 0, "00:00:59;29", "00:01:00;02");
+    checkRun(30000, 30, 9, "00:09:59;29", "00:10:00;00");
+    checkRun(30000, 30, 10, "00:10:59;29", "00:11:00;02");
+
+    // 59.94 : four labels
+    checkRun(60000, 60, 0, "00:00:59;59", "00:01:00;04");
+    checkRun(60000, 60, 9, "00:09:59;59", "00:10:00;00");
+    checkRun(60000, 60, 10, "00:10:59;59", "00:11:00;04");
+
+    // One hour of 59.94 drop-frame labels lasts 3600 seconds of clock time within a frame
+    TimecodeEngine hour;
+    hour.setTiming(1001, 60000);
+    hour.push(dropFrameTimecode(1, 0, 0, 0));
+    expect(hour.entries()[0].timestamp == 215784 * 1001, "frames in one hour at 59.94");
+
+    // Only the NumClockTS timestamps of pic_struct are read
+    SEIPictureTimingH264 pt{};
+    pt.pic_struct_present_flag = 1;
+    pt.pic_struct = 0;
+    pt.clock_timestamp_flag[1] = 1;
+    TimecodeEngine frame;
+    frame.setTiming(1001, 30000);
+    expect(!frame.push(pt), "stale clock timestamp beyond NumClockTS");
+
+    return testResult("test_timecode");
+}
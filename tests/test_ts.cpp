@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "nal_ts.h"
+#include "test_util.h"
+
+// Access units of the elementary stream the transport stream was made from
+static std::vector<access_unit> reference(std::vector<unsigned char> es)
+{
+    const int size = static_cast<int>(es.size());
+    es.resize(es.size() + 16, 0);
+    AccessUnitAssembler assembler(videoCodecType::H264_AVC, parsingLevel::PARSING_SLICE_PREFIX);
+    std::vector<access_unit> aus;
+    assembler.assemble(es.data(), size, aus);
+
+    // The last NAL unit is given up to the end of the padded buffer
+    if (!aus.empty() && !aus.back().nals.empty())
+    {
+        au_nal &last = aus.back().nals.back();
+        const uint32_t clamped = static_cast<uint32_t>(size - last.offset);
+        aus.back().size -= last.size - clamped;
+        last.size = clamped;
+    }
+    return aus;
+}
+
+static bool sameNals(const access_unit &au, const access_unit &ref, int64_t shift)
+{
+    if (au.size != ref.size || au.nals.size() != ref.nals.size())
+        return false;
+    for (size_t i = 0; i < au.nals.size(); i++)
+    {
+        if (au.nals[i].nalUnitType != ref.nals[i].nalUnitType || au.nals[i].size != ref.nals[i].size ||
+            au.nals[i].offset + shift != ref.nals[i].offset)
+            return false;
+    }
+    return au.offset + shift == ref.offset;
+}
+
+// small.ts carries small.264 (100 access units, IDR every 25) in one PES packet per access unit, with the last start code
+// of every access unit split after its two zero bytes, no PTS in the PES packet of access unit 10 and the last TS packet
+// of access unit 50 (its IDR slice) missing
+static void checkDemux(const std::vector<unsigned char> &ts, const std::vector<access_unit> &ref, size_t chunk)
+{
+    const std::string label = " (chunk " + std::to_string(chunk) + ")";
+    TsDemuxer demuxer;
+    std::vector<access_unit> aus;
+    for (size_t pos = 0; pos < ts.size(); pos += chunk)
+    {
+        // Copied so that pieces left in the caller's buffer would be caught
+        std::vector<unsigned char> piece(ts.begin() + pos, ts.begin() + std::min(pos + chunk, ts.size()));
+        demuxer.push(piece.data(), piece.size(), aus);
+    }
+    demuxer.flush(aus);
+
+    const ts_stats &stats = demuxer.stats();
+    expect(demuxer.codecType() == videoCodecType::H264_AVC, "codec" + label);
+    expect(demuxer.pid() == 0x100, "pid" + label);
+    expect(stats.continuityErrors == 1, "continuity errors" + label);
+    expect(stats.pesPackets == 100, "PES packets" + label);
+    expect(aus.size() == 99, "access units" + label + " : " + std::to_string(aus.size()));
+    if (aus.size() != 99 || ref.size() != 100)
+        return;
+
+    for (size_t i = 0; i < 50; i++)
+    {
+        const std::string au = " of access unit " + std::to_string(i) + label;
+        expect(sameNals(aus[i], ref[i], 0), "NAL units" + au);
+        expect(aus[i].poc == ref[i].poc, "POC" + au);
+        const int64_t pts = i == 10 ? -1 : 90000 + 3003 * static_cast<int64_t>(ref[i].poc);
+        const int64_t dts = i == 10 ? -1 : 90000 + 3003 * static_cast<int64_t>(i);
+        expect(aus[i].pts == pts && aus[i].dts == dts, "time stamps" + au);
+    }
+
+    // The parameter sets and SEI of access unit 50 are followed by the NAL units of access unit 51
+    const access_unit &merged = aus[50];
+    expect(merged.nals.size() == 5 && merged.nals[0].nalUnitType == 7 && merged.nals[1].nalUnitType == 8 &&
+               merged.nals[2].nalUnitType == 6 && merged.nals[3].nalUnitType == 6 && merged.nals[4].nalUnitType == 1,
+           "NAL units of access unit 50" + label);
+    expect(merged.pts == 90000 && merged.dts == 90000 + 3003 * 50, "time stamps of access unit 50" + label);
+
+    const int64_t shift = ref[52].offset - aus[51].offset;
+    for (size_t i = 51; i < aus.size(); i++)
+    {
+        const std::string au = " of access unit " + std::to_string(i) + label;
+        expect(sameNals(aus[i], ref[i + 1], shift), "NAL units" + au);
+        const int64_t pts = 90000 + 3003 * static_cast<int64_t>(ref[i + 1].poc);
+        const int64_t dts = 90000 + 3003 * static_cast<int64_t>(i + 1);
+        expect(aus[i].pts == pts && aus[i].dts == dts, "time stamps" + au);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string dir = argc > 1 ? argv[1] : "data";
+    const std::vector<unsigned char> es = readFile(dir + "/small.264");
+    const std::vector<unsigned char> ts = readFile(dir + "/small.ts");
+    expect(!es.empty() && !ts.empty(), "fixtures in " + dir);
+    if (es.empty() || ts.empty())
+        return 1;
+
+    const std::vector<access_unit> ref = reference(es);
+    expect(ref.size() == 100, "reference access units");
+
+    const size_t chunks[] = {ts.size(), 1, 100, 188, 569};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+        checkDemux(ts, ref, chunks[i]);
+
+    return testResult("test_ts");
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// Harness shared by the unit tests : every failed expectation is printed and counted, main() returns testResult()
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void expect(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        testFailures()++;
+    }
+}
+
+// Exit code of the test program
+inline int testResult(const char *name)
+{
+    if (testFailures())
+        return 1;
+    std::cout << name << " passed" << std::endl;
+    return 0;
+}
+
+inline std::vector<unsigned char> readFile(const std::string &path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    return std::vector<unsigned char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+inline void writeFile(const std::string &path, const std::vector<unsigned char> &bytes)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
@@ -0,0 +1,149 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nal_visitor.h"
+#include "test_streams.h"
+#include "test_util.h"
+
+// Events seen by the visitor, on_vps() and on_aps() are left to the empty defaults
+struct recorder : nal_visitor
+{
+    std::vector<int> nalTypes;
+    std::vector<int64_t> nalOffsets;
+    int spsCount = 0;
+    int ppsCount = 0;
+    std::vector<std::pair<int, test_bytes> > seis;
+    std::vector<int> frameNums;
+    std::vector<access_unit> aus;
+
+    void on_nal(const nal_info &nal, int64_t offset, uint32_t)
+    {
+        nalTypes.push_back(nal.nal_unit_type);
+        nalOffsets.push_back(offset);
+    }
+    template <typename SPS>
+    void on_sps(const nal_info &, const SPS &)
+    {
+        spsCount++;
+    }
+    template <typename PPS>
+    void on_pps(const nal_info &, const PPS &)
+    {
+        ppsCount++;
+    }
+    void on_sei(const nal_info &, const sei_view &sei)
+    {
+        seis.push_back(std::make_pair(sei.payloadType, test_bytes(sei.payload, sei.payload + sei.payloadSize)));
+    }
+    void on_slice_prefix(const nal_info &, const slice_prefix &slice) { frameNums.push_back(slice.frameNum); }
+    void on_au_end(const access_unit &au) { aus.push_back(au); }
+};
+
+// Two H264 access units : SPS, PPS, SEI of two messages and an IDR slice, then a P slice
+static std::vector<test_bytes> stream(test_bytes &payload)
+{
+    // The payload needs an emulation prevention byte, the visitor sees it without
+    const uint8_t data[] = {0x11, 0x22, 0x00, 0x00, 0x02, 0x33};
+    payload.assign(data, data + sizeof(data));
+    std::vector<std::pair<int, test_bytes> > messages;
+    messages.push_back(std::make_pair(200, payload));
+    messages.push_back(std::make_pair(300, test_bytes(2, 0x44)));
+
+    std::vector<test_bytes> nals;
+    nals.push_back(h264Sps(0, 0, 2));
+    nals.push_back(h264Pps(0, 0));
+    nals.push_back(seiNal(test_bytes(1, 6), messages));
+    nals.push_back(h264Slice(true, 7, 0, 0, 4, 0, 6));
+    nals.push_back(h264Slice(false, 5, 0, 1, 4, 2, 6));
+    return nals;
+}
+
+static void checkEvents(const recorder &r, const test_bytes &payload, const std::string &label)
+{
+    expect(r.nalTypes.size() == 5 && r.nalTypes[0] == 7 && r.nalTypes[2] == 6 && r.nalTypes[4] == 1, "NAL unit events" + label);
+    expect(r.spsCount == 1 && r.ppsCount == 1, "parameter set events" + label);
+    expect(r.seis.size() == 2, "SEI message events" + label);
+    if (r.seis.size() == 2)
+    {
+        expect(r.seis[0].first == 200 && r.seis[0].second == payload, "SEI payload without emulation prevention bytes" + label);
+        expect(r.seis[1].first == 300 && r.seis[1].second == test_bytes(2, 0x44), "SEI payloadType above 255" + label);
+    }
+    expect(r.frameNums.size() == 2 && r.frameNums[0] == 0 && r.frameNums[1] == 1, "slice prefix events" + label);
+
+    expect(r.aus.size() == 2, "access unit events" + label);
+    if (r.aus.size() != 2)
+        return;
+    expect(r.aus[0].nals.size() == 4 && r.aus[0].irap && r.aus[0].offset == 0, "first access unit" + label);
+    expect(r.aus[1].nals.size() == 1 && !r.aus[1].irap && r.aus[1].picType == sliceType::SLICE_P, "second access unit" + label);
+    expect(r.nalOffsets.size() == 5 && r.aus[1].offset == r.nalOffsets[4], "offset of the second access unit" + label);
+}
+
+static void checkByteStream()
+{
+    test_bytes payload;
+    const std::vector<test_bytes> nals = stream(payload);
+    test_bytes bytes = byteStream(nals);
+
+    recorder r;
+    NalEventParser<videoCodecType::H264_AVC, recorder> parser(r);
+    parser.parse(bytes.data(), static_cast<int>(bytes.size()));
+    expect(r.aus.size() == 1, "last access unit pending before flush()");
+    parser.flush();
+    checkEvents(r, payload, " of a byte stream");
+}
+
+static void checkSplitNals()
+{
+    test_bytes payload;
+    const std::vector<test_bytes> nals = stream(payload);
+    std::vector<nal_buffer> buffers(nals.size());
+    for (size_t i = 0; i < nals.size(); i++)
+    {
+        buffers[i].data = nals[i].data();
+        buffers[i].size = static_cast<uint32_t>(nals[i].size());
+    }
+
+    recorder r;
+    NalEventParser<videoCodecType::H264_AVC, recorder> parser(r);
+    parser.parse(buffers.data(), buffers.size());
+    parser.flush();
+    checkEvents(r, payload, " of split NAL units");
+    uint64_t firstSize = 0;
+    for (size_t i = 0; i < 4; i++)
+        firstSize += nals[i].size();
+    expect(r.aus.size() == 2 && r.aus[0].size == firstSize && r.aus[1].offset == static_cast<int64_t>(firstSize),
+           "access units of split NAL units");
+
+    // Only NAL unit and access unit events without parsing
+    recorder headers;
+    NalEventParser<videoCodecType::H264_AVC, recorder> headerParser(headers, parsingLevel::PARSING_NONE);
+    headerParser.parse(buffers.data(), buffers.size());
+    headerParser.flush();
+    expect(headers.nalTypes.size() == 5 && headers.spsCount == 0 && headers.seis.empty() && headers.frameNums.empty(),
+           "events of NAL unit headers only");
+}
+
+static void checkNextSeiMessage()
+{
+    const uint8_t rbsp[] = {0xFF, 0x01, 0x02, 0xAA, 0xBB, 0x04, 0x05, 0xCC, 0x80};
+    size_t pos = 0;
+    sei_view sei;
+    expect(NextSeiMessage(rbsp, sizeof(rbsp), pos, sei) && sei.payloadType == 256 && sei.payloadSize == 2 && sei.payload == rbsp + 3,
+           "first SEI message");
+    expect(pos == 5, "position after the first SEI message");
+    expect(!NextSeiMessage(rbsp, sizeof(rbsp), pos, sei) && pos == sizeof(rbsp), "truncated SEI message");
+
+    const uint8_t trailing[] = {0x04, 0x01, 0xDD, 0x80};
+    pos = 0;
+    expect(NextSeiMessage(trailing, sizeof(trailing), pos, sei) && pos == 3, "SEI message before the trailing bits");
+    expect(!NextSeiMessage(trailing, sizeof(trailing), pos, sei) && pos == 3, "RBSP trailing bits");
+}
+
+int main()
+{
+    checkByteStream();
+    checkSplitNals();
+    checkNextSeiMessage();
+    return testResult("test_visitor");
+}